@@ -61,14 +61,14 @@ void INA226_WE::setCorrectionFactor(float corr){
 
 void INA226_WE::setAverage(INA226_AVERAGES averages){
     deviceAverages = averages;
-    uint16_t currentConfReg = readRegister(INA226_CONF_REG);
+    uint16_t currentConfReg = confRegShadow;
     currentConfReg &= ~(0x0E00);  
     currentConfReg |= deviceAverages;
     writeRegister(INA226_CONF_REG, currentConfReg);
 }
 
 void INA226_WE::setConversionTime(INA226_CONV_TIME shuntConvTime, INA226_CONV_TIME busConvTime){
-    uint16_t currentConfReg = readRegister(INA226_CONF_REG);
+    uint16_t currentConfReg = confRegShadow;
     currentConfReg &= ~(0x01C0);  
     currentConfReg &= ~(0x0038);
     uint16_t convMask = (static_cast<uint16_t>(shuntConvTime))<<3;
@@ -84,7 +84,7 @@ void INA226_WE::setConversionTime(INA226_CONV_TIME convTime){
 
 void INA226_WE::setMeasureMode(INA226_MEASURE_MODE mode){
     deviceMeasureMode = mode;
-    uint16_t currentConfReg = readRegister(INA226_CONF_REG);
+    uint16_t currentConfReg = confRegShadow;
     currentConfReg &= ~(0x0007);
     currentConfReg |= deviceMeasureMode;
     writeRegister(INA226_CONF_REG, currentConfReg);
@@ -141,7 +141,7 @@ float INA226_WE::getBusPower(){
 
 void INA226_WE::startSingleMeasurement(){
     uint16_t val = readRegister(INA226_MASK_EN_REG); // clears CNVR (Conversion Ready) Flag
-    val = readRegister(INA226_CONF_REG);
+    val = confRegShadow;
     writeRegister(INA226_CONF_REG, val);        // Starts conversion
     uint16_t convReady = 0x0000;
     unsigned long convStart = millis();
@@ -153,12 +153,12 @@ void INA226_WE::startSingleMeasurement(){
 // Don't wait for conversion to complete
 void INA226_WE::startSingleMeasurementNoWait(){
     uint16_t val = readRegister(INA226_MASK_EN_REG); // clears CNVR (Conversion Ready) Flag
-    val = readRegister(INA226_CONF_REG);
+    val = confRegShadow;
     writeRegister(INA226_CONF_REG, val);        // Starts conversion
 }
 
 void INA226_WE::powerDown(){
-    confRegCopy = readRegister(INA226_CONF_REG);
+    confRegCopy = confRegShadow;
 #ifndef INA226_WE_COMPATIBILITY_MODE_
     setMeasureMode(POWER_DOWN);
 #else
@@ -265,6 +265,43 @@ void INA226_WE::readAndClearFlags(){
     limitAlert = (value>>4) & 0x0001;
 }
 
+bool INA226_WE::readMeasurements(INA226_RAW_VALUES &raw, bool withCurrent){
+    // The INA226 has no register auto-increment, so each register still needs
+    // its own pointer write + read. They are issued back to back without any
+    // float conversion in between; Mask/Enable goes first so the flags match
+    // the conversion that is read.
+    uint8_t err = 0;
+    raw.maskEnable = readRegister(INA226_MASK_EN_REG);
+    err |= i2cErrorCode;
+    raw.shunt = static_cast<int16_t>(readRegister(INA226_SHUNT_REG));
+    err |= i2cErrorCode;
+    raw.bus = readRegister(INA226_BUS_REG);
+    err |= i2cErrorCode;
+    raw.current = 0;
+    if (withCurrent) {
+        raw.current = static_cast<int16_t>(readRegister(INA226_CURRENT_REG));
+        err |= i2cErrorCode;
+    }
+    i2cErrorCode = err;
+
+    overflow = (raw.maskEnable & INA226_OVF) != 0;
+    convAlert = (raw.maskEnable & INA226_CVRF) != 0;
+    limitAlert = (raw.maskEnable & INA226_AFF) != 0;
+    return err == 0;
+}
+
+float INA226_WE::rawShuntToMilliVolts(int16_t raw) const {
+    return raw * 0.0025 * corrFactor;
+}
+
+float INA226_WE::rawBusToVolts(uint16_t raw) const {
+    return raw * 0.00125;
+}
+
+float INA226_WE::rawCurrentToMilliAmps(int16_t raw) const {
+    return raw / currentDivider_mA;
+}
+
 uint8_t INA226_WE::getI2cErrorCode(){
     return i2cErrorCode;
 }
@@ -275,6 +312,11 @@ uint8_t INA226_WE::getI2cErrorCode(){
 *************************************************/
 
 void INA226_WE::writeRegister(uint8_t reg, uint16_t val){
+  if (reg == INA226_CONF_REG) {
+    // A reset returns the register to its power-on default
+    confRegShadow = (val & INA226_RST) ? INA226_CONF_DEFAULT : val;
+  }
+  i2cTransactions++;
   _wire->beginTransmission(i2cAddress);
   uint8_t lVal = val & 255;
   uint8_t hVal = val >> 8;
@@ -287,6 +329,7 @@ void INA226_WE::writeRegister(uint8_t reg, uint16_t val){
 uint16_t INA226_WE::readRegister(uint8_t reg) const {
   uint8_t MSByte = 0, LSByte = 0;
   uint16_t regValue = 0;
+  i2cTransactions++;
   _wire->beginTransmission(i2cAddress);
   _wire->write(reg);
   i2cErrorCode = _wire->endTransmission(false);
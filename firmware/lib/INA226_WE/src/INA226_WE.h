@@ -79,6 +79,14 @@ typedef enum INA226_CURRENT_RANGE{ // Deprecated, but left for downward compatib
     MA_800
 } currentRange;
 
+// Raw register contents of one measurement, as returned by readMeasurements()
+struct INA226_RAW_VALUES{
+    uint16_t maskEnable;    // flags (AFF, CVRF, OVF) - reading clears them
+    int16_t shunt;          // LSB 2.5 uV
+    uint16_t bus;           // LSB 1.25 mV
+    int16_t current;        // LSB = current LSB set by calibration (0 if skipped)
+};
+
 class INA226_WE
 {
 public:
@@ -101,6 +109,7 @@ public:
 
         /* parameters, flag bits */
         static constexpr uint16_t INA226_RST        {0x8000}; //Reset 
+        static constexpr uint16_t INA226_CNVR       {0x0400}; //Conversion ready alert enable
         static constexpr uint16_t INA226_AFF        {0x0010}; //Alert function flag
         static constexpr uint16_t INA226_CVRF       {0x0008}; //Conversion ready flag
         static constexpr uint16_t INA226_OVF        {0x0004}; //Overflow flags
@@ -108,10 +117,11 @@ public:
         //Latch enable - if set then alert flag remains until mask/enable register is read
         //if not set then flag is cleared after next conversion within limits
         static constexpr uint16_t INA226_LATCH_EN   {0x0001}; 
+        static constexpr uint16_t INA226_CONF_DEFAULT {0x4127}; //Config register value after reset
 
         // Constructors: if not passed, 0x40 / Wire will be set as address / wire object
-        INA226_WE(const int addr = 0x40) : _wire{&Wire}, i2cAddress{addr} {}
-        INA226_WE(TwoWire *w, const int addr = 0x40) : _wire{w}, i2cAddress{addr} {}
+        INA226_WE(const int addr = 0x40) : _wire{&Wire}, i2cAddress{addr}, confRegShadow{INA226_CONF_DEFAULT}, i2cTransactions{0} {}
+        INA226_WE(TwoWire *w, const int addr = 0x40) : _wire{w}, i2cAddress{addr}, confRegShadow{INA226_CONF_DEFAULT}, i2cTransactions{0} {}
                 
         bool init();
         void reset_INA226();
@@ -139,6 +149,14 @@ public:
         void enableConvReadyAlert();
         void setAlertType(INA226_ALERT_TYPE type, float limit);
         void readAndClearFlags();
+        // Reads Mask/Enable, shunt, bus and (optionally) current back to back
+        // and updates the flag members. Returns false on an I2C error.
+        bool readMeasurements(INA226_RAW_VALUES &raw, bool withCurrent = true);
+        float rawShuntToMilliVolts(int16_t raw) const;
+        float rawBusToVolts(uint16_t raw) const;
+        float rawCurrentToMilliAmps(int16_t raw) const;
+        uint16_t getConfigRegister() const { return confRegShadow; }
+        uint32_t getI2cTransactionCount() const { return i2cTransactions; }
         uint8_t getI2cErrorCode();
         bool overflow;
         bool convAlert;
@@ -157,6 +175,8 @@ public:
         uint16_t calVal;
         float corrFactor;
         uint16_t confRegCopy;
+        uint16_t confRegShadow;     // last value written to CONF, saves read-modify-write
+        mutable uint32_t i2cTransactions;
         float currentDivider_mA;
         float pwrMultiplier_mW;
         mutable uint8_t i2cErrorCode;
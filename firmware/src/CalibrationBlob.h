@@ -0,0 +1,104 @@
+#ifndef CALIBRATION_BLOB_H
+#define CALIBRATION_BLOB_H
+
+#include <Preferences.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Calibration tables stored as one NVS blob per table instead of one key per
+// value. Layout: a small header (format version, point size, point count,
+// CRC-32) followed by the points exactly as they sit in memory. The CRC covers
+// the header with its crc field zeroed plus the points, so a torn write or a
+// blob written by an incompatible build reads back as "no table".
+//
+// Persistent counters use the same format as a one-point table (N = 1).
+namespace CalibrationBlob {
+
+constexpr uint8_t VERSION = 1;
+
+struct Header {
+    uint8_t version;
+    uint8_t pointSize;
+    uint16_t count;
+    uint32_t crc;
+};
+
+// CRC-32 (IEEE, reflected). Bitwise: tables are read once at boot.
+inline uint32_t crc32(const uint8_t *data, size_t len, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+template <typename T>
+uint32_t checksum(Header hdr, const T *points, size_t n) {
+    hdr.crc = 0;
+    uint32_t crc = crc32(reinterpret_cast<const uint8_t *>(&hdr), sizeof(hdr));
+    return crc32(reinterpret_cast<const uint8_t *>(points), n * sizeof(T), crc);
+}
+
+// Write n points under key with a single putBytes(). Returns false if the
+// write did not store the whole blob.
+template <typename T, size_t N>
+bool write(Preferences &prefs, const char *key, const T *points, size_t n) {
+    static_assert(sizeof(T) < 256, "point type too large for the blob header");
+    static_assert(sizeof(Header) % alignof(T) == 0, "points must follow the header unpadded");
+    if (n > N) {
+        return false;
+    }
+    struct {
+        Header hdr;
+        T points[N];
+    } blob;
+    blob.hdr.version = VERSION;
+    blob.hdr.pointSize = sizeof(T);
+    blob.hdr.count = (uint16_t)n;
+    memcpy(blob.points, points, n * sizeof(T));
+    blob.hdr.crc = checksum(blob.hdr, blob.points, n);
+
+    const size_t len = sizeof(Header) + n * sizeof(T);
+    return prefs.putBytes(key, &blob, len) == len;
+}
+
+// Read a blob written by write() into out (room for N points). Returns the
+// number of points, or 0 when the key is missing, has the wrong version or
+// point size, or fails the CRC. `found` tells a missing key (false) apart from
+// a present but rejected one.
+template <typename T, size_t N>
+size_t read(Preferences &prefs, const char *key, T *out, bool &found) {
+    found = false;
+    const size_t len = prefs.getBytesLength(key);
+    if (len == 0) {
+        return 0;
+    }
+    found = true;
+    if (len < sizeof(Header) || len > sizeof(Header) + N * sizeof(T)) {
+        return 0;
+    }
+
+    struct {
+        Header hdr;
+        T points[N];
+    } blob;
+    if (prefs.getBytes(key, &blob, len) != len) {
+        return 0;
+    }
+    const Header &hdr = blob.hdr;
+    if (hdr.version != VERSION || hdr.pointSize != sizeof(T) ||
+        len != sizeof(Header) + hdr.count * sizeof(T) ||
+        hdr.crc != checksum(hdr, blob.points, hdr.count)) {
+        return 0;
+    }
+    memcpy(out, blob.points, hdr.count * sizeof(T));
+    return hdr.count;
+}
+
+} // namespace CalibrationBlob
+
+#endif // CALIBRATION_BLOB_H
@@ -2,39 +2,70 @@
 #define CIRCULAR_BUFFER_H
 
 #include <Arduino.h>
+#include <cmath>
+#include <type_traits>
 
-template <typename T, size_t Size>
+// Fixed-size ring of the last Size values with O(1) aggregates.
+//
+// The sum is kept up to date on every push() instead of being recomputed on
+// each call; for floating point it uses Neumaier compensated summation so
+// adding and evicting values for months does not drift away from the true
+// sum. With TrackExtremes, min() and max() are maintained too; the window is
+// rescanned only when the evicted value was the current extreme.
+//
+// The storage layout (buffer, head, count) is unchanged from the plain ring so
+// RTC/NVS snapshots taken through getBuffer() stay compatible.
+template <typename T, size_t Size, bool TrackExtremes = false>
 class CircularBuffer {
+    static_assert(Size > 0, "CircularBuffer needs at least one slot");
+
 public:
-    CircularBuffer() : head(0), count(0) {
-        memset(buffer, 0, sizeof(buffer));
+    CircularBuffer() {
+        clear();
     }
 
     void push(T value) {
-        buffer[head] = value;
-        head = (head + 1) % Size;
-        if (count < Size) count++;
+        if (count == Size) {
+            const T evicted = buffer[head];
+            buffer[head] = value;
+            accumulate(-evicted);
+            accumulate(value);
+            if (TrackExtremes) {
+                updateExtremes(value, evicted);
+            }
+        } else {
+            buffer[head] = value;
+            count++;
+            accumulate(value);
+            if (TrackExtremes) {
+                updateExtremes(value);
+            }
+        }
+        head = next(head);
     }
 
     T sum() const {
-        T total = 0;
-        for (size_t i = 0; i < count; i++) {
-            total += buffer[i];
-        }
-        return total;
+        return total + compensation;
+    }
+
+    // Smallest/largest value in the window (0 when empty); needs TrackExtremes
+    T min() const {
+        static_assert(TrackExtremes, "min() needs TrackExtremes");
+        return count ? lowest : T(0);
+    }
+
+    T max() const {
+        static_assert(TrackExtremes, "max() needs TrackExtremes");
+        return count ? highest : T(0);
     }
-    
-    // Add value to the current head without advancing (for accumulating partials)
-    // Actually, for this specific use case, we might want to just overwrite or add.
-    // The requirement is "fed from left to right". 
-    // Minute buffer: Push 1-min total.
-    
+
     void clear() {
         head = 0;
         count = 0;
         memset(buffer, 0, sizeof(buffer));
+        resetAggregates();
     }
-    
+
     // Fill buffer with value (useful for restoring from persistence if simplified)
     void fill(T* values, size_t amount) {
         clear();
@@ -42,24 +73,97 @@ public:
             push(values[i]);
         }
     }
-    
+
     // Access raw buffer for NVS/RTC persistence
     const T* getBuffer() const { return buffer; }
     size_t getHead() const { return head; }
     size_t getCount() const { return count; }
-    
+
     // Restore state
     void restore(const T* values, size_t storedHead, size_t storedCount) {
         if (storedCount > Size) storedCount = Size;
         memcpy(buffer, values, sizeof(T) * Size); // Copy full buffer just in case
-        head = storedHead % Size;
         count = storedCount;
+        if (count < Size) {
+            // A ring that has not wrapped yet fills slots 0..count-1 in order
+            head = count;
+            memset(buffer + count, 0, sizeof(T) * (Size - count));
+        } else {
+            head = storedHead % Size;
+        }
+        recompute();
     }
 
 private:
+    static constexpr bool POWER_OF_TWO = (Size & (Size - 1)) == 0;
+
+    static size_t next(size_t i) {
+        if (POWER_OF_TWO) {
+            return (i + 1) & (Size - 1);
+        }
+        return (i + 1 == Size) ? 0 : i + 1;
+    }
+
+    void accumulate(T value) {
+        if constexpr (std::is_floating_point<T>::value) {
+            // Neumaier: keep the low-order bits lost by total in compensation
+            const T t = total + value;
+            if (std::fabs(total) >= std::fabs(value)) {
+                compensation += (total - t) + value;
+            } else {
+                compensation += (value - t) + total;
+            }
+            total = t;
+        } else {
+            total += value;
+        }
+    }
+
+    void updateExtremes(T value) {
+        if (count == 1 || value < lowest) lowest = value;
+        if (count == 1 || value > highest) highest = value;
+    }
+
+    void updateExtremes(T value, T evicted) {
+        if ((evicted == lowest && value > lowest) || (evicted == highest && value < highest)) {
+            scanExtremes();
+            return;
+        }
+        updateExtremes(value);
+    }
+
+    void scanExtremes() {
+        lowest = highest = buffer[0];
+        for (size_t i = 1; i < count; i++) {
+            if (buffer[i] < lowest) lowest = buffer[i];
+            if (buffer[i] > highest) highest = buffer[i];
+        }
+    }
+
+    void resetAggregates() {
+        total = T(0);
+        compensation = T(0);
+        lowest = T(0);
+        highest = T(0);
+    }
+
+    void recompute() {
+        resetAggregates();
+        for (size_t i = 0; i < count; i++) {
+            accumulate(buffer[i]);
+        }
+        if (TrackExtremes && count > 0) {
+            scanExtremes();
+        }
+    }
+
     T buffer[Size];
     size_t head;
     size_t count;
+    T total;
+    T compensation; // always 0 for integer T
+    T lowest;
+    T highest;
 };
 
 #endif
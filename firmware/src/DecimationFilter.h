@@ -0,0 +1,81 @@
+#ifndef DECIMATION_FILTER_H
+#define DECIMATION_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-point oversampling filter for raw ADC register counts.
+//
+// Stage 1 is a boxcar (first-order CIC) that sums `decimation` input samples
+// and dumps one output. Stage 2 is a 5-tap binomial FIR (1 4 6 4 1)/16 on the
+// decimated stream to knock down what the boxcar's sinc response lets
+// through. Outputs carry FRAC_BITS extra fractional bits, so averaging N
+// noisy samples resolves below one register LSB.
+//
+// Integer only, no heap: per input sample it is one add and one compare.
+class DecimationFilter {
+public:
+    static constexpr uint8_t FRAC_BITS = 8;
+    static constexpr uint8_t MAX_DECIMATION = 64;
+    static constexpr size_t FIR_TAPS = 5;
+
+    explicit DecimationFilter(uint8_t decimation = 4) { setDecimation(decimation); }
+
+    // Output rate = input rate / decimation. Resets the filter state.
+    void setDecimation(uint8_t decimation) {
+        if (decimation < 1) decimation = 1;
+        if (decimation > MAX_DECIMATION) decimation = MAX_DECIMATION;
+        factor = decimation;
+        reset();
+    }
+    uint8_t getDecimation() const { return factor; }
+
+    void reset() {
+        sum = 0;
+        count = 0;
+        firHead = 0;
+        primed = false;
+        for (size_t i = 0; i < FIR_TAPS; i++) history[i] = 0;
+    }
+
+    // Feed one raw sample. Returns true and sets `out` (input units scaled by
+    // 2^FRAC_BITS) every `decimation` samples.
+    bool push(int32_t raw, int32_t &out) {
+        sum += raw;
+        if (++count < factor) {
+            return false;
+        }
+
+        const int32_t boxcar = (int32_t)(((int64_t)sum << FRAC_BITS) / factor);
+        sum = 0;
+        count = 0;
+
+        if (!primed) {
+            // Start from a settled FIR instead of ramping up from zero
+            for (size_t i = 0; i < FIR_TAPS; i++) history[i] = boxcar;
+            primed = true;
+        }
+        history[firHead] = boxcar;
+        firHead = (firHead + 1) % FIR_TAPS;
+
+        static constexpr int32_t coeffs[FIR_TAPS] = {1, 4, 6, 4, 1};
+        int64_t acc = 0;
+        for (size_t i = 0; i < FIR_TAPS; i++) {
+            acc += (int64_t)coeffs[i] * history[(firHead + i) % FIR_TAPS];
+        }
+        out = (int32_t)(acc / 16);
+        return true;
+    }
+
+    bool isPrimed() const { return primed; }
+
+private:
+    int32_t sum;
+    uint8_t count;
+    uint8_t factor;
+    int32_t history[FIR_TAPS];
+    size_t firHead;
+    bool primed;
+};
+
+#endif // DECIMATION_FILTER_H
@@ -0,0 +1,94 @@
+#ifndef PIECEWISE_LINEAR_H
+#define PIECEWISE_LINEAR_H
+
+#include <stddef.h>
+
+// Fixed-capacity piecewise-linear interpolation, shared by the INA226 current
+// calibration and the GPIO starter-voltage calibration.
+//
+// Points live in member arrays (no heap) and must be sorted by ascending x.
+// The slope of every segment is computed once in assign(), so evaluate() is
+// a binary search plus one multiply-add. Inputs at or beyond either end clamp
+// to that end's y.
+template <size_t N>
+class PiecewiseLinear {
+    static_assert(N >= 2, "PiecewiseLinear needs room for at least two points");
+
+public:
+    struct Point {
+        float x;
+        float y;
+    };
+
+    PiecewiseLinear() : count(0) {}
+
+    // Load `n` sorted points, reading x and y through the accessors so tables
+    // of any point struct (including constexpr arrays) can be used directly.
+    // Returns false and leaves the curve empty when n exceeds the capacity.
+    template <typename T, typename GetX, typename GetY>
+    bool assign(const T *pts, size_t n, GetX getX, GetY getY) {
+        count = 0;
+        if (n > N) {
+            return false;
+        }
+        for (size_t i = 0; i < n; i++) {
+            xs[i] = (float)getX(pts[i]);
+            ys[i] = (float)getY(pts[i]);
+        }
+        count = n;
+        for (size_t i = 1; i < count; i++) {
+            const float dx = xs[i] - xs[i - 1];
+            // Zero-width segments should not occur in a sorted, deduplicated
+            // table; hold the left value if one does.
+            slopes[i - 1] = (dx > -1e-9f && dx < 1e-9f) ? 0.0f : (ys[i] - ys[i - 1]) / dx;
+        }
+        return true;
+    }
+
+    bool assign(const Point *pts, size_t n) {
+        return assign(pts, n, [](const Point &p) { return p.x; },
+                      [](const Point &p) { return p.y; });
+    }
+
+    void clear() { count = 0; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    static constexpr size_t capacity() { return N; }
+    Point point(size_t i) const { return {xs[i], ys[i]}; }
+
+    // Interpolated y for x. With fewer than two points there is no curve and
+    // x is returned unchanged.
+    float evaluate(float x) const {
+        if (count < 2) {
+            return x;
+        }
+        if (x <= xs[0]) {
+            return ys[0];
+        }
+        if (x >= xs[count - 1]) {
+            return ys[count - 1];
+        }
+
+        // First point with xs[hi] > x; the segment starts at hi - 1
+        size_t lo = 1, hi = count - 1;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            if (x < xs[mid]) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        const size_t seg = hi - 1;
+        return ys[seg] + (x - xs[seg]) * slopes[seg];
+    }
+
+private:
+    float xs[N];
+    float ys[N];
+    float slopes[N - 1];
+    size_t count;
+};
+
+#endif // PIECEWISE_LINEAR_H
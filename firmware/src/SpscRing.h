@@ -0,0 +1,61 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free single-producer / single-consumer ring.
+// One task may call push(), one other task may call pop(); no other locking
+// is needed. Size must be a power of two so indices wrap with a mask.
+template <typename T, size_t Size>
+class SpscRing {
+    static_assert(Size >= 2 && (Size & (Size - 1)) == 0,
+                  "SpscRing size must be a power of two");
+
+public:
+    SpscRing() : head(0), tail(0), dropped(0) {}
+
+    // Producer side. Returns false (and counts a drop) when the consumer has
+    // fallen a full ring behind; the producer never blocks.
+    bool push(const T &value) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= Size) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer[h & (Size - 1)] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    bool pop(T &out) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = buffer[t & (Size - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t available() const {
+        return head.load(std::memory_order_acquire) -
+               tail.load(std::memory_order_acquire);
+    }
+
+    uint32_t getDropped() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t capacity() { return Size; }
+
+private:
+    T buffer[Size];
+    std::atomic<size_t> head; // written by the producer only
+    std::atomic<size_t> tail; // written by the consumer only
+    std::atomic<uint32_t> dropped;
+};
+
+#endif
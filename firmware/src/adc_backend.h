@@ -0,0 +1,21 @@
+#ifndef ADC_BACKEND_H
+#define ADC_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Source of raw ADC conversions for one analog pin. Implementations sample
+// continuously in the background; readSamples() hands over whatever has
+// been converted since the last call without blocking.
+class AdcBackend {
+public:
+    virtual ~AdcBackend() {}
+
+    virtual bool begin(int pin) = 0;
+
+    // Copy up to maxSamples pending raw conversions into out, oldest first.
+    // Returns the number copied; 0 when nothing new is available.
+    virtual size_t readSamples(uint16_t* out, size_t maxSamples) = 0;
+};
+
+#endif // ADC_BACKEND_H
@@ -36,6 +36,9 @@ const char* BLEHandler::TEMP_SENSOR_DATA_CHAR_UUID = "ACDC1234-5678-90AB-CDEF-12
 const char* BLEHandler::TPMS_DATA_CHAR_UUID        = "ACDC1234-5678-90AB-CDEF-1234567890CF"; // TPMS Pressures
 const char* BLEHandler::TPMS_CONFIG_CHAR_UUID      = "ACDC1234-5678-90AB-CDEF-1234567890D1"; // TPMS Config Backup/Restore
 const char* BLEHandler::GAUGE_STATUS_CHAR_UUID     = "ACDC1234-5678-90AB-CDEF-1234567890D0"; // Gauge Status
+const char* BLEHandler::HISTORY_CHAR_UUID          = "ACDC1234-5678-90AB-CDEF-1234567890D2"; // V/I/P/SOC History Pages
+const char* BLEHandler::LIFETIME_CHAR_UUID         = "ACDC1234-5678-90AB-CDEF-1234567890D3"; // Lifetime Ah/Wh In/Out
+const char* BLEHandler::HEALTH_CHAR_UUID           = "ACDC1234-5678-90AB-CDEF-1234567890D4"; // Cycles / Capacity / SOH / R int
 
 // --- New OTA Service UUIDs ---
 const char* BLEHandler::OTA_SERVICE_UUID = "1a89b148-b4e8-43d7-952b-a0b4b01e43b3";
@@ -264,6 +267,17 @@ void BLEHandler::setTpmsConfigCallback(std::function<void(std::vector<uint8_t>)>
     this->tpmsConfigCallback = callback;
 }
 
+void BLEHandler::setHistoryRequestCallback(std::function<void(std::vector<uint8_t>)> callback) {
+    this->historyRequestCallback = callback;
+}
+
+void BLEHandler::updateHistoryPage(const uint8_t* data, size_t length) {
+    if (pHistoryCharacteristic) {
+        pHistoryCharacteristic->setValue(data, length);
+        pHistoryCharacteristic->notify();
+    }
+}
+
 void BLEHandler::setCloudConfigCallback(std::function<void(bool)> callback) {
     this->cloudConfigCallback = callback;
 }
@@ -549,6 +563,32 @@ void BLEHandler::begin(const Telemetry& initial_telemetry) {
     uint8_t initGaugeStatus[5] = {0};
     pGaugeStatusCharacteristic->setValue(initGaugeStatus, 5);
 
+    // History pages (request tier/offset, read or notify the packed page)
+    pHistoryCharacteristic = pService->createCharacteristic(
+        HISTORY_CHAR_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::NOTIFY
+    );
+    pHistoryCharacteristic->setCallbacks(new ByteVectorCharacteristicCallbacks([this](std::vector<uint8_t> data){
+        if (historyRequestCallback) historyRequestCallback(data);
+    }));
+
+    // Lifetime counters (float Ah in, Ah out, Wh in, Wh out = 16 bytes)
+    pLifetimeCharacteristic = pService->createCharacteristic(
+        LIFETIME_CHAR_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY
+    );
+    uint8_t initLifetime[16] = {0};
+    pLifetimeCharacteristic->setValue(initLifetime, 16);
+
+    // Health (float equivalent cycles, usable capacity Ah, SOH %,
+    // internal resistance mOhm = 16 bytes)
+    pHealthCharacteristic = pService->createCharacteristic(
+        HEALTH_CHAR_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY
+    );
+    uint8_t initHealth[16] = {0};
+    pHealthCharacteristic->setValue(initHealth, 16);
+
 
     // Cloud Config
     pCloudConfigCharacteristic = pService->createCharacteristic(
@@ -734,6 +774,24 @@ void BLEHandler::updateTelemetry(const Telemetry& telemetry) {
     pGaugeStatusCharacteristic->setValue(gaugeBuf, 5);
     pGaugeStatusCharacteristic->notify();
 
+    // Update Lifetime Counters (4 floats = 16 bytes)
+    uint8_t lifetimeBuf[16];
+    memcpy(&lifetimeBuf[0], &telemetry.lifetimeAhIn, 4);
+    memcpy(&lifetimeBuf[4], &telemetry.lifetimeAhOut, 4);
+    memcpy(&lifetimeBuf[8], &telemetry.lifetimeWhIn, 4);
+    memcpy(&lifetimeBuf[12], &telemetry.lifetimeWhOut, 4);
+    pLifetimeCharacteristic->setValue(lifetimeBuf, 16);
+    pLifetimeCharacteristic->notify();
+
+    // Update Health (4 floats = 16 bytes)
+    uint8_t healthBuf[16];
+    memcpy(&healthBuf[0], &telemetry.equivalentCycles, 4);
+    memcpy(&healthBuf[4], &telemetry.usableCapacityAh, 4);
+    memcpy(&healthBuf[8], &telemetry.stateOfHealth, 4);
+    memcpy(&healthBuf[12], &telemetry.internalResistanceMilliOhm, 4);
+    pHealthCharacteristic->setValue(healthBuf, 16);
+    pHealthCharacteristic->notify();
+
     // Conditional advertising restart
     bool dataChanged = (fabsf(telemetry.batteryVoltage - lastAdvVoltage) > 0.05f) || 
                        (telemetry.errorState != lastAdvErrorState) || 
@@ -40,6 +40,16 @@ struct Telemetry {
     // Gauge
     uint32_t gaugeLastRx;
     bool gaugeLastTxSuccess;
+    // Lifetime throughput
+    float lifetimeAhIn;
+    float lifetimeAhOut;
+    float lifetimeWhIn;
+    float lifetimeWhOut;
+    // Cycling and health
+    float equivalentCycles;
+    float usableCapacityAh;
+    float stateOfHealth;
+    float internalResistanceMilliOhm;
 };
 
 
@@ -68,6 +78,10 @@ public:
     void setPairingCallback(std::function<void(String)> callback);
     void setEfuseLimitCallback(std::function<void(float)> callback);
     void setTpmsConfigCallback(std::function<void(std::vector<uint8_t>)> callback);
+    // Write: tier (uint8) + offset (uint16 LE, buckets back from the newest).
+    // The callback answers with updateHistoryPage(), which is then notified.
+    void setHistoryRequestCallback(std::function<void(std::vector<uint8_t>)> callback);
+    void updateHistoryPage(const uint8_t* data, size_t length);
     void setCloudConfigCallback(std::function<void(bool)> callback);
     void setMqttBrokerCallback(std::function<void(String)> callback);
     void setMqttAuthCallback(std::function<void(String, String)> callback);
@@ -112,6 +126,9 @@ public:
     static const char* TPMS_DATA_CHAR_UUID;
     static const char* TPMS_CONFIG_CHAR_UUID;
     static const char* GAUGE_STATUS_CHAR_UUID;
+    static const char* HISTORY_CHAR_UUID;
+    static const char* LIFETIME_CHAR_UUID;
+    static const char* HEALTH_CHAR_UUID;
     static const char* CLOUD_CONFIG_CHAR_UUID; // New
     static const char* CLOUD_STATUS_CHAR_UUID; // New
     static const char* MQTT_BROKER_CHAR_UUID; // New
@@ -159,6 +176,9 @@ private:
     BLECharacteristic* pTpmsDataCharacteristic;
     BLECharacteristic* pTpmsConfigCharacteristic;
     BLECharacteristic* pGaugeStatusCharacteristic;
+    BLECharacteristic* pHistoryCharacteristic;
+    BLECharacteristic* pLifetimeCharacteristic;
+    BLECharacteristic* pHealthCharacteristic;
     BLECharacteristic* pCloudConfigCharacteristic;
     BLECharacteristic* pCloudStatusCharacteristic;
     BLECharacteristic* pMqttBrokerCharacteristic;
@@ -187,6 +207,7 @@ private:
     std::function<void(String)> pairingCallback;
     std::function<void(float)> efuseLimitCallback;
     std::function<void(std::vector<uint8_t>)> tpmsConfigCallback;
+    std::function<void(std::vector<uint8_t>)> historyRequestCallback;
     std::function<void(bool)> cloudConfigCallback;
     std::function<void(String)> mqttBrokerCallback;
     std::function<void(String, String)> mqttAuthCallback;
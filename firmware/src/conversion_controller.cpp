@@ -0,0 +1,97 @@
+#include "conversion_controller.h"
+#include <math.h>
+
+const char* conversionProfileName(ConversionProfile profile) {
+    switch (profile) {
+        case PROFILE_FAST:   return "FAST";
+        case PROFILE_ACTIVE: return "ACTIVE";
+        case PROFILE_REST:   return "REST";
+        default:             return "?";
+    }
+}
+
+ConversionController::ConversionController() : ConversionController(Config()) {}
+
+ConversionController::ConversionController(const Config& config) : cfg(config) {
+    reset();
+}
+
+void ConversionController::reset(ConversionProfile start) {
+    profile = start;
+    primed = false;
+    lastCurrentA = 0.0f;
+    lastTimestamp_us = 0;
+    mean = 0.0f;
+    variance = 0.0f;
+    lastSlope_Aps = 0.0f;
+    fastUntil_us = 0;
+    slowerSince_us = -1;
+    switchCount = 0;
+}
+
+float ConversionController::getStdDev_A() const {
+    return sqrtf(variance);
+}
+
+ConversionProfile ConversionController::targetFor(float stdDevA) const {
+    if (stdDevA >= cfg.fastStdDevA) return PROFILE_FAST;
+    if (stdDevA >= cfg.activeStdDevA) return PROFILE_ACTIVE;
+    return PROFILE_REST;
+}
+
+bool ConversionController::update(float currentA, int64_t timestamp_us) {
+    if (!primed) {
+        primed = true;
+        lastCurrentA = currentA;
+        lastTimestamp_us = timestamp_us;
+        mean = currentA;
+        variance = 0.0f;
+        return false;
+    }
+
+    const int64_t dt_us = timestamp_us - lastTimestamp_us;
+    if (dt_us <= 0) {
+        return false;
+    }
+    const float dtS = dt_us / 1e6f;
+    const float delta = currentA - lastCurrentA;
+    lastSlope_Aps = delta / dtS;
+    lastCurrentA = currentA;
+    lastTimestamp_us = timestamp_us;
+
+    // Time-based EWMA so the statistics mean the same at every sample rate
+    const float alpha = dtS / (cfg.varianceTauS + dtS);
+    const float diff = currentA - mean;
+    mean += alpha * diff;
+    variance = (1.0f - alpha) * (variance + alpha * diff * diff);
+
+    ConversionProfile target = targetFor(getStdDev_A());
+    if (fabsf(delta) >= cfg.stepThresholdA) {
+        fastUntil_us = timestamp_us + cfg.fastHoldUs;
+    }
+    if (timestamp_us < fastUntil_us) {
+        target = PROFILE_FAST;
+    }
+
+    ConversionProfile next = profile;
+    if (target < profile) {
+        next = target; // speed up immediately
+        slowerSince_us = -1;
+    } else if (target > profile) {
+        if (slowerSince_us < 0) {
+            slowerSince_us = timestamp_us;
+        } else if (timestamp_us - slowerSince_us >= cfg.dwellUs) {
+            next = static_cast<ConversionProfile>(profile + 1);
+            slowerSince_us = timestamp_us; // dwell again before the next step
+        }
+    } else {
+        slowerSince_us = -1;
+    }
+
+    if (next != profile) {
+        profile = next;
+        switchCount++;
+        return true;
+    }
+    return false;
+}
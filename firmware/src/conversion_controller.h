@@ -0,0 +1,64 @@
+#ifndef CONVERSION_CONTROLLER_H
+#define CONVERSION_CONTROLLER_H
+
+#include <stdint.h>
+
+// Conversion profiles, fastest first. INA226_ADC maps each one to an
+// averaging count / conversion time pair.
+enum ConversionProfile : uint8_t {
+    PROFILE_FAST = 0,   // load steps, cranking
+    PROFILE_ACTIVE,     // varying load
+    PROFILE_REST,       // steady or idle battery, longest averaging
+    PROFILE_COUNT
+};
+
+const char* conversionProfileName(ConversionProfile profile);
+
+// Picks a conversion profile from the recent slope and variance of the
+// battery current. Pure logic so it can be tested natively.
+//
+// - A step larger than stepThresholdA between two samples jumps straight to
+//   PROFILE_FAST and holds it for fastHoldUs.
+// - Otherwise the target follows the EWMA standard deviation of the current.
+// - Moving to a faster profile is immediate; moving to a slower one happens
+//   one level at a time after the target has been slower for dwellUs.
+class ConversionController {
+public:
+    struct Config {
+        float stepThresholdA = 2.0f;
+        float activeStdDevA = 0.5f;  // above: at least ACTIVE
+        float fastStdDevA = 3.0f;    // above: FAST
+        float varianceTauS = 2.0f;   // EWMA time constant for mean/variance
+        uint32_t fastHoldUs = 2000000;
+        uint32_t dwellUs = 5000000;
+    };
+
+    ConversionController();
+    explicit ConversionController(const Config& config);
+
+    // Feed one sample. Returns true when the profile changed.
+    bool update(float currentA, int64_t timestamp_us);
+
+    ConversionProfile getProfile() const { return profile; }
+    float getStdDev_A() const;
+    float getSlope_Aps() const { return lastSlope_Aps; }
+    uint32_t getSwitchCount() const { return switchCount; }
+    void reset(ConversionProfile start = PROFILE_REST);
+
+private:
+    ConversionProfile targetFor(float stdDevA) const;
+
+    Config cfg;
+    ConversionProfile profile;
+    bool primed;
+    float lastCurrentA;
+    int64_t lastTimestamp_us;
+    float mean;
+    float variance;
+    float lastSlope_Aps;
+    int64_t fastUntil_us;
+    int64_t slowerSince_us; // -1 when the target is not slower
+    uint32_t switchCount;
+};
+
+#endif // CONVERSION_CONTROLLER_H
@@ -0,0 +1,178 @@
+#include "cycle_counter.h"
+#include "CalibrationBlob.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+constexpr double CHARGE_PC_PER_AH = 3.6e15; // 1 Ah = 3600 A*s = 3.6e15 uA*us
+} // end anonymous namespace
+
+CycleCounter::CycleCounter() {
+    reset();
+}
+
+void CycleCounter::reset() {
+    memset(&state, 0, sizeof(state));
+    state.lastMeasured_Ah = NAN;
+    state.capacity_Ah = NAN;
+}
+
+void CycleCounter::restore(const State& s) {
+    state = s;
+    if (state.residueCount > MAX_REVERSALS) {
+        state.residueCount = MAX_REVERSALS;
+    }
+}
+
+void CycleCounter::addSoc(float soc_percent) {
+    if (isnan(soc_percent)) {
+        return;
+    }
+    if (!state.primed) {
+        state.primed = true;
+        state.direction = 0;
+        state.extreme = soc_percent;
+        state.residueCount = 0;
+        pushReversal(soc_percent);
+        return;
+    }
+
+    if (state.direction == 0) {
+        // Wait for the first move away from the starting point
+        const float start = state.residue[0];
+        if (soc_percent >= start + HYSTERESIS_PERCENT) {
+            state.direction = 1;
+            state.extreme = soc_percent;
+        } else if (soc_percent <= start - HYSTERESIS_PERCENT) {
+            state.direction = -1;
+            state.extreme = soc_percent;
+        }
+        return;
+    }
+
+    if (state.direction > 0) {
+        if (soc_percent > state.extreme) {
+            state.extreme = soc_percent;
+        } else if (state.extreme - soc_percent >= HYSTERESIS_PERCENT) {
+            pushReversal(state.extreme);
+            state.direction = -1;
+            state.extreme = soc_percent;
+        }
+    } else {
+        if (soc_percent < state.extreme) {
+            state.extreme = soc_percent;
+        } else if (soc_percent - state.extreme >= HYSTERESIS_PERCENT) {
+            pushReversal(state.extreme);
+            state.direction = 1;
+            state.extreme = soc_percent;
+        }
+    }
+}
+
+void CycleCounter::pushReversal(float soc_percent) {
+    float* r = state.residue;
+    if (state.residueCount == MAX_REVERSALS) {
+        // Out of room: give up on closing the oldest range
+        countRange(fabsf(r[1] - r[0]), false);
+        memmove(&r[0], &r[1], (MAX_REVERSALS - 1) * sizeof(float));
+        state.residueCount--;
+    }
+    r[state.residueCount++] = soc_percent;
+
+    // Three-point rule: the range Y before the newest range X is a cycle
+    // once X is at least as large
+    while (state.residueCount >= 3) {
+        const size_t n = state.residueCount;
+        const float x = fabsf(r[n - 1] - r[n - 2]);
+        const float y = fabsf(r[n - 2] - r[n - 3]);
+        if (x < y) {
+            break;
+        }
+        if (n == 3) {
+            // Y contains the starting point: half a cycle
+            countRange(y, false);
+            r[0] = r[1];
+            r[1] = r[2];
+            state.residueCount = 2;
+        } else {
+            countRange(y, true);
+            r[n - 3] = r[n - 1];
+            state.residueCount = n - 2;
+        }
+    }
+}
+
+void CycleCounter::countRange(float range_percent, bool fullCycle) {
+    size_t bin = (size_t)(range_percent / (100.0f / DEPTH_BINS));
+    if (bin >= DEPTH_BINS) {
+        bin = DEPTH_BINS - 1;
+    }
+    state.halfCycles[bin] += fullCycle ? 2 : 1;
+    state.closedSwing_percent += fullCycle ? 2.0 * range_percent : range_percent;
+}
+
+float CycleCounter::getEquivalentCycles() const {
+    // A full 0-100-0 cycle is 200 % of SOC travel
+    double swing = state.closedSwing_percent;
+    for (size_t i = 1; i < state.residueCount; i++) {
+        swing += fabsf(state.residue[i] - state.residue[i - 1]);
+    }
+    if (state.residueCount > 0 && state.direction != 0) {
+        swing += fabsf(state.extreme - state.residue[state.residueCount - 1]);
+    }
+    return (float)(swing / 200.0);
+}
+
+float CycleCounter::getCycles(size_t bin) const {
+    return bin < DEPTH_BINS ? state.halfCycles[bin] / 2.0f : 0.0f;
+}
+
+void CycleCounter::addCharge(int64_t delta_pC) {
+    if (state.armed) {
+        state.sinceFull_pC += delta_pC;
+    }
+}
+
+void CycleCounter::markFull() {
+    state.armed = true;
+    state.sinceFull_pC = 0;
+}
+
+bool CycleCounter::markEmpty(float ratedCapacity_Ah) {
+    if (!state.armed) {
+        return false;
+    }
+    state.armed = false;
+
+    const float measured_Ah = (float)(-state.sinceFull_pC / CHARGE_PC_PER_AH);
+    state.lastMeasured_Ah = measured_Ah;
+    if (!(ratedCapacity_Ah > 0.0f) ||
+        measured_Ah < ratedCapacity_Ah * MIN_CAPACITY_FRACTION ||
+        measured_Ah > ratedCapacity_Ah * MAX_CAPACITY_FRACTION) {
+        return true;
+    }
+
+    if (state.measurements == 0 || isnan(state.capacity_Ah)) {
+        state.capacity_Ah = measured_Ah;
+    } else {
+        state.capacity_Ah += CAPACITY_GAIN * (measured_Ah - state.capacity_Ah);
+    }
+    state.measurements++;
+    return true;
+}
+
+float CycleCounter::getStateOfHealth_percent(float ratedCapacity_Ah) const {
+    if (isnan(state.capacity_Ah) || !(ratedCapacity_Ah > 0.0f)) {
+        return NAN;
+    }
+    return state.capacity_Ah / ratedCapacity_Ah * 100.0f;
+}
+
+bool CycleCounter::write(Preferences& prefs, const char* key, const State& s) {
+    return CalibrationBlob::write<State, 1>(prefs, key, &s, 1);
+}
+
+bool CycleCounter::read(Preferences& prefs, const char* key, State& out) {
+    bool found;
+    return CalibrationBlob::read<State, 1>(prefs, key, &out, found) == 1;
+}
@@ -0,0 +1,88 @@
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include <Preferences.h>
+#include <stdint.h>
+
+// Battery cycling and state of health, in bounded memory with no stored
+// history. Pure logic so it can be tested natively.
+//
+// Cycles: a streaming rainflow count (ASTM E1049 three-point rule) over the
+// SOC trajectory. Turning points are picked out with HYSTERESIS_PERCENT so
+// measurement noise does not count as cycles. Closed cycles go into a
+// depth-of-discharge histogram and are dropped; only the residue of
+// unclosed turning points is kept, at most MAX_REVERSALS of them (on
+// overflow the oldest range is counted as a half cycle). Equivalent full
+// cycles weigh every cycle by its depth, so ten 10 % cycles count as one.
+//
+// Health: between a sync to full and the next sync to empty the net charge
+// that left the battery is its usable capacity. Each such measurement that
+// is plausible for the rated capacity is blended into the estimate; SOH is
+// the estimate over the rated capacity.
+class CycleCounter {
+public:
+    static constexpr size_t MAX_REVERSALS = 32;
+    static constexpr size_t DEPTH_BINS = 10; // 10 % of depth each
+    static constexpr float HYSTERESIS_PERCENT = 1.0f;
+    // Measurements outside this fraction of the rated capacity are rejected
+    static constexpr float MIN_CAPACITY_FRACTION = 0.3f;
+    static constexpr float MAX_CAPACITY_FRACTION = 1.3f;
+    static constexpr float CAPACITY_GAIN = 0.3f; // weight of a new measurement
+
+    // Everything the counter knows; plain data so it can be persisted as is
+    struct State {
+        // Rainflow
+        bool primed;
+        int8_t direction;    // +1 rising, -1 falling, 0 not yet moved
+        uint8_t residueCount;
+        float extreme;       // running extreme since the last turning point
+        float residue[MAX_REVERSALS];
+        double closedSwing_percent; // SOC travel of all counted cycles
+        uint32_t halfCycles[DEPTH_BINS]; // a full cycle counts two
+
+        // Capacity
+        bool armed;          // synced to full, not yet to empty
+        int64_t sinceFull_pC;
+        uint32_t measurements;
+        float lastMeasured_Ah;
+        float capacity_Ah;   // NaN until measured
+    };
+
+    CycleCounter();
+
+    // Feed the SOC after every coulomb counter update.
+    void addSoc(float soc_percent);
+
+    // Net charge counted by the coulomb counter, before any sync or clamp.
+    void addCharge(int64_t delta_pC);
+    // Called while the battery is synced to full / to empty. markEmpty()
+    // returns true when it finished a capacity measurement, accepted or not.
+    void markFull();
+    bool markEmpty(float ratedCapacity_Ah);
+
+    // Closed cycles plus the residue counted as half cycles
+    float getEquivalentCycles() const;
+    // Closed cycles whose depth falls in bin (bin * 10 % .. bin * 10 % + 10 %)
+    float getCycles(size_t bin) const;
+    float getCapacity_Ah() const { return state.capacity_Ah; }
+    float getLastMeasured_Ah() const { return state.lastMeasured_Ah; }
+    uint32_t getCapacityMeasurements() const { return state.measurements; }
+    // NaN until a capacity has been measured
+    float getStateOfHealth_percent(float ratedCapacity_Ah) const;
+
+    const State& getState() const { return state; }
+    void restore(const State& s);
+    void reset();
+
+    // One CRC-checked blob under key.
+    static bool write(Preferences& prefs, const char* key, const State& s);
+    static bool read(Preferences& prefs, const char* key, State& out);
+
+private:
+    void pushReversal(float soc_percent);
+    void countRange(float range_percent, bool fullCycle);
+
+    State state;
+};
+
+#endif // CYCLE_COUNTER_H
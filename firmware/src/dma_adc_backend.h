@@ -0,0 +1,30 @@
+#ifndef DMA_ADC_BACKEND_H
+#define DMA_ADC_BACKEND_H
+
+#include "adc_backend.h"
+
+// Continuous (DMA) ADC1 sampling of a single pin using the ESP-IDF digital
+// controller. The hardware keeps converting at SAMPLE_FREQ_HZ into the
+// driver's ring; readSamples() drains it without blocking.
+//
+// Raw values use the same 11 dB attenuation and 12-bit width as
+// analogRead(), so existing calibration tables stay valid.
+class DmaAdcBackend : public AdcBackend {
+public:
+    static constexpr uint32_t SAMPLE_FREQ_HZ = 1000;
+    static constexpr uint32_t FRAME_BYTES = 128;       // per DMA interrupt
+    static constexpr uint32_t DRIVER_BUFFER_BYTES = 1024; // driver-side ring
+
+    DmaAdcBackend();
+    bool begin(int pin) override;
+    size_t readSamples(uint16_t* out, size_t maxSamples) override;
+
+    uint32_t getOverflowCount() const { return overflows; }
+
+private:
+    bool running;
+    int channel;
+    uint32_t overflows;
+};
+
+#endif // DMA_ADC_BACKEND_H
@@ -95,9 +95,13 @@ static void OnDataRecv(const uint8_t * mac, const uint8_t *incomingData, int len
 
 // 🔒 Compile-time check: catch padding/alignment mismatches.
 // Update "EXPECTED_AE_SMART_SHUNT_STRUCT_SIZE" if your struct changes.
-#define EXPECTED_AE_SMART_SHUNT_STRUCT_SIZE 298   // Updated for Gauge relay + MAC fields
+#define EXPECTED_AE_SMART_SHUNT_STRUCT_SIZE 330   // Updated for cycle/health fields
 static_assert(sizeof(struct_message_ae_smart_shunt_1) == EXPECTED_AE_SMART_SHUNT_STRUCT_SIZE,
               "struct_message_ae_smart_shunt_1 has unexpected size! Possible padding/alignment issue.");
+// The mesh part is what goes on air; esp_now_send() rejects more than
+// ESP_NOW_MAX_DATA_LEN (250) bytes.
+static_assert(sizeof(struct_message_ae_smart_shunt_mesh) <= 250,
+              "struct_message_ae_smart_shunt_mesh exceeds the ESP-NOW payload limit.");
 
 ESPNowHandler::ESPNowHandler(const uint8_t *broadcastAddr)
 {
@@ -0,0 +1,338 @@
+#include "flash_log.h"
+#include <string.h>
+
+namespace {
+constexpr uint32_t LOG_MAGIC = 0x474C4541; // "AELG"
+constexpr uint8_t TYPE_KEYFRAME = 0x4B;
+constexpr uint8_t TYPE_DELTA = 0x44;
+constexpr uint8_t ERASED = 0xFF;
+
+uint8_t crc8(const uint8_t* data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint8_t* putVarint(uint8_t* p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        const uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+} // end anonymous namespace
+
+// Decodes the records of one page in order through a small read window.
+class FlashLog::Reader {
+public:
+    enum Status { RECORD, END, CORRUPT };
+
+    Reader(const PageStore& store, size_t page)
+        : store(store), page(page), pos(HEADER_BYTES), windowStart(0),
+          windowLength(0), haveBase(false), keyframe(false) {}
+
+    Status next(Record& out) {
+        const size_t pageSize = store.pageSize();
+        uint8_t bytes[MAX_RECORD_BYTES];
+        if (pos >= pageSize || !get(pos, bytes, 1)) {
+            return END;
+        }
+        const size_t len = bytes[0];
+        if (len == ERASED) {
+            return END;
+        }
+        if (len < 2 || len + 2 > MAX_RECORD_BYTES || pos + len + 2 > pageSize ||
+            !get(pos, bytes, len + 2) || crc8(bytes, len + 1) != bytes[len + 1]) {
+            return CORRUPT;
+        }
+
+        const uint8_t* p = bytes + 2;
+        const uint8_t* end = bytes + 1 + len;
+        const uint8_t type = bytes[1];
+        uint32_t v;
+        Record rec;
+        if (type == TYPE_KEYFRAME) {
+            if (!getVarint(p, end, v)) return CORRUPT;
+            rec.time_s = v;
+            for (size_t f = 0; f < FIELD_COUNT; f++) {
+                if (!getVarint(p, end, v)) return CORRUPT;
+                rec.field[f] = (int16_t)unzigzag(v);
+            }
+        } else if (type == TYPE_DELTA && haveBase) {
+            if (!getVarint(p, end, v)) return CORRUPT;
+            rec.time_s = base.time_s + v;
+            for (size_t f = 0; f < FIELD_COUNT; f++) {
+                if (!getVarint(p, end, v)) return CORRUPT;
+                rec.field[f] = (int16_t)(base.field[f] + unzigzag(v));
+            }
+        } else {
+            return CORRUPT;
+        }
+        if (p != end) {
+            return CORRUPT;
+        }
+
+        pos += len + 2;
+        base = rec;
+        haveBase = true;
+        keyframe = type == TYPE_KEYFRAME;
+        out = rec;
+        return RECORD;
+    }
+
+    size_t position() const { return pos; }
+    bool wasKeyframe() const { return keyframe; }
+
+private:
+    bool get(size_t offset, uint8_t* out, size_t len) {
+        if (offset < windowStart || offset + len > windowStart + windowLength) {
+            windowStart = offset;
+            windowLength = store.pageSize() - offset;
+            if (windowLength > sizeof(window)) {
+                windowLength = sizeof(window);
+            }
+            if (len > windowLength || !store.read(page, offset, window, windowLength)) {
+                windowLength = 0;
+                return false;
+            }
+        }
+        memcpy(out, window + (offset - windowStart), len);
+        return true;
+    }
+
+    const PageStore& store;
+    size_t page;
+    size_t pos;
+    uint8_t window[128];
+    size_t windowStart;
+    size_t windowLength;
+    Record base;
+    bool haveBase;
+    bool keyframe;
+};
+
+FlashLog::FlashLog(PageStore& store)
+    : store(store), ready(false), headPage(-1), headSequence(0),
+      writeOffset(0), sealed(false), previous(), sinceKeyframe(0),
+      lastTime_s(0), usedPages(0), maxEraseCount(0), appendFailures(0),
+      nextPage(0) {}
+
+bool FlashLog::readHeader(size_t page, Header& out) const {
+    return store.read(page, 0, &out, sizeof(out)) && out.magic == LOG_MAGIC;
+}
+
+bool FlashLog::begin() {
+    ready = false;
+    headPage = -1;
+    headSequence = 0;
+    usedPages = 0;
+    maxEraseCount = 0;
+    nextPage = 0;
+    if (store.pageCount() < 2 || store.pageSize() < HEADER_BYTES + MAX_RECORD_BYTES) {
+        return false;
+    }
+
+    Header h;
+    Header newest = {};
+    for (size_t page = 0; page < store.pageCount(); page++) {
+        if (!readHeader(page, h)) {
+            continue;
+        }
+        usedPages++;
+        if (h.eraseCount > maxEraseCount) {
+            maxEraseCount = h.eraseCount;
+        }
+        if (headPage < 0 || h.sequence > headSequence) {
+            headPage = (int32_t)page;
+            headSequence = h.sequence;
+            newest = h;
+        }
+    }
+
+    if (headPage >= 0) {
+        // Resume after the last intact record of the newest page
+        Reader reader(store, headPage);
+        Record rec;
+        Reader::Status status;
+        lastTime_s = newest.firstTime_s;
+        sinceKeyframe = 0;
+        while ((status = reader.next(rec)) == Reader::RECORD) {
+            previous = rec;
+            lastTime_s = rec.time_s;
+            sinceKeyframe = reader.wasKeyframe() ? 0 : sinceKeyframe + 1;
+        }
+        writeOffset = reader.position();
+        sealed = status == Reader::CORRUPT;
+    }
+    ready = true;
+    return true;
+}
+
+bool FlashLog::startPage(uint32_t time_s) {
+    const size_t pages = store.pageCount();
+    const size_t page = headPage < 0 ? nextPage % pages : (headPage + 1) % pages;
+
+    Header old;
+    const bool reused = readHeader(page, old);
+    Header h;
+    h.magic = LOG_MAGIC;
+    h.sequence = headSequence + 1;
+    h.eraseCount = (reused ? old.eraseCount : 0) + 1;
+    h.firstTime_s = time_s;
+    if (!store.erase(page) || !store.write(page, 0, &h, sizeof(h))) {
+        return false;
+    }
+
+    headPage = (int32_t)page;
+    headSequence = h.sequence;
+    writeOffset = HEADER_BYTES;
+    sealed = false;
+    sinceKeyframe = 0;
+    if (!reused) {
+        usedPages++;
+    }
+    if (h.eraseCount > maxEraseCount) {
+        maxEraseCount = h.eraseCount;
+    }
+    return true;
+}
+
+size_t FlashLog::encode(const Record& record, bool keyframe, uint8_t* out) const {
+    uint8_t* p = out + 1;
+    *p++ = keyframe ? TYPE_KEYFRAME : TYPE_DELTA;
+    if (keyframe) {
+        p = putVarint(p, record.time_s);
+        for (size_t f = 0; f < FIELD_COUNT; f++) {
+            p = putVarint(p, zigzag(record.field[f]));
+        }
+    } else {
+        p = putVarint(p, record.time_s - previous.time_s);
+        for (size_t f = 0; f < FIELD_COUNT; f++) {
+            p = putVarint(p, zigzag((int32_t)record.field[f] - previous.field[f]));
+        }
+    }
+    const size_t len = (size_t)(p - out) - 1;
+    out[0] = (uint8_t)len;
+    *p = crc8(out, len + 1);
+    return len + 2;
+}
+
+bool FlashLog::append(const Record& record) {
+    if (!ready) {
+        return false;
+    }
+    Record r = record;
+    if (!isEmpty() && r.time_s < lastTime_s) {
+        r.time_s = lastTime_s;
+    }
+
+    if (isEmpty() || sealed || writeOffset + MAX_RECORD_BYTES > store.pageSize()) {
+        if (!startPage(r.time_s)) {
+            appendFailures++;
+            return false;
+        }
+    }
+
+    const bool keyframe = writeOffset == HEADER_BYTES ||
+                          sinceKeyframe + 1 >= KEYFRAME_INTERVAL;
+    uint8_t bytes[MAX_RECORD_BYTES];
+    const size_t n = encode(r, keyframe, bytes);
+    if (!store.write(headPage, writeOffset, bytes, n)) {
+        appendFailures++;
+        sealed = true;
+        return false;
+    }
+    writeOffset += n;
+    previous = r;
+    sinceKeyframe = keyframe ? 0 : sinceKeyframe + 1;
+    lastTime_s = r.time_s;
+    return true;
+}
+
+size_t FlashLog::query(uint32_t from_s, uint32_t to_s,
+                       const std::function<bool(const Record&)>& visit) const {
+    if (!ready || isEmpty() || from_s > to_s) {
+        return 0;
+    }
+
+    size_t visited = 0;
+    // Returns false once the range is done or visit() asked to stop
+    auto scan = [&](size_t page) {
+        Reader reader(store, page);
+        Record rec;
+        while (reader.next(rec) == Reader::RECORD) {
+            if (rec.time_s > to_s) {
+                return false;
+            }
+            if (rec.time_s >= from_s) {
+                visited++;
+                if (!visit(rec)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    // Oldest page first. A page's records end where the next page's begin,
+    // so it is skipped when the next page starts before from_s.
+    const size_t pages = store.pageCount();
+    int32_t pending = -1;
+    for (size_t k = 1; k <= pages; k++) {
+        const size_t page = (headPage + k) % pages;
+        Header h;
+        if (!readHeader(page, h)) {
+            continue;
+        }
+        if (pending >= 0 && h.firstTime_s >= from_s && !scan(pending)) {
+            return visited;
+        }
+        pending = -1;
+        if (h.firstTime_s > to_s) {
+            return visited;
+        }
+        pending = (int32_t)page;
+    }
+    if (pending >= 0) {
+        scan(pending);
+    }
+    return visited;
+}
+
+void FlashLog::clear() {
+    for (size_t page = 0; page < store.pageCount(); page++) {
+        Header h;
+        if (readHeader(page, h)) {
+            store.erase(page);
+        }
+    }
+    // Carry on in ring order so the first pages do not take extra erases
+    nextPage = headPage < 0 ? nextPage : (size_t)(headPage + 1);
+    headPage = -1;
+    headSequence = 0;
+    usedPages = 0;
+    sealed = false;
+    sinceKeyframe = 0;
+    lastTime_s = 0;
+}
@@ -0,0 +1,99 @@
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include "page_store.h"
+
+// Append-only, power-loss tolerant log of one-minute summaries in flash.
+//
+// The PageStore is used as a ring of pages. Each page starts with a header
+// (magic, sequence number, erase count, time of its first record) followed
+// by records:
+//
+//   [length][type][payload][crc8]
+//
+// A keyframe holds the time and every field as varints; a delta record
+// holds the time step and the change of every field as zigzag varints,
+// usually one byte each. Every page starts with a keyframe and another is
+// written every KEYFRAME_INTERVAL records, so pages decode on their own once
+// older ones have been erased. Pages are erased just before reuse, in ring
+// order, so every page sees the same number of erases.
+//
+// After a reset begin() finds the newest page from the sequence numbers and
+// resumes after its last record that passes the CRC; a torn record closes
+// that page and appending continues on the next one.
+class FlashLog {
+public:
+    enum Field : uint8_t {
+        VOLTAGE_MEAN = 0, VOLTAGE_MIN, VOLTAGE_MAX,
+        CURRENT_MEAN, CURRENT_MIN, CURRENT_MAX,
+        POWER_MEAN, SOC_MEAN,
+        FIELD_COUNT
+    };
+
+    struct Record {
+        uint32_t time_s;            // non-decreasing; append() clamps
+        int16_t field[FIELD_COUNT]; // HistoryStore fixed-point codes
+    };
+
+    static constexpr uint32_t KEYFRAME_INTERVAL = 32;
+    static constexpr size_t HEADER_BYTES = 16;
+    // length + type + time varint + field varints + crc
+    static constexpr size_t MAX_RECORD_BYTES = 1 + 1 + 5 + FIELD_COUNT * 3 + 1;
+
+    explicit FlashLog(PageStore& store);
+
+    bool begin();
+    bool isReady() const { return ready; }
+
+    bool append(const Record& record);
+
+    // Visit every record with from_s <= time_s <= to_s, oldest first, until
+    // visit returns false. Pages entirely outside the range are skipped by
+    // their header; records are decoded through a small window, never a
+    // whole page. Returns the number of records visited.
+    size_t query(uint32_t from_s, uint32_t to_s,
+                 const std::function<bool(const Record&)>& visit) const;
+
+    // Erase every page in use.
+    void clear();
+
+    uint32_t getLastTime_s() const { return lastTime_s; }
+    bool isEmpty() const { return headPage < 0; }
+    size_t getUsedPages() const { return usedPages; }
+    size_t getPageCount() const { return store.pageCount(); }
+    uint32_t getMaxEraseCount() const { return maxEraseCount; }
+    uint32_t getAppendFailures() const { return appendFailures; }
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t eraseCount;
+        uint32_t firstTime_s;
+    };
+
+    class Reader;
+
+    bool readHeader(size_t page, Header& out) const;
+    bool startPage(uint32_t time_s);
+    size_t encode(const Record& record, bool keyframe, uint8_t* out) const;
+
+    PageStore& store;
+    bool ready;
+    int32_t headPage;      // page being appended to, -1 when empty
+    uint32_t headSequence;
+    size_t writeOffset;
+    bool sealed;           // head page has a torn record; start a new one
+    Record previous;       // base for the next delta
+    uint32_t sinceKeyframe;
+    uint32_t lastTime_s;
+    size_t usedPages;
+    uint32_t maxEraseCount;
+    uint32_t appendFailures;
+    size_t nextPage;       // where an empty log starts
+};
+
+#endif // FLASH_LOG_H
@@ -3,13 +3,83 @@
 
 // NVS namespace and keys for storing calibration data
 #define GPIO_ADC_NVS_NAMESPACE "gpio_adc_cal_v2" // New namespace for new format
-#define GPIO_ADC_KEY_COUNT "count"
+#define GPIO_ADC_KEY_COUNT "count" // legacy per-point format, migrated on load
+#define GPIO_ADC_KEY_TABLE "table"
 
-GPIO_ADC::GPIO_ADC(int pin) : _pin(pin) {}
+namespace {
+// Default starter voltage calibration, used until the user calibrates
+constexpr VoltageCalPoint default_voltage_cal_table[] = {
+    {2182, 10.0f}, {2396, 11.0f}, {2525, 11.5f}, {2625, 12.0f},
+    {2748, 12.5f}, {2841, 13.0f}, {3055, 14.0f}, {3283, 15.0f}
+};
+} // end anonymous namespace
+
+GPIO_ADC::GPIO_ADC(int pin, AdcBackend* backend)
+    : _pin(pin), _backend(backend), _sum(0), _head(0), _count(0),
+      _cachedVoltage(-1.0f) {}
 
 void GPIO_ADC::begin() {
     pinMode(_pin, INPUT);
     loadCalibration();
+    if (_backend != nullptr && !_backend->begin(_pin)) {
+        Serial.println("Continuous ADC unavailable, falling back to analogRead().");
+        _backend = nullptr;
+    }
+}
+
+void GPIO_ADC::update() {
+    if (_backend == nullptr) {
+        return;
+    }
+
+    uint16_t fresh[64];
+    size_t n;
+    bool changed = false;
+    while ((n = _backend->readSamples(fresh, sizeof(fresh) / sizeof(fresh[0]))) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (_count == AVG_SAMPLES) {
+                _sum -= _samples[_head];
+            } else {
+                _count++;
+            }
+            _samples[_head] = fresh[i];
+            _sum += fresh[i];
+            _head = (_head + 1) % AVG_SAMPLES;
+        }
+        changed = true;
+    }
+    if (changed) {
+        refreshVoltage();
+    }
+}
+
+void GPIO_ADC::refreshVoltage() {
+    if (!isCalibrated() || _count == 0) {
+        _cachedVoltage = -1.0f;
+        return;
+    }
+    // Clamps to the end points outside the table
+    _cachedVoltage = _calibration.evaluate((float)_sum / _count);
+}
+
+int GPIO_ADC::getAverageRaw() const {
+    if (_backend == nullptr) {
+        return analogRead(_pin);
+    }
+    return _count == 0 ? -1 : (int)((_sum + _count / 2) / _count);
+}
+
+void GPIO_ADC::clearAverage() {
+    if (_backend != nullptr) {
+        // Conversions still queued in the driver predate the clear
+        uint16_t stale[64];
+        while (_backend->readSamples(stale, sizeof(stale) / sizeof(stale[0])) > 0) {
+        }
+    }
+    _sum = 0;
+    _head = 0;
+    _count = 0;
+    _cachedVoltage = -1.0f;
 }
 
 float GPIO_ADC::readVoltage() {
@@ -19,70 +89,67 @@ float GPIO_ADC::readVoltage() {
         return -1.0f;
     }
 
-    int raw_adc = analogRead(_pin);
-
-    // Handle edge cases: value is below the first point or above the last point
-    if (raw_adc <= _calibrationTable.front().raw_adc) {
-        return _calibrationTable.front().voltage;
-    }
-    if (raw_adc >= _calibrationTable.back().raw_adc) {
-        return _calibrationTable.back().voltage;
+    if (_backend != nullptr) {
+        return _cachedVoltage;
     }
 
-    // Find the segment for interpolation
-    for (size_t i = 1; i < _calibrationTable.size(); ++i) {
-        if (raw_adc < _calibrationTable[i].raw_adc) {
-            const auto& p0 = _calibrationTable[i-1];
-            const auto& p1 = _calibrationTable[i];
-
-            // Linear interpolation: y = y0 + (x - x0) * (y1 - y0) / (x1 - x0)
-            // Avoid division by zero, though sorted unique points should prevent this.
-            if (p1.raw_adc == p0.raw_adc) {
-                return p0.voltage;
-            }
-            float t = (float)(raw_adc - p0.raw_adc) / (float)(p1.raw_adc - p0.raw_adc);
-            return p0.voltage + t * (p1.voltage - p0.voltage);
-        }
-    }
+    int raw_adc = analogRead(_pin);
 
-    return -1.0f; // Should not be reached if table is sorted and has > 1 point
+    // Clamps to the end points outside the table
+    return _calibration.evaluate((float)raw_adc);
 }
 
 void GPIO_ADC::calibrate(const std::vector<VoltageCalPoint>& points) {
-    _calibrationTable = points;
+    std::vector<VoltageCalPoint> sorted = points;
     // Ensure the table is sorted by raw_adc value for correct interpolation
-    std::sort(_calibrationTable.begin(), _calibrationTable.end(),
+    std::sort(sorted.begin(), sorted.end(),
               [](const VoltageCalPoint& a, const VoltageCalPoint& b) {
                   return a.raw_adc < b.raw_adc;
               });
+    if (!setCalibrationPoints(sorted.data(), sorted.size())) {
+        Serial.printf("Too many calibration points (%u, max %u). Not saved.\n",
+                      (unsigned)sorted.size(), (unsigned)MAX_CAL_POINTS);
+        return;
+    }
+    refreshVoltage();
     saveCalibration();
 }
 
-const std::vector<VoltageCalPoint>& GPIO_ADC::getCalibrationTable() const {
-    return _calibrationTable;
+std::vector<VoltageCalPoint> GPIO_ADC::getCalibrationTable() const {
+    std::vector<VoltageCalPoint> table;
+    table.reserve(_calibration.size());
+    for (size_t i = 0; i < _calibration.size(); ++i) {
+        const auto pt = _calibration.point(i);
+        table.push_back({(int)pt.x, pt.y});
+    }
+    return table;
 }
 
 bool GPIO_ADC::isCalibrated() const {
     // A valid calibration needs at least two points to interpolate between.
-    return _calibrationTable.size() >= 2;
+    return _calibration.size() >= 2;
 }
 
-void GPIO_ADC::loadCalibration() {
-    // Define the default table here as a local static const to ensure it's initialized
-    // before it's ever accessed. This avoids the static initialization order fiasco.
-    static const std::vector<VoltageCalPoint> default_voltage_cal_table = {
-        {2182, 10.0f}, {2396, 11.0f}, {2525, 11.5f}, {2625, 12.0f},
-        {2748, 12.5f}, {2841, 13.0f}, {3055, 14.0f}, {3283, 15.0f}
-    };
+bool GPIO_ADC::setCalibrationPoints(const VoltageCalPoint* points, size_t count) {
+    return _calibration.assign(points, count,
+                               [](const VoltageCalPoint& p) { return p.raw_adc; },
+                               [](const VoltageCalPoint& p) { return p.voltage; });
+}
 
+void GPIO_ADC::loadCalibration() {
     Preferences prefs;
-    prefs.begin(GPIO_ADC_NVS_NAMESPACE, true); // read-only
-
-    uint32_t count = prefs.getUInt(GPIO_ADC_KEY_COUNT, 0);
+    prefs.begin(GPIO_ADC_NVS_NAMESPACE, false); // writable for migration
+
+    VoltageCalPoint points[MAX_CAL_POINTS];
+    bool found = false;
+    size_t loaded = CalibrationBlob::read<VoltageCalPoint, MAX_CAL_POINTS>(
+        prefs, GPIO_ADC_KEY_TABLE, points, found);
+    if (found && loaded == 0) {
+        Serial.println("GPIO ADC calibration in NVS is corrupt; ignoring it.");
+    }
 
-    if (count >= 2) { // A valid table needs at least 2 points
-        _calibrationTable.clear();
-        _calibrationTable.reserve(count);
+    uint32_t count = found ? 0 : prefs.getUInt(GPIO_ADC_KEY_COUNT, 0);
+    if (count >= 2 && count <= MAX_CAL_POINTS) { // A valid table needs at least 2 points
         for (uint32_t i = 0; i < count; ++i) {
             char key_raw[16], key_volt[16];
             snprintf(key_raw, sizeof(key_raw), "raw_%u", i);
@@ -92,13 +159,25 @@ void GPIO_ADC::loadCalibration() {
             float voltage = prefs.getFloat(key_volt, -1.0f);
 
             if (raw_adc != -1 && voltage != -1.0f) {
-                _calibrationTable.push_back({raw_adc, voltage});
+                points[loaded++] = {raw_adc, voltage};
             }
         }
-        Serial.printf("Loaded %u GPIO ADC calibration points from NVS.\\n", _calibrationTable.size());
+        // clear() drops the per-point keys along with the count
+        prefs.clear();
+        if (CalibrationBlob::write<VoltageCalPoint, MAX_CAL_POINTS>(
+                prefs, GPIO_ADC_KEY_TABLE, points, loaded)) {
+            Serial.printf("Migrated %u GPIO ADC calibration points to a single blob.\n",
+                          (unsigned)loaded);
+        }
+    }
+
+    if (loaded >= 2) {
+        setCalibrationPoints(points, loaded);
+        Serial.printf("Loaded %u GPIO ADC calibration points from NVS.\n", _calibration.size());
     } else {
         // No user calibration found in NVS, so load the hard-coded default table.
-        _calibrationTable = default_voltage_cal_table;
+        setCalibrationPoints(default_voltage_cal_table,
+                             sizeof(default_voltage_cal_table) / sizeof(default_voltage_cal_table[0]));
         Serial.println("No user calibration found in NVS. Loaded default starter voltage calibration.");
     }
     prefs.end();
@@ -111,19 +190,20 @@ void GPIO_ADC::saveCalibration() {
         return;
     }
 
-    // Clear old calibration data before saving new data
-    prefs.clear();
-
-    prefs.putUInt(GPIO_ADC_KEY_COUNT, _calibrationTable.size());
-
-    for (size_t i = 0; i < _calibrationTable.size(); ++i) {
-        char key_raw[16], key_volt[16];
-        snprintf(key_raw, sizeof(key_raw), "raw_%u", i);
-        snprintf(key_volt, sizeof(key_volt), "volt_%u", i);
-
-        prefs.putInt(key_raw, _calibrationTable[i].raw_adc);
-        prefs.putFloat(key_volt, _calibrationTable[i].voltage);
+    VoltageCalPoint points[MAX_CAL_POINTS];
+    for (size_t i = 0; i < _calibration.size(); ++i) {
+        const auto pt = _calibration.point(i);
+        points[i] = {(int)pt.x, pt.y};
     }
+
+    // Clear old calibration data (including any legacy keys) before saving
+    prefs.clear();
+    bool ok = CalibrationBlob::write<VoltageCalPoint, MAX_CAL_POINTS>(
+        prefs, GPIO_ADC_KEY_TABLE, points, _calibration.size());
     prefs.end();
-    Serial.printf("Saved %u GPIO ADC calibration points.\\n", _calibrationTable.size());
+    if (!ok) {
+        Serial.println("Failed to write GPIO ADC calibration.");
+        return;
+    }
+    Serial.printf("Saved %u GPIO ADC calibration points.\n", _calibration.size());
 }
@@ -4,24 +4,55 @@
 #include <Arduino.h>
 #include <Preferences.h>
 #include <vector>
+#include "adc_backend.h"
+#include "CalibrationBlob.h"
+#include "PiecewiseLinear.h"
 
 struct VoltageCalPoint {
     int raw_adc;
     float voltage;
 };
 
+// Starter battery voltage from a GPIO ADC pin.
+//
+// With a backend, conversions run continuously in the background; update()
+// drains them into a running average over the last AVG_SAMPLES conversions
+// and refreshes the cached voltage, which readVoltage() returns in O(1).
+// Without one, readVoltage() falls back to a single blocking analogRead().
 class GPIO_ADC {
 public:
-    GPIO_ADC(int pin);
+    static constexpr size_t AVG_SAMPLES = 256;
+
+    GPIO_ADC(int pin, AdcBackend* backend = nullptr);
     void begin();
+    void update();
     float readVoltage();
+    // Averaged raw conversion (-1 before the first sample); a fresh
+    // analogRead() without a backend
+    int getAverageRaw() const;
+    // Start a new window: drop the average and discard any conversions the
+    // backend has queued but update() has not read yet
+    void clearAverage();
     void calibrate(const std::vector<VoltageCalPoint>& points);
-    const std::vector<VoltageCalPoint>& getCalibrationTable() const;
+    std::vector<VoltageCalPoint> getCalibrationTable() const;
     bool isCalibrated() const;
 
+    static constexpr size_t MAX_CAL_POINTS = 16;
+
 private:
     int _pin;
-    std::vector<VoltageCalPoint> _calibrationTable;
+    AdcBackend* _backend;
+    PiecewiseLinear<MAX_CAL_POINTS> _calibration;
+
+    // Running sum over a ring of the most recent raw conversions
+    uint16_t _samples[AVG_SAMPLES];
+    uint32_t _sum;
+    size_t _head;
+    size_t _count;
+    float _cachedVoltage;
+    void refreshVoltage();
+
+    bool setCalibrationPoints(const VoltageCalPoint* points, size_t count);
 
     void loadCalibration();
     void saveCalibration();
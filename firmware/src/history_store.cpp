@@ -0,0 +1,224 @@
+#include "history_store.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+constexpr size_t TIER_CAPACITY[HistoryStore::TIER_COUNT] = {
+    HistoryStore::SECOND_BUCKETS, HistoryStore::MINUTE_BUCKETS,
+    HistoryStore::HOUR_BUCKETS, HistoryStore::DAY_BUCKETS};
+
+constexpr size_t TIER_OFFSET[HistoryStore::TIER_COUNT] = {
+    0, HistoryStore::SECOND_BUCKETS,
+    HistoryStore::SECOND_BUCKETS + HistoryStore::MINUTE_BUCKETS,
+    HistoryStore::SECOND_BUCKETS + HistoryStore::MINUTE_BUCKETS + HistoryStore::HOUR_BUCKETS};
+
+constexpr uint32_t TIER_SECONDS[HistoryStore::TIER_COUNT] = {1, 60, 3600, 86400};
+
+// Value of one code step per channel: 2 mV (+-65 V), 20 mA (+-655 A),
+// 1 W (+-32 kW), 0.01 % SOC
+constexpr float CHANNEL_LSB[HistoryStore::CHANNEL_COUNT] = {0.002f, 20.0f, 1000.0f, 0.01f};
+constexpr float CHANNEL_INV_LSB[HistoryStore::CHANNEL_COUNT] = {500.0f, 0.05f, 0.001f, 100.0f};
+
+void putU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+void putU32(uint8_t* p, uint32_t v) {
+    putU16(p, (uint16_t)v);
+    putU16(p + 2, (uint16_t)(v >> 16));
+}
+} // end anonymous namespace
+
+HistoryStore::HistoryStore() {
+    clear();
+}
+
+void HistoryStore::clear() {
+    memset(buckets, 0, sizeof(buckets));
+    for (size_t t = 0; t < TIER_COUNT; t++) {
+        head[t] = 0;
+        count[t] = 0;
+        newest[t] = -1;
+        memset(&open[t], 0, sizeof(open[t]));
+        open[t].period = -1;
+    }
+}
+
+int16_t HistoryStore::encode(Channel channel, float value) {
+    if (isnan(value)) {
+        return 0;
+    }
+    const float scaled = value * CHANNEL_INV_LSB[channel];
+    if (scaled >= 32767.0f) return 32767;
+    if (scaled <= -32768.0f) return -32768;
+    return (int16_t)lroundf(scaled);
+}
+
+float HistoryStore::decode(Channel channel, int16_t code) {
+    return code * CHANNEL_LSB[channel];
+}
+
+uint32_t HistoryStore::periodSeconds(Tier tier) {
+    return TIER_SECONDS[tier];
+}
+
+size_t HistoryStore::capacity(Tier tier) {
+    return TIER_CAPACITY[tier];
+}
+
+size_t HistoryStore::size(Tier tier) const {
+    return count[tier];
+}
+
+const HistoryStore::Bucket& HistoryStore::at(Tier tier, size_t index) const {
+    const size_t cap = TIER_CAPACITY[tier];
+    const size_t oldest = (head[tier] + cap - count[tier]) % cap;
+    return buckets[TIER_OFFSET[tier] + (oldest + index) % cap];
+}
+
+void HistoryStore::record(const SensorSample& sample, float soc_percent) {
+    const int64_t seconds = sample.timestamp_us / 1000000;
+
+    // Close every tier whose period has ended, lowest first so each closed
+    // bucket is folded into its parent before the parent is checked
+    for (size_t t = 0; t < TIER_COUNT; t++) {
+        const int64_t period = seconds / TIER_SECONDS[t];
+        if (open[t].samples > 0 && open[t].period != period) {
+            close(t);
+        }
+    }
+
+    const int16_t codes[CHANNEL_COUNT] = {
+        encode(CH_VOLTAGE, sample.busVoltage_V),
+        encode(CH_CURRENT, sample.current_mA),
+        encode(CH_POWER, sample.power_mW),
+        encode(CH_SOC, soc_percent)};
+
+    Accumulator& acc = open[TIER_SECOND];
+    if (acc.samples == 0) {
+        acc.period = seconds;
+        for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+            acc.min[c] = acc.max[c] = codes[c];
+            acc.sum[c] = 0;
+        }
+    }
+    for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+        if (codes[c] < acc.min[c]) acc.min[c] = codes[c];
+        if (codes[c] > acc.max[c]) acc.max[c] = codes[c];
+        acc.sum[c] += codes[c];
+    }
+    acc.samples++;
+}
+
+void HistoryStore::fold(Accumulator& into, const Accumulator& from) {
+    if (into.samples == 0) {
+        for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+            into.min[c] = from.min[c];
+            into.max[c] = from.max[c];
+            into.sum[c] = 0;
+        }
+    }
+    for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+        if (from.min[c] < into.min[c]) into.min[c] = from.min[c];
+        if (from.max[c] > into.max[c]) into.max[c] = from.max[c];
+        into.sum[c] += from.sum[c];
+    }
+    into.samples += from.samples;
+}
+
+void HistoryStore::close(size_t tier) {
+    Accumulator& acc = open[tier];
+    store(tier, acc.period, acc);
+
+    if (tier + 1 < TIER_COUNT) {
+        const int64_t parent = acc.period * TIER_SECONDS[tier] / TIER_SECONDS[tier + 1];
+        Accumulator& up = open[tier + 1];
+        if (up.samples > 0 && up.period != parent) {
+            close(tier + 1); // only if time went backwards
+        }
+        fold(up, acc);
+        up.period = parent;
+    }
+    acc.samples = 0;
+}
+
+void HistoryStore::store(size_t tier, int64_t period, const Accumulator& acc) {
+    const size_t cap = TIER_CAPACITY[tier];
+
+    // Empty buckets for periods without samples keep positions aligned to time
+    if (newest[tier] >= 0 && period > newest[tier] + 1) {
+        Bucket empty;
+        memset(&empty, 0, sizeof(empty));
+        int64_t gap = period - newest[tier] - 1;
+        if (gap > (int64_t)cap) {
+            gap = cap;
+        }
+        for (int64_t i = 0; i < gap; i++) {
+            storeBucket(tier, empty);
+        }
+    }
+
+    Bucket b;
+    b.samples = acc.samples;
+    for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+        b.channel[c].min = acc.min[c];
+        b.channel[c].max = acc.max[c];
+        // Round half away from zero
+        const int64_t half = acc.samples / 2;
+        const int64_t s = acc.sum[c];
+        b.channel[c].mean = (int16_t)((s >= 0 ? s + half : s - half) / (int64_t)acc.samples);
+    }
+    storeBucket(tier, b);
+    newest[tier] = period;
+}
+
+void HistoryStore::storeBucket(size_t tier, const Bucket& bucket) {
+    const size_t cap = TIER_CAPACITY[tier];
+    buckets[TIER_OFFSET[tier] + head[tier]] = bucket;
+    head[tier] = (head[tier] + 1) % cap;
+    if (count[tier] < cap) {
+        count[tier]++;
+    }
+}
+
+size_t HistoryStore::exportPage(Tier tier, size_t offset, int64_t now_us,
+                                uint8_t* out, size_t maxLen) const {
+    if (maxLen < PAGE_HEADER_BYTES) {
+        return 0;
+    }
+    static constexpr size_t BUCKET_BYTES = 4 + CHANNEL_COUNT * 3 * 2;
+    const size_t stored = count[tier];
+    size_t n = offset < stored ? stored - offset : 0;
+    const size_t room = (maxLen - PAGE_HEADER_BYTES) / BUCKET_BYTES;
+    if (n > room) n = room;
+    if (n > 255) n = 255;
+
+    uint32_t age_s = 0;
+    if (newest[tier] >= 0) {
+        const int64_t age = now_us / 1000000 - newest[tier] * TIER_SECONDS[tier];
+        age_s = age > 0 ? (uint32_t)age : 0;
+    }
+
+    out[0] = tier;
+    out[1] = (uint8_t)n;
+    putU16(out + 2, (uint16_t)offset);
+    putU16(out + 4, (uint16_t)stored);
+    putU16(out + 6, 0); // reserved
+    putU32(out + 8, TIER_SECONDS[tier]);
+    putU32(out + 12, age_s);
+
+    uint8_t* p = out + PAGE_HEADER_BYTES;
+    for (size_t i = 0; i < n; i++) {
+        const Bucket& b = at(tier, stored - 1 - offset - i);
+        putU32(p, b.samples);
+        p += 4;
+        for (size_t c = 0; c < CHANNEL_COUNT; c++) {
+            putU16(p, (uint16_t)b.channel[c].min);
+            putU16(p + 2, (uint16_t)b.channel[c].max);
+            putU16(p + 4, (uint16_t)b.channel[c].mean);
+            p += 6;
+        }
+    }
+    return (size_t)(p - out);
+}
@@ -0,0 +1,95 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_sample.h"
+
+// Round-robin (RRD-style) history of bus voltage, current, power and SOC.
+//
+// Four tiers of fixed-size rings: 1 s, 1 min, 1 h and 1 day buckets, each
+// holding min/max/mean per channel. record() runs at the full sample rate:
+// the sample is quantised once to int16 and folded into the open 1 s bucket
+// with integer min/max/sum. When a period ends its bucket is stored and its
+// exact sum and count are folded into the next tier up, so every tier's mean
+// is sample-weighted and no tier is recomputed from the ones below. Periods
+// without samples are stored as empty buckets (samples == 0) so bucket
+// positions always map to time.
+//
+// Time is esp_timer time since boot; the history starts empty after a reset.
+// Fixed memory, no heap: about 9 KB for the default depths.
+class HistoryStore {
+public:
+    enum Tier : uint8_t { TIER_SECOND = 0, TIER_MINUTE, TIER_HOUR, TIER_DAY, TIER_COUNT };
+    enum Channel : uint8_t { CH_VOLTAGE = 0, CH_CURRENT, CH_POWER, CH_SOC, CHANNEL_COUNT };
+
+    static constexpr size_t SECOND_BUCKETS = 120; // 2 minutes
+    static constexpr size_t MINUTE_BUCKETS = 120; // 2 hours
+    static constexpr size_t HOUR_BUCKETS = 48;    // 2 days
+    static constexpr size_t DAY_BUCKETS = 31;
+    static constexpr size_t TOTAL_BUCKETS =
+        SECOND_BUCKETS + MINUTE_BUCKETS + HOUR_BUCKETS + DAY_BUCKETS;
+
+    struct Stat {
+        int16_t min;
+        int16_t max;
+        int16_t mean;
+    };
+
+    struct Bucket {
+        uint32_t samples; // 0: no data for this period
+        Stat channel[CHANNEL_COUNT];
+    };
+
+    // Bytes in front of the buckets in an exportPage() result
+    static constexpr size_t PAGE_HEADER_BYTES = 16;
+
+    HistoryStore();
+
+    // Producer side, once per sample.
+    void record(const SensorSample& sample, float soc_percent);
+    void clear();
+
+    // Stored buckets, oldest first; index size(tier) - 1 is the newest closed
+    // period. The bucket still being filled is not included.
+    size_t size(Tier tier) const;
+    static size_t capacity(Tier tier);
+    const Bucket& at(Tier tier, size_t index) const;
+    // Period number (since boot, in units of periodSeconds()) of the newest
+    // stored bucket; -1 before the first one.
+    int64_t getNewestPeriod(Tier tier) const { return newest[tier]; }
+    static uint32_t periodSeconds(Tier tier);
+
+    // Fixed-point codes used in Bucket::channel
+    static int16_t encode(Channel channel, float value);
+    static float decode(Channel channel, int16_t code);
+
+    // Pack up to maxLen bytes: a PAGE_HEADER_BYTES header (tier, bucket
+    // count, offset, total stored, period seconds, age of the newest bucket
+    // in seconds at now_us; little endian) followed by buckets newest first,
+    // starting `offset` buckets back from the newest. Returns the length.
+    size_t exportPage(Tier tier, size_t offset, int64_t now_us,
+                      uint8_t* out, size_t maxLen) const;
+
+private:
+    struct Accumulator {
+        int64_t period;
+        uint32_t samples;
+        int16_t min[CHANNEL_COUNT];
+        int16_t max[CHANNEL_COUNT];
+        int64_t sum[CHANNEL_COUNT];
+    };
+
+    void close(size_t tier);
+    void store(size_t tier, int64_t period, const Accumulator& acc);
+    void storeBucket(size_t tier, const Bucket& bucket);
+    void fold(Accumulator& into, const Accumulator& from);
+
+    Bucket buckets[TOTAL_BUCKETS];
+    size_t head[TIER_COUNT];
+    size_t count[TIER_COUNT];
+    int64_t newest[TIER_COUNT];
+    Accumulator open[TIER_COUNT];
+};
+
+#endif // HISTORY_STORE_H
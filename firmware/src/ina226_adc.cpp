@@ -1,13 +1,22 @@
 #include "ina226_adc.h"
+#include "settings_store.h"
 #include "driver/gpio.h"
 #include "esp_sleep.h"
+#include "esp_timer.h"
+#include "hal/gpio_ll.h"
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
-#include <map>
 
 // This flag is stored in RTC memory to persist across deep sleep cycles.
 RTC_DATA_ATTR uint32_t g_low_power_sleep_flag = 0;
+
+// Opens the load switch with one register write. gpio_set_level() is not
+// IRAM-resident on IDF 4.4, so the alert ISR could not call it during a
+// flash write.
+static inline void IRAM_ATTR openLoadSwitch() {
+  gpio_ll_set_level(&GPIO, (gpio_num_t)LOAD_SWITCH_PIN, 0);
+}
 #define LOW_POWER_SLEEP_MAGIC                                                  \
   0x12345678 // A magic number to indicate low power sleep
 
@@ -33,52 +42,79 @@ struct RTC_Data {
     size_t dayCount;
     
     // Battery State
-    float batteryCapacity;
+    int64_t batteryCharge_pC;
     bool hasCapacity;
 
+    // Lifetime throughput, newer than NVS between saves
+    LifetimeCounters::Totals lifetime;
+    bool hasLifetime;
+
     // Counters for partial buffering
     int minutesSinceLastHourPush;
     int hoursSinceLastDayPush;
 };
 
 RTC_DATA_ATTR RTC_Data rtcData = {0};
-#define RTC_MAGIC 0xAE534855 // "AESHU" - Increment for new struct layout
+#define RTC_MAGIC 0xAE534857 // "AESHV" - Increment for new struct layout
 
 namespace {
+constexpr double PC_PER_AH = 3.6e15; // 1 Ah = 3600 A*s = 3.6e15 uA*us
+
+int64_t ahToCharge_pC(float ah) { return llround((double)ah * PC_PER_AH); }
+float chargeToAh(int64_t charge_pC) { return (float)(charge_pC / PC_PER_AH); }
+
 // Factory tables removed in favor of linear calibration
 
 // Factory-calibrated table for the 100A shunt, based on user-provided data
-const std::vector<CalPoint> factory_cal_200A = {
+constexpr CalPoint factory_cal_200A[] = {
     {28.015135f, 50.000000f},         {4031.613037f, 4050.000244f},
     {8020.571289f, 8050.000000f},     {20000.863281f, 20050.000000f},
     {199728.696339f, 200050.000000f}, // extrapolated to 200 A
 };
 } // end anonymous namespace
 
-// Initialize the static map of factory default shunt resistances.
-const std::map<uint16_t, float> INA226_ADC::factory_shunt_resistances = {
-    {100, 0.001730000f}, {150, 0.000500000f}, {200, 0.005518110f},
-    {250, 0.000300000f}, {300, 0.000250000f}, {350, 0.000214286f},
-    {400, 0.000187500f}, {450, 0.000166667f}, {500, 0.000150000f}};
+namespace {
+// Factory default shunt resistances. The conductance is folded in at compile
+// time so the shunt-voltage current path is a single multiply per sample.
+struct FactoryShunt {
+  uint16_t ratedA;
+  float ohms;
+  float siemens;
+};
+
+constexpr FactoryShunt makeFactoryShunt(uint16_t ratedA, float ohms) {
+  return {ratedA, ohms, 1.0f / ohms};
+}
+
+constexpr FactoryShunt factory_shunts[] = {
+    makeFactoryShunt(100, 0.001730000f), makeFactoryShunt(150, 0.000500000f),
+    makeFactoryShunt(200, 0.005518110f), makeFactoryShunt(250, 0.000300000f),
+    makeFactoryShunt(300, 0.000250000f), makeFactoryShunt(350, 0.000214286f),
+    makeFactoryShunt(400, 0.000187500f), makeFactoryShunt(450, 0.000166667f),
+    makeFactoryShunt(500, 0.000150000f)};
+
+const FactoryShunt *findFactoryShunt(uint16_t ratedA) {
+  for (const FactoryShunt &shunt : factory_shunts) {
+    if (shunt.ratedA == ratedA) {
+      return &shunt;
+    }
+  }
+  return nullptr;
+}
+} // end anonymous namespace
 
 bool INA226_ADC::isSaturated() const {
     // Limit is +/- 81.92 mV. Check for >= 81.90mV to be safe.
     return (fabsf(shuntVoltage_mV) >= 81.90f);
 }
 
-const std::map<float, float> INA226_ADC::soc_voltage_map = {
-    {14.60, 100.0}, {14.45, 99.0}, {13.87, 95.0}, {13.30, 90.0}, {13.25, 80.0},
-    {13.20, 70.0},  {13.17, 60.0}, {13.13, 50.0}, {13.10, 40.0}, {13.00, 30.0},
-    {12.90, 20.0},  {12.80, 17.0}, {12.50, 14.0}, {12.00, 9.0},  {10.00, 0.0}};
-
 INA226_ADC::INA226_ADC(uint8_t address, float shuntResistorOhms,
                        float batteryCapacityAh)
     : ina226(address),
       defaultOhms(shuntResistorOhms > 0.0f ? shuntResistorOhms : 0.003286742f),
       calibratedOhms(shuntResistorOhms > 0.0f ? shuntResistorOhms : 0.003286742f),
-      batteryCapacity(batteryCapacityAh),
+      batteryCharge_pC(ahToCharge_pC(batteryCapacityAh)),
       maxBatteryCapacity(batteryCapacityAh),
-      lastUpdateTime(0),
       shuntVoltage_mV(-1),
       loadVoltage_V(-1),
       busVoltage_V(-1),
@@ -98,13 +134,25 @@ INA226_ADC::INA226_ADC(uint8_t address, float shuntResistorOhms,
       alertTriggered(false),
       m_isConfigured(false),
       m_activeShuntA(100), // Default to 100A
-      m_disconnectReason(NONE), m_hardwareAlertsDisabled(false), m_batteryState(0), sampleIndex(0),
-      sampleCount(0), lastSampleTime(0), sampleIntervalSeconds(10),
+      m_disconnectReason(NONE), m_hardwareAlertsDisabled(false), m_batteryState(0),
       lastEnergyUpdateTime(0), lastMinuteMark(0), currentMinuteEnergy_Ws(0.0f),
-      averagingState(STATE_UNKNOWN), m_socSyncStartTime(0) {
-  for (int i = 0; i < maxSamples; ++i)
-    currentSamples[i] = 0.0f;
-}
+      m_socSyncStartTime(0),
+      m_averages(AVERAGE_16), m_convTime(CONV_TIME_8244),
+      m_convReadyMode(false), m_alertPinEvents(0), m_alertPinEventsSeen(0),
+      m_alertEdge_us(0), m_conversionEdge_us(0), m_tripPending(false),
+      m_pendingTripLatency_us(0),
+      m_lastConversionMicros(0), m_missedConversions(0),
+      m_sampleI2cTransactions(0), m_adaptiveConversion(false),
+      m_rateWindowStart_us(0), m_rateWindowSamples(0), m_sampleRate_Hz(0.0f),
+      m_shuntCurrentPath(false), m_shuntSiemens(1.0f / calibratedOhms),
+      m_currentFilter(4), m_filteredRaw_mA(0.0f),
+      m_chargePrimed(false), m_lastChargeSample_us(0), m_lastCurrent_uA(0),
+      m_chargeRemainder_pC(0), m_maxSampleGap_us(1000000),
+      m_integrationGaps(0), m_longestGap_us(0), m_energyPrimed(false),
+      m_lastEnergySample_us(0), m_lastPower_mW(0.0f), m_socSeedVoltage_V(NAN),
+      m_batteryTemp_C(NAN), m_seedCorrection_pC(0), m_autoCompensation(false),
+      m_storedCompensation(0.0f), m_socFilterEnabled(false),
+      m_socFilterCorrection_percent(0.0f) {}
 
 void INA226_ADC::begin(int sdaPin, int sclPin) {
   esp_reset_reason_t reason = esp_reset_reason();
@@ -128,32 +176,34 @@ void INA226_ADC::begin(int sdaPin, int sclPin) {
   pinMode(INA_ALERT_PIN, INPUT_PULLUP);
 
   // Load active shunt rating
-  Preferences prefs;
-  prefs.begin(NVS_CAL_NAMESPACE, true);
-  m_activeShuntA = prefs.getUShort(NVS_KEY_ACTIVE_SHUNT, 100); // Default 100A
-  m_activeShuntA = prefs.getUShort(NVS_KEY_ACTIVE_SHUNT, 100); // Default 100A
+  m_activeShuntA = settings.getUShort(NVS_CAL_NAMESPACE, NVS_KEY_ACTIVE_SHUNT, 100); // Default 100A
   
   // Load max battery capacity if it exists
-  if (prefs.isKey("max_cap")) {
-      maxBatteryCapacity = prefs.getFloat("max_cap", 100.0f);
+  if (settings.isKey(NVS_CAL_NAMESPACE, "max_cap")) {
+      maxBatteryCapacity = settings.getFloat(NVS_CAL_NAMESPACE, "max_cap", 100.0f);
       Serial.printf("Loaded max battery capacity from NVS: %.2f Ah\n", maxBatteryCapacity);
   }
-  prefs.end();
   Serial.printf("Using active shunt rating: %dA\n", m_activeShuntA);
 
+  const uint32_t statsWindow_ms = settings.getUInt(
+      NVS_CAL_NAMESPACE, "stats_win", SignalStats::DEFAULT_WINDOW_MS);
+  m_currentStats.setWindow_ms(statsWindow_ms);
+  m_voltageStats.setWindow_ms(statsWindow_ms);
+  m_socFilterEnabled = settings.getBool(NVS_CAL_NAMESPACE, "soc_ekf", false);
+
   ina226.init();
   ina226.waitUntilConversionCompleted();
 
-  ina226.setAverage(AVERAGE_16);
-  ina226.setConversionTime(CONV_TIME_8244);
+  ina226.setAverage(m_averages);
+  ina226.setConversionTime(m_convTime);
 
   // Try to load the custom calibrated shunt resistance.
   // If it fails, use the factory default for the active shunt.
   this->m_isConfigured = loadShuntResistance();
   if (!this->m_isConfigured) {
-    auto it = factory_shunt_resistances.find(m_activeShuntA);
-    if (it != factory_shunt_resistances.end()) {
-      calibratedOhms = it->second;
+    const FactoryShunt *factory = findFactoryShunt(m_activeShuntA);
+    if (factory != nullptr) {
+      calibratedOhms = factory->ohms;
       Serial.printf("No custom calibrated shunt resistance found. Using "
                     "factory default for %dA shunt: %.9f Ohms.\n",
                     m_activeShuntA, calibratedOhms);
@@ -176,7 +226,11 @@ void INA226_ADC::begin(int sdaPin, int sclPin) {
   Serial.printf("INA226 boot cfg: activeShunt=%u A, Rsh=%.9f Ohm\n",
                 m_activeShuntA, calibratedOhms);
   // Load the calibration table for the active shunt
-  if (loadCalibrationTable(m_activeShuntA)) {
+  const uint32_t calLoadStart_us = micros();
+  const bool calLoaded = loadCalibrationTable(m_activeShuntA);
+  Serial.printf("Calibration table lookup took %lu us.\n",
+                (unsigned long)(micros() - calLoadStart_us));
+  if (calLoaded) {
     Serial.printf("Loaded custom calibration table for %dA shunt.\n",
                   m_activeShuntA);
   } else {
@@ -202,15 +256,38 @@ void INA226_ADC::begin(int sdaPin, int sclPin) {
       configureAlert(overcurrentThreshold);
   }
   setInitialSOC();
+  loadLifetimeCounters();
+  loadCycleCounter();
 
   resetUplinkAverage(); // Init accumulator
 }
 
 void INA226_ADC::readSensors() {
-  ina226.readAndClearFlags();
-  float new_shuntVoltage_mV = ina226.getShuntVoltage_mV();
-  float new_busVoltage_V = ina226.getBusVoltage_V();
-  float new_current_mA = ina226.getCurrent_mA(); // raw mA
+  // One batched read of flags + measurement registers. Reading Mask/Enable
+  // clears CVRF and releases the ALERT pin; in conversion-ready mode the same
+  // read tells an over-limit event (AFF) apart from a conversion-ready edge.
+  const uint32_t txStart = ina226.getI2cTransactionCount();
+  INA226_RAW_VALUES raw;
+  ina226.readMeasurements(raw, !m_shuntCurrentPath);
+  m_sampleI2cTransactions = ina226.getI2cTransactionCount() - txStart;
+
+  if (m_convReadyMode && ina226.limitAlert && !m_hardwareAlertsDisabled) {
+    // Open the switch before anything else; processAlert() books it
+    if (loadConnected && !m_tripPending) {
+      openLoadSwitch();
+      const int64_t now_us = esp_timer_get_time();
+      m_pendingTripLatency_us =
+          (uint32_t)(now_us - (m_conversionEdge_us ? m_conversionEdge_us : now_us));
+      m_tripPending = true;
+    }
+    alertTriggered = true;
+  }
+  float new_shuntVoltage_mV = ina226.rawShuntToMilliVolts(raw.shunt);
+  float new_busVoltage_V = ina226.rawBusToVolts(raw.bus);
+  // raw mA, before table/linear calibration
+  float new_current_mA = m_shuntCurrentPath
+                             ? new_shuntVoltage_mV * m_shuntSiemens
+                             : ina226.rawCurrentToMilliAmps(raw.current);
 
   // Sanity check: Filter out insane current values
   // Defined as values > 2x the rated active shunt capacity or NaN/Inf
@@ -224,6 +301,19 @@ void INA226_ADC::readSensors() {
   } else {
     current_mA = new_current_mA;
     shuntVoltage_mV = new_shuntVoltage_mV;
+
+    // Oversample the counts new_current_mA came from; the filter output
+    // has sub-LSB resolution that the single reading above does not.
+    int32_t filteredCounts;
+    if (m_currentFilter.push(m_shuntCurrentPath ? raw.shunt : raw.current,
+                             filteredCounts)) {
+      const float lsb_mA =
+          m_shuntCurrentPath
+              ? ina226.rawShuntToMilliVolts(1) * m_shuntSiemens
+              : ina226.rawCurrentToMilliAmps(1);
+      m_filteredRaw_mA = lsb_mA * filteredCounts /
+                         (float)(1 << DecimationFilter::FRAC_BITS);
+    }
   }
 
   busVoltage_V = new_busVoltage_V;
@@ -280,6 +370,22 @@ void INA226_ADC::readSensors() {
         m_batteryState = 7; // High Current Warning
     }
 #endif
+
+  const uint32_t now_ms = millis();
+  m_currentStats.add(getCurrent_mA(), now_ms);
+  m_voltageStats.add(busVoltage_V, now_ms);
+
+  const int64_t now_us = esp_timer_get_time();
+  updateSampleRate(now_us);
+  m_runFlat.update(getCurrent_mA() / 1000.0f, now_us);
+  if (m_resistance.update(getCurrent_mA() / 1000.0f, busVoltage_V, now_us) &&
+      m_autoCompensation) {
+    applyResistanceEstimate();
+  }
+  if (m_adaptiveConversion &&
+      m_convController.update(getCurrent_mA() / 1000.0f, now_us)) {
+    applyConversionProfile(m_convController.getProfile());
+  }
 }
 
 float INA226_ADC::getShuntVoltage_mV() const { return shuntVoltage_mV; }
@@ -287,29 +393,45 @@ float INA226_ADC::getBusVoltage_V() const { return busVoltage_V; }
 float INA226_ADC::getRawCurrent_mA() const { return current_mA; }
 
 float INA226_ADC::getCurrent_mA() const {
+  return applyCalibration_mA(current_mA);
+}
+
+float INA226_ADC::getFilteredCurrent_mA() const {
+  if (!m_currentFilter.isPrimed()) {
+    return getCurrent_mA();
+  }
+  return applyCalibration_mA(m_filteredRaw_mA);
+}
+
+float INA226_ADC::applyCalibration_mA(float raw_mA) const {
   float result_mA;
-  if (!calibrationTable.empty()) {
-    result_mA = getCalibratedCurrent_mA(current_mA);
+  if (!calibrationCurve.empty()) {
+    result_mA = getCalibratedCurrent_mA(raw_mA);
   } else {
     // fallback: linear
-    result_mA = (current_mA * calibrationGain) + calibrationOffset_mA;
+    result_mA = (raw_mA * calibrationGain) + calibrationOffset_mA;
   }
 
   return -result_mA;
 }
 
+void INA226_ADC::setCurrentDecimation(uint8_t factor) {
+  m_currentFilter.setDecimation(factor);
+}
+
+uint8_t INA226_ADC::getCurrentDecimation() const {
+  return m_currentFilter.getDecimation();
+}
+
 void INA226_ADC::setInitialSOC() {
   // Check RTC first for restored capacity
   if (rtcData.magic == RTC_MAGIC && rtcData.hasCapacity) {
-    batteryCapacity = rtcData.batteryCapacity;
-    if (batteryCapacity < 0)
-      batteryCapacity = 0;
-    if (batteryCapacity > maxBatteryCapacity)
-      batteryCapacity = maxBatteryCapacity;
+    batteryCharge_pC = rtcData.batteryCharge_pC;
+    clampBatteryCharge();
 
-    lastUpdateTime = millis();
+    m_chargePrimed = false; // restart integration from the next sample
     Serial.printf("Restored battery capacity from RTC: %.2f Ah\n",
-                  batteryCapacity);
+                  getBatteryCapacity());
     return;
   }
 
@@ -348,6 +470,8 @@ void INA226_ADC::setInitialSOC() {
   }
 
   float soc_percent = 50.0; // Default SOC
+  m_socSeedVoltage_V = NAN;
+  m_seedCorrection_pC = 0;
 
   // Handle special cases
   if (voltage <= 11.6) {
@@ -355,32 +479,19 @@ void INA226_ADC::setInitialSOC() {
   } else if (voltage >= 14.0) {
     soc_percent = 100.0;
   } else {
-    // Lookup SOC from the map
-    auto it = soc_voltage_map.lower_bound(voltage);
-    if (it == soc_voltage_map.end()) {
-      soc_percent = 100.0;
-    } else if (it == soc_voltage_map.begin()) {
-      soc_percent = 0.0;
-    } else {
-      // Linear interpolation
-      float v_high = it->first;
-      float soc_high = it->second;
-      it--;
-      float v_low = it->first;
-      float soc_low = it->second;
-
-      if (v_high > v_low) {
-        soc_percent =
-            soc_low + ((voltage - v_low) * (soc_high - soc_low)) / (v_high - v_low);
-      } else {
-        soc_percent = soc_low;
-      }
+    // The temperature sensor is usually not heard from until after boot; seed
+    // at the reference temperature and correct once a reading arrives.
+    const bool haveTemp = !isnan(m_batteryTemp_C);
+    soc_percent = ocv::socPercent(voltage, haveTemp ? m_batteryTemp_C
+                                                    : ocv::REFERENCE_TEMP_C);
+    if (!haveTemp && ocv::TEMPERATURE_DEPENDENT) {
+      m_socSeedVoltage_V = voltage;
     }
   }
 
   // Set the battery capacity based on the calculated SOC
-  batteryCapacity = maxBatteryCapacity * (soc_percent / 100.0f);
-  lastUpdateTime = millis();
+  batteryCharge_pC = ahToCharge_pC(maxBatteryCapacity * (soc_percent / 100.0f));
+  m_chargePrimed = false; // restart integration from the next sample
 
   // Initialize RTC data if invalid
   if (rtcData.magic != RTC_MAGIC) {
@@ -388,70 +499,93 @@ void INA226_ADC::setInitialSOC() {
     rtcData.magic = RTC_MAGIC;
   }
   // Save initial estimate to RTC
-  rtcData.batteryCapacity = batteryCapacity;
-  rtcData.hasCapacity = true;
+  syncChargeToRtc();
 
   Serial.printf("Initial SOC set to %.2f%% based on averaged voltage of %.2fV. "
                 "Initial capacity: %.2fAh\n",
-                soc_percent, voltage, batteryCapacity);
+                soc_percent, voltage, getBatteryCapacity());
 }
 
 float INA226_ADC::getCalibratedCurrent_mA(float raw_mA) const {
-
-  if (calibrationTable.size() < 2)
+  if (calibrationCurve.size() < 2)
     return raw_mA;
-  if (calibrationTable.empty()) {
-    return raw_mA;
-  }
 
   // Handle negative currents by assuming symmetric calibration around zero.
-  const bool is_negative = raw_mA < 0.0f;
-  const float abs_raw_mA = fabsf(raw_mA);
-
-  float calibrated_abs_mA;
-
-  // If the absolute value is below or at the first calibration point,
-  // use the first calibration point's true value (which should be 0).
-  if (abs_raw_mA <= calibrationTable.front().raw_mA) {
-    calibrated_abs_mA = calibrationTable.front().true_mA;
-  }
-  // If the absolute value is above or at the last calibration point,
-  // clamp to the last point's true value.
-  else if (abs_raw_mA >= calibrationTable.back().raw_mA) {
-    calibrated_abs_mA = calibrationTable.back().true_mA;
-  }
-  // Otherwise, find the interval and linearly interpolate.
-  else {
-    calibrated_abs_mA = abs_raw_mA; // Fallback
-    for (size_t i = 1; i < calibrationTable.size(); ++i) {
-      if (abs_raw_mA < calibrationTable[i].raw_mA) {
-        const float x0 = calibrationTable[i - 1].raw_mA;
-        const float y0 = calibrationTable[i - 1].true_mA;
-        const float x1 = calibrationTable[i].raw_mA;
-        const float y1 = calibrationTable[i].true_mA;
-
-        if (fabsf(x1 - x0) < 1e-9f) {
-          calibrated_abs_mA =
-              y0; // Should not happen with sorted, deduped points
-        } else {
-          calibrated_abs_mA = y0 + (abs_raw_mA - x0) * (y1 - y0) / (x1 - x0);
-        }
-        break; // Interval found
-      }
-    }
-  }
+  // Below the first point the curve holds the first point's true value
+  // (which should be 0); above the last point it clamps to the last.
+  const float calibrated_abs_mA = calibrationCurve.evaluate(fabsf(raw_mA));
+  return raw_mA < 0.0f ? -calibrated_abs_mA : calibrated_abs_mA;
+}
 
-  return is_negative ? -calibrated_abs_mA : calibrated_abs_mA;
+bool INA226_ADC::setCalibrationPoints(const std::vector<CalPoint> &pts) {
+  m_currentFilter.reset();
+  return calibrationCurve.assign(
+      pts.data(), pts.size(), [](const CalPoint &p) { return p.raw_mA; },
+      [](const CalPoint &p) { return p.true_mA; });
 }
 
 float INA226_ADC::getPower_mW() const { return power_mW; }
 float INA226_ADC::getLoadVoltage_V() const { return loadVoltage_V; }
-float INA226_ADC::getBatteryCapacity() const { return batteryCapacity; }
+float INA226_ADC::getBatteryCapacity() const { return chargeToAh(batteryCharge_pC); }
 void INA226_ADC::setBatteryCapacity(float capacity) {
-  batteryCapacity = capacity;
+  setBatteryCharge_pC(ahToCharge_pC(capacity));
+}
+
+int64_t INA226_ADC::getBatteryCharge_pC() const { return batteryCharge_pC; }
+void INA226_ADC::setBatteryCharge_pC(int64_t charge_pC) {
+  batteryCharge_pC = charge_pC;
+  m_socSeedVoltage_V = NAN; // an explicit charge supersedes the OCV seed
+  m_seedCorrection_pC = 0;
+  m_socFilter.resetSoc(1.0f);
+  syncChargeToRtc();
+}
+
+void INA226_ADC::setBatteryTemperature_C(float temperature_C) {
+  m_batteryTemp_C = temperature_C;
+  m_socFilter.setTemperature_C(temperature_C);
+  if (!ocv::TEMPERATURE_DEPENDENT || isnan(m_socSeedVoltage_V) ||
+      isnan(temperature_C)) {
+    return;
+  }
+
+  const float seed = m_socSeedVoltage_V;
+  m_socSeedVoltage_V = NAN;
+  const float delta_percent = ocv::socPercent(seed, temperature_C) -
+                              ocv::socPercent(seed, ocv::REFERENCE_TEMP_C);
+  // Slewed in by updateBatteryCapacity rather than applied at once, so one
+  // reading never steps SOC; charge counted since boot is kept.
+  m_seedCorrection_pC = ahToCharge_pC(maxBatteryCapacity * delta_percent / 100.0f);
+  Serial.printf("SOC seed correction for %.1fC: %+.1f%%, applied at %.2f%%/s\n",
+                temperature_C, delta_percent, SEED_CORRECTION_SLEW_PERCENT_PER_S);
+}
+
+void INA226_ADC::slewSeedCorrection(int64_t deltaTime_us) {
+  if (m_seedCorrection_pC == 0) {
+    return;
+  }
+  const int64_t limit_pC =
+      ahToCharge_pC(maxBatteryCapacity * SEED_CORRECTION_SLEW_PERCENT_PER_S /
+                    100.0f * (deltaTime_us / 1e6f));
+  const int64_t step_pC =
+      std::max(-limit_pC, std::min(limit_pC, m_seedCorrection_pC));
+  batteryCharge_pC += step_pC;
+  m_seedCorrection_pC -= step_pC;
+}
+
+void INA226_ADC::clampBatteryCharge() {
+  const int64_t maxCharge_pC = ahToCharge_pC(maxBatteryCapacity);
+  if (batteryCharge_pC < 0)
+    batteryCharge_pC = 0;
+  if (batteryCharge_pC > maxCharge_pC)
+    batteryCharge_pC = maxCharge_pC;
+}
+
+void INA226_ADC::syncChargeToRtc() {
   if (rtcData.magic == RTC_MAGIC) {
-      rtcData.batteryCapacity = batteryCapacity;
+      rtcData.batteryCharge_pC = batteryCharge_pC;
       rtcData.hasCapacity = true;
+      rtcData.lifetime = m_lifetime.getTotals();
+      rtcData.hasLifetime = true;
   }
 }
 
@@ -461,10 +595,7 @@ void INA226_ADC::setMaxBatteryCapacity(float capacityAh) {
   maxBatteryCapacity = capacityAh;
   Serial.printf("New max battery capacity set: %.2f Ah\n", maxBatteryCapacity);
   
-  Preferences prefs;
-  prefs.begin(NVS_CAL_NAMESPACE, false);
-  prefs.putFloat("max_cap", maxBatteryCapacity);
-  prefs.end();
+  settings.putFloat(NVS_CAL_NAMESPACE, "max_cap", maxBatteryCapacity);
 }
 
 float INA226_ADC::getMaxBatteryCapacity() const {
@@ -473,22 +604,19 @@ float INA226_ADC::getMaxBatteryCapacity() const {
 
 void INA226_ADC::setRatedCapacity_Ah(float capacity) {
     // Calculate current SOC percentage using the OLD max capacity
-    float currentSocPercent = (maxBatteryCapacity > 0) ? (batteryCapacity / maxBatteryCapacity) : 0.0f;
+    float currentSocPercent = (maxBatteryCapacity > 0) ? (getBatteryCapacity() / maxBatteryCapacity) : 0.0f;
     
     // Update to NEW max capacity
     maxBatteryCapacity = capacity;
     
     // Recalculate remaining capacity (Ah) to match the same SOC percentage
-    batteryCapacity = maxBatteryCapacity * currentSocPercent;
+    batteryCharge_pC = ahToCharge_pC(maxBatteryCapacity * currentSocPercent);
     
     // Save to NVS
-    Preferences prefs;
-    prefs.begin(NVS_PROTECTION_NAMESPACE, false);
-    prefs.putFloat("rated_cap", maxBatteryCapacity);
-    prefs.end();
+    settings.putFloat(NVS_PROTECTION_NAMESPACE, "rated_cap", maxBatteryCapacity);
     
     Serial.printf("Rated capacity set to %.2fAh (saved to NVS). Current capacity: %.2fAh (%.1f%% SOC)\n", 
-                  maxBatteryCapacity, batteryCapacity, currentSocPercent);
+                  maxBatteryCapacity, getBatteryCapacity(), currentSocPercent);
 }
 
 float INA226_ADC::getRatedCapacity_Ah() const {
@@ -501,18 +629,15 @@ void INA226_ADC::setSOC_percent(float percent) {
   } else if (percent > 100.0f) {
     percent = 100.0f;
   }
-  batteryCapacity = maxBatteryCapacity * (percent / 100.0f);
-  if (rtcData.magic == RTC_MAGIC) {
-      rtcData.batteryCapacity = batteryCapacity;
-      rtcData.hasCapacity = true;
-  }
+  setBatteryCharge_pC(ahToCharge_pC(maxBatteryCapacity * (percent / 100.0f)));
   Serial.printf("SOC set to %.2f%%. New capacity: %.2fAh\n", percent,
-                batteryCapacity);
+                getBatteryCapacity());
 }
 
 void INA226_ADC::setCalibration(float gain, float offset_mA) {
   calibrationGain = gain;
   calibrationOffset_mA = offset_mA;
+  m_currentFilter.reset();
 }
 
 void INA226_ADC::getCalibration(float &gainOut, float &offsetOut) const {
@@ -524,17 +649,14 @@ void INA226_ADC::getCalibration(float &gainOut, float &offsetOut) const {
 // Returns true if a persisted calibration existed and was applied; false
 // otherwise.
 bool INA226_ADC::loadCalibration(uint16_t shuntRatedA) {
-  Preferences prefs;
-  prefs.begin("ina_cal", true);
   char keyGain[16];
   char keyOff[16];
   snprintf(keyGain, sizeof(keyGain), "g_%u", (unsigned)shuntRatedA);
   snprintf(keyOff, sizeof(keyOff), "o_%u", (unsigned)shuntRatedA);
 
   const float sentinel = 1e30f;
-  float g = prefs.getFloat(keyGain, sentinel);
-  float o = prefs.getFloat(keyOff, sentinel);
-  prefs.end();
+  float g = settings.getFloat("ina_cal", keyGain, sentinel);
+  float o = settings.getFloat("ina_cal", keyOff, sentinel);
 
   if (g == sentinel && o == sentinel) {
     // No stored calibration for this shunt rating
@@ -558,17 +680,14 @@ bool INA226_ADC::loadCalibration(uint16_t shuntRatedA) {
 bool INA226_ADC::getStoredCalibrationForShunt(uint16_t shuntRatedA,
                                               float &gainOut,
                                               float &offsetOut) const {
-  Preferences prefs;
-  prefs.begin("ina_cal", true);
   char keyGain[16];
   char keyOff[16];
   snprintf(keyGain, sizeof(keyGain), "g_%u", (unsigned)shuntRatedA);
   snprintf(keyOff, sizeof(keyOff), "o_%u", (unsigned)shuntRatedA);
 
   const float sentinel = 1e30f;
-  float g = prefs.getFloat(keyGain, sentinel);
-  float o = prefs.getFloat(keyOff, sentinel);
-  prefs.end();
+  float g = settings.getFloat("ina_cal", keyGain, sentinel);
+  float o = settings.getFloat("ina_cal", keyOff, sentinel);
 
   if (g == sentinel && o == sentinel) {
     return false;
@@ -587,15 +706,12 @@ bool INA226_ADC::getStoredCalibrationForShunt(uint16_t shuntRatedA,
 
 bool INA226_ADC::saveCalibration(uint16_t shuntRatedA, float gain,
                                  float offset_mA) {
-  Preferences prefs;
-  prefs.begin("ina_cal", false);
   char keyGain[16];
   char keyOff[16];
   snprintf(keyGain, sizeof(keyGain), "g_%u", (unsigned)shuntRatedA);
   snprintf(keyOff, sizeof(keyOff), "o_%u", (unsigned)shuntRatedA);
-  prefs.putFloat(keyGain, gain);
-  prefs.putFloat(keyOff, offset_mA);
-  prefs.end();
+  settings.putFloat("ina_cal", keyGain, gain);
+  settings.putFloat("ina_cal", keyOff, offset_mA);
 
   calibrationGain = gain;
   calibrationOffset_mA = offset_mA;
@@ -604,10 +720,7 @@ bool INA226_ADC::saveCalibration(uint16_t shuntRatedA, float gain,
 
 // New method to save calibrated shunt resistance to NVS
 bool INA226_ADC::saveShuntResistance(float resistance) {
-  Preferences prefs;
-  prefs.begin("ina_cal", false);
-  prefs.putFloat("cal_ohms", resistance);
-  prefs.end();
+  settings.putFloat("ina_cal", "cal_ohms", resistance);
   calibratedOhms = resistance;
 
   // Immediately apply the new resistance to the INA226 configuration
@@ -621,24 +734,12 @@ bool INA226_ADC::saveShuntResistance(float resistance) {
 
 // New method to load calibrated shunt resistance from NVS
 bool INA226_ADC::loadShuntResistance() {
-  Preferences prefs;
-  // Start preferences in read-only mode
-  if (!prefs.begin("ina_cal", true)) {
-    // Namespace does not exist, so it's not configured.
-    // We can end here, no need to print an error as this is expected on first
-    // boot.
-    prefs.end();
-    return false;
-  }
-
-  // Check if the key exists
-  if (!prefs.isKey("cal_ohms")) {
-    prefs.end();
+  // Not configured yet; expected on first boot
+  if (!settings.isKey("ina_cal", "cal_ohms")) {
     return false;
   }
 
-  float resistance = prefs.getFloat("cal_ohms", -1.0f);
-  prefs.end();
+  float resistance = settings.getFloat("ina_cal", "cal_ohms", -1.0f);
 
   if (resistance > 0.0f) {
     calibratedOhms = resistance;
@@ -651,9 +752,9 @@ bool INA226_ADC::loadShuntResistance() {
 }
 
 bool INA226_ADC::loadFactoryDefaultResistance(uint16_t shuntRatedA) {
-  auto it = factory_shunt_resistances.find(shuntRatedA);
-  if (it != factory_shunt_resistances.end()) {
-    float factoryOhms = it->second;
+  const FactoryShunt *factory = findFactoryShunt(shuntRatedA);
+  if (factory != nullptr) {
+    float factoryOhms = factory->ohms;
 
     // Save the factory default resistance to NVS so it persists.
     // This is better than just removing the key, which would cause
@@ -679,12 +780,12 @@ bool INA226_ADC::loadFactoryDefaultResistance(uint16_t shuntRatedA) {
 
 bool INA226_ADC::getFactoryDefaultResistance(uint16_t shuntRatedA,
                                              float &outOhms) const {
-  auto it = factory_shunt_resistances.find(shuntRatedA);
-  if (it == factory_shunt_resistances.end()) {
+  const FactoryShunt *factory = findFactoryShunt(shuntRatedA);
+  if (factory == nullptr) {
     return false;
   }
 
-  outOhms = it->second;
+  outOhms = factory->ohms;
   return true;
 }
 
@@ -718,6 +819,16 @@ void INA226_ADC::applyShuntConfiguration() {
     currentLsbA = 0.0001f;
 
   ina226.setCalibration(shunt, currentLsbA);
+
+  // Conductance for the shunt-voltage current path; the factory value is a
+  // compile-time constant, a calibrated resistance costs one divide here.
+  const FactoryShunt *factory = findFactoryShunt(m_activeShuntA);
+  m_shuntSiemens = (factory != nullptr && factory->ohms == shunt)
+                       ? factory->siemens
+                       : 1.0f / shunt;
+  // Counts already in the filter were taken at the old LSB
+  m_currentFilter.reset();
+
   Serial.printf("Configured INA226: Rsh=%.9f Ohm, I_LSB=%.6f A (max~=%.2f A)\n",
                 shunt, currentLsbA, maxCurrentA);
   Serial.printf("Configured INA226: Rsh=%.9f Ω, I_LSB=%.6f A (max≈%.2f A).\n",
@@ -743,93 +854,157 @@ static void sortAndDedup(std::vector<CalPoint> &pts) {
   pts.swap(out);
 }
 
-bool INA226_ADC::saveCalibrationTable(uint16_t shuntRatedA,
-                                      const std::vector<CalPoint> &points) {
-  std::vector<CalPoint> pts = points;
-  if (pts.empty())
-    return false;
-  sortAndDedup(pts);
-
-  Preferences prefs;
-  prefs.begin("ina_cal", false);
+namespace {
+// One blob per shunt rating; tables from older firmware used n_/r_/t_ keys
+// (a count plus two floats per point) and are migrated on first load.
+void calibrationBlobKey(char *key, size_t len, uint16_t shuntRatedA) {
+  snprintf(key, len, "cal_%u", (unsigned)shuntRatedA);
+}
 
-  // Store number of points
+void readLegacyCalibrationTable(Preferences &prefs, uint16_t shuntRatedA,
+                                std::vector<CalPoint> &pts) {
   char keyCount[16];
   snprintf(keyCount, sizeof(keyCount), "n_%u", (unsigned)shuntRatedA);
-  prefs.putUInt(keyCount, (uint32_t)pts.size());
+  uint32_t N = prefs.getUInt(keyCount, 0);
 
-  // Store each point
-  for (size_t i = 0; i < pts.size(); i++) {
+  pts.clear();
+  pts.reserve(N);
+  for (uint32_t i = 0; i < N; i++) {
     char keyRaw[20], keyTrue[20];
     snprintf(keyRaw, sizeof(keyRaw), "r_%u_%u", (unsigned)shuntRatedA,
              (unsigned)i);
     snprintf(keyTrue, sizeof(keyTrue), "t_%u_%u", (unsigned)shuntRatedA,
              (unsigned)i);
-    prefs.putFloat(keyRaw, pts[i].raw_mA);
-    prefs.putFloat(keyTrue, pts[i].true_mA);
+    float raw = prefs.getFloat(keyRaw, NAN);
+    float tru = prefs.getFloat(keyTrue, NAN);
+    if (isnan(raw) || isnan(tru))
+      continue;
+    pts.push_back({raw, tru});
   }
-
-  prefs.end();
-  calibrationTable = std::move(pts);
-  return true;
 }
 
-bool INA226_ADC::loadCalibrationTable(uint16_t shuntRatedA) {
-  Preferences prefs;
-  prefs.begin("ina_cal", true);
-
+void removeLegacyCalibrationTable(Preferences &prefs, uint16_t shuntRatedA) {
   char keyCount[16];
   snprintf(keyCount, sizeof(keyCount), "n_%u", (unsigned)shuntRatedA);
   uint32_t N = prefs.getUInt(keyCount, 0);
 
-  if (N == 0) {
-    prefs.end();
-    calibrationTable.clear();
-    return false;
-  }
+  // Remove count first
+  prefs.remove(keyCount);
 
-  std::vector<CalPoint> pts;
-  pts.reserve(N);
+  // Remove individual points if they existed
   for (uint32_t i = 0; i < N; i++) {
     char keyRaw[20], keyTrue[20];
     snprintf(keyRaw, sizeof(keyRaw), "r_%u_%u", (unsigned)shuntRatedA,
              (unsigned)i);
     snprintf(keyTrue, sizeof(keyTrue), "t_%u_%u", (unsigned)shuntRatedA,
              (unsigned)i);
-    float raw = prefs.getFloat(keyRaw, NAN);
-    float tru = prefs.getFloat(keyTrue, NAN);
-    if (isnan(raw) || isnan(tru))
-      continue;
-    pts.push_back({raw, tru});
+    prefs.remove(keyRaw);
+    prefs.remove(keyTrue);
+  }
+}
+} // end anonymous namespace
+
+bool INA226_ADC::saveCalibrationTable(uint16_t shuntRatedA,
+                                      const std::vector<CalPoint> &points) {
+  std::vector<CalPoint> pts = points;
+  if (pts.empty())
+    return false;
+  sortAndDedup(pts);
+  if (pts.size() > MAX_CAL_POINTS) {
+    Serial.printf("Calibration table has %u points; at most %u are supported.\n",
+                  (unsigned)pts.size(), (unsigned)MAX_CAL_POINTS);
+    return false;
+  }
+
+  Preferences prefs;
+  prefs.begin("ina_cal", false);
+  char key[16];
+  calibrationBlobKey(key, sizeof(key), shuntRatedA);
+  bool ok = CalibrationBlob::write<CalPoint, MAX_CAL_POINTS>(prefs, key, pts.data(),
+                                                             pts.size());
+  if (ok) {
+    removeLegacyCalibrationTable(prefs, shuntRatedA);
+  }
+  prefs.end();
+
+  if (!ok) {
+    Serial.printf("Failed to write calibration table for %uA shunt.\n",
+                  (unsigned)shuntRatedA);
+    return false;
+  }
+  setCalibrationPoints(pts);
+  return true;
+}
+
+bool INA226_ADC::loadCalibrationTable(uint16_t shuntRatedA) {
+  Preferences prefs;
+  prefs.begin("ina_cal", false); // writable so a legacy table can be migrated
+
+  char key[16];
+  calibrationBlobKey(key, sizeof(key), shuntRatedA);
+  CalPoint stored[MAX_CAL_POINTS];
+  bool found = false;
+  size_t n = CalibrationBlob::read<CalPoint, MAX_CAL_POINTS>(prefs, key, stored, found);
+
+  std::vector<CalPoint> pts(stored, stored + n);
+  if (found && n == 0) {
+    Serial.printf("Calibration table for %uA shunt is corrupt; ignoring it.\n",
+                  (unsigned)shuntRatedA);
+  } else if (!found) {
+    readLegacyCalibrationTable(prefs, shuntRatedA, pts);
+    if (!pts.empty()) {
+      sortAndDedup(pts);
+      if (pts.size() <= MAX_CAL_POINTS &&
+          CalibrationBlob::write<CalPoint, MAX_CAL_POINTS>(prefs, key, pts.data(),
+                                                           pts.size())) {
+        removeLegacyCalibrationTable(prefs, shuntRatedA);
+        Serial.printf("Migrated %u-point calibration table for %uA shunt to a "
+                      "single blob.\n",
+                      (unsigned)pts.size(), (unsigned)shuntRatedA);
+      }
+    }
   }
   prefs.end();
 
   if (pts.empty()) {
-    calibrationTable.clear();
+    calibrationCurve.clear();
     return false;
   }
   sortAndDedup(pts);
-  calibrationTable = std::move(pts);
-  return true;
+  return setCalibrationPoints(pts); // fails if more than MAX_CAL_POINTS
 }
 
 bool INA226_ADC::hasCalibrationTable() const {
-  return !calibrationTable.empty();
+  return !calibrationCurve.empty();
 }
 
-const std::vector<CalPoint> &INA226_ADC::getCalibrationTable() const {
-  return calibrationTable;
+std::vector<CalPoint> INA226_ADC::getCalibrationTable() const {
+  std::vector<CalPoint> table;
+  table.reserve(calibrationCurve.size());
+  for (size_t i = 0; i < calibrationCurve.size(); i++) {
+    const auto pt = calibrationCurve.point(i);
+    table.push_back({pt.x, pt.y});
+  }
+  return table;
 }
 
 bool INA226_ADC::hasStoredCalibrationTable(uint16_t shuntRatedA,
                                            size_t &countOut) const {
   Preferences prefs;
   prefs.begin("ina_cal", true);
-  char keyCount[16];
-  snprintf(keyCount, sizeof(keyCount), "n_%u", (unsigned)shuntRatedA);
-  uint32_t N = prefs.getUInt(keyCount, 0);
+  char key[16];
+  calibrationBlobKey(key, sizeof(key), shuntRatedA);
+  CalPoint stored[MAX_CAL_POINTS];
+  bool found = false;
+  size_t N = CalibrationBlob::read<CalPoint, MAX_CAL_POINTS>(prefs, key, stored, found);
+  if (!found) {
+    // Not migrated yet
+    char keyCount[16];
+    snprintf(keyCount, sizeof(keyCount), "n_%u", (unsigned)shuntRatedA);
+    N = prefs.getUInt(keyCount, 0);
+  }
   prefs.end();
-  countOut = (size_t)N;
+  countOut = N;
   return (N > 0);
 }
 
@@ -837,38 +1012,28 @@ bool INA226_ADC::clearCalibrationTable(uint16_t shuntRatedA) {
   Preferences prefs;
   prefs.begin("ina_cal", false);
 
-  char keyCount[16];
-  snprintf(keyCount, sizeof(keyCount), "n_%u", (unsigned)shuntRatedA);
-  uint32_t N = prefs.getUInt(keyCount, 0);
-
-  // Remove count first
-  prefs.remove(keyCount);
-
-  // Remove individual points if they existed
-  for (uint32_t i = 0; i < N; i++) {
-    char keyRaw[20], keyTrue[20];
-    snprintf(keyRaw, sizeof(keyRaw), "r_%u_%u", (unsigned)shuntRatedA,
-             (unsigned)i);
-    snprintf(keyTrue, sizeof(keyTrue), "t_%u_%u", (unsigned)shuntRatedA,
-             (unsigned)i);
-    prefs.remove(keyRaw);
-    prefs.remove(keyTrue);
-  }
+  char key[16];
+  calibrationBlobKey(key, sizeof(key), shuntRatedA);
+  prefs.remove(key);
+  removeLegacyCalibrationTable(prefs, shuntRatedA);
 
   prefs.end();
-  calibrationTable.clear();
+  calibrationCurve.clear();
   return true;
 }
 
 bool INA226_ADC::loadFactoryCalibrationTable(uint16_t shuntRatedA) {
-  const std::vector<CalPoint> *factory_table = nullptr;
+  const CalPoint *factory_table = nullptr;
+  size_t factory_count = 0;
 
   // Factory tables are deprecated. Always return false to use linear calculation.
   return false;
 
   if (factory_table) {
     // saveCalibrationTable persists to NVS and loads into RAM
-    if (saveCalibrationTable(shuntRatedA, *factory_table)) {
+    if (saveCalibrationTable(shuntRatedA,
+                             std::vector<CalPoint>(factory_table,
+                                                   factory_table + factory_count))) {
       Serial.printf(
           "Successfully loaded and saved factory calibration for %dA shunt.\\n",
           shuntRatedA);
@@ -884,32 +1049,79 @@ bool INA226_ADC::loadFactoryCalibrationTable(uint16_t shuntRatedA) {
 // ---------------- Battery/run-flat logic (unchanged) ----------------
 
 void INA226_ADC::updateBatteryCapacity(float currentA) {
-  unsigned long currentTime = millis();
+  updateBatteryCapacity(currentA, esp_timer_get_time());
+}
+
+void INA226_ADC::updateBatteryCapacity(float currentA, int64_t timestamp_us) {
+  m_lifetime.addCurrent(currentA * 1000.0f, timestamp_us);
+
+  const int64_t current_uA = lroundf(currentA * 1e6f);
 
-  if (lastUpdateTime == 0) {
-    lastUpdateTime = currentTime;
+  const int64_t deltaTime_us = timestamp_us - m_lastChargeSample_us;
+  if (!m_chargePrimed || deltaTime_us < 0) {
+    m_chargePrimed = true;
+    m_lastChargeSample_us = timestamp_us;
+    m_lastCurrent_uA = current_uA;
     return;
   }
 
-  float deltaTimeSec = (currentTime - lastUpdateTime) / 1000.0f;
-  float deltaAh = (currentA * deltaTimeSec) / 3600.0f;
-  batteryCapacity += deltaAh;
+  if (deltaTime_us > (int64_t)m_maxSampleGap_us) {
+    m_integrationGaps++;
+    if (deltaTime_us > m_longestGap_us) {
+      m_longestGap_us = deltaTime_us;
+    }
+    // Not printed: this runs under the sampling lock, and a gap usually
+    // means the task was already late
+  }
+
+  // Trapezoid in integer uA * us. The sum is twice the charge; the odd pC is
+  // carried so nothing is lost to rounding, however long the counter runs.
+  const int64_t twiceCharge_pC =
+      (m_lastCurrent_uA + current_uA) * deltaTime_us + m_chargeRemainder_pC;
+  batteryCharge_pC += twiceCharge_pC / 2;
+  m_chargeRemainder_pC = twiceCharge_pC % 2;
+  m_cycles.addCharge(twiceCharge_pC / 2);
+  if (ocv::TEMPERATURE_DEPENDENT) {
+    slewSeedCorrection(deltaTime_us);
+  }
+
+  if (m_socFilterEnabled) {
+    applySocFilter(currentA, timestamp_us);
+  }
 
   // Sync SOC with voltage extrema to correct drift
+  const int64_t unsynced_pC = batteryCharge_pC;
   checkSoCSync(currentA);
+  if (batteryCharge_pC != unsynced_pC) {
+    // A sync pins SOC far better than the voltage model does
+    m_socFilter.resetSoc(1.0f);
+    m_seedCorrection_pC = 0;
+  }
 
-  if (batteryCapacity < 0.0f)
-    batteryCapacity = 0.0f;
-  if (batteryCapacity > maxBatteryCapacity)
-    batteryCapacity = maxBatteryCapacity;
+  clampBatteryCharge();
 
-  // Sync to RTC
-  if (rtcData.magic == RTC_MAGIC) {
-      rtcData.batteryCapacity = batteryCapacity;
-      rtcData.hasCapacity = true;
+  const int64_t maxCharge_pC = ahToCharge_pC(maxBatteryCapacity);
+  if (maxCharge_pC > 0) {
+    m_cycles.addSoc((float)batteryCharge_pC / (float)maxCharge_pC * 100.0f);
   }
 
-  lastUpdateTime = currentTime;
+  // Sync to RTC
+  syncChargeToRtc();
+
+  m_lastChargeSample_us = timestamp_us;
+  m_lastCurrent_uA = current_uA;
+}
+
+void INA226_ADC::setMaxSampleGap_ms(uint32_t gap_ms) {
+  m_maxSampleGap_us = gap_ms * 1000;
+}
+
+uint32_t INA226_ADC::getMaxSampleGap_ms() const { return m_maxSampleGap_us / 1000; }
+
+uint32_t INA226_ADC::getIntegrationGapCount() const { return m_integrationGaps; }
+
+uint32_t INA226_ADC::getLongestGap_ms() const {
+  return (uint32_t)(m_longestGap_us / 1000);
 }
 
 void INA226_ADC::checkSoCSync(float currentA) {
@@ -929,8 +1141,10 @@ void INA226_ADC::checkSoCSync(float currentA) {
           m_socSyncStartTime = millis();
       } else if (millis() - m_socSyncStartTime >= 60000) {
           // Condition persisted for 60 seconds -> fully charged
-          if (batteryCapacity < maxBatteryCapacity) {
-              batteryCapacity = maxBatteryCapacity;
+          m_cycles.markFull();
+          const int64_t maxCharge_pC = ahToCharge_pC(maxBatteryCapacity);
+          if (batteryCharge_pC < maxCharge_pC) {
+              batteryCharge_pC = maxCharge_pC;
               static unsigned long lastSocLog = 0;
               if (millis() - lastSocLog > 60000) {
                   Serial.printf("SOC Synced to 100%% (High Voltage %.2fV + Low Current %.2fA Persisted)\n", 
@@ -942,8 +1156,9 @@ void INA226_ADC::checkSoCSync(float currentA) {
 
       // If charging but current is still high (> 1A), cap at 99%
       if (currentA > 1.0f) {
-          if (batteryCapacity > maxBatteryCapacity * 0.99f) {
-              batteryCapacity = maxBatteryCapacity * 0.99f;
+          const int64_t capCharge_pC = ahToCharge_pC(maxBatteryCapacity * 0.99f);
+          if (batteryCharge_pC > capCharge_pC) {
+              batteryCharge_pC = capCharge_pC;
           }
       }
   } else {
@@ -954,13 +1169,14 @@ void INA226_ADC::checkSoCSync(float currentA) {
   // Sync to 0%
   // If voltage drops below absolute functional minimum.
   if (busVoltage_V < 10.5f) {
-    batteryCapacity = 0.0f;
-  }
+    batteryCharge_pC = 0;
 
-  // Sync to 0%
-  // If voltage drops below absolute functional minimum.
-  if (busVoltage_V < 10.5f) {
-    batteryCapacity = 0.0f;
+    // Reached from a sync to full: what left the battery is its capacity
+    if (m_cycles.markEmpty(maxBatteryCapacity)) {
+      Serial.printf("Capacity measured full to empty: %.2f Ah (estimate %.2f Ah, %u measurements)\n",
+                    m_cycles.getLastMeasured_Ah(), m_cycles.getCapacity_Ah(),
+                    m_cycles.getCapacityMeasurements());
+    }
   }
 }
 
@@ -980,6 +1196,7 @@ String INA226_ADC::calculateRunFlatTimeFormatted(float currentA,
 
   // Define a small tolerance for "fully charged" state, e.g., 99.5%
   const float fullyChargedThreshold = maxBatteryCapacity * 0.995f;
+  const float batteryCapacity = getBatteryCapacity();
 
   // Check for idle state first (within ±0.050A)
   if (fabsf(currentA) <= idleThresholdA) {
@@ -1048,103 +1265,25 @@ String INA226_ADC::calculateRunFlatTimeFormatted(float currentA,
   return result;
 }
 
-String INA226_ADC::getAveragedRunFlatTime(float currentA,
-                                          float warningThresholdHours,
+String INA226_ADC::getAveragedRunFlatTime(float warningThresholdHours,
                                           bool &warningTriggered) {
-  warningTriggered = false;
-  const int minSamplesForAverage = 3;
-  unsigned long now = millis();
-
-  // --- State Detection & Buffer Reset ---
-  // We maintain the averaging buffer, but if we switch modes (Charge <->
-  // Discharge), we reset the buffer to ensure immediate responsiveness and
-  // avoid mixing data.
-
-  CurrentState newState = averagingState;
-  // Hysteresis for state switching
-  if (currentA > 0.1f) {
-    newState = STATE_CHARGING;
-  } else if (currentA <= 0.05f) {
-    // We treat Idle (approx 0A) as part of the "Discharge/RunFlat" state
-    // so that fridge cycling (Load -> Idle -> Load) is averaged together.
-    newState = STATE_DISCHARGING;
-  } else if (newState == STATE_UNKNOWN) {
-    // Initial state determination if in deadband
-    newState = (currentA > 0) ? STATE_CHARGING : STATE_DISCHARGING;
-  }
-
-  // Reset buffer on true state change
-  if (newState != averagingState) {
-    if (averagingState != STATE_UNKNOWN) {
-      // Reset buffer
-      sampleIndex = 0;
-      sampleCount = 0;
-      // Clearing memory is optional but cleaner for debugging
-      for (int i = 0; i < maxSamples; ++i)
-        currentSamples[i] = 0.0f;
-    }
-    averagingState = newState;
-  }
-
-  // --- Sample Acquisition ---
-  // Store the new current sample every `sampleIntervalSeconds`
-  if (now - lastSampleTime >= (unsigned long)sampleIntervalSeconds * 1000UL) {
-    lastSampleTime = now;
-    currentSamples[sampleIndex] = currentA;
-    sampleIndex = (sampleIndex + 1) % maxSamples;
-    if (sampleCount < maxSamples) {
-      sampleCount++;
-    }
-  }
-
-  // If we don't have enough samples yet, return a status message
-  if (sampleCount < minSamplesForAverage) {
-    // Fallback to instant calculation if needed, or just wait
-    return calculateRunFlatTimeFormatted(currentA, warningThresholdHours,
-                                         warningTriggered);
-  }
-
-  // --- Adaptive Averaging ---
-  // User Requirement: "small window to start with" (handled by sampleCount
-  // growing) "keep the time until full/charged average window the same as it is
-  // now" (Short) "average the time until flat over a longer period" (Long)
-
-  int countToAverage = sampleCount;
-
-  if (averagingState == STATE_CHARGING) {
-    // Cap the averaging window for Charging to keep it responsive (e.g., 10
-    // samples ~ 100s) This matches the original behavior.
-    const int chargingWindow = 10;
-    if (countToAverage > chargingWindow)
-      countToAverage = chargingWindow;
-  }
-  // For DISCHARGING, we use the full available `sampleCount` (up to
-  // maxSamples/1 hour)
-
-  float sum = 0.0f;
-  // Sum the last `countToAverage` samples from the ring buffer.
-  // The latest sample is at `(sampleIndex - 1 + maxSamples) % maxSamples`.
-  int idx = (sampleIndex - 1 + maxSamples) % maxSamples;
-
-  for (int i = 0; i < countToAverage; i++) {
-    sum += currentSamples[idx];
-    idx = (idx - 1 + maxSamples) % maxSamples;
-  }
-
-  float avgCurrentA = sum / (float)countToAverage;
-
-  // Now, use the averaged current to format the time string
-  return calculateRunFlatTimeFormatted(avgCurrentA, warningThresholdHours,
+  // Before the first sample there is nothing to average
+  const float currentA = m_runFlat.isPrimed() ? m_runFlat.getAverage_A()
+                                              : getCurrent_mA() / 1000.0f;
+  return calculateRunFlatTimeFormatted(currentA, warningThresholdHours,
                                        warningTriggered);
 }
 
+float INA226_ADC::getRunFlatCurrent_A() const {
+  return m_runFlat.getAverage_A();
+}
+
 // ---------------- Protection Features ----------------
 
 void INA226_ADC::loadProtectionSettings() {
-  Preferences prefs;
-  prefs.begin(NVS_PROTECTION_NAMESPACE, true); // read-only
+  const char *ns = NVS_PROTECTION_NAMESPACE;
 
-  float loaded_cutoff = prefs.getFloat(NVS_KEY_LOW_VOLTAGE_CUTOFF, 11.6f);
+  float loaded_cutoff = settings.getFloat(ns, NVS_KEY_LOW_VOLTAGE_CUTOFF, 11.6f);
   Serial.printf("NVS loaded cutoff: %.2fV\n", loaded_cutoff);
   if (loaded_cutoff < 6.0f || loaded_cutoff > 14.0f) {
     lowVoltageCutoff = 11.6f;
@@ -1153,7 +1292,7 @@ void INA226_ADC::loadProtectionSettings() {
     lowVoltageCutoff = loaded_cutoff;
   }
 
-  float loaded_hysteresis = prefs.getFloat(NVS_KEY_HYSTERESIS, 0.2f);
+  float loaded_hysteresis = settings.getFloat(ns, NVS_KEY_HYSTERESIS, 0.2f);
   Serial.printf("NVS loaded hysteresis: %.2fV\n", loaded_hysteresis);
   if (loaded_hysteresis < 0.1f || loaded_hysteresis > 3.0f) {
     hysteresis = 0.2f;
@@ -1162,8 +1301,8 @@ void INA226_ADC::loadProtectionSettings() {
     hysteresis = loaded_hysteresis;
   }
 
-  overcurrentThreshold = prefs.getFloat(NVS_KEY_OVERCURRENT, 50.0f);
-  efuseLimit = prefs.getFloat(NVS_KEY_EFUSE_LIMIT, -1.0f);
+  overcurrentThreshold = settings.getFloat(ns, NVS_KEY_OVERCURRENT, 50.0f);
+  efuseLimit = settings.getFloat(ns, NVS_KEY_EFUSE_LIMIT, -1.0f);
   if (efuseLimit < 0.0f) {
      if (m_activeShuntA > 0) {
          efuseLimit = (float)m_activeShuntA * 0.5f;
@@ -1172,44 +1311,46 @@ void INA226_ADC::loadProtectionSettings() {
          efuseLimit = 0.0f;
      }
   }
-  lowVoltageDelayMs = prefs.getUInt(NVS_KEY_LOW_VOLTAGE_DELAY, 30000); // Default 30s
-  deviceNameSuffix = prefs.getString(NVS_KEY_DEVICE_NAME_SUFFIX, "");
+  lowVoltageDelayMs = settings.getUInt(ns, NVS_KEY_LOW_VOLTAGE_DELAY, 30000); // Default 30s
+  deviceNameSuffix = settings.getString(ns, NVS_KEY_DEVICE_NAME_SUFFIX, "");
   
-  float loaded_comp_res = prefs.getFloat(NVS_KEY_COMPENSATION_RESISTANCE, 0.0f);
+  float loaded_comp_res = settings.getFloat(ns, NVS_KEY_COMPENSATION_RESISTANCE, 0.0f);
   if (loaded_comp_res < 0.0f || loaded_comp_res > 1.0f) {
       compensationResistance = 0.0f;
   } else {
       compensationResistance = loaded_comp_res;
   }
+  m_storedCompensation = compensationResistance;
+  m_autoCompensation = settings.getBool(ns, NVS_KEY_COMPENSATION_AUTO, false);
 
   // Load rated capacity (defaults to current maxBatteryCapacity if not set)
-  float savedRatedCap = prefs.getFloat("rated_cap", -1.0f);
+  float savedRatedCap = settings.getFloat(ns, "rated_cap", -1.0f);
   if (savedRatedCap > 0.0f) {
       maxBatteryCapacity = savedRatedCap;
       Serial.printf("Loaded rated capacity from NVS: %.2fAh\n", maxBatteryCapacity);
   }
     
-  prefs.end();
   Serial.println("Loaded protection settings:");
   Serial.printf("  LV Cutoff: %.2fV\n", lowVoltageCutoff);
   Serial.printf("  Hysteresis: %.2fV\n", hysteresis);
   Serial.printf("  OC Threshold: %.2fA\n", overcurrentThreshold);
   Serial.printf("  E-Fuse Limit: %.2fA\n", efuseLimit);
-  Serial.printf("  Comp Res: %.3f Ohm\n", compensationResistance);
+  Serial.printf("  Comp Res: %.3f Ohm%s\n", compensationResistance,
+                m_autoCompensation ? " (auto)" : "");
   Serial.printf("  Rated Capacity: %.2fAh\n", maxBatteryCapacity);
 }
 
 void INA226_ADC::saveProtectionSettings() {
-  Preferences prefs;
-  prefs.begin(NVS_PROTECTION_NAMESPACE, false); // read-write
-  prefs.putFloat(NVS_KEY_LOW_VOLTAGE_CUTOFF, lowVoltageCutoff);
-  prefs.putFloat(NVS_KEY_HYSTERESIS, hysteresis);
-  prefs.putFloat(NVS_KEY_OVERCURRENT, overcurrentThreshold);
-  prefs.putFloat(NVS_KEY_EFUSE_LIMIT, efuseLimit);
-  prefs.putFloat(NVS_KEY_COMPENSATION_RESISTANCE, compensationResistance);
-  prefs.putUInt(NVS_KEY_LOW_VOLTAGE_DELAY, lowVoltageDelayMs);
-  prefs.putString(NVS_KEY_DEVICE_NAME_SUFFIX, deviceNameSuffix);
-  prefs.end();
+  const char *ns = NVS_PROTECTION_NAMESPACE;
+  settings.putFloat(ns, NVS_KEY_LOW_VOLTAGE_CUTOFF, lowVoltageCutoff);
+  settings.putFloat(ns, NVS_KEY_HYSTERESIS, hysteresis);
+  settings.putFloat(ns, NVS_KEY_OVERCURRENT, overcurrentThreshold);
+  settings.putFloat(ns, NVS_KEY_EFUSE_LIMIT, efuseLimit);
+  settings.putFloat(ns, NVS_KEY_COMPENSATION_RESISTANCE, compensationResistance);
+  m_storedCompensation = compensationResistance;
+  settings.putBool(ns, NVS_KEY_COMPENSATION_AUTO, m_autoCompensation);
+  settings.putUInt(ns, NVS_KEY_LOW_VOLTAGE_DELAY, lowVoltageDelayMs);
+  settings.putString(ns, NVS_KEY_DEVICE_NAME_SUFFIX, deviceNameSuffix);
   Serial.println("Saved protection settings.");
 }
 
@@ -1248,10 +1389,7 @@ void INA226_ADC::setActiveShunt(uint16_t shuntRatedA) {
   m_activeShuntA = shuntRatedA;
 
   // Save the selected shunt as the active one
-  Preferences prefs;
-  prefs.begin(NVS_CAL_NAMESPACE, false);
-  prefs.putUShort(NVS_KEY_ACTIVE_SHUNT, m_activeShuntA);
-  prefs.end();
+  settings.putUShort(NVS_CAL_NAMESPACE, NVS_KEY_ACTIVE_SHUNT, m_activeShuntA);
   Serial.printf("Set %dA as active shunt.\n", m_activeShuntA);
 
   // Reload configuration for the new shunt
@@ -1259,9 +1397,9 @@ void INA226_ADC::setActiveShunt(uint16_t shuntRatedA) {
   // If it fails, use the factory default for the active shunt.
   this->m_isConfigured = loadShuntResistance();
   if (!this->m_isConfigured) {
-    auto it = factory_shunt_resistances.find(m_activeShuntA);
-    if (it != factory_shunt_resistances.end()) {
-      calibratedOhms = it->second;
+    const FactoryShunt *factory = findFactoryShunt(m_activeShuntA);
+    if (factory != nullptr) {
+      calibratedOhms = factory->ohms;
       this->m_isConfigured = true; // Consider factory default as configured
       Serial.printf("No custom calibrated shunt resistance found. Using "
                     "factory default for %dA shunt: %.9f Ohms.\n",
@@ -1355,6 +1493,8 @@ float INA226_ADC::getCalibratedShuntResistance() const {
 void INA226_ADC::setCompensationResistance(float ohms) {
     if (ohms < 0.0f) ohms = 0.0f;
     compensationResistance = ohms;
+    // A value set by hand wins over the learnt one
+    m_autoCompensation = false;
     saveProtectionSettings();
 }
 
@@ -1362,6 +1502,52 @@ float INA226_ADC::getCompensationResistance() const {
     return compensationResistance;
 }
 
+void INA226_ADC::setAutoCompensation(bool enabled) {
+    m_autoCompensation = enabled;
+    if (enabled) {
+        applyResistanceEstimate();
+    }
+    saveProtectionSettings();
+}
+
+bool INA226_ADC::isAutoCompensation() const { return m_autoCompensation; }
+
+float INA226_ADC::getInternalResistance_Ohm() const {
+    return m_resistance.getEstimate_Ohm();
+}
+
+uint32_t INA226_ADC::getResistanceSteps() const {
+    return m_resistance.getAcceptedSteps();
+}
+
+uint32_t INA226_ADC::getResistanceRejects() const {
+    return m_resistance.getRejectedSteps();
+}
+
+float INA226_ADC::getLastResistanceStep_Ohm() const {
+    return m_resistance.getLastMeasurement_Ohm();
+}
+
+void INA226_ADC::applyResistanceEstimate() {
+    const float estimate = m_resistance.getEstimate_Ohm();
+    if (isnan(estimate)) {
+        return;
+    }
+    // The estimate may reach ResistanceEstimator's 0.5 Ohm plausibility
+    // limit; under discharge that much compensation would mask the
+    // low-voltage cutoff, so only battery-realistic values are applied
+    const float applied = std::min(estimate, MAX_AUTO_COMPENSATION_OHM);
+    compensationResistance = applied;
+    // Only write NVS when the learnt value has moved by more than 10 %;
+    // after warm-up the estimate settles and this is rare
+    if (fabsf(applied - m_storedCompensation) > 0.1f * m_storedCompensation) {
+        settings.putFloat(NVS_PROTECTION_NAMESPACE, NVS_KEY_COMPENSATION_RESISTANCE, applied);
+        m_storedCompensation = applied;
+        Serial.printf("Compensation resistance learnt: %.1f mOhm (%u steps)\n",
+                      applied * 1000.0f, m_resistance.getAcceptedSteps());
+    }
+}
+
 void INA226_ADC::checkAndHandleProtection() {
   float voltage = getBusVoltage_V();
   float current = getCurrent_mA() / 1000.0f;
@@ -1433,11 +1619,12 @@ void INA226_ADC::checkAndHandleProtection() {
 }
 
 void INA226_ADC::setLoadConnected(bool connected, DisconnectReason reason) {
+  // Switch first: the log below can block on a full UART buffer
+  digitalWrite(LOAD_SWITCH_PIN, connected ? HIGH : LOW);
+  loadConnected = connected;
   Serial.printf(
       "DEBUG: setLoadConnected called. Target state: %s, Reason: %d\n",
       connected ? "ON" : "OFF", reason);
-  digitalWrite(LOAD_SWITCH_PIN, connected ? HIGH : LOW);
-  loadConnected = connected;
   if (connected) {
     m_disconnectReason = NONE;
   } else {
@@ -1456,8 +1643,10 @@ DisconnectReason INA226_ADC::getDisconnectReason() const {
 
 void INA226_ADC::configureAlert(float amps) {
   if (m_hardwareAlertsDisabled) {
-    // Disable alerts by clearing the Mask/Enable Register
-    ina226.writeRegister(INA226_WE::INA226_MASK_EN_REG, 0x0000);
+    // Disable alerts by clearing the Mask/Enable Register (keep CNVR if the
+    // pin is also used for conversion-ready sampling)
+    ina226.writeRegister(INA226_WE::INA226_MASK_EN_REG,
+                         m_convReadyMode ? INA226_WE::INA226_CNVR : 0x0000);
     Serial.println("INA226 hardware alert DISABLED.");
     return;
   }
@@ -1474,10 +1663,43 @@ void INA226_ADC::configureAlert(float amps) {
                 limitAmps, v_limit * 1000.0f, r_shunt);
 }
 
-void INA226_ADC::handleAlert() { alertTriggered = true; }
+void IRAM_ATTR INA226_ADC::handleAlert() {
+  // Handler entry, not the pin edge: interrupt dispatch is not counted
+  const int64_t now_us = esp_timer_get_time();
+  if (m_convReadyMode) {
+    // The pin also fires on every conversion; readSensors() decides from the
+    // AFF flag whether this edge was an over-limit event. Keep the oldest
+    // edge not yet consumed, so a late task cannot look fast.
+    if (m_alertPinEvents == m_alertPinEventsSeen) {
+      m_alertEdge_us = now_us;
+    }
+    m_alertPinEvents = m_alertPinEvents + 1;
+  } else {
+    m_alertEdge_us = now_us;
+    // Only the over-limit alert drives the pin: trip without waiting for a
+    // task, the rest is left to processAlert()
+    if (!m_hardwareAlertsDisabled && loadConnected && !m_tripPending) {
+      openLoadSwitch();
+      m_pendingTripLatency_us = (uint32_t)(esp_timer_get_time() - now_us);
+      m_tripPending = true;
+    }
+    alertTriggered = true;
+  }
+}
 
 void INA226_ADC::processAlert() {
-  if (alertTriggered) {
+  if (alertTriggered || m_tripPending) {
+    if (m_tripPending) {
+      // The chip compares each averaged result, so the current may have
+      // crossed the limit up to one conversion period before the edge
+      m_tripLatency.record(m_pendingTripLatency_us + getConversionPeriod_us());
+      m_tripPending = false;
+      if (isLoadConnected()) {
+        Serial.printf("Short circuit or overcurrent alert: load switched off in %u us.\n",
+                      (unsigned)m_pendingTripLatency_us);
+        setLoadConnected(false, OVERCURRENT);
+      }
+    }
     if (m_hardwareAlertsDisabled) {
       // If alerts are disabled, just clear the flag and do nothing else.
       alertTriggered = false;
@@ -1496,12 +1718,18 @@ void INA226_ADC::processAlert() {
 
 bool INA226_ADC::isAlertTriggered() const { return alertTriggered; }
 
+const LatencyHistogram& INA226_ADC::getTripLatency() const { return m_tripLatency; }
+
+void INA226_ADC::resetTripLatency() { m_tripLatency.reset(); }
+
 void INA226_ADC::clearAlerts() { ina226.readAndClearFlags(); }
 
 void INA226_ADC::enterSleepMode() {
   Serial.println("Entering deep sleep to conserve power.");
   g_low_power_sleep_flag = LOW_POWER_SLEEP_MAGIC;
   gpio_hold_en(GPIO_NUM_5);
+  saveLifetimeCounters(m_lifetime.getTotals(), m_cycles.getState(), true);
+  settings.flush(); // RAM is lost in deep sleep
   esp_sleep_enable_timer_wakeup(30 * 1000000); // Wake up every 30 seconds
   esp_deep_sleep_start();
 }
@@ -1528,6 +1756,232 @@ bool INA226_ADC::areHardwareAlertsDisabled() const {
   return m_hardwareAlertsDisabled;
 }
 
+// ---------------- Conversion-ready acquisition ----------------
+namespace {
+uint32_t averagingCount(INA226_AVERAGES avg) {
+  switch (avg) {
+    case AVERAGE_1:    return 1;
+    case AVERAGE_4:    return 4;
+    case AVERAGE_16:   return 16;
+    case AVERAGE_64:   return 64;
+    case AVERAGE_128:  return 128;
+    case AVERAGE_256:  return 256;
+    case AVERAGE_512:  return 512;
+    case AVERAGE_1024: return 1024;
+  }
+  return 1;
+}
+
+uint32_t conversionTime_us(INA226_CONV_TIME ct) {
+  switch (ct) {
+    case CONV_TIME_140:  return 140;
+    case CONV_TIME_204:  return 204;
+    case CONV_TIME_332:  return 332;
+    case CONV_TIME_588:  return 588;
+    case CONV_TIME_1100: return 1100;
+    case CONV_TIME_2116: return 2116;
+    case CONV_TIME_4156: return 4156;
+    case CONV_TIME_8244: return 8244;
+  }
+  return 1100;
+}
+} // end anonymous namespace
+
+void INA226_ADC::setConversionReadyMode(bool enabled) {
+  uint16_t mask = ina226.readRegister(INA226_WE::INA226_MASK_EN_REG);
+  if (enabled) {
+    mask |= INA226_WE::INA226_CNVR;
+  } else {
+    mask &= ~INA226_WE::INA226_CNVR;
+  }
+  ina226.writeRegister(INA226_WE::INA226_MASK_EN_REG, mask);
+
+  m_convReadyMode = enabled;
+  m_alertPinEventsSeen = m_alertPinEvents;
+  m_lastConversionMicros = micros();
+  m_missedConversions = 0;
+  ina226.readAndClearFlags(); // release the pin if a conversion is pending
+
+  Serial.printf("INA226 conversion-ready sampling %s (period %lu us).\n",
+                enabled ? "ENABLED" : "DISABLED",
+                (unsigned long)getConversionPeriod_us());
+}
+
+bool INA226_ADC::isConversionReadyMode() const { return m_convReadyMode; }
+
+uint32_t INA226_ADC::getConversionPeriod_us() const {
+  // Continuous shunt + bus mode: each averaged result needs N shunt and N bus
+  // conversions.
+  return averagingCount(m_averages) * 2 * conversionTime_us(m_convTime);
+}
+
+bool INA226_ADC::pollConversionReady() {
+  const unsigned long now = micros();
+  const unsigned long period = getConversionPeriod_us();
+  const uint32_t events = m_alertPinEvents;
+
+  bool ready = (events != m_alertPinEventsSeen);
+  const unsigned long elapsed = now - m_lastConversionMicros;
+  if (ready) {
+    m_conversionEdge_us = m_alertEdge_us;
+  } else if (elapsed > 3 * period) {
+    // An edge was lost (e.g. the interrupt was detached for calibration) and
+    // the latched pin is still low. Reading the flags releases it. The
+    // result has been ready since one period after the last one.
+    ready = true;
+    m_conversionEdge_us = esp_timer_get_time() - (int64_t)(elapsed - period);
+  }
+  if (!ready) {
+    return false;
+  }
+
+  m_alertPinEventsSeen = events;
+  if (elapsed > period + period / 2) {
+    // The INA226 only holds the latest result; anything older was overwritten.
+    m_missedConversions += elapsed / period - 1;
+  }
+  m_lastConversionMicros = now;
+  return true;
+}
+
+uint32_t INA226_ADC::getMissedConversions() const { return m_missedConversions; }
+
+uint32_t INA226_ADC::getSampleI2cTransactions() const {
+  return m_sampleI2cTransactions;
+}
+
+// ---------------- Adaptive conversion ----------------
+void INA226_ADC::setAdaptiveConversion(bool enabled) {
+  m_adaptiveConversion = enabled;
+  // Start from the long-averaging profile; a load step switches up at once
+  m_convController.reset(PROFILE_REST);
+  applyConversionProfile(PROFILE_REST);
+  Serial.printf("INA226 adaptive conversion %s.\n",
+                enabled ? "ENABLED" : "DISABLED");
+}
+
+bool INA226_ADC::isAdaptiveConversion() const { return m_adaptiveConversion; }
+
+// ---------------- Kalman SOC correction ----------------
+void INA226_ADC::applySocFilter(float currentA, int64_t timestamp_us) {
+  const int64_t maxCharge_pC = ahToCharge_pC(maxBatteryCapacity);
+  if (maxCharge_pC <= 0) {
+    return;
+  }
+  // The coulomb count is the prediction; the correction is added to it in
+  // pC so the count itself stays exact
+  const float soc_percent = (float)batteryCharge_pC / (float)maxCharge_pC * 100.0f;
+  const float correction_percent = m_socFilter.update(
+      soc_percent, currentA, busVoltage_V, compensationResistance, timestamp_us);
+  batteryCharge_pC += ahToCharge_pC(maxBatteryCapacity * correction_percent / 100.0f);
+  m_socFilterCorrection_percent += correction_percent;
+}
+
+void INA226_ADC::setSocFilterEnabled(bool enabled) {
+  m_socFilterEnabled = enabled;
+  m_socFilter.reset();
+  m_socFilterCorrection_percent = 0.0f;
+  settings.putBool(NVS_CAL_NAMESPACE, "soc_ekf", enabled);
+  Serial.printf("Kalman SOC correction %s.\n", enabled ? "ENABLED" : "DISABLED");
+}
+
+bool INA226_ADC::isSocFilterEnabled() const { return m_socFilterEnabled; }
+
+float INA226_ADC::getSocSigma_percent() const {
+  return m_socFilter.getSocSigma_percent();
+}
+
+float INA226_ADC::getSocPolarization_V() const {
+  return m_socFilter.getPolarization_V();
+}
+
+float INA226_ADC::getSocFilterCorrection_percent() const {
+  return m_socFilterCorrection_percent;
+}
+
+// ---------------- Streaming statistics ----------------
+void INA226_ADC::setStatsWindow_ms(uint32_t window_ms) {
+  m_currentStats.setWindow_ms(window_ms);
+  m_voltageStats.setWindow_ms(window_ms);
+  settings.putUInt(NVS_CAL_NAMESPACE, "stats_win", m_currentStats.getWindow_ms());
+  Serial.printf("Statistics window set to %u ms.\n",
+                (unsigned)m_currentStats.getWindow_ms());
+}
+
+uint32_t INA226_ADC::getStatsWindow_ms() const {
+  return m_currentStats.getWindow_ms();
+}
+
+SignalStats::Summary INA226_ADC::getCurrentStats() const {
+  return m_currentStats.getSummary();
+}
+
+SignalStats::Summary INA226_ADC::getVoltageStats() const {
+  return m_voltageStats.getSummary();
+}
+
+// ---------------- Shunt-voltage current path ----------------
+void INA226_ADC::setShuntCurrentPath(bool enabled) {
+  m_shuntCurrentPath = enabled;
+  m_currentFilter.reset(); // its counts came from the other register
+  Serial.printf("INA226 current from %s.\n",
+                enabled ? "shunt voltage" : "current register");
+}
+
+bool INA226_ADC::isShuntCurrentPath() const { return m_shuntCurrentPath; }
+
+ConversionProfile INA226_ADC::getConversionProfile() const {
+  return m_convController.getProfile();
+}
+
+const char *INA226_ADC::getConversionProfileName() const {
+  return conversionProfileName(m_convController.getProfile());
+}
+
+float INA226_ADC::getEffectiveSampleRate_Hz() const { return m_sampleRate_Hz; }
+
+void INA226_ADC::applyConversionProfile(ConversionProfile profile) {
+  switch (profile) {
+    case PROFILE_FAST: // 8.8 ms per result
+      m_averages = AVERAGE_4;
+      m_convTime = CONV_TIME_1100;
+      break;
+    case PROFILE_ACTIVE: // 35 ms per result
+      m_averages = AVERAGE_16;
+      m_convTime = CONV_TIME_1100;
+      break;
+    default:
+      // 264 ms per result. Not longer: the SHUNT_OVER alert is only
+      // evaluated once per averaged result, so this bounds alert latency.
+      m_averages = AVERAGE_16;
+      m_convTime = CONV_TIME_8244;
+      break;
+  }
+  // CONF is shadowed, so these are plain writes
+  ina226.setAverage(m_averages);
+  ina226.setConversionTime(m_convTime);
+  // Writing CONF restarts the conversion; don't count that as missed
+  m_lastConversionMicros = micros();
+  Serial.printf("INA226 profile -> %s (%lu us/result)\n",
+                conversionProfileName(profile),
+                (unsigned long)getConversionPeriod_us());
+}
+
+void INA226_ADC::updateSampleRate(int64_t now_us) {
+  if (m_rateWindowStart_us == 0) {
+    m_rateWindowStart_us = now_us;
+    m_rateWindowSamples = 0;
+    return;
+  }
+  m_rateWindowSamples++;
+  const int64_t elapsed = now_us - m_rateWindowStart_us;
+  if (elapsed >= 1000000) {
+    m_sampleRate_Hz = m_rateWindowSamples * 1e6f / (float)elapsed;
+    m_rateWindowStart_us = now_us;
+    m_rateWindowSamples = 0;
+  }
+}
+
 void INA226_ADC::dumpRegisters() const {
   Serial.println(F("\n--- INA226 Register Dump ---"));
 
@@ -1548,13 +2002,21 @@ void INA226_ADC::dumpRegisters() const {
   Serial.print(F("Alert Limit (0x07)   : 0x"));
   Serial.println(alertLimitReg, HEX);
 
+  Serial.printf("I2C transactions/sample: %u (total %u)\n",
+                (unsigned)m_sampleI2cTransactions,
+                (unsigned)ina226.getI2cTransactionCount());
+
   Serial.println(F("----------------------------"));
 }
 
 // ---------------- Energy Usage Tracking ----------------
 // ---------------- Energy Usage Tracking ----------------
 void INA226_ADC::updateEnergyUsage(float power_mW) {
-  unsigned long now = millis();
+  updateEnergyUsage(power_mW, esp_timer_get_time());
+}
+
+void INA226_ADC::updateEnergyUsage(float power_mW, int64_t timestamp_us) {
+  unsigned long now = (unsigned long)(timestamp_us / 1000);
   
   // Static counters (moved to top for restore access)
   static int minutesSinceLastHourPush = 0;
@@ -1594,11 +2056,18 @@ void INA226_ADC::updateEnergyUsage(float power_mW) {
     }
   }
 
-  // Calculate energy since last update
-  float time_delta_s = (now - lastEnergyUpdateTime) / 1000.0f;
-  if (time_delta_s < 0) time_delta_s = 0; // Guard overflow
-  
-  float energy_Ws = (power_mW / 1000.0f) * time_delta_s;
+  m_lifetime.addPower(power_mW, timestamp_us);
+
+  // Calculate energy since the last sample (trapezoidal)
+  float time_delta_s = 0.0f;
+  if (m_energyPrimed && timestamp_us > m_lastEnergySample_us) {
+    time_delta_s = (timestamp_us - m_lastEnergySample_us) / 1e6f;
+  }
+  m_energyPrimed = true;
+  m_lastEnergySample_us = timestamp_us;
+
+  float energy_Ws = ((m_lastPower_mW + power_mW) / 2000.0f) * time_delta_s;
+  m_lastPower_mW = power_mW;
   currentMinuteEnergy_Ws += energy_Ws;
   lastEnergyUpdateTime = now;
   
@@ -1653,6 +2122,110 @@ float INA226_ADC::getLastHourEnergy_Wh() const {
   return (minuteBuffer.sum() + currentMinuteEnergy_Ws) / 3600.0f;
 }
 
+// ---------------- Lifetime counters ----------------
+void INA226_ADC::loadLifetimeCounters() {
+  LifetimeCounters::Totals stored = {};
+  Preferences prefs;
+  prefs.begin("storage", true);
+  const bool found = LifetimeCounters::read(prefs, "life", stored);
+  prefs.end();
+
+  // RTC memory survives resets and deep sleep and is newer than NVS when
+  // it has not fallen behind it (counters only grow)
+  LifetimeCounters::Totals current = stored;
+  if (rtcData.magic == RTC_MAGIC && rtcData.hasLifetime &&
+      rtcData.lifetime.chargeIn_uC >= stored.chargeIn_uC &&
+      rtcData.lifetime.chargeOut_uC >= stored.chargeOut_uC &&
+      rtcData.lifetime.energyIn_uJ >= stored.energyIn_uJ &&
+      rtcData.lifetime.energyOut_uJ >= stored.energyOut_uJ) {
+    current = rtcData.lifetime;
+  }
+  m_lifetime.restore(current, stored);
+  Serial.printf("Lifetime counters%s: in %.2f Ah / %.1f Wh, out %.2f Ah / %.1f Wh\n",
+                found ? "" : " (none in NVS)", current.chargeIn_Ah(),
+                current.energyIn_Wh(), current.chargeOut_Ah(), current.energyOut_Wh());
+}
+
+LifetimeCounters::Totals INA226_ADC::getLifetimeTotals() const {
+  return m_lifetime.getTotals();
+}
+
+bool INA226_ADC::saveLifetimeCounters(const LifetimeCounters::Totals &snapshot,
+                                      const CycleCounter::State &cycles,
+                                      bool force) {
+  const uint32_t now = millis();
+  if (force ? !m_lifetime.isUnsaved(snapshot) : !m_lifetime.saveDue(snapshot, now)) {
+    return false;
+  }
+  // Cycles only move with throughput, so they share the wear budget
+  Preferences prefs;
+  prefs.begin("storage", false);
+  const bool ok = LifetimeCounters::write(prefs, "life", snapshot);
+  CycleCounter::write(prefs, "cycles", cycles);
+  prefs.end();
+  if (ok) {
+    m_lifetime.markSaved(snapshot, now);
+  }
+  return ok;
+}
+
+void INA226_ADC::resetLifetimeCounters() {
+  m_lifetime.reset();
+  if (rtcData.magic == RTC_MAGIC) {
+    rtcData.lifetime = m_lifetime.getTotals();
+  }
+  Preferences prefs;
+  prefs.begin("storage", false);
+  prefs.remove("life");
+  prefs.end();
+  Serial.println("Lifetime counters reset.");
+}
+
+// ---------------- Cycle counting / state of health ----------------
+void INA226_ADC::loadCycleCounter() {
+  CycleCounter::State stored;
+  Preferences prefs;
+  prefs.begin("storage", true);
+  const bool found = CycleCounter::read(prefs, "cycles", stored);
+  prefs.end();
+  if (!found) {
+    return;
+  }
+  m_cycles.restore(stored);
+  Serial.printf("Cycle counter: %.1f equivalent cycles, capacity %.2f Ah (%u measurements)\n",
+                m_cycles.getEquivalentCycles(), m_cycles.getCapacity_Ah(),
+                m_cycles.getCapacityMeasurements());
+}
+
+CycleCounter::State INA226_ADC::getCycleState() const { return m_cycles.getState(); }
+
+float INA226_ADC::getEquivalentCycles() const { return m_cycles.getEquivalentCycles(); }
+
+float INA226_ADC::getCyclesAtDepth(size_t bin) const { return m_cycles.getCycles(bin); }
+
+float INA226_ADC::getEstimatedCapacity_Ah() const { return m_cycles.getCapacity_Ah(); }
+
+float INA226_ADC::getLastMeasuredCapacity_Ah() const {
+  return m_cycles.getLastMeasured_Ah();
+}
+
+uint32_t INA226_ADC::getCapacityMeasurements() const {
+  return m_cycles.getCapacityMeasurements();
+}
+
+float INA226_ADC::getStateOfHealth_percent() const {
+  return m_cycles.getStateOfHealth_percent(maxBatteryCapacity);
+}
+
+void INA226_ADC::resetCycleCounter() {
+  m_cycles.reset();
+  Preferences prefs;
+  prefs.begin("storage", false);
+  prefs.remove("cycles");
+  prefs.end();
+  Serial.println("Cycle counter reset.");
+}
+
 void INA226_ADC::resetEnergyStats() {
     Serial.println("Resetting Energy Statistics...");
     
@@ -7,9 +7,20 @@
 #include <INA226_WE.h>
 #include <Preferences.h>
 #include <Wire.h>
-#include <map>
 #include <vector>
+#include "CalibrationBlob.h"
 #include "CircularBuffer.h"
+#include "conversion_controller.h"
+#include "cycle_counter.h"
+#include "DecimationFilter.h"
+#include "latency_histogram.h"
+#include "lifetime_counters.h"
+#include "ocv_table.h"
+#include "PiecewiseLinear.h"
+#include "resistance_estimator.h"
+#include "run_flat_estimator.h"
+#include "soc_kalman_filter.h"
+#include "streaming_stats.h"
 
 enum DisconnectReason { NONE, LOW_VOLTAGE, OVERCURRENT, MANUAL };
 
@@ -21,6 +32,10 @@ struct CalPoint {
 class INA226_ADC {
 public:
   static constexpr float MCU_IDLE_CURRENT_A = 0.052f;
+  // Ceiling for a learnt compensation resistance: pack plus wiring
+  static constexpr float MAX_AUTO_COMPENSATION_OHM = 0.05f;
+  // Rate at which a temperature correction of the OCV seed is fed into SOC
+  static constexpr float SEED_CORRECTION_SLEW_PERCENT_PER_S = 0.05f;
 
   INA226_ADC(uint8_t address, float shuntResistorOhms, float batteryCapacityAh);
   void begin(int sdaPin, int sclPin);
@@ -29,22 +44,54 @@ public:
   float getBusVoltage_V() const;
   float getCurrent_mA() const; // calibrated current (mA) using table when present, else linear
   float getRawCurrent_mA() const; // raw measured current (mA) from INA226
+  // Calibrated current from the oversampling/decimation filter; lower noise
+  // than getCurrent_mA(), updated at sample rate / decimation
+  float getFilteredCurrent_mA() const;
+  void setCurrentDecimation(uint8_t factor);
+  uint8_t getCurrentDecimation() const;
   float getPower_mW() const;
   float getLoadVoltage_V() const;
   float getBatteryCapacity() const;
   void setBatteryCapacity(float capacity);
+  // Remaining charge as kept by the coulomb counter, in pC (uA * us)
+  int64_t getBatteryCharge_pC() const;
+  void setBatteryCharge_pC(int64_t charge_pC);
   void setRatedCapacity_Ah(float capacity);
   float getRatedCapacity_Ah() const;
   void updateBatteryCapacity(float currentA); // current in A (positive = charge)
+  // Trapezoidal integration between esp_timer timestamps of consecutive samples
+  void updateBatteryCapacity(float currentA, int64_t timestamp_us);
+  // Sample gaps longer than this are counted (see the status dump); the trapezoid
+  // bridges them with the average of the current at both ends.
+  void setMaxSampleGap_ms(uint32_t gap_ms);
+  uint32_t getMaxSampleGap_ms() const;
+  uint32_t getIntegrationGapCount() const;
+  uint32_t getLongestGap_ms() const;
   bool isOverflow() const;
   bool isSaturated() const; // New saturation check
   bool clearCalibrationTable(uint16_t shuntRatedA);
-  String getAveragedRunFlatTime(float currentA, float warningThresholdHours, bool &warningTriggered);
+  // Run-flat / run-to-full time from the RunFlatEstimator average, which
+  // readSensors() feeds with every sample
+  String getAveragedRunFlatTime(float warningThresholdHours, bool &warningTriggered);
+  float getRunFlatCurrent_A() const;
   String calculateRunFlatTimeFormatted(float currentA, float warningThresholdHours, bool &warningTriggered);
 
   void setSOC_percent(float percent);
+  // Battery temperature for the OCV surface. The first call after a
+  // voltage-based SOC seed re-reads the seed voltage at this temperature and
+  // shifts the stored charge by the difference; NaN means unknown.
+  void setBatteryTemperature_C(float temperature_C);
   void setVoltageProtection(float cutoff, float reconnect_voltage);
 
+  // Optional SOC mode: a Kalman filter corrects the coulomb count with the
+  // terminal voltage every sample (see SocKalmanFilter). The ohmic term is
+  // the compensation resistance, so set that first. Persisted.
+  void setSocFilterEnabled(bool enabled);
+  bool isSocFilterEnabled() const;
+  float getSocSigma_percent() const;       // filter's SOC uncertainty
+  float getSocPolarization_V() const;
+  float getSocFilterCorrection_percent() const; // sum of corrections since boot
+
   // New shunt resistance calibration methods
   bool saveShuntResistance(float resistance);
   bool loadShuntResistance();
@@ -69,6 +116,16 @@ public:
   String getDeviceNameSuffix() const;
   void setCompensationResistance(float ohms);
   float getCompensationResistance() const;
+  // Internal resistance learnt from load steps (see ResistanceEstimator).
+  // With auto compensation on (off by default, persisted), a primed
+  // estimate, capped at MAX_AUTO_COMPENSATION_OHM, replaces the
+  // compensation resistance. setCompensationResistance() turns it off.
+  void setAutoCompensation(bool enabled);
+  bool isAutoCompensation() const;
+  float getInternalResistance_Ohm() const; // NaN until primed
+  uint32_t getResistanceSteps() const;
+  uint32_t getResistanceRejects() const;
+  float getLastResistanceStep_Ohm() const; // last measured step, accepted or not
   void checkAndHandleProtection();
   void setLoadConnected(bool connected, DisconnectReason reason = MANUAL);
   bool isLoadConnected() const;
@@ -76,9 +133,18 @@ public:
   void configureAlert(float amps);
   void setTempOvercurrentAlert(float amps);
   void restoreOvercurrentAlert();
+  // Called from the ALERT pin ISR. With the pin dedicated to the over-limit
+  // alert (conversion-ready mode off) it opens the load switch right there;
+  // otherwise readSensors() does as soon as it sees the AFF flag.
   void handleAlert();
+  // Deferred bookkeeping for a hardware trip (reason, log, latency); runs
+  // in the sampling task.
   void processAlert();
   bool isAlertTriggered() const;
+  // Latency of hardware trips in us: alert edge to load switch, plus one
+  // conversion period for the averaging window the current crossed in
+  const LatencyHistogram& getTripLatency() const;
+  void resetTripLatency();
   void clearAlerts();
   void enterSleepMode();
   bool isConfigured() const;
@@ -88,6 +154,34 @@ public:
   float getHardwareAlertThreshold_A() const;
   void dumpRegisters() const;
 
+  // Conversion-ready acquisition: the ALERT pin also signals CNVR so each
+  // completed conversion is read exactly once instead of polled on a timer.
+  void setConversionReadyMode(bool enabled);
+  bool isConversionReadyMode() const;
+  bool pollConversionReady(); // true when a completed conversion is waiting
+  uint32_t getConversionPeriod_us() const;
+  uint32_t getMissedConversions() const;
+  uint32_t getSampleI2cTransactions() const; // debug: bus transactions in the last readSensors()
+
+  // Adaptive averaging / conversion time (see ConversionController)
+  void setAdaptiveConversion(bool enabled);
+  bool isAdaptiveConversion() const;
+  ConversionProfile getConversionProfile() const;
+  const char *getConversionProfileName() const;
+  float getEffectiveSampleRate_Hz() const;
+
+  // Compute current from the shunt-voltage register and the shunt
+  // conductance instead of reading the CAL-scaled current register.
+  void setShuntCurrentPath(bool enabled);
+  bool isShuntCurrentPath() const;
+
+  // Per-window current (mA) and bus voltage (V) statistics, fed from every
+  // readSensors(). Summaries describe the last finished window.
+  void setStatsWindow_ms(uint32_t window_ms); // persisted
+  uint32_t getStatsWindow_ms() const;
+  SignalStats::Summary getCurrentStats() const;
+  SignalStats::Summary getVoltageStats() const;
+
   float getCalibratedShuntResistance() const;
   
   void setMaxBatteryCapacity(float capacityAh);
@@ -106,19 +200,43 @@ public:
   bool saveCalibrationTable(uint16_t shuntRatedA,
                             const std::vector<CalPoint> &points);
   bool loadCalibrationTable(uint16_t shuntRatedA); // loads into RAM; returns true if found
-  const std::vector<CalPoint> &getCalibrationTable() const;
+  std::vector<CalPoint> getCalibrationTable() const;
+  static constexpr size_t MAX_CAL_POINTS = 32;
+  // Table interpolation only (no sign flip, no linear fallback)
+  float getCalibratedCurrent_mA(float raw_mA) const;
   bool hasCalibrationTable() const; // RAM presence
   bool hasStoredCalibrationTable(uint16_t shuntRatedA, size_t &countOut) const;
   bool loadFactoryCalibrationTable(uint16_t shuntRatedA);
 
   // Energy usage tracking
   void updateEnergyUsage(float power_mW);
+  void updateEnergyUsage(float power_mW, int64_t timestamp_us);
   float getLastHourEnergy_Wh() const;
   float getLastDayEnergy_Wh() const;
   float getLastWeekEnergy_Wh() const;
   float getAverageCurrentFromEnergyBuffer_A() const;
   void resetEnergyStats();
 
+  // Lifetime charge/energy throughput per direction, integrated by
+  // updateBatteryCapacity() / updateEnergyUsage(). Take the snapshot under
+  // the sampling lock; saving it writes NVS and needs no lock.
+  LifetimeCounters::Totals getLifetimeTotals() const;
+  // The cycle counter state is written along with the totals.
+  bool saveLifetimeCounters(const LifetimeCounters::Totals &snapshot,
+                            const CycleCounter::State &cycles, bool force);
+  void resetLifetimeCounters();
+
+  // Rainflow cycle count over the SOC, and the usable capacity measured
+  // between a sync to full and the next sync to empty (see CycleCounter)
+  CycleCounter::State getCycleState() const;
+  float getEquivalentCycles() const;
+  float getCyclesAtDepth(size_t bin) const; // bin of CycleCounter::DEPTH_BINS
+  float getEstimatedCapacity_Ah() const;    // NaN until measured
+  float getLastMeasuredCapacity_Ah() const; // NaN until measured
+  uint32_t getCapacityMeasurements() const;
+  float getStateOfHealth_percent() const;   // vs rated capacity, NaN until measured
+  void resetCycleCounter();
+
   // Uplink Averaging
   void accumulateUplinkCurrent(float current_mA);
   float getUplinkAverageCurrent_A() const;
@@ -128,9 +246,10 @@ private:
   INA226_WE ina226;
   float defaultOhms;    // Original default shunt resistance
   float calibratedOhms; // Calibrated shunt resistance
-  float batteryCapacity;
+  // Remaining charge in pC (1 uA for 1 us). Integer so that small
+  // per-sample increments are never rounded away; 1 Ah = 3.6e15 pC.
+  int64_t batteryCharge_pC;
   float maxBatteryCapacity;
-  unsigned long lastUpdateTime;
   float shuntVoltage_mV, loadVoltage_V, busVoltage_V, current_mA, power_mW;
   float calibrationGain, calibrationOffset_mA;
 
@@ -143,7 +262,7 @@ private:
   uint32_t lowVoltageDelayMs;
   unsigned long lowVoltageStartTime;
   String deviceNameSuffix;
-  bool loadConnected;
+  volatile bool loadConnected;
   volatile bool alertTriggered;
   bool m_isConfigured;
   uint16_t m_activeShuntA;
@@ -152,32 +271,99 @@ private:
   bool m_hardwareAlertsDisabled;
   unsigned long m_socSyncStartTime;
 
+  // Conversion-ready acquisition
+  INA226_AVERAGES m_averages;
+  INA226_CONV_TIME m_convTime;
+  bool m_convReadyMode;
+  volatile uint32_t m_alertPinEvents; // bumped by the ISR
+  uint32_t m_alertPinEventsSeen;
+  volatile int64_t m_alertEdge_us;       // esp_timer time of the pending pin edge
+  int64_t m_conversionEdge_us;           // edge of the result being read (CNVR)
+  volatile bool m_tripPending;           // switch opened, bookkeeping not done
+  volatile uint32_t m_pendingTripLatency_us;
+  LatencyHistogram m_tripLatency;
+  unsigned long m_lastConversionMicros;
+  uint32_t m_missedConversions;
+  uint32_t m_sampleI2cTransactions;
+
+  // Adaptive conversion
+  ConversionController m_convController;
+  bool m_adaptiveConversion;
+  int64_t m_rateWindowStart_us;
+  uint32_t m_rateWindowSamples;
+  float m_sampleRate_Hz;
+  void applyConversionProfile(ConversionProfile profile);
+
+  // Shunt-voltage current path
+  bool m_shuntCurrentPath;
+  float m_shuntSiemens; // mA per mV of shunt voltage, set with the shunt
+
+  // Oversampled shunt current
+  DecimationFilter m_currentFilter;
+  float m_filteredRaw_mA;
+  float applyCalibration_mA(float raw_mA) const;
+
+  // Streaming statistics
+  SignalStats m_currentStats;
+  SignalStats m_voltageStats;
+
+  // Trapezoidal coulomb counting
+  bool m_chargePrimed;
+  int64_t m_lastChargeSample_us;
+  int64_t m_lastCurrent_uA;
+  int64_t m_chargeRemainder_pC; // 0 or 1: half-pC left over by the trapezoid
+  uint32_t m_maxSampleGap_us;
+  uint32_t m_integrationGaps;
+  int64_t m_longestGap_us;
+
+  // Lifetime throughput
+  LifetimeCounters m_lifetime;
+  void loadLifetimeCounters();
+
+  // Cycling and state of health
+  CycleCounter m_cycles;
+  void loadCycleCounter();
+
+  // Trapezoidal energy accounting
+  bool m_energyPrimed;
+  int64_t m_lastEnergySample_us;
+  float m_lastPower_mW;
+  void updateSampleRate(int64_t now_us);
+
   // Table-based calibration
-  std::vector<CalPoint> calibrationTable;
-  float getCalibratedCurrent_mA(float raw_mA) const;
+  PiecewiseLinear<MAX_CAL_POINTS> calibrationCurve;
+  bool setCalibrationPoints(const std::vector<CalPoint> &pts);
 
   void setInitialSOC();
 
-  // Factory default resistances
-  static const std::map<uint16_t, float> factory_shunt_resistances;
-  static const std::map<float, float> soc_voltage_map;
+  // Seed voltage awaiting a temperature correction (NaN when none is pending)
+  float m_socSeedVoltage_V;
+  float m_batteryTemp_C;
+  // Part of that correction not yet applied, slewed in by updateBatteryCapacity
+  int64_t m_seedCorrection_pC;
 
   // run-flat time averaging
-  const static int maxSamples = 360; // 1 hour at 10s interval
-  float currentSamples[maxSamples];
-  int sampleIndex;
-  int sampleCount;
-  unsigned long lastSampleTime;
-  int sampleIntervalSeconds;
+  RunFlatEstimator m_runFlat;
+
+  // Internal resistance from load steps
+  ResistanceEstimator m_resistance;
+  bool m_autoCompensation;
+  float m_storedCompensation; // value in NVS, to limit writes
+  void applyResistanceEstimate();
 
-  // State tracking for averaging
-  enum CurrentState { STATE_UNKNOWN, STATE_CHARGING, STATE_DISCHARGING };
-  CurrentState averagingState;
+  // Kalman SOC correction
+  SocKalmanFilter m_socFilter;
+  bool m_socFilterEnabled;
+  float m_socFilterCorrection_percent;
+  void applySocFilter(float currentA, int64_t timestamp_us);
 
   void applyShuntConfiguration();
 
   // SOC Sync
   void checkSoCSync(float currentA);
+  void clampBatteryCharge();
+  void slewSeedCorrection(int64_t deltaTime_us);
+  void syncChargeToRtc();
 
   // Energy usage tracking
   // Energy usage tracking
@@ -0,0 +1,55 @@
+#include "latency_histogram.h"
+#include <string.h>
+
+void LatencyHistogram::record(uint32_t latency_us) {
+    uint8_t bin = latency_us == 0 ? 0 : 32 - __builtin_clz(latency_us);
+    if (bin >= BINS) {
+        bin = BINS - 1;
+    }
+    bins[bin]++;
+    if (count == 0 || latency_us < lo) lo = latency_us;
+    if (latency_us > hi) hi = latency_us;
+    count++;
+    sum += latency_us;
+}
+
+void LatencyHistogram::reset() {
+    memset(bins, 0, sizeof(bins));
+    count = 0;
+    lo = 0;
+    hi = 0;
+    sum = 0;
+}
+
+float LatencyHistogram::getMean_us() const {
+    return count ? (float)((double)sum / count) : 0.0f;
+}
+
+uint32_t LatencyHistogram::getBinLimit_us(uint8_t bin) {
+    if (bin >= BINS - 1) {
+        return UINT32_MAX;
+    }
+    return (uint32_t)1 << bin;
+}
+
+uint32_t LatencyHistogram::getPercentile_us(float p) const {
+    if (count == 0) {
+        return 0;
+    }
+    // Rank of the sample we need, 1-based
+    uint32_t rank = (uint32_t)(p * count + 0.999f);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+
+    uint32_t seen = 0;
+    for (uint8_t bin = 0; bin < BINS; bin++) {
+        seen += bins[bin];
+        if (seen >= rank) {
+            // Largest value the bin can hold, no more than the maximum seen
+            const uint32_t limit = getBinLimit_us(bin);
+            const uint32_t top = limit == UINT32_MAX ? hi : limit - 1;
+            return top < hi ? top : hi;
+        }
+    }
+    return hi;
+}
@@ -0,0 +1,37 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+// Log2 histogram of latencies in microseconds, plus count, min, max and
+// mean. Integer only and O(1) per sample. Bin 0 holds 0 us, bin k holds
+// [2^(k-1), 2^k) us and the last bin everything from 2^(BINS-2) us up.
+class LatencyHistogram {
+public:
+    static constexpr uint8_t BINS = 20; // last bin: >= 262 ms
+
+    LatencyHistogram() { reset(); }
+
+    void record(uint32_t latency_us);
+    void reset();
+
+    uint32_t getCount() const { return count; }
+    uint32_t getMin_us() const { return count ? lo : 0; }
+    uint32_t getMax_us() const { return hi; }
+    float getMean_us() const;
+    uint32_t getBin(uint8_t bin) const { return bin < BINS ? bins[bin] : 0; }
+    // Upper edge of a bin (exclusive); UINT32_MAX for the last one
+    static uint32_t getBinLimit_us(uint8_t bin);
+    // Upper bound on the p-quantile (0..1): the limit of the bin it falls
+    // in, capped at the maximum seen. 0 when empty.
+    uint32_t getPercentile_us(float p) const;
+
+private:
+    uint32_t bins[BINS];
+    uint32_t count;
+    uint32_t lo;
+    uint32_t hi;
+    uint64_t sum;
+};
+
+#endif // LATENCY_HISTOGRAM_H
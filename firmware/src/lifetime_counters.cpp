@@ -0,0 +1,111 @@
+#include "lifetime_counters.h"
+#include "CalibrationBlob.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+constexpr int64_t PC_PER_UC = 1000000; // uA * us per uC
+constexpr int64_t NJ_PER_UJ = 1000;    // mW * us per uJ
+constexpr int64_t MAX_BRIDGE_US = 3600LL * 1000000;
+} // end anonymous namespace
+
+bool LifetimeCounters::Totals::operator==(const Totals& other) const {
+    return chargeIn_uC == other.chargeIn_uC && chargeOut_uC == other.chargeOut_uC &&
+           energyIn_uJ == other.energyIn_uJ && energyOut_uJ == other.energyOut_uJ;
+}
+
+LifetimeCounters::LifetimeCounters() {
+    reset();
+}
+
+void LifetimeCounters::reset() {
+    memset(&totals, 0, sizeof(totals));
+    memset(&charge, 0, sizeof(charge));
+    memset(&energy, 0, sizeof(energy));
+    saved = totals;
+    lastSave_ms = 0;
+    saveCount = 0;
+}
+
+void LifetimeCounters::restore(const Totals& current, const Totals& persisted) {
+    totals = current;
+    saved = persisted;
+}
+
+void LifetimeCounters::integrate(Integrator& it, int64_t value, int64_t timestamp_us,
+                                 int64_t finePerUnit, uint64_t& in, uint64_t& out) {
+    const int64_t dt_us = timestamp_us - it.last_us;
+    if (!it.primed || dt_us < 0 || dt_us > MAX_BRIDGE_US) {
+        it.primed = true;
+        it.last_us = timestamp_us;
+        it.lastValue = value;
+        return;
+    }
+
+    // Trapezoid of the positive and the negative part separately
+    const int64_t a = it.lastValue;
+    const int64_t b = value;
+    it.twiceIn += ((a > 0 ? a : 0) + (b > 0 ? b : 0)) * dt_us;
+    it.twiceOut += ((a < 0 ? -a : 0) + (b < 0 ? -b : 0)) * dt_us;
+
+    const int64_t twiceUnit = 2 * finePerUnit;
+    if (it.twiceIn >= twiceUnit) {
+        in += (uint64_t)(it.twiceIn / twiceUnit);
+        it.twiceIn %= twiceUnit;
+    }
+    if (it.twiceOut >= twiceUnit) {
+        out += (uint64_t)(it.twiceOut / twiceUnit);
+        it.twiceOut %= twiceUnit;
+    }
+
+    it.last_us = timestamp_us;
+    it.lastValue = value;
+}
+
+void LifetimeCounters::addCurrent(float current_mA, int64_t timestamp_us) {
+    if (isnan(current_mA)) {
+        return;
+    }
+    integrate(charge, llroundf(current_mA * 1000.0f), timestamp_us, PC_PER_UC,
+              totals.chargeIn_uC, totals.chargeOut_uC);
+}
+
+void LifetimeCounters::addPower(float power_mW, int64_t timestamp_us) {
+    if (isnan(power_mW)) {
+        return;
+    }
+    integrate(energy, llroundf(power_mW), timestamp_us, NJ_PER_UJ,
+              totals.energyIn_uJ, totals.energyOut_uJ);
+}
+
+bool LifetimeCounters::saveDue(const Totals& snapshot, uint32_t now_ms) const {
+    if (!isUnsaved(snapshot)) {
+        return false;
+    }
+    const uint32_t elapsed_ms = now_ms - lastSave_ms;
+    if (elapsed_ms < MIN_SAVE_INTERVAL_MS) {
+        return false;
+    }
+    const double moved_uC = (double)(snapshot.chargeIn_uC - saved.chargeIn_uC) +
+                            (double)(snapshot.chargeOut_uC - saved.chargeOut_uC);
+    const double moved_uJ = (double)(snapshot.energyIn_uJ - saved.energyIn_uJ) +
+                            (double)(snapshot.energyOut_uJ - saved.energyOut_uJ);
+    return moved_uC >= SAVE_STEP_AH * UNITS_PER_HOUR ||
+           moved_uJ >= SAVE_STEP_WH * UNITS_PER_HOUR ||
+           elapsed_ms >= MAX_SAVE_INTERVAL_MS;
+}
+
+void LifetimeCounters::markSaved(const Totals& snapshot, uint32_t now_ms) {
+    saved = snapshot;
+    lastSave_ms = now_ms;
+    saveCount++;
+}
+
+bool LifetimeCounters::write(Preferences& prefs, const char* key, const Totals& t) {
+    return CalibrationBlob::write<Totals, 1>(prefs, key, &t, 1);
+}
+
+bool LifetimeCounters::read(Preferences& prefs, const char* key, Totals& out) {
+    bool found;
+    return CalibrationBlob::read<Totals, 1>(prefs, key, &out, found) == 1;
+}
@@ -0,0 +1,87 @@
+#ifndef LIFETIME_COUNTERS_H
+#define LIFETIME_COUNTERS_H
+
+#include <Preferences.h>
+#include <stdint.h>
+
+// Lifetime charge and energy throughput, kept separately for each direction
+// so charging efficiency and consumption can be worked out from the totals.
+//
+// Current and power are integrated with the trapezoid rule in integer
+// units (uA * us = pC, mW * us = nJ) and the remainders are carried, so no
+// sample is rounded away. The positive and negative parts of the signal are
+// integrated separately; at a zero crossing both pick up a sliver of the
+// interval, but in - out always equals the net integral.
+//
+// Persistence is wear-aware: saveDue() allows an NVS write once the totals
+// have moved by SAVE_STEP_AH / SAVE_STEP_WH and MIN_SAVE_INTERVAL_MS has
+// passed since the last one, or after MAX_SAVE_INTERVAL_MS with any change.
+// That caps the blob at 96 writes a day; power loss costs at most the
+// throughput since the last write.
+class LifetimeCounters {
+public:
+    static constexpr double UNITS_PER_HOUR = 3.6e9; // uC per Ah, uJ per Wh
+    static constexpr uint32_t MIN_SAVE_INTERVAL_MS = 15UL * 60 * 1000;
+    static constexpr uint32_t MAX_SAVE_INTERVAL_MS = 6UL * 60 * 60 * 1000;
+    static constexpr float SAVE_STEP_AH = 1.0f;
+    static constexpr float SAVE_STEP_WH = 10.0f;
+
+    struct Totals {
+        uint64_t chargeIn_uC;
+        uint64_t chargeOut_uC;
+        uint64_t energyIn_uJ;
+        uint64_t energyOut_uJ;
+
+        float chargeIn_Ah() const { return (float)(chargeIn_uC / UNITS_PER_HOUR); }
+        float chargeOut_Ah() const { return (float)(chargeOut_uC / UNITS_PER_HOUR); }
+        float energyIn_Wh() const { return (float)(energyIn_uJ / UNITS_PER_HOUR); }
+        float energyOut_Wh() const { return (float)(energyOut_uJ / UNITS_PER_HOUR); }
+        bool operator==(const Totals& other) const;
+        bool operator!=(const Totals& other) const { return !(*this == other); }
+    };
+
+    LifetimeCounters();
+
+    // Feed one sample. Positive is charging. Current and power have their
+    // own timestamps; a backwards step or a gap of over an hour restarts the
+    // integration instead of bridging it.
+    void addCurrent(float current_mA, int64_t timestamp_us);
+    void addPower(float power_mW, int64_t timestamp_us);
+
+    const Totals& getTotals() const { return totals; }
+    // Continue from current; persisted is what NVS already holds.
+    void restore(const Totals& current, const Totals& persisted);
+    void reset();
+
+    // Persistence policy. Called with a snapshot of getTotals() so it can
+    // run outside the lock that protects the sample path.
+    bool saveDue(const Totals& snapshot, uint32_t now_ms) const;
+    bool isUnsaved(const Totals& snapshot) const { return snapshot != saved; }
+    void markSaved(const Totals& snapshot, uint32_t now_ms);
+    uint32_t getSaveCount() const { return saveCount; }
+
+    // One CRC-checked blob under key.
+    static bool write(Preferences& prefs, const char* key, const Totals& t);
+    static bool read(Preferences& prefs, const char* key, Totals& out);
+
+private:
+    struct Integrator {
+        bool primed;
+        int64_t last_us;
+        int64_t lastValue;
+        int64_t twiceIn;  // fine units * 2, less than 2 * fine units per unit
+        int64_t twiceOut;
+    };
+
+    static void integrate(Integrator& it, int64_t value, int64_t timestamp_us,
+                          int64_t finePerUnit, uint64_t& in, uint64_t& out);
+
+    Totals totals;
+    Integrator charge;
+    Integrator energy;
+    Totals saved;
+    uint32_t lastSave_ms;
+    uint32_t saveCount;
+};
+
+#endif // LIFETIME_COUNTERS_H
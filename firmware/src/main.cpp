@@ -8,15 +8,21 @@ SET_LOOP_TASK_STACK_SIZE(16 * 1024); // 16KB, GitHub responses are heavy
 #include "ble_handler.h"
 #include "espnow_handler.h"
 #include "gpio_adc.h"
+#include "dma_adc_backend.h"
 #include "ota_handler.h"
 #include "tpms_handler.h"
 #include "crash_handler.h"
+#include "sampling_task.h"
+#include "settings_store.h"
+#include "flash_log.h"
+#include "partition_page_store.h"
 #include <esp_now.h>
 #include <esp_err.h>
 #include "driver/gpio.h"
 #include <ArduinoJson.h>
 #include <nvs_flash.h>
 #include "esp_wifi.h"
+#include "esp_timer.h"
 
 // WiFi and OTA
 #include <WiFi.h>
@@ -40,7 +46,8 @@ const unsigned long telemetry_interval = 5000; // Increased frequency (5s)
 unsigned long last_telemetry_millis = 0;
 uint32_t telemetry_counter = 0;
 
-// Polling interval for accurate coulomb counting
+// Only the unused loop_deprecated() polls with this. Live sampling runs in
+// SamplingTask, paced by CNVR or by SamplingTask::POLL_INTERVAL_MS.
 const unsigned long polling_interval = 100; // 100ms = 10Hz
 unsigned long last_polling_millis = 0;
 
@@ -48,6 +55,15 @@ unsigned long last_polling_millis = 0;
 bool g_pendingRestart = false;
 unsigned long g_restartTs = 0;
 
+// Low-priority writer for the settings cache: keeps NVS erase/write latency
+// off the BLE and MQTT callbacks that change settings.
+static void settingsCommitTask(void*) {
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(250));
+        settings.commitDue(millis());
+    }
+}
+
 void scheduleRestart(uint32_t delay_ms) {
     g_pendingRestart = true;
     g_restartTs = millis() + delay_ms;
@@ -68,8 +84,21 @@ struct_message_ae_smart_shunt_1 ae_smart_shunt_struct = {};  // Zero-initialize
 // INA226_ADC ina226_adc(I2C_ADDRESS, 0.000750000f, batteryCapacity);
 INA226_ADC ina226_adc(I2C_ADDRESS, 0.001730000f, batteryCapacity);
 
-// ADC for the starter battery voltage on GPIO3
-GPIO_ADC starter_adc(3);
+// Sensor sampling, protection and coulomb counting run in their own task;
+// loop() consumes the published samples.
+SamplingTask samplingTask(ina226_adc);
+SensorSample g_latestSample = {};
+
+// ADC for the starter battery voltage on GPIO3, sampled continuously by DMA
+DmaAdcBackend starterAdcBackend;
+GPIO_ADC starter_adc(3, &starterAdcBackend);
+
+// Long-term one-minute history in its own flash partition, fed from the
+// minute tier of the sampling task's HistoryStore
+PartitionPageStore historyFlash;
+FlashLog flashLog(historyFlash);
+int64_t g_lastLoggedMinute = -1;
+uint32_t g_logTimeBase_s = 0; // wall-clock seconds at esp_timer zero
 
 ESPNowHandler espNowHandler(broadcastAddress); // ESP-NOW handler for sending data
 BLEHandler bleHandler;
@@ -78,7 +107,7 @@ OtaHandler otaHandler(bleHandler, espNowHandler, wifi_client);
 
 // MQTT Handler
 #include "mqtt_handler.h"
-MqttHandler mqttHandler(espNowHandler, ina226_adc);
+MqttHandler mqttHandler(espNowHandler, ina226_adc, samplingTask);
 
 unsigned long lastMqttUplink = 0;
 const unsigned long MQTT_UPLINK_INTERVAL = 15 * 60 * 1000; // 15 Minutes
@@ -88,17 +117,22 @@ uint8_t g_lastCloudStatus = 0;
 uint32_t g_lastCloudSuccessTime = 0;
 bool g_hasCrashLog = false;
 
+void saveLifetimeCounters(bool force); // Fwd Decl
+
 void preOtaUpdate() {
     Serial.println("[MAIN] Pre-OTA update callback triggered. Saving battery capacity...");
+    saveLifetimeCounters(true);
+    settings.flush();
     Preferences preferences;
     preferences.begin("storage", false);
-    float capacity = ina226_adc.getBatteryCapacity();
-    preferences.putFloat("bat_cap", capacity);
+    int64_t charge_pC = ina226_adc.getBatteryCharge_pC();
+    preferences.putLong64("bat_q", charge_pC);
     preferences.end();
-    Serial.printf("[MAIN] Saved battery capacity: %f\n", capacity);
+    Serial.printf("[MAIN] Saved battery capacity: %f\n", ina226_adc.getBatteryCapacity());
 }
 
 void loadSwitchCallback(bool enabled) {
+    SamplingLock lock(samplingTask);
     if (enabled) {
         ina226_adc.setLoadConnected(true, NONE);
         Serial.println("[BLE WRITE] Load Control: ON");
@@ -110,6 +144,7 @@ void loadSwitchCallback(bool enabled) {
 
 void socCallback(float percent) {
     Serial.printf("[BLE WRITE] SOC: %.2f%%\n", percent);
+    SamplingLock lock(samplingTask);
     ina226_adc.setSOC_percent(percent);
 }
 
@@ -121,6 +156,7 @@ void voltageProtectionCallback(String value) {
         String reconnect_str = value.substring(commaIndex + 1);
         float cutoff = cutoff_str.toFloat();
         float reconnect = reconnect_str.toFloat();
+        SamplingLock lock(samplingTask);
         ina226_adc.setVoltageProtection(cutoff, reconnect);
     } else {
         Serial.println("[BLE WRITE] Invalid format for voltage protection setting.");
@@ -129,16 +165,19 @@ void voltageProtectionCallback(String value) {
 
 void lowVoltageDelayCallback(uint32_t seconds) {
     Serial.printf("[BLE WRITE] Low Voltage Delay: %u seconds\n", seconds);
+    SamplingLock lock(samplingTask);
     ina226_adc.setLowVoltageDelay(seconds);
 }
 
 void deviceNameSuffixCallback(String suffix) {
     Serial.printf("[BLE WRITE] Device Name Suffix: '%s'\n", suffix.c_str());
+    SamplingLock lock(samplingTask);
     ina226_adc.setDeviceNameSuffix(suffix);
 }
 
 void ratedCapacityCallback(float capacityAh) {
     Serial.printf("[BLE WRITE] Rated Capacity: %.2f Ah\n", capacityAh);
+    SamplingLock lock(samplingTask);
     ina226_adc.setMaxBatteryCapacity(capacityAh);
 }
 
@@ -332,6 +371,7 @@ void pairingCallback(String payload) {
 
     if (payload == "RESET_ENERGY") {
         Serial.println("Received RESET_ENERGY command via BLE.");
+        SamplingLock lock(samplingTask);
         ina226_adc.resetEnergyStats();
         return;
     }
@@ -339,16 +379,23 @@ void pairingCallback(String payload) {
     if (payload == "FACTORY_RESET") {
         Serial.println("Received FACTORY RESET command via BLE.");
         
-        // 1. Backup Calibration Data
-        // Active Shunt Rating
-        uint16_t backup_activeShunt = ina226_adc.getActiveShunt();
-        // Resistance Logic
-        float backup_resistance = ina226_adc.getCalibratedShuntResistance();
-        bool backup_configured = ina226_adc.isConfigured();
-        // Linear Calibration (Gain/Offset)
+        // 1. Backup Calibration Data. The lock is held only to copy and to
+        // restore, so protection keeps running through the wipe and delay.
+        uint16_t backup_activeShunt;
+        float backup_resistance;
+        bool backup_configured;
         float backup_gain = 1.0f;
         float backup_offset = 0.0f;
-        ina226_adc.getCalibration(backup_gain, backup_offset);
+        {
+            SamplingLock lock(samplingTask);
+            // Active Shunt Rating
+            backup_activeShunt = ina226_adc.getActiveShunt();
+            // Resistance Logic
+            backup_resistance = ina226_adc.getCalibratedShuntResistance();
+            backup_configured = ina226_adc.isConfigured();
+            // Linear Calibration (Gain/Offset)
+            ina226_adc.getCalibration(backup_gain, backup_offset);
+        }
         
         Serial.printf("Backing up: Shunt=%dA, Res=%.9f, Gain=%.6f, Off=%.3f\n", 
                       backup_activeShunt, backup_resistance, backup_gain, backup_offset);
@@ -356,6 +403,7 @@ void pairingCallback(String payload) {
 
         Serial.println("PERFORMING FULL HARDWARE WIPE of NVS partition...");
         WiFi.disconnect(true, true);
+        settings.invalidate(); // nothing cached may be written back after the wipe
         
         esp_err_t err = nvs_flash_erase();
         if (err != ESP_OK) Serial.printf("Error: nvs_flash_erase failed (0x%x)\n", err);
@@ -364,18 +412,24 @@ void pairingCallback(String payload) {
 
         // 2. Restore Calibration Data
         Serial.println("Restoring Shunt Calibration...");
-        ina226_adc.setActiveShunt(backup_activeShunt);
-        
-        if (backup_configured) {
-            // Restore Resistance
-            ina226_adc.saveShuntResistance(backup_resistance);
-            // Restore Linear Calibration (Gain/Offset)
-            if (backup_gain != 1.0f || backup_offset != 0.0f) {
-                ina226_adc.saveCalibration(backup_activeShunt, backup_gain, backup_offset);
-                Serial.println("Restored Linear Calibration (Gain/Offset).");
+        {
+            SamplingLock lock(samplingTask);
+            ina226_adc.setActiveShunt(backup_activeShunt);
+            
+            if (backup_configured) {
+                // Restore Resistance
+                ina226_adc.saveShuntResistance(backup_resistance);
+                // Restore Linear Calibration (Gain/Offset)
+                if (backup_gain != 1.0f || backup_offset != 0.0f) {
+                    ina226_adc.saveCalibration(backup_activeShunt, backup_gain, backup_offset);
+                }
             }
         }
+        if (backup_configured && (backup_gain != 1.0f || backup_offset != 0.0f)) {
+            Serial.println("Restored Linear Calibration (Gain/Offset).");
+        }
 
+        settings.flush();
         Serial.println("NVS wiped and Calibration Restored. Rebooting in 1s...");
         delay(1000);
         ESP.restart();
@@ -437,9 +491,34 @@ class MainServerCallbacks: public BLEServerCallbacks {
     }
 };
 
-void IRAM_ATTR alertISR()
+// Registered with ESP_INTR_FLAG_IRAM, so it keeps running while flash is
+// written (NVS, flash log); everything it calls must be in IRAM.
+void IRAM_ATTR alertISR(void *)
 {
   ina226_adc.handleAlert();
+  samplingTask.notifyFromISR();
+}
+
+// attachInterrupt() installs the GPIO ISR service without
+// ESP_INTR_FLAG_IRAM, which defers the alert until a flash write is over.
+void attachAlertInterrupt()
+{
+  static bool serviceInstalled = false;
+  if (!serviceInstalled) {
+    esp_err_t err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+      Serial.printf("Alert ISR service install failed: %s\n", esp_err_to_name(err));
+      return;
+    }
+    serviceInstalled = true;
+  }
+  gpio_set_intr_type((gpio_num_t)INA_ALERT_PIN, GPIO_INTR_NEGEDGE);
+  gpio_isr_handler_add((gpio_num_t)INA_ALERT_PIN, alertISR, nullptr);
+}
+
+void detachAlertInterrupt()
+{
+  gpio_isr_handler_remove((gpio_num_t)INA_ALERT_PIN);
 }
 
 // helper: read a trimmed line from Serial (blocks until newline), with echo and backspace support.
@@ -545,12 +624,17 @@ void runStarterADC_MultiPoint_Calibration(GPIO_ADC &adc) {
             Serial.println(F("Canceled."));
             return;
         }
-        // Read raw ADC value
+        // Read raw ADC value. loop() is not running here, so drain the
+        // continuous samples ourselves. clearAverage() also throws away the
+        // conversions queued while waiting for Enter, so the window starts
+        // at this voltage.
         const int samples = 8;
         int raw_adc_sum = 0;
+        adc.clearAverage();
         for (int s = 0; s < samples; ++s) {
-            raw_adc_sum += analogRead(3); // Reading from GPIO3
             delay(50);
+            adc.update();
+            raw_adc_sum += adc.getAverageRaw();
         }
         int raw_adc_avg = raw_adc_sum / samples;
         Serial.printf("  -> Recorded raw ADC value: %d\n", raw_adc_avg);
@@ -698,10 +782,7 @@ void runTableBasedCalibration(INA226_ADC &ina, int shuntA)
   Serial.println(F("MCU draws ~0.052A at all times; prompts below refer to EXTERNAL load only."));
 
   // Save the selected shunt as the active one
-  Preferences prefs;
-  prefs.begin(NVS_CAL_NAMESPACE, false);
-  prefs.putUShort(NVS_KEY_ACTIVE_SHUNT, shuntA);
-  prefs.end();
+  settings.putUShort(NVS_CAL_NAMESPACE, NVS_KEY_ACTIVE_SHUNT, shuntA);
   Serial.printf("Set %dA as active shunt.\n", shuntA);
 
   // Show existing linear + table calibration (if any)
@@ -926,7 +1007,8 @@ void runTableBasedCalibration(INA226_ADC &ina, int shuntA)
   bool alert_fired = false;
   unsigned long test_start = millis();
   while(millis() - test_start < 20000) { // 20s timeout
-      if (ina.isAlertTriggered()) {
+      // The sampling task may have booked the trip already
+      if (ina.isAlertTriggered() || !ina.isLoadConnected()) {
           ina.processAlert();
           alert_fired = true;
           break;
@@ -966,6 +1048,10 @@ void printShunt(const struct_message_ae_smart_shunt_1 *p)
       "Last Hour      : %.2f Wh\n"
       "Last Day       : %.2f Wh\n"
       "Last Week      : %.2f Wh\n"
+      "Lifetime In    : %.2f Ah / %.1f Wh\n"
+      "Lifetime Out   : %.2f Ah / %.1f Wh\n"
+      "Cycles         : %.1f (capacity %.1f Ah, SOH %.0f %%)\n"
+      "Internal R     : %.1f mOhm\n"
       "Load Output    : %s\n"
       "===================\n",
       p->mesh.messageID,
@@ -981,8 +1067,33 @@ void printShunt(const struct_message_ae_smart_shunt_1 *p)
       p->mesh.lastHourWh,
       p->mesh.lastDayWh,
       p->mesh.lastWeekWh,
+      p->mesh.lifetimeAhIn, p->mesh.lifetimeWhIn,
+      p->mesh.lifetimeAhOut, p->mesh.lifetimeWhOut,
+      p->equivalentCycles, p->usableCapacityAh, p->stateOfHealth,
+      p->internalResistanceMilliOhm,
       ina226_adc.isLoadConnected() ? "ON" : "OFF"
   );
+
+  Serial.println("--- Sampling ---");
+  Serial.printf("  Profile     : %s%s\n", ina226_adc.getConversionProfileName(),
+                ina226_adc.isAdaptiveConversion() ? " (adaptive)" : "");
+  Serial.printf("  Rate        : %.1f Hz\n", ina226_adc.getEffectiveSampleRate_Hz());
+  Serial.printf("  Missed conv : %u\n", ina226_adc.getMissedConversions());
+  Serial.printf("  Ring drops  : %u\n", samplingTask.getDroppedSamples());
+  Serial.printf("  Stack free  : %u of %u bytes\n", samplingTask.getStackHeadroom(),
+                (unsigned)SamplingTask::STACK_SIZE);
+  Serial.printf("  I2C/sample  : %u\n", ina226_adc.getSampleI2cTransactions());
+  if (ina226_adc.isSocFilterEnabled()) {
+    Serial.printf("  SOC filter  : +/-%.1f%% V1 %.3fV corr %+.2f%%\n",
+                  ina226_adc.getSocSigma_percent(), ina226_adc.getSocPolarization_V(),
+                  ina226_adc.getSocFilterCorrection_percent());
+  }
+  Serial.printf("  Decimation  : /%u (%.1f Hz filtered current)\n",
+                ina226_adc.getCurrentDecimation(),
+                ina226_adc.getEffectiveSampleRate_Hz() / ina226_adc.getCurrentDecimation());
+  Serial.printf("  Sample gaps : %u (longest %u ms, limit %u ms)\n",
+                ina226_adc.getIntegrationGapCount(), ina226_adc.getLongestGap_ms(),
+                ina226_adc.getMaxSampleGap_ms());
   
   // Print Temp Sensor Data (Relay) - Always show what is in the struct!
   Serial.println("--- Relayed Temp Sensor ---");
@@ -1056,7 +1167,7 @@ void runShuntResistanceCalibration(INA226_ADC &ina)
 
   // 2. Disable Hardware Alert Interrupts
   // Prevents the ISR from checking protection/safety limits during calibration
-  detachInterrupt(digitalPinToInterrupt(INA_ALERT_PIN));
+  detachAlertInterrupt();
   Serial.println(F("Alert Pin Interrupt DISABLED for calibration safety."));
 
   // 3. Shunt Selection
@@ -1064,7 +1175,7 @@ void runShuntResistanceCalibration(INA226_ADC &ina)
   if (shuntInput < 0) {
       // Restore Interrupt before returning
       ina.clearAlerts(); // clear any stale status
-      attachInterrupt(digitalPinToInterrupt(INA_ALERT_PIN), alertISR, FALLING);
+      attachAlertInterrupt();
       Serial.println(F("Alert Pin Interrupt RESTORED."));
       return; 
   }
@@ -1124,7 +1235,7 @@ void runShuntResistanceCalibration(INA226_ADC &ina)
       if (line.equalsIgnoreCase("x")) { 
           Serial.println(F("Canceled.")); 
           ina.clearAlerts();
-          attachInterrupt(digitalPinToInterrupt(INA_ALERT_PIN), alertISR, FALLING);
+          attachAlertInterrupt();
           Serial.println(F("Alert Pin Interrupt RESTORED."));
           return; 
       }
@@ -1577,7 +1688,16 @@ void setup()
   // Clear any startup alerts before attaching the interrupt
   ina226_adc.clearAlerts();
   // Attach interrupt for INA226 alert pin
-  attachInterrupt(digitalPinToInterrupt(INA_ALERT_PIN), alertISR, FALLING);
+  attachAlertInterrupt();
+  // The alert pin also signals conversion-ready and the sampling task runs
+  // on it (default). Off, the pin carries only the over-limit alert and the
+  // ISR opens the load switch itself: see CMD:TRIP_PATH.
+  ina226_adc.setConversionReadyMode(
+      settings.getBool(NVS_CAL_NAMESPACE, NVS_KEY_CONVERSION_READY, true));
+  // Retune averaging/conversion time from the current's variance and slope
+  ina226_adc.setAdaptiveConversion(true);
+  // Current from the shunt register: one read less and no CAL rounding
+  ina226_adc.setShuntCurrentPath(true);
 
   if (!ina226_adc.isConfigured())
   {
@@ -1590,16 +1710,21 @@ void setup()
   // Check for and restore battery capacity from NVS
   Preferences preferences;
   preferences.begin("storage", true); // read-only
-  if (preferences.isKey("bat_cap"))
+  bool hasCharge = preferences.isKey("bat_q");
+  if (hasCharge || preferences.isKey("bat_cap"))
   {
-    float restored_capacity = preferences.getFloat("bat_cap", 0.0f);
+    if (hasCharge) {
+      ina226_adc.setBatteryCharge_pC(preferences.getLong64("bat_q", 0));
+    } else {
+      // Saved by firmware that still kept capacity as a float
+      ina226_adc.setBatteryCapacity(preferences.getFloat("bat_cap", 0.0f));
+    }
     preferences.end(); // close read-only
-
-    ina226_adc.setBatteryCapacity(restored_capacity);
-    Serial.printf("Restored battery capacity: %f\n", restored_capacity);
+    Serial.printf("Restored battery capacity: %f\n", ina226_adc.getBatteryCapacity());
 
     // Now clear the key
     preferences.begin("storage", false); // read-write
+    preferences.remove("bat_q");
     preferences.remove("bat_cap");
     preferences.end();
     Serial.println("Cleared battery capacity from NVS");
@@ -1689,8 +1814,24 @@ void setup()
   bleHandler.setPairingCallback(pairingCallback);
   bleHandler.setEfuseLimitCallback([](float limit){
       Serial.printf("[BLE WRITE] E-Fuse Limit: %.2f A\n", limit);
+      SamplingLock lock(samplingTask);
       ina226_adc.setEfuseLimit(limit);
   });
+  bleHandler.setHistoryRequestCallback([](std::vector<uint8_t> data){
+      if (data.empty() || data[0] >= HistoryStore::TIER_COUNT) {
+          Serial.println("BLE: Invalid History Request");
+          return;
+      }
+      const uint16_t offset = data.size() >= 3 ? (uint16_t)(data[1] | (data[2] << 8)) : 0;
+      static uint8_t page[512];
+      size_t length;
+      {
+          SamplingLock lock(samplingTask);
+          length = samplingTask.getHistory().exportPage(
+              (HistoryStore::Tier)data[0], offset, esp_timer_get_time(), page, sizeof(page));
+      }
+      bleHandler.updateHistoryPage(page, length);
+  });
   bleHandler.setTpmsConfigCallback([](std::vector<uint8_t> data){
       if (data.size() == 48) {
           Serial.println("BLE: Received TPMS Config Restore (48 bytes)");
@@ -1707,10 +1848,7 @@ void setup()
       Serial.printf("[BLE] Cloud Config Set: %s\n", enabled ? "ON" : "OFF");
       g_cloudEnabled = enabled;
       
-      Preferences p;
-      p.begin("config", false);
-      p.putBool("cloud_enabled", enabled);
-      p.end();
+      settings.putBool("config", "cloud_enabled", enabled);
       
       
       if (enabled) {
@@ -1740,12 +1878,10 @@ void setup()
 
   // Create initial telemetry data for the first advertisement
   ina226_adc.readSensors(); // Read sensors to get initial values
+  starter_adc.update();
   
   // Load Cloud Config
-  Preferences prefs;
-  prefs.begin("config", true);
-  g_cloudEnabled = prefs.getBool("cloud_enabled", false);
-  prefs.end();
+  g_cloudEnabled = settings.getBool("config", "cloud_enabled", false);
   Serial.printf("Cloud Uplink Enabled: %s\n", g_cloudEnabled ? "YES" : "NO");
 
   Telemetry initial_telemetry = {
@@ -1785,6 +1921,28 @@ void setup()
   
   mqttHandler.begin(); // Init MQTT Client
 
+  // Hand sampling over to the dedicated task. Everything above read the
+  // INA226 directly; from here on only the task (or a SamplingLock holder)
+  // touches it.
+  g_latestSample.busVoltage_V = ina226_adc.getBusVoltage_V();
+  g_latestSample.current_mA = ina226_adc.getCurrent_mA();
+  g_latestSample.filteredCurrent_mA = g_latestSample.current_mA;
+  g_latestSample.power_mW = ina226_adc.getPower_mW();
+  if (historyFlash.begin("history", "spiffs") && flashLog.begin()) {
+    Serial.printf("[FLASHLOG] %u/%u pages used, max erase count %u.\n",
+                  (unsigned)flashLog.getUsedPages(), (unsigned)flashLog.getPageCount(),
+                  (unsigned)flashLog.getMaxEraseCount());
+  }
+
+  if (!samplingTask.begin()) {
+    Serial.println("WARNING: sampling task not running, coulomb counting stopped!");
+  }
+
+  // Settings changed from BLE/MQTT/Serial are written to NVS from here
+  if (xTaskCreate(settingsCommitTask, "settings", 3072, nullptr, 1, nullptr) != pdPASS) {
+    Serial.println("WARNING: settings commit task not running, changes are saved on restart only!");
+  }
+
   Serial.println("Setup done");
 }
 
@@ -1854,6 +2012,7 @@ void loop_deprecated()
         WiFi.disconnect(true, true);
         
         // Perform low-level NVS erase
+        settings.invalidate(); // nothing cached may be written back after the wipe
         esp_err_t err = nvs_flash_erase();
         if (err != ESP_OK) {
             Serial.printf("Error: nvs_flash_erase failed (0x%x)\n", err);
@@ -2011,9 +2170,8 @@ void loop_deprecated()
 
       // Calculate and print run-flat time with warning threshold
       bool warning = false;
-      float currentA = ina226_adc.getCurrent_mA() / 1000.0f; // convert mA to A
       float warningThresholdHours = 10.0f;
-      String avgRunFlatTimeStr = ina226_adc.getAveragedRunFlatTime(currentA, warningThresholdHours, warning);
+      String avgRunFlatTimeStr = ina226_adc.getAveragedRunFlatTime(warningThresholdHours, warning);
       memset(ae_smart_shunt_struct.mesh.runFlatTime, 0, sizeof(ae_smart_shunt_struct.mesh.runFlatTime));  // Clear buffer
       strncpy(ae_smart_shunt_struct.mesh.runFlatTime, avgRunFlatTimeStr.c_str(), sizeof(ae_smart_shunt_struct.mesh.runFlatTime) - 1);
     }
@@ -2150,6 +2308,7 @@ void loop_deprecated()
   // Handle Async Restart
   if (g_pendingRestart && millis() > g_restartTs) {
       Serial.println("Executing Scheduled Restart...");
+      settings.flush();
       delay(100);
       ESP.restart();
   }
@@ -2157,29 +2316,56 @@ void loop_deprecated()
 
 // Helper to package and send BLE data
 void sendBleUpdate() {
-
+      // Copy the sampling task's state in one short lock hold
+      float capacityAh, cutoffV, hysteresisV, hourWh, dayWh, weekWh, efuseA, ratedAh, sampleHz;
+      bool configured, loadConnected;
+      uint32_t lowVoltageDelayS;
+      uint16_t activeShunt;
+      const char *profileName;
+      String suffix;
+      SignalStats::Summary iStats, vStats;
+      {
+        SamplingLock lock(samplingTask);
+        capacityAh = ina226_adc.getBatteryCapacity();
+        configured = ina226_adc.isConfigured();
+        loadConnected = ina226_adc.isLoadConnected();
+        cutoffV = ina226_adc.getLowVoltageCutoff();
+        hysteresisV = ina226_adc.getHysteresis();
+        hourWh = ina226_adc.getLastHourEnergy_Wh();
+        dayWh = ina226_adc.getLastDayEnergy_Wh();
+        weekWh = ina226_adc.getLastWeekEnergy_Wh();
+        lowVoltageDelayS = ina226_adc.getLowVoltageDelay();
+        suffix = ina226_adc.getDeviceNameSuffix();
+        efuseA = ina226_adc.getEfuseLimit();
+        activeShunt = ina226_adc.getActiveShunt();
+        ratedAh = ina226_adc.getMaxBatteryCapacity();
+        profileName = ina226_adc.getConversionProfileName();
+        sampleHz = ina226_adc.getEffectiveSampleRate_Hz();
+        iStats = ina226_adc.getCurrentStats();
+        vStats = ina226_adc.getVoltageStats();
+      }
 
       // 10 Hz Telemetry Loop
       Telemetry telemetry_data = {
-          .batteryVoltage = ina226_adc.getBusVoltage_V(),
-          .batteryCurrent = ina226_adc.getCurrent_mA() / 1000.0f,
-          .batteryPower = ina226_adc.getPower_mW() / 1000.0f,
+          .batteryVoltage = g_latestSample.busVoltage_V,
+          .batteryCurrent = g_latestSample.filteredCurrent_mA / 1000.0f,
+          .batteryPower = g_latestSample.power_mW / 1000.0f,
           .batterySOC = ae_smart_shunt_struct.mesh.batterySOC * 100.0f,
-          .batteryCapacity = ina226_adc.getBatteryCapacity(),
+          .batteryCapacity = capacityAh,
           .starterBatteryVoltage = starter_adc.readVoltage(),
-          .isCalibrated = ina226_adc.isConfigured(),
+          .isCalibrated = configured,
           .errorState = ae_smart_shunt_struct.mesh.batteryState,
-          .loadState = ina226_adc.isLoadConnected(),
-          .cutoffVoltage = ina226_adc.getLowVoltageCutoff(),
-          .reconnectVoltage = (ina226_adc.getLowVoltageCutoff() + ina226_adc.getHysteresis()),
-          .lastHourWh = ina226_adc.getLastHourEnergy_Wh(),
-          .lastDayWh = ina226_adc.getLastDayEnergy_Wh(),
-          .lastWeekWh = ina226_adc.getLastWeekEnergy_Wh(),
-          .lowVoltageDelayS = ina226_adc.getLowVoltageDelay(),
-          .deviceNameSuffix = ina226_adc.getDeviceNameSuffix(),
-          .eFuseLimit = ina226_adc.getEfuseLimit(),
-          .activeShuntRating = ina226_adc.getActiveShunt(),
-          .ratedCapacity = ina226_adc.getMaxBatteryCapacity(),
+          .loadState = loadConnected,
+          .cutoffVoltage = cutoffV,
+          .reconnectVoltage = (cutoffV + hysteresisV),
+          .lastHourWh = hourWh,
+          .lastDayWh = dayWh,
+          .lastWeekWh = weekWh,
+          .lowVoltageDelayS = lowVoltageDelayS,
+          .deviceNameSuffix = suffix,
+          .eFuseLimit = efuseA,
+          .activeShuntRating = activeShunt,
+          .ratedCapacity = ratedAh,
           .runFlatTime = String(ae_smart_shunt_struct.mesh.runFlatTime),
           // Diagnostics
           .diagnostics = "", 
@@ -2190,7 +2376,15 @@ void sendBleUpdate() {
           .tempSensorUpdateInterval = ae_smart_shunt_struct.mesh.tempSensorUpdateInterval,
           .tpmsPressurePsi = {ae_smart_shunt_struct.mesh.tpmsPressurePsi[0], ae_smart_shunt_struct.mesh.tpmsPressurePsi[1], ae_smart_shunt_struct.mesh.tpmsPressurePsi[2], ae_smart_shunt_struct.mesh.tpmsPressurePsi[3]},
           .gaugeLastRx = espNowHandler.getLastGaugeRx(),
-          .gaugeLastTxSuccess = g_gaugeLastTxSuccess
+          .gaugeLastTxSuccess = g_gaugeLastTxSuccess,
+          .lifetimeAhIn = ae_smart_shunt_struct.mesh.lifetimeAhIn,
+          .lifetimeAhOut = ae_smart_shunt_struct.mesh.lifetimeAhOut,
+          .lifetimeWhIn = ae_smart_shunt_struct.mesh.lifetimeWhIn,
+          .lifetimeWhOut = ae_smart_shunt_struct.mesh.lifetimeWhOut,
+          .equivalentCycles = ae_smart_shunt_struct.equivalentCycles,
+          .usableCapacityAh = ae_smart_shunt_struct.usableCapacityAh,
+          .stateOfHealth = ae_smart_shunt_struct.stateOfHealth,
+          .internalResistanceMilliOhm = ae_smart_shunt_struct.internalResistanceMilliOhm
       };
       
       // Populate TPMS Config Backup
@@ -2202,8 +2396,17 @@ void sendBleUpdate() {
       int hours = (uptime % 86400) / 3600;
       int minutes = (uptime % 3600) / 60;
       
-      char diagBuf[64];
-      snprintf(diagBuf, sizeof(diagBuf), "Rst:%d Up:%dd %dh %dm", esp_reset_reason(), days, hours, minutes);
+      char diagBuf[192];
+      int diagLen = snprintf(diagBuf, sizeof(diagBuf), "Rst:%d Up:%dd %dh %dm Cv:%s %.0fHz",
+                             esp_reset_reason(), days, hours, minutes,
+                             profileName, sampleHz);
+      // Last statistics window: current percentiles (A), voltage range (V)
+      if (iStats.count > 0 && diagLen > 0 && diagLen < (int)sizeof(diagBuf)) {
+        snprintf(diagBuf + diagLen, sizeof(diagBuf) - diagLen,
+                 " I50/95/99:%.2f/%.2f/%.2f Isd:%.2f V:%.2f-%.2f/%.2f",
+                 iStats.p50 / 1000.0f, iStats.p95 / 1000.0f, iStats.p99 / 1000.0f,
+                 iStats.stddev / 1000.0f, vStats.min, vStats.max, vStats.mean);
+      }
       telemetry_data.diagnostics = String(diagBuf);
 
       bleHandler.updateTelemetry(telemetry_data);
@@ -2230,17 +2433,55 @@ void updateStruct() {
       ae_smart_shunt_struct.mesh.isCalibrated = true;
       // Note: We don't need to call checkAndHandleProtection here as it's done in the fast loop
 
-      ae_smart_shunt_struct.mesh.batteryVoltage = ina226_adc.getBusVoltage_V();
-      ae_smart_shunt_struct.mesh.batteryCurrent = ina226_adc.getCurrent_mA() / 1000.0f;
-      ae_smart_shunt_struct.mesh.batteryCurrentAvg = ina226_adc.getUplinkAverageCurrent_A(); // NEW: Averaged
-      ae_smart_shunt_struct.mesh.batteryPower = ina226_adc.getPower_mW() / 1000.0f;
+      // Everything the sampling task writes is copied in one lock hold;
+      // the struct is filled after it is released.
+      LifetimeCounters::Totals lifetime;
+      float cycles, capacityAh, soh, rInt;
+      float currentAvgA, hourWh, dayWh, weekWh, remainingAh, maxCap;
+      bool loadConnected;
+      DisconnectReason disconnectReason;
+      String suffix;
+      String runFlatTimeStr;
+      {
+        SamplingLock lock(samplingTask);
+        currentAvgA = ina226_adc.getUplinkAverageCurrent_A();
+        hourWh = ina226_adc.getLastHourEnergy_Wh();
+        dayWh = ina226_adc.getLastDayEnergy_Wh();
+        weekWh = ina226_adc.getLastWeekEnergy_Wh();
+        lifetime = ina226_adc.getLifetimeTotals();
+        cycles = ina226_adc.getEquivalentCycles();
+        capacityAh = ina226_adc.getEstimatedCapacity_Ah();
+        soh = ina226_adc.getStateOfHealth_percent();
+        rInt = ina226_adc.getInternalResistance_Ohm();
+        loadConnected = ina226_adc.isLoadConnected();
+        disconnectReason = ina226_adc.getDisconnectReason();
+        remainingAh = ina226_adc.getBatteryCapacity();
+        maxCap = ina226_adc.getMaxBatteryCapacity();
+        suffix = ina226_adc.getDeviceNameSuffix();
+        // Run flat time from the sampling-path current average. This provides
+        // a stable reading that accounts for intermittent loads (e.g., fridges)
+        bool warning = false;
+        runFlatTimeStr = ina226_adc.getAveragedRunFlatTime(10.0f, warning);
+      }
+
+      ae_smart_shunt_struct.mesh.batteryVoltage = g_latestSample.busVoltage_V;
+      ae_smart_shunt_struct.mesh.batteryCurrent = g_latestSample.filteredCurrent_mA / 1000.0f;
+      ae_smart_shunt_struct.mesh.batteryCurrentAvg = currentAvgA; // NEW: Averaged
+      ae_smart_shunt_struct.mesh.batteryPower = g_latestSample.power_mW / 1000.0f;
       ae_smart_shunt_struct.mesh.starterBatteryVoltage = starter_adc.readVoltage();
-      ae_smart_shunt_struct.mesh.lastHourWh = ina226_adc.getLastHourEnergy_Wh();
-      ae_smart_shunt_struct.mesh.lastDayWh = ina226_adc.getLastDayEnergy_Wh();
-      ae_smart_shunt_struct.mesh.lastWeekWh = ina226_adc.getLastWeekEnergy_Wh();
+      ae_smart_shunt_struct.mesh.lastHourWh = hourWh;
+      ae_smart_shunt_struct.mesh.lastDayWh = dayWh;
+      ae_smart_shunt_struct.mesh.lastWeekWh = weekWh;
+      ae_smart_shunt_struct.mesh.lifetimeAhIn = lifetime.chargeIn_Ah();
+      ae_smart_shunt_struct.mesh.lifetimeAhOut = lifetime.chargeOut_Ah();
+      ae_smart_shunt_struct.mesh.lifetimeWhIn = lifetime.energyIn_Wh();
+      ae_smart_shunt_struct.mesh.lifetimeWhOut = lifetime.energyOut_Wh();
+      ae_smart_shunt_struct.equivalentCycles = cycles;
+      ae_smart_shunt_struct.usableCapacityAh = isnan(capacityAh) ? 0.0f : capacityAh;
+      ae_smart_shunt_struct.stateOfHealth = isnan(soh) ? 0.0f : soh;
+      ae_smart_shunt_struct.internalResistanceMilliOhm = isnan(rInt) ? 0.0f : rInt * 1000.0f;
 
       // Populate Device Name (Consistency with BLE Advertised Name)
-      String suffix = ina226_adc.getDeviceNameSuffix();
       String deviceName = "AE Smart Shunt";
       if (suffix.length() > 0) {
           deviceName += " - " + suffix;
@@ -2261,16 +2502,13 @@ void updateStruct() {
 
       ae_smart_shunt_struct.mesh.batteryState = 0; // 0 = Normal, 1 = Warning, 2 = Critical
       
-      if (!ina226_adc.isLoadConnected() && ina226_adc.getDisconnectReason() == OVERCURRENT) {
+      if (!loadConnected && disconnectReason == OVERCURRENT) {
           ae_smart_shunt_struct.mesh.batteryState = 5; // 5 = E-Fuse Tripped
       }
 
-      // Get remaining Ah from INA helper
-      float remainingAh = ina226_adc.getBatteryCapacity();
       ae_smart_shunt_struct.mesh.batteryCapacity = remainingAh; // remaining capacity in Ah
       
       // Use the dynamic max capacity for SOC calc
-      float maxCap = ina226_adc.getMaxBatteryCapacity();
       if (maxCap > 0.0f)
       {
         ae_smart_shunt_struct.mesh.batterySOC = remainingAh / maxCap; // fraction 0..1
@@ -2293,11 +2531,6 @@ void updateStruct() {
         }
       }
       
-      // Calculate Run Flat Time using averaged current from energy buffer
-      // This provides a stable reading that accounts for intermittent loads (e.g., fridges)
-      bool warning = false;
-      float avgCurrentA = ina226_adc.getAverageCurrentFromEnergyBuffer_A();
-      String runFlatTimeStr = ina226_adc.getAveragedRunFlatTime(avgCurrentA, 10.0f, warning);
       memset(ae_smart_shunt_struct.mesh.runFlatTime, 0, sizeof(ae_smart_shunt_struct.mesh.runFlatTime));  // Clear buffer
       strncpy(ae_smart_shunt_struct.mesh.runFlatTime, runFlatTimeStr.c_str(), sizeof(ae_smart_shunt_struct.mesh.runFlatTime) - 1);
       ae_smart_shunt_struct.mesh.runFlatTime[sizeof(ae_smart_shunt_struct.mesh.runFlatTime) - 1] = '\0';
@@ -2356,6 +2589,12 @@ void updateStruct() {
         tsTemp = 0.0f;    // Clear value
         tsBatt = 0;
     }
+
+    {
+        // Feeds the OCV surface; corrects a pending voltage-based SOC seed
+        SamplingLock lock(samplingTask);
+        ina226_adc.setBatteryTemperature_C(age == 0xFFFFFFFF ? NAN : tsTemp);
+    }
     
     ae_smart_shunt_struct.mesh.tempSensorTemperature = tsTemp;
     ae_smart_shunt_struct.mesh.tempSensorBatteryLevel = tsBatt;
@@ -2386,10 +2625,18 @@ void updateStruct() {
 
 
 // Factory Mode Command Handler
+// Serial factory/diagnostic commands. Each one takes the sampling lock only
+// to read or change INA226_ADC state and prints after releasing it, so a
+// slow serial link never holds off the sampling task (and with it the
+// conversion-ready trip path).
 void handleFactoryCommands(String cmd) {
     if (cmd == "CMD:TEST_ADC") {
-        ina226_adc.readSensors();
-        float busV = ina226_adc.getBusVoltage_V();
+        float busV;
+        {
+            SamplingLock lock(samplingTask);
+            ina226_adc.readSensors();
+            busV = ina226_adc.getBusVoltage_V();
+        }
         float starterV = starter_adc.readVoltage();
         // Return simulated success if values are sane, or just the values
         // Format expectations from Provisioning Tool: "<< ADC_CAL: OK (-2mV offset)"
@@ -2401,11 +2648,373 @@ void handleFactoryCommands(String cmd) {
         int8_t rssi = WiFi.RSSI(); 
         Serial.printf("<< WIFI: OK (RSSI: %d dBm)\n", rssi);
     }
+    else if (cmd == "CMD:LIFETIME_RESET") {
+        {
+            SamplingLock lock(samplingTask);
+            ina226_adc.resetLifetimeCounters();
+        }
+        Serial.println("<< LIFETIME_RESET: OK");
+    }
+    else if (cmd == "CMD:CYCLES") {
+        float equivalent, capacity, last, soh;
+        uint32_t measurements;
+        float atDepth[CycleCounter::DEPTH_BINS];
+        {
+            SamplingLock lock(samplingTask);
+            equivalent = ina226_adc.getEquivalentCycles();
+            capacity = ina226_adc.getEstimatedCapacity_Ah();
+            last = ina226_adc.getLastMeasuredCapacity_Ah();
+            measurements = ina226_adc.getCapacityMeasurements();
+            soh = ina226_adc.getStateOfHealth_percent();
+            for (size_t b = 0; b < CycleCounter::DEPTH_BINS; b++) {
+                atDepth[b] = ina226_adc.getCyclesAtDepth(b);
+            }
+        }
+        Serial.printf("<< CYCLES: equivalent=%.2f capacity=%.2fAh last=%.2fAh measurements=%u soh=%.1f%%\n",
+                      equivalent, capacity, last, measurements, soh);
+        const int binWidth = 100 / (int)CycleCounter::DEPTH_BINS;
+        for (size_t b = 0; b < CycleCounter::DEPTH_BINS; b++) {
+            Serial.printf("<< DOD %3d-%3d%%: %.1f\n", (int)b * binWidth, (int)(b + 1) * binWidth,
+                          atDepth[b]);
+        }
+    }
+    else if (cmd == "CMD:CYCLES_RESET") {
+        {
+            SamplingLock lock(samplingTask);
+            ina226_adc.resetCycleCounter();
+        }
+        Serial.println("<< CYCLES_RESET: OK");
+    }
+    else if (cmd == "CMD:TRIP_LATENCY") {
+        LatencyHistogram trips;
+        bool taskPath;
+        uint32_t period_us;
+        {
+            SamplingLock lock(samplingTask);
+            trips = ina226_adc.getTripLatency();
+            taskPath = ina226_adc.isConversionReadyMode();
+            period_us = ina226_adc.getConversionPeriod_us();
+        }
+        Serial.printf("<< TRIP_LATENCY: trips=%u min=%uus mean=%.1fus p99<=%uus max=%uus path=%s result=%uus\n",
+                      trips.getCount(), trips.getMin_us(), trips.getMean_us(),
+                      trips.getPercentile_us(0.99f), trips.getMax_us(),
+                      taskPath ? "TASK" : "ISR", period_us);
+        for (uint8_t b = 0; b < LatencyHistogram::BINS; b++) {
+            if (trips.getBin(b) == 0) {
+                continue;
+            }
+            if (b == LatencyHistogram::BINS - 1) {
+                Serial.printf("<< >= %uus: %u\n", LatencyHistogram::getBinLimit_us(b - 1),
+                              trips.getBin(b));
+            } else {
+                Serial.printf("<< < %uus: %u\n", LatencyHistogram::getBinLimit_us(b),
+                              trips.getBin(b));
+            }
+        }
+    }
+    else if (cmd == "CMD:TRIP_LATENCY_RESET") {
+        {
+            SamplingLock lock(samplingTask);
+            ina226_adc.resetTripLatency();
+        }
+        Serial.println("<< TRIP_LATENCY_RESET: OK");
+    }
+    else if (cmd == "CMD:TRIP_PATH=ISR" || cmd == "CMD:TRIP_PATH=TASK") {
+        // ISR: the alert pin only carries the over-limit alert and the
+        // interrupt opens the switch. TASK: conversion-ready sampling.
+        const bool taskPath = cmd.endsWith("TASK");
+        {
+            SamplingLock lock(samplingTask);
+            ina226_adc.setConversionReadyMode(taskPath);
+        }
+        settings.putBool(NVS_CAL_NAMESPACE, NVS_KEY_CONVERSION_READY, taskPath);
+        Serial.printf("<< TRIP_PATH: OK (%s)\n", taskPath ? "TASK" : "ISR");
+    }
+    else if (cmd == "CMD:RINT") {
+        float estimate, last, comp;
+        uint32_t steps, rejects;
+        bool autoComp;
+        {
+            SamplingLock lock(samplingTask);
+            estimate = ina226_adc.getInternalResistance_Ohm();
+            last = ina226_adc.getLastResistanceStep_Ohm();
+            steps = ina226_adc.getResistanceSteps();
+            rejects = ina226_adc.getResistanceRejects();
+            comp = ina226_adc.getCompensationResistance();
+            autoComp = ina226_adc.isAutoCompensation();
+        }
+        Serial.printf("<< RINT: estimate=%.2fmOhm last=%.2fmOhm steps=%u rejected=%u comp=%.2fmOhm auto=%s\n",
+                      estimate * 1000.0f, last * 1000.0f, steps, rejects, comp * 1000.0f,
+                      autoComp ? "ON" : "OFF");
+    }
+    else if (cmd == "CMD:RINT_AUTO=ON" || cmd == "CMD:RINT_AUTO=OFF") {
+        bool autoComp;
+        {
+            SamplingLock lock(samplingTask);
+            ina226_adc.setAutoCompensation(cmd.endsWith("ON"));
+            autoComp = ina226_adc.isAutoCompensation();
+        }
+        Serial.printf("<< RINT_AUTO: OK (%s)\n", autoComp ? "ON" : "OFF");
+    }
+    else if (cmd == "CMD:SOC_FILTER") {
+        bool enabled;
+        float sigma, v1, correction, r0;
+        {
+            SamplingLock lock(samplingTask);
+            enabled = ina226_adc.isSocFilterEnabled();
+            sigma = ina226_adc.getSocSigma_percent();
+            v1 = ina226_adc.getSocPolarization_V();
+            correction = ina226_adc.getSocFilterCorrection_percent();
+            r0 = ina226_adc.getCompensationResistance();
+        }
+        Serial.printf("<< SOC_FILTER: %s sigma=%.2f%% v1=%.3fV correction=%+.2f%% r0=%.4fOhm\n",
+                      enabled ? "ON" : "OFF", sigma, v1, correction, r0);
+    }
+    else if (cmd == "CMD:SOC_FILTER=ON" || cmd == "CMD:SOC_FILTER=OFF") {
+        bool enabled;
+        {
+            SamplingLock lock(samplingTask);
+            ina226_adc.setSocFilterEnabled(cmd.endsWith("ON"));
+            enabled = ina226_adc.isSocFilterEnabled();
+        }
+        Serial.printf("<< SOC_FILTER: OK (%s)\n", enabled ? "ON" : "OFF");
+    }
+    else if (cmd == "CMD:STATS") {
+        SignalStats::Summary i, v;
+        {
+            SamplingLock lock(samplingTask);
+            i = ina226_adc.getCurrentStats();
+            v = ina226_adc.getVoltageStats();
+        }
+        Serial.printf("<< STATS: window=%ums samples=%u\n", (unsigned)i.window_ms, (unsigned)i.count);
+        Serial.printf("<< I(mA): mean=%.1f sd=%.1f min=%.1f max=%.1f p50=%.1f p95=%.1f p99=%.1f\n",
+                      i.mean, i.stddev, i.min, i.max, i.p50, i.p95, i.p99);
+        Serial.printf("<< V(V): mean=%.3f sd=%.3f min=%.3f max=%.3f p50=%.3f p95=%.3f p99=%.3f\n",
+                      v.mean, v.stddev, v.min, v.max, v.p50, v.p95, v.p99);
+    }
+    else if (cmd.startsWith("CMD:STATS_WINDOW=")) {
+        const long seconds = cmd.substring(17).toInt();
+        if (seconds < 1 || seconds > 86400) {
+            Serial.println("<< ERROR: Window must be 1..86400 s");
+        } else {
+            {
+                SamplingLock lock(samplingTask);
+                ina226_adc.setStatsWindow_ms((uint32_t)seconds * 1000);
+            }
+            Serial.printf("<< STATS_WINDOW: OK (%lds)\n", seconds);
+        }
+    }
     else {
         Serial.println("<< ERROR: Unknown Command");
     }
 }
 
+// Write the lifetime counters (and the cycle counter with them) to NVS when
+// their save policy allows it, or whenever they changed if force is set
+// (before a restart or OTA).
+void saveLifetimeCounters(bool force) {
+    LifetimeCounters::Totals snapshot;
+    CycleCounter::State cycles;
+    {
+        SamplingLock lock(samplingTask);
+        snapshot = ina226_adc.getLifetimeTotals();
+        cycles = ina226_adc.getCycleState();
+    }
+    ina226_adc.saveLifetimeCounters(snapshot, cycles, force);
+}
+
+// Wall-clock time for a log record. Until NTP has set the clock the log
+// carries on from its newest record as if the device had just been off.
+uint32_t flashLogTime_s(int64_t uptime_s) {
+    const time_t now = time(nullptr);
+    if (now > 1600000000) {
+        g_logTimeBase_s = (uint32_t)(now - esp_timer_get_time() / 1000000);
+    } else if (g_logTimeBase_s == 0) {
+        g_logTimeBase_s = flashLog.getLastTime_s() + 60;
+    }
+    return g_logTimeBase_s + (uint32_t)uptime_s;
+}
+
+// Append the minute buckets closed since the last call to the flash log.
+void logClosedMinutes() {
+    if (!flashLog.isReady()) {
+        return;
+    }
+    HistoryStore::Bucket closed[4];
+    int64_t newest;
+    size_t n = 0;
+    {
+        SamplingLock lock(samplingTask);
+        const HistoryStore& history = samplingTask.getHistory();
+        const size_t stored = history.size(HistoryStore::TIER_MINUTE);
+        newest = history.getNewestPeriod(HistoryStore::TIER_MINUTE);
+        if (stored == 0 || newest == g_lastLoggedMinute) {
+            return;
+        }
+        int64_t pending = g_lastLoggedMinute < 0 ? 1 : newest - g_lastLoggedMinute;
+        if (pending > (int64_t)stored) pending = stored;
+        if (pending > 4) pending = 4;
+        for (n = 0; n < (size_t)pending; n++) {
+            closed[n] = history.at(HistoryStore::TIER_MINUTE, stored - pending + n);
+        }
+    }
+    g_lastLoggedMinute = newest;
+
+    for (size_t i = 0; i < n; i++) {
+        const HistoryStore::Bucket& b = closed[i];
+        if (b.samples == 0) {
+            continue;
+        }
+        FlashLog::Record r;
+        // Stamp the end of the minute
+        r.time_s = flashLogTime_s((newest - (int64_t)(n - 1 - i) + 1) * 60);
+        r.field[FlashLog::VOLTAGE_MEAN] = b.channel[HistoryStore::CH_VOLTAGE].mean;
+        r.field[FlashLog::VOLTAGE_MIN] = b.channel[HistoryStore::CH_VOLTAGE].min;
+        r.field[FlashLog::VOLTAGE_MAX] = b.channel[HistoryStore::CH_VOLTAGE].max;
+        r.field[FlashLog::CURRENT_MEAN] = b.channel[HistoryStore::CH_CURRENT].mean;
+        r.field[FlashLog::CURRENT_MIN] = b.channel[HistoryStore::CH_CURRENT].min;
+        r.field[FlashLog::CURRENT_MAX] = b.channel[HistoryStore::CH_CURRENT].max;
+        r.field[FlashLog::POWER_MEAN] = b.channel[HistoryStore::CH_POWER].mean;
+        r.field[FlashLog::SOC_MEAN] = b.channel[HistoryStore::CH_SOC].mean;
+        flashLog.append(r);
+    }
+}
+
+// Flash log commands: CMD:LOG (status), CMD:LOG=<from>,<to> (unix seconds,
+// streamed as CSV), CMD:LOG_CLEAR. Only loop() touches the log.
+void handleLogCommand(String cmd) {
+    if (cmd == "CMD:LOG") {
+        Serial.printf("<< LOG: %s pages=%u/%u max_erase=%u last=%u failures=%u\n",
+                      flashLog.isReady() ? "READY" : "UNAVAILABLE",
+                      (unsigned)flashLog.getUsedPages(), (unsigned)flashLog.getPageCount(),
+                      (unsigned)flashLog.getMaxEraseCount(), (unsigned)flashLog.getLastTime_s(),
+                      (unsigned)flashLog.getAppendFailures());
+    } else if (cmd.startsWith("CMD:LOG=")) {
+        const String args = cmd.substring(strlen("CMD:LOG="));
+        const int comma = args.indexOf(',');
+        const uint32_t from = strtoul(args.c_str(), nullptr, 10);
+        const uint32_t to = comma > 0 ? strtoul(args.c_str() + comma + 1, nullptr, 10) : UINT32_MAX;
+        Serial.println("t_s,v_mean,v_min,v_max,i_mean,i_min,i_max,p_mean,soc_mean");
+        const size_t n = flashLog.query(from, to, [](const FlashLog::Record& r) {
+            Serial.printf("%u,%.3f,%.3f,%.3f,%.2f,%.2f,%.2f,%.0f,%.2f\n", (unsigned)r.time_s,
+                          HistoryStore::decode(HistoryStore::CH_VOLTAGE, r.field[FlashLog::VOLTAGE_MEAN]),
+                          HistoryStore::decode(HistoryStore::CH_VOLTAGE, r.field[FlashLog::VOLTAGE_MIN]),
+                          HistoryStore::decode(HistoryStore::CH_VOLTAGE, r.field[FlashLog::VOLTAGE_MAX]),
+                          HistoryStore::decode(HistoryStore::CH_CURRENT, r.field[FlashLog::CURRENT_MEAN]) / 1000.0f,
+                          HistoryStore::decode(HistoryStore::CH_CURRENT, r.field[FlashLog::CURRENT_MIN]) / 1000.0f,
+                          HistoryStore::decode(HistoryStore::CH_CURRENT, r.field[FlashLog::CURRENT_MAX]) / 1000.0f,
+                          HistoryStore::decode(HistoryStore::CH_POWER, r.field[FlashLog::POWER_MEAN]) / 1000.0f,
+                          HistoryStore::decode(HistoryStore::CH_SOC, r.field[FlashLog::SOC_MEAN]));
+            return true;
+        });
+        Serial.printf("<< LOG: END records=%u\n", (unsigned)n);
+    } else if (cmd == "CMD:LOG_CLEAR") {
+        flashLog.clear();
+        Serial.println("<< LOG: CLEARED");
+    } else {
+        Serial.println("<< ERROR: Unknown Command");
+    }
+}
+
+// History dump: CMD:HISTORY=<0..3> (1 s, 1 min, 1 h, 1 day buckets). The
+// tier is copied under the sampling lock and printed without it.
+void handleHistoryCommand(String cmd) {
+    const int tier = cmd.substring(strlen("CMD:HISTORY=")).toInt();
+    if (!cmd.startsWith("CMD:HISTORY=") || tier < 0 || tier >= HistoryStore::TIER_COUNT) {
+        Serial.println("<< ERROR: Unknown Command");
+        return;
+    }
+    static_assert(HistoryStore::SECOND_BUCKETS >= HistoryStore::MINUTE_BUCKETS &&
+                  HistoryStore::SECOND_BUCKETS >= HistoryStore::HOUR_BUCKETS &&
+                  HistoryStore::SECOND_BUCKETS >= HistoryStore::DAY_BUCKETS,
+                  "dump buffer sized for the deepest tier");
+    static HistoryStore::Bucket copy[HistoryStore::SECOND_BUCKETS];
+    const HistoryStore::Tier t = (HistoryStore::Tier)tier;
+    size_t count;
+    int64_t newest;
+    {
+        SamplingLock lock(samplingTask);
+        const HistoryStore& history = samplingTask.getHistory();
+        count = history.size(t);
+        newest = history.getNewestPeriod(t);
+        for (size_t i = 0; i < count; i++) {
+            copy[i] = history.at(t, i);
+        }
+    }
+
+    const uint32_t period_s = HistoryStore::periodSeconds(t);
+    Serial.printf("<< HISTORY: tier=%d period=%us buckets=%u\n", tier,
+                  (unsigned)period_s, (unsigned)count);
+    Serial.println("t_s,samples,v_min,v_max,v_mean,i_min,i_max,i_mean,p_min,p_max,p_mean,soc_min,soc_max,soc_mean");
+    for (size_t i = 0; i < count; i++) {
+        const HistoryStore::Bucket& b = copy[i];
+        Serial.printf("%lld,%u", (long long)((newest - (int64_t)(count - 1 - i)) * period_s),
+                      (unsigned)b.samples);
+        for (int c = 0; c < HistoryStore::CHANNEL_COUNT; c++) {
+            const HistoryStore::Channel ch = (HistoryStore::Channel)c;
+            const float scale = (ch == HistoryStore::CH_CURRENT || ch == HistoryStore::CH_POWER) ? 0.001f : 1.0f;
+            Serial.printf(",%.3f,%.3f,%.3f",
+                          HistoryStore::decode(ch, b.channel[c].min) * scale,
+                          HistoryStore::decode(ch, b.channel[c].max) * scale,
+                          HistoryStore::decode(ch, b.channel[c].mean) * scale);
+        }
+        Serial.println();
+    }
+    Serial.println("<< HISTORY: END");
+}
+
+// Transient capture commands. The dump reads a frozen capture without the
+// sampling lock so a slow serial link does not stall sampling.
+void handleCaptureCommand(String cmd) {
+    TransientCapture& capture = samplingTask.getCapture();
+
+    if (cmd == "CMD:CAPTURE") {
+        if (!capture.isFrozen()) {
+            Serial.printf("<< CAPTURE: %s (threshold %.2fA)\n",
+                          capture.getState() == TransientCapture::ARMED ? "ARMED" : "TRIGGERED",
+                          capture.getThreshold_mA() / 1000.0f);
+            return;
+        }
+        const size_t count = capture.size();
+        const size_t pre = capture.getPreTriggerCount();
+        const int64_t t0 = capture.at(pre).timestamp_us;
+        Serial.printf("<< CAPTURE: %s samples=%u pre=%u\n",
+                      TransientCapture::sourceName(capture.getSource()),
+                      (unsigned)count, (unsigned)pre);
+        Serial.println("t_us,current_mA,bus_V");
+        for (size_t i = 0; i < count; i++) {
+            const SensorSample& s = capture.at(i);
+            Serial.printf("%ld,%.1f,%.3f\n", (long)(s.timestamp_us - t0),
+                          s.current_mA, s.busVoltage_V);
+        }
+        Serial.println("<< CAPTURE: END");
+        return;
+    }
+
+    if (cmd == "CMD:CAPTURE_ARM") {
+        {
+            SamplingLock lock(samplingTask);
+            capture.rearm();
+        }
+        Serial.println("<< CAPTURE: ARMED");
+    } else if (cmd == "CMD:CAPTURE_TRIGGER") {
+        {
+            SamplingLock lock(samplingTask);
+            capture.trigger(TransientCapture::TRIGGER_MANUAL);
+        }
+        Serial.println("<< CAPTURE: TRIGGERED");
+    } else if (cmd.startsWith("CMD:CAPTURE_THRESHOLD=")) {
+        float amps = cmd.substring(strlen("CMD:CAPTURE_THRESHOLD=")).toFloat();
+        {
+            SamplingLock lock(samplingTask);
+            capture.setThreshold_mA(fabsf(amps) * 1000.0f);
+        }
+        Serial.printf("<< CAPTURE: threshold %.2fA\n", fabsf(amps));
+    } else {
+        Serial.println("<< ERROR: Unknown Command");
+    }
+}
+
 void loop() {
   bleHandler.loop(); 
   // Drives TPMS Scan & Callbacks -> onScanComplete() -> updateStruct() -> espNowHandler.sendMessage()
@@ -2416,21 +3025,24 @@ void loop() {
       tpmsHandler.update();
   }
   
-  // High Frequency Polling (10 Hz)
-  if (millis() - last_polling_millis > polling_interval) {
-      ina226_adc.readSensors();
-      ina226_adc.checkAndHandleProtection(); 
+  // Fold in the starter ADC conversions made since the last pass
+  starter_adc.update();
+
+  // Drain samples published by the sampling task (protection and coulomb
+  // counting already ran there at full rate)
+  SensorSample sample;
+  while (samplingTask.popSample(sample)) {
+      g_latestSample = sample;
       if (ina226_adc.isConfigured()) {
-          float current_mA = ina226_adc.getCurrent_mA();
-          ina226_adc.updateBatteryCapacity(current_mA / 1000.0f);
-          ina226_adc.updateEnergyUsage(ina226_adc.getPower_mW());
-          
           // Accumulate for Uplink Average
-          ina226_adc.accumulateUplinkCurrent(current_mA);
+          ina226_adc.accumulateUplinkCurrent(sample.current_mA);
       }
-      last_polling_millis = millis();
   }
   
+  // Persist closed one-minute summaries to the flash log
+  logClosedMinutes();
+  saveLifetimeCounters(false);
+
   // Fallback Telemetry (Safety Net)
   if (millis() - last_telemetry_millis > telemetry_interval) {
       updateStruct();
@@ -2632,6 +3244,8 @@ void loop() {
   // Handle Async Restart
   if (g_pendingRestart && millis() > g_restartTs) {
       Serial.println("Executing Scheduled Restart...");
+      saveLifetimeCounters(true);
+      settings.flush();
       delay(100);
       ESP.restart();
   }
@@ -2640,8 +3254,14 @@ void loop() {
   if (Serial.available()) {
       String s = Serial.readStringUntil('\n');
       s.trim();
-      if (s.startsWith("CMD:")) {
-          handleFactoryCommands(s);
+      if (s.startsWith("CMD:CAPTURE")) {
+          handleCaptureCommand(s); // takes the sampling lock itself
+      } else if (s.startsWith("CMD:HISTORY")) {
+          handleHistoryCommand(s); // takes the sampling lock itself
+      } else if (s.startsWith("CMD:LOG")) {
+          handleLogCommand(s);
+      } else if (s.startsWith("CMD:")) {
+          handleFactoryCommands(s); // takes the sampling lock per command
       } else {
           pairingCallback(s); // Reuse pairing callback for serial commands
       }
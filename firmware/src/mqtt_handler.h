@@ -6,6 +6,7 @@
 #include <ArduinoJson.h>
 #include "espnow_handler.h"
 #include "ina226_adc.h"
+#include "sampling_task.h"
 
 // Hardcoded for Proof of Concept as requested. In prod, use NVS/Manager.
 // Hardcoded Default
@@ -13,20 +14,18 @@
 #define DEFAULT_MQTT_USER "aesmartshunt"
 #define DEFAULT_MQTT_PASS "AERemoteAccess2024!"
 #define MQTT_PORT 1883
-#include <Preferences.h>
+#include "settings_store.h"
 
 class MqttHandler {
 public:
-    MqttHandler(ESPNowHandler& espNow, INA226_ADC& ina) : _espNow(espNow), _ina(ina), client(espClient) {}
+    MqttHandler(ESPNowHandler& espNow, INA226_ADC& ina, SamplingTask& sampling)
+        : _espNow(espNow), _ina(ina), _sampling(sampling), client(espClient) {}
 
     void begin() {
         // Load Broker from NVS
-        Preferences p;
-        p.begin("config", true);
-        _broker = p.getString("mqtt_broker", DEFAULT_MQTT_BROKER);
-        _user = p.getString("mqtt_user", DEFAULT_MQTT_USER);
-        _pass = p.getString("mqtt_pass", DEFAULT_MQTT_PASS);
-        p.end();
+        _broker = settings.getString("config", "mqtt_broker", DEFAULT_MQTT_BROKER);
+        _user = settings.getString("config", "mqtt_user", DEFAULT_MQTT_USER);
+        _pass = settings.getString("config", "mqtt_pass", DEFAULT_MQTT_PASS);
         Serial.printf("[MQTT] Loaded Broker: %s\n", _broker.c_str());
 
         client.setServer(_broker.c_str(), MQTT_PORT);
@@ -47,6 +46,7 @@ public:
             Serial.printf("[MQTT] Executing Debounced Load: %s\n", _pendingLoadState ? "ON" : "OFF");
             
             // Use INA226 ADC directly as we have access
+            SamplingLock lock(_sampling);
             if (_pendingLoadState) {
                 _ina.setLoadConnected(true, NONE); 
             } else {
@@ -100,6 +100,41 @@ public:
         shunt["state"] = shuntStruct.mesh.batteryState;
         shunt["run_flat_time"] = String(shuntStruct.mesh.runFlatTime);
         shunt["rssi"] = WiFi.RSSI();
+
+        // Sampling (adaptive conversion profile and measured rate) and the
+        // statistics of the last finished window, copied under the lock
+        const char* profileName;
+        float sampleHz;
+        SignalStats::Summary iStats, vStats;
+        {
+            SamplingLock lock(_sampling);
+            profileName = _ina.getConversionProfileName();
+            sampleHz = _ina.getEffectiveSampleRate_Hz();
+            iStats = _ina.getCurrentStats();
+            vStats = _ina.getVoltageStats();
+        }
+        shunt["conv_profile"] = profileName;
+        shunt["sample_hz"] = sampleHz;
+
+        if (iStats.count > 0) {
+            JsonObject stats = shunt["stats"].to<JsonObject>();
+            stats["window_s"] = iStats.window_ms / 1000.0f;
+            stats["samples"] = iStats.count;
+            stats["amps_mean"] = iStats.mean / 1000.0f;
+            stats["amps_sd"] = iStats.stddev / 1000.0f;
+            stats["amps_min"] = iStats.min / 1000.0f;
+            stats["amps_max"] = iStats.max / 1000.0f;
+            stats["amps_p50"] = iStats.p50 / 1000.0f;
+            stats["amps_p95"] = iStats.p95 / 1000.0f;
+            stats["amps_p99"] = iStats.p99 / 1000.0f;
+            stats["volts_mean"] = vStats.mean;
+            stats["volts_sd"] = vStats.stddev;
+            stats["volts_min"] = vStats.min;
+            stats["volts_max"] = vStats.max;
+            stats["volts_p50"] = vStats.p50;
+            stats["volts_p95"] = vStats.p95;
+            stats["volts_p99"] = vStats.p99;
+        }
         
         // Starter battery
         shunt["starter_volts"] = shuntStruct.mesh.starterBatteryVoltage;
@@ -111,6 +146,24 @@ public:
         shunt["last_hour_wh"] = shuntStruct.mesh.lastHourWh;
         shunt["last_day_wh"] = shuntStruct.mesh.lastDayWh;
         shunt["last_week_wh"] = shuntStruct.mesh.lastWeekWh;
+
+        // Lifetime throughput (efficiency = wh_out / wh_in over any span)
+        JsonObject lifetime = shunt["lifetime"].to<JsonObject>();
+        lifetime["ah_in"] = shuntStruct.mesh.lifetimeAhIn;
+        lifetime["ah_out"] = shuntStruct.mesh.lifetimeAhOut;
+        lifetime["wh_in"] = shuntStruct.mesh.lifetimeWhIn;
+        lifetime["wh_out"] = shuntStruct.mesh.lifetimeWhOut;
+
+        // Cycling and health; capacity/SOH only once measured
+        JsonObject health = shunt["health"].to<JsonObject>();
+        health["cycles"] = shuntStruct.equivalentCycles;
+        if (shuntStruct.usableCapacityAh > 0.0f) {
+            health["capacity_ah"] = shuntStruct.usableCapacityAh;
+            health["soh"] = shuntStruct.stateOfHealth;
+        }
+        if (shuntStruct.internalResistanceMilliOhm > 0.0f) {
+            health["r_int_mohm"] = shuntStruct.internalResistanceMilliOhm;
+        }
         
         // Device name
         if (strlen(shuntStruct.mesh.name) > 0) {
@@ -236,21 +289,15 @@ public:
 
     void setBroker(String broker) {
         _broker = broker;
-        Preferences p;
-        p.begin("config", false);
-        p.putString("mqtt_broker", broker);
-        p.end();
+        settings.putString("config", "mqtt_broker", broker);
         Serial.printf("[MQTT] Broker updated to: %s\n", broker.c_str());
     }
 
     void setAuth(String user, String pass) {
         _user = user;
         _pass = pass;
-        Preferences p;
-        p.begin("config", false);
-        p.putString("mqtt_user", user);
-        p.putString("mqtt_pass", pass);
-        p.end();
+        settings.putString("config", "mqtt_user", user);
+        settings.putString("config", "mqtt_pass", pass);
         Serial.println("[MQTT] Auth updated.");
     }
 
@@ -333,11 +380,8 @@ private:
             }
             
             // Load WiFi Credentials from NVS
-            Preferences p;
-            p.begin("ota", true);
-            String ssid = p.getString("w_ssid", "");
-            String pass = p.getString("w_pass", "");
-            p.end();
+            String ssid = settings.getString("ota", "w_ssid", "");
+            String pass = settings.getString("ota", "w_pass", "");
             
             if (ssid.length() == 0) {
                  Serial.println("[MQTT] ERROR: No WiFi credentials saved to relay to child");
@@ -401,6 +445,7 @@ private:
 
     ESPNowHandler& _espNow;
     INA226_ADC& _ina;
+    SamplingTask& _sampling;
     OtaHandler* _ota = nullptr;
     WiFiClient espClient;
     PubSubClient client;
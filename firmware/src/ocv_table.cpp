@@ -0,0 +1,96 @@
+#include "ocv_table.h"
+#include <math.h>
+
+namespace ocv {
+
+namespace {
+
+// Index i of the cell [i, i + 1] containing x, and the fraction across it.
+// x is clamped to the axis, so the fraction is always within [0, 1].
+void locate(const float *axis, size_t n, float x, size_t &i, float &frac) {
+    if (x <= axis[0]) {
+        i = 0;
+        frac = 0.0f;
+        return;
+    }
+    if (x >= axis[n - 1]) {
+        i = n - 2;
+        frac = 1.0f;
+        return;
+    }
+    // First breakpoint above x; the cell starts one before it
+    size_t lo = 1, hi = n - 1;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if (x < axis[mid]) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    i = hi - 1;
+    frac = (x - axis[i]) / (axis[hi] - axis[i]);
+}
+
+} // end anonymous namespace
+
+float socPercent(float voltage_V, float temperature_C) {
+    size_t v;
+    float fv;
+    if constexpr (!TEMPERATURE_DEPENDENT) {
+        locate(kVoltages_V, VOLTAGE_POINTS, voltage_V, v, fv);
+        return kSoc_percent[v] + (kSoc_percent[v + 1] - kSoc_percent[v]) * fv;
+    }
+
+    if (isnan(temperature_C)) {
+        temperature_C = REFERENCE_TEMP_C;
+    }
+
+    size_t t;
+    float ft;
+    locate(kVoltages_V, VOLTAGE_POINTS, voltage_V, v, fv);
+    locate(kTemperatures_C, TEMPERATURE_POINTS, temperature_C, t, ft);
+
+    const float *row0 = &kSoc_percent[t * VOLTAGE_POINTS + v];
+    const float *row1 = row0 + VOLTAGE_POINTS;
+    const float s0 = row0[0] + (row0[1] - row0[0]) * fv;
+    const float s1 = row1[0] + (row1[1] - row1[0]) * fv;
+    return s0 + (s1 - s0) * ft;
+}
+
+void socRow(float temperature_C, float out_percent[VOLTAGE_POINTS]) {
+    if constexpr (!TEMPERATURE_DEPENDENT) {
+        for (size_t v = 0; v < VOLTAGE_POINTS; v++) {
+            out_percent[v] = kSoc_percent[v];
+        }
+        return;
+    }
+
+    if (isnan(temperature_C)) {
+        temperature_C = REFERENCE_TEMP_C;
+    }
+
+    size_t t;
+    float ft;
+    locate(kTemperatures_C, TEMPERATURE_POINTS, temperature_C, t, ft);
+
+    const float *row0 = &kSoc_percent[t * VOLTAGE_POINTS];
+    const float *row1 = row0 + VOLTAGE_POINTS;
+    for (size_t v = 0; v < VOLTAGE_POINTS; v++) {
+        out_percent[v] = row0[v] + (row1[v] - row0[v]) * ft;
+    }
+}
+
+float restVoltage(const float row_percent[VOLTAGE_POINTS], float soc_percent,
+                  float &slope_V_per_percent) {
+    size_t i;
+    float frac;
+    locate(row_percent, VOLTAGE_POINTS, soc_percent, i, frac);
+
+    const float dSoc = row_percent[i + 1] - row_percent[i];
+    const float dV = kVoltages_V[i + 1] - kVoltages_V[i];
+    slope_V_per_percent = dSoc > 0.0f ? dV / dSoc : 0.0f;
+    return kVoltages_V[i] + dV * frac;
+}
+
+} // namespace ocv
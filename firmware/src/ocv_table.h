@@ -0,0 +1,69 @@
+#ifndef OCV_TABLE_H
+#define OCV_TABLE_H
+
+#include <stddef.h>
+
+// Rested open-circuit voltage -> state of charge for the 12.8 V LiFePO4 pack,
+// as a voltage x temperature surface.
+//
+// The table is a flat constexpr array in flash (no allocation at boot) and is
+// read with bilinear interpolation: a binary search on each axis and four
+// loads. Inputs outside the table clamp to its edges; a NaN temperature is
+// treated as the 25 C reference. While all rows are equal
+// (TEMPERATURE_DEPENDENT false) it is read as a 1-D voltage curve.
+namespace ocv {
+
+constexpr size_t VOLTAGE_POINTS = 15;
+constexpr size_t TEMPERATURE_POINTS = 6;
+constexpr float REFERENCE_TEMP_C = 25.0f;
+
+// Ascending breakpoints: pack volts and degrees C
+constexpr float kVoltages_V[VOLTAGE_POINTS] = {
+    10.00f, 12.00f, 12.50f, 12.80f, 12.90f, 13.00f, 13.10f, 13.13f,
+    13.17f, 13.20f, 13.25f, 13.30f, 13.87f, 14.45f, 14.60f};
+
+constexpr float kTemperatures_C[TEMPERATURE_POINTS] = {-20.0f, -10.0f, 0.0f,
+                                                       10.0f,  25.0f,  45.0f};
+
+// SOC in percent, one row per temperature: [t * VOLTAGE_POINTS + v].
+// Only the 25 C curve has been measured on this pack. Until bench data for
+// the other temperatures exists every row repeats it, so the surface is flat
+// along the temperature axis and a temperature reading never moves the SOC.
+// Replace a row only with a rested-voltage measurement at that temperature.
+constexpr float kSoc_percent[TEMPERATURE_POINTS * VOLTAGE_POINTS] = {
+    /* -20 C */ 0.0f,  9.0f, 14.0f, 17.0f, 20.0f, 30.0f, 40.0f, 50.0f, 60.0f, 70.0f, 80.0f, 90.0f, 95.0f, 99.0f, 100.0f,
+    /* -10 C */ 0.0f,  9.0f, 14.0f, 17.0f, 20.0f, 30.0f, 40.0f, 50.0f, 60.0f, 70.0f, 80.0f, 90.0f, 95.0f, 99.0f, 100.0f,
+    /*   0 C */ 0.0f,  9.0f, 14.0f, 17.0f, 20.0f, 30.0f, 40.0f, 50.0f, 60.0f, 70.0f, 80.0f, 90.0f, 95.0f, 99.0f, 100.0f,
+    /*  10 C */ 0.0f,  9.0f, 14.0f, 17.0f, 20.0f, 30.0f, 40.0f, 50.0f, 60.0f, 70.0f, 80.0f, 90.0f, 95.0f, 99.0f, 100.0f,
+    /*  25 C */ 0.0f,  9.0f, 14.0f, 17.0f, 20.0f, 30.0f, 40.0f, 50.0f, 60.0f, 70.0f, 80.0f, 90.0f, 95.0f, 99.0f, 100.0f,
+    /*  45 C */ 0.0f,  9.0f, 14.0f, 17.0f, 20.0f, 30.0f, 40.0f, 50.0f, 60.0f, 70.0f, 80.0f, 90.0f, 95.0f, 99.0f, 100.0f,
+};
+
+constexpr bool rowsDiffer() {
+    for (size_t i = VOLTAGE_POINTS; i < TEMPERATURE_POINTS * VOLTAGE_POINTS; i++) {
+        if (kSoc_percent[i] != kSoc_percent[i % VOLTAGE_POINTS]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// False while every row is the same curve. The lookups then skip the
+// temperature axis, and callers can compile out temperature corrections.
+constexpr bool TEMPERATURE_DEPENDENT = rowsDiffer();
+
+float socPercent(float voltage_V, float temperature_C = REFERENCE_TEMP_C);
+
+// SOC at each voltage breakpoint for one temperature: the row of the surface
+// that restVoltage() inverts. NaN temperature is the reference.
+void socRow(float temperature_C, float out_percent[VOLTAGE_POINTS]);
+
+// Inverse of a row: rested voltage at soc_percent and the slope dV/dSOC in
+// V per %. SOC outside the row clamps to its ends; the slope is then that of
+// the end segment.
+float restVoltage(const float row_percent[VOLTAGE_POINTS], float soc_percent,
+                  float &slope_V_per_percent);
+
+} // namespace ocv
+
+#endif // OCV_TABLE_H
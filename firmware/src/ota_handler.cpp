@@ -5,6 +5,7 @@
 #include <ota-github-cacerts.h>
 #include <OTA-Hub.hpp>
 #include <ArduinoJson.h>
+#include "settings_store.h"
 
 OtaHandler::OtaHandler(BLEHandler& bleHandler, ESPNowHandler& espNowHandler, WiFiClientSecure& wifi_client)
     : bleHandler(bleHandler), espNowHandler(espNowHandler), wifi_client(wifi_client) {}
@@ -14,11 +15,8 @@ void OtaHandler::begin() {
     OTA::init(wifi_client);
     
     // Load WiFi Config
-    Preferences p;
-    p.begin("ota", true); 
-    wifi_ssid = p.getString("w_ssid", "");
-    wifi_pass = p.getString("w_pass", "");
-    p.end();
+    wifi_ssid = settings.getString("ota", "w_ssid", "");
+    wifi_pass = settings.getString("ota", "w_pass", "");
 
     Serial.printf("[OTA_HANDLER] Initialized. Loaded WiFi SSID: '%s'\n", wifi_ssid.c_str());
 }
@@ -55,10 +53,7 @@ void OtaHandler::setWifiSsid(const String& ssid) {
     wifi_ssid = trimmed_ssid;
     Serial.printf("[OTA_HANDLER] WiFi SSID set to: '%s'\n", wifi_ssid.c_str());
 
-    Preferences p;
-    p.begin("ota", false);
-    p.putString("w_ssid", wifi_ssid);
-    p.end();
+    settings.putString("ota", "w_ssid", wifi_ssid);
 
     // Reset OTA state to allow for a new check
     if (ota_state != OTA_IDLE) {
@@ -76,10 +71,7 @@ void OtaHandler::setWifiPass(const String& pass) {
     wifi_pass = pass;
     Serial.println("[OTA_HANDLER] WiFi password has been set.");
 
-    Preferences p;
-    p.begin("ota", false);
-    p.putString("w_pass", wifi_pass);
-    p.end();
+    settings.putString("ota", "w_pass", wifi_pass);
 
     // Reset OTA state to allow for a new check
     if (ota_state != OTA_IDLE) {
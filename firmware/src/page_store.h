@@ -0,0 +1,22 @@
+#ifndef PAGE_STORE_H
+#define PAGE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Raw flash divided into fixed-size erase pages, with NOR semantics:
+// erase() sets a whole page to 0xFF and write() can only clear bits, so
+// each byte is written once between erases.
+class PageStore {
+public:
+    virtual ~PageStore() {}
+
+    virtual size_t pageSize() const = 0;
+    virtual size_t pageCount() const = 0;
+
+    virtual bool read(size_t page, size_t offset, void* out, size_t length) const = 0;
+    virtual bool write(size_t page, size_t offset, const void* data, size_t length) = 0;
+    virtual bool erase(size_t page) = 0;
+};
+
+#endif // PAGE_STORE_H
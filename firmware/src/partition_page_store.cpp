@@ -0,0 +1,45 @@
+#include "partition_page_store.h"
+#include <Arduino.h>
+
+PartitionPageStore::PartitionPageStore() : partition(nullptr) {}
+
+bool PartitionPageStore::begin(const char* label, const char* fallbackLabel) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == nullptr && fallbackLabel != nullptr) {
+        partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                             ESP_PARTITION_SUBTYPE_ANY, fallbackLabel);
+    }
+    if (partition == nullptr) {
+        Serial.printf("[FLASHLOG] No '%s' partition.\n", label);
+        return false;
+    }
+    Serial.printf("[FLASHLOG] Using partition '%s' (%u KB).\n", partition->label,
+                  (unsigned)(partition->size / 1024));
+    return true;
+}
+
+size_t PartitionPageStore::pageCount() const {
+    return partition ? partition->size / PAGE_SIZE : 0;
+}
+
+bool PartitionPageStore::read(size_t page, size_t offset, void* out, size_t length) const {
+    if (partition == nullptr || page >= pageCount() || offset + length > PAGE_SIZE) {
+        return false;
+    }
+    return esp_partition_read(partition, page * PAGE_SIZE + offset, out, length) == ESP_OK;
+}
+
+bool PartitionPageStore::write(size_t page, size_t offset, const void* data, size_t length) {
+    if (partition == nullptr || page >= pageCount() || offset + length > PAGE_SIZE) {
+        return false;
+    }
+    return esp_partition_write(partition, page * PAGE_SIZE + offset, data, length) == ESP_OK;
+}
+
+bool PartitionPageStore::erase(size_t page) {
+    if (partition == nullptr || page >= pageCount()) {
+        return false;
+    }
+    return esp_partition_erase_range(partition, page * PAGE_SIZE, PAGE_SIZE) == ESP_OK;
+}
@@ -0,0 +1,28 @@
+#ifndef PARTITION_PAGE_STORE_H
+#define PARTITION_PAGE_STORE_H
+
+#include "page_store.h"
+#include "esp_partition.h"
+
+// PageStore over a data partition, one 4 KB flash sector per page.
+class PartitionPageStore : public PageStore {
+public:
+    static constexpr size_t PAGE_SIZE = 4096;
+
+    PartitionPageStore();
+    // Use the partition labelled `label`, or `fallbackLabel` on devices whose
+    // partition table predates it. Returns false if neither exists.
+    bool begin(const char* label, const char* fallbackLabel = nullptr);
+
+    size_t pageSize() const override { return PAGE_SIZE; }
+    size_t pageCount() const override;
+
+    bool read(size_t page, size_t offset, void* out, size_t length) const override;
+    bool write(size_t page, size_t offset, const void* data, size_t length) override;
+    bool erase(size_t page) override;
+
+private:
+    const esp_partition_t* partition;
+};
+
+#endif // PARTITION_PAGE_STORE_H
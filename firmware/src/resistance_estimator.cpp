@@ -0,0 +1,115 @@
+#include "resistance_estimator.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+// Median of a handful of values; sorts them in place
+float medianOf(float* v, uint8_t n) {
+    for (uint8_t i = 1; i < n; i++) {
+        const float x = v[i];
+        uint8_t j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+    return (n & 1) ? v[n / 2] : 0.5f * (v[n / 2 - 1] + v[n / 2]);
+}
+} // end anonymous namespace
+
+ResistanceEstimator::ResistanceEstimator() : ResistanceEstimator(Config()) {}
+
+ResistanceEstimator::ResistanceEstimator(const Config& config) : cfg(config) {
+    reset();
+}
+
+void ResistanceEstimator::reset() {
+    memset(history, 0, sizeof(history));
+    historyCount = 0;
+    primed = false;
+    estimate = 0.0f;
+    spread = 0.0f;
+    warmupCount = 0;
+    consecutiveRejects = 0;
+    lastMeasurement = NAN;
+    accepted = 0;
+    rejected = 0;
+}
+
+float ResistanceEstimator::getEstimate_Ohm() const {
+    return primed ? estimate : NAN;
+}
+
+bool ResistanceEstimator::update(float currentA, float voltage_V, int64_t timestamp_us) {
+    if (isnan(currentA) || isnan(voltage_V) || voltage_V < cfg.minVoltage_V) {
+        historyCount = 0;
+        return false;
+    }
+
+    // Samples s[-1], s0 (settled before), s1 (may be mixed), s2 (this one)
+    bool measured = false;
+    if (historyCount == 3) {
+        const Sample& prior = history[0];
+        const Sample& before = history[1];
+        const Sample& mixed = history[2];
+        const float step = currentA - before.currentA;
+        if (fabsf(step) >= cfg.minStepA &&
+            fabsf(before.currentA - prior.currentA) <= cfg.quietA &&
+            fabsf(currentA - mixed.currentA) <= cfg.quietA &&
+            timestamp_us - before.timestamp_us <= (int64_t)cfg.maxSpanUs) {
+            const float ohm = (voltage_V - before.voltage_V) / step;
+            lastMeasurement = ohm;
+            addMeasurement(ohm);
+            measured = true;
+        }
+    }
+
+    if (historyCount == 3) {
+        history[0] = history[1];
+        history[1] = history[2];
+        historyCount = 2;
+    }
+    history[historyCount++] = {currentA, voltage_V, timestamp_us};
+    return measured;
+}
+
+void ResistanceEstimator::addMeasurement(float ohm) {
+    if (!(ohm >= cfg.minOhm && ohm <= cfg.maxOhm)) {
+        rejected++;
+        return;
+    }
+
+    if (!primed) {
+        warmup[warmupCount++] = ohm;
+        accepted++;
+        if (warmupCount == WARMUP_STEPS) {
+            estimate = medianOf(warmup, warmupCount);
+            float dev[WARMUP_STEPS];
+            for (uint8_t i = 0; i < warmupCount; i++) {
+                dev[i] = fabsf(warmup[i] - estimate);
+            }
+            spread = medianOf(dev, warmupCount);
+            warmupCount = 0;
+            consecutiveRejects = 0;
+            primed = true;
+        }
+        return;
+    }
+
+    const float error = ohm - estimate;
+    const float spreadFloor = estimate * cfg.minSpreadFraction;
+    if (fabsf(error) > REJECT_K * (spread > spreadFloor ? spread : spreadFloor)) {
+        rejected++;
+        if (++consecutiveRejects >= MAX_CONSECUTIVE_REJECTS) {
+            // Consistently somewhere else: learn the battery again
+            primed = false;
+            warmupCount = 0;
+        }
+        return;
+    }
+    consecutiveRejects = 0;
+    accepted++;
+    estimate += cfg.gain * error;
+    spread += cfg.gain * (fabsf(error) - spread);
+}
@@ -0,0 +1,74 @@
+#ifndef RESISTANCE_ESTIMATOR_H
+#define RESISTANCE_ESTIMATOR_H
+
+#include <stdint.h>
+
+// Battery internal resistance from sharp load steps, O(1) per sample. Pure
+// logic so it can be tested natively.
+//
+// A step is a current change of at least minStepA between a settled sample
+// before it and a settled sample after it, less than maxSpanUs apart. One
+// sample in between may be mixed (the INA226 converts shunt and bus voltage
+// one after the other), so the two settled samples are compared:
+// R = (V_after - V_before) / (I_after - I_before), with I positive charging.
+//
+// The estimate is robust: the first WARMUP_STEPS plausible measurements are
+// combined by their median, after that each one moves the estimate by gain
+// unless it is more than REJECT_K times the running spread away. A run of
+// MAX_CONSECUTIVE_REJECTS outliers means the battery really changed (swap,
+// temperature) and warm-up starts over.
+class ResistanceEstimator {
+public:
+    static constexpr uint8_t WARMUP_STEPS = 5;
+    static constexpr float REJECT_K = 3.0f;
+    static constexpr uint8_t MAX_CONSECUTIVE_REJECTS = 5;
+
+    struct Config {
+        float minStepA = 5.0f;
+        float quietA = 0.5f;        // max change between samples to count as settled
+        uint32_t maxSpanUs = 1500000;
+        float minVoltage_V = 5.25f; // below: no battery (USB powered)
+        float minOhm = 0.0005f;     // plausible range
+        float maxOhm = 0.5f;
+        float gain = 0.1f;
+        float minSpreadFraction = 0.05f; // spread floor, fraction of the estimate
+    };
+
+    ResistanceEstimator();
+    explicit ResistanceEstimator(const Config& config);
+
+    // Feed one sample. Returns true when a step was measured (accepted or not).
+    bool update(float currentA, float voltage_V, int64_t timestamp_us);
+
+    bool isPrimed() const { return primed; }
+    float getEstimate_Ohm() const; // NaN until primed
+    float getLastMeasurement_Ohm() const { return lastMeasurement; }
+    uint32_t getAcceptedSteps() const { return accepted; }
+    uint32_t getRejectedSteps() const { return rejected; }
+    void reset();
+
+private:
+    struct Sample {
+        float currentA;
+        float voltage_V;
+        int64_t timestamp_us;
+    };
+
+    void addMeasurement(float ohm);
+
+    Config cfg;
+    Sample history[3]; // oldest first
+    uint8_t historyCount;
+
+    bool primed;
+    float estimate;
+    float spread;       // running mean absolute deviation
+    float warmup[WARMUP_STEPS];
+    uint8_t warmupCount;
+    uint8_t consecutiveRejects;
+    float lastMeasurement;
+    uint32_t accepted;
+    uint32_t rejected;
+};
+
+#endif // RESISTANCE_ESTIMATOR_H
@@ -0,0 +1,70 @@
+#include "run_flat_estimator.h"
+
+RunFlatEstimator::RunFlatEstimator() : RunFlatEstimator(Config()) {}
+
+RunFlatEstimator::RunFlatEstimator(const Config& config) : cfg(config) {
+    reset();
+}
+
+void RunFlatEstimator::reset() {
+    primed = false;
+    lastTimestamp_us = 0;
+    detector = 0.0f;
+    average = 0.0f;
+    averageAge_s = 0.0f;
+    regime = REGIME_UNKNOWN;
+    regimeChanges = 0;
+}
+
+float RunFlatEstimator::tauFor(Regime r) const {
+    return r == REGIME_CHARGING ? cfg.chargeTauS : cfg.dischargeTauS;
+}
+
+bool RunFlatEstimator::update(float currentA, int64_t timestamp_us) {
+    if (!primed) {
+        primed = true;
+        lastTimestamp_us = timestamp_us;
+        detector = currentA;
+        average = currentA;
+        averageAge_s = 0.0f;
+        regime = currentA > cfg.chargeThresholdA ? REGIME_CHARGING : REGIME_DISCHARGING;
+        return false;
+    }
+
+    const int64_t dt_us = timestamp_us - lastTimestamp_us;
+    if (dt_us <= 0) {
+        return false;
+    }
+    lastTimestamp_us = timestamp_us;
+    const float dtS = dt_us / 1e6f;
+
+    // dt / (tau + dt) is the backward-Euler form of 1 - exp(-dt / tau): no
+    // expf() per sample, and a gap much longer than tau simply restarts.
+    detector += (currentA - detector) * (dtS / (cfg.detectTauS + dtS));
+
+    Regime next = regime;
+    if (detector > cfg.chargeThresholdA) {
+        next = REGIME_CHARGING;
+    } else if (detector <= cfg.dischargeThresholdA) {
+        next = REGIME_DISCHARGING;
+    }
+    if (next != regime) {
+        regime = next;
+        regimeChanges++;
+        average = currentA;
+        averageAge_s = 0.0f;
+        return true;
+    }
+
+    // Time-weighted mean while younger than tau, EWMA afterwards
+    const float tau = tauFor(regime);
+    float alpha;
+    if (averageAge_s < tau) {
+        averageAge_s += dtS;
+        alpha = dtS / averageAge_s;
+    } else {
+        alpha = dtS / (tau + dtS);
+    }
+    average += (currentA - average) * alpha;
+    return false;
+}
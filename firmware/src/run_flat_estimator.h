@@ -0,0 +1,57 @@
+#ifndef RUN_FLAT_ESTIMATOR_H
+#define RUN_FLAT_ESTIMATOR_H
+
+#include <stdint.h>
+
+// Average battery current for the time-to-flat / time-to-full estimate, in
+// constant memory and constant time per sample. Pure logic so it can be
+// tested natively.
+//
+// - A short EWMA of the current decides the regime, with hysteresis:
+//   charging above chargeThresholdA, discharging at or below
+//   dischargeThresholdA. Idle counts as discharging so fridge cycling
+//   (load -> idle -> load) is averaged as one regime.
+// - The estimate is an EWMA with the time constant of the current regime:
+//   short while charging so the time to full follows the charger, long
+//   while discharging so intermittent loads are smoothed out.
+// - A regime change restarts the estimate so the two regimes are never
+//   mixed. Until the estimate is one time constant old it is the plain
+//   time-weighted mean of what it has seen, so it settles quickly.
+class RunFlatEstimator {
+public:
+    enum Regime : uint8_t { REGIME_UNKNOWN = 0, REGIME_CHARGING, REGIME_DISCHARGING };
+
+    struct Config {
+        float detectTauS = 10.0f;
+        float chargeTauS = 60.0f;
+        float dischargeTauS = 1800.0f;
+        float chargeThresholdA = 0.1f;
+        float dischargeThresholdA = 0.05f;
+    };
+
+    RunFlatEstimator();
+    explicit RunFlatEstimator(const Config& config);
+
+    // Feed one sample. Returns true when the regime changed.
+    bool update(float currentA, int64_t timestamp_us);
+
+    bool isPrimed() const { return primed; }
+    float getAverage_A() const { return average; }
+    Regime getRegime() const { return regime; }
+    uint32_t getRegimeChanges() const { return regimeChanges; }
+    void reset();
+
+private:
+    float tauFor(Regime r) const;
+
+    Config cfg;
+    bool primed;
+    int64_t lastTimestamp_us;
+    float detector;   // short EWMA, regime detection only
+    float average;    // estimate for the current regime
+    float averageAge_s;
+    Regime regime;
+    uint32_t regimeChanges;
+};
+
+#endif // RUN_FLAT_ESTIMATOR_H
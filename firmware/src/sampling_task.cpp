@@ -0,0 +1,115 @@
+#include "sampling_task.h"
+#include "esp_timer.h"
+
+SamplingTask::SamplingTask(INA226_ADC& ina)
+    : ina(ina), taskHandle(nullptr), mutex(nullptr) {}
+
+bool SamplingTask::begin() {
+    mutex = xSemaphoreCreateRecursiveMutex();
+    if (mutex == nullptr) {
+        Serial.println("[SAMPLING] Failed to create mutex.");
+        return false;
+    }
+    BaseType_t ok = xTaskCreate(taskEntry, "sampling", STACK_SIZE, this,
+                                PRIORITY, &taskHandle);
+    if (ok != pdPASS) {
+        Serial.println("[SAMPLING] Failed to create task.");
+        taskHandle = nullptr;
+        return false;
+    }
+    Serial.printf("[SAMPLING] Task started (prio %u, ring %u samples).\n",
+                  (unsigned)PRIORITY, (unsigned)RING_SIZE);
+    return true;
+}
+
+void IRAM_ATTR SamplingTask::notifyFromISR() {
+    if (taskHandle == nullptr) {
+        return;
+    }
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(taskHandle, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+uint32_t SamplingTask::getStackHeadroom() const {
+    return taskHandle ? uxTaskGetStackHighWaterMark(taskHandle) : 0;
+}
+
+bool SamplingTask::popSample(SensorSample& out) {
+    return ring.pop(out);
+}
+
+void SamplingTask::lock() {
+    if (mutex) {
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    }
+}
+
+void SamplingTask::unlock() {
+    if (mutex) {
+        xSemaphoreGiveRecursive(mutex);
+    }
+}
+
+void SamplingTask::taskEntry(void* arg) {
+    static_cast<SamplingTask*>(arg)->run();
+}
+
+void SamplingTask::run() {
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        if (ina.isConversionReadyMode()) {
+            // Woken by the ALERT pin; the timeout lets pollConversionReady()
+            // recover a lost edge.
+            uint32_t timeoutMs = ina.getConversionPeriod_us() / 1000 + 1;
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+            // Keep the polling schedule current, so switching CNVR off does
+            // not replay every 100 ms slot missed since boot
+            lastWake = xTaskGetTickCount();
+            lock();
+            bool ready = ina.pollConversionReady();
+            unlock();
+            if (!ready) {
+                continue;
+            }
+        } else {
+            vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(POLL_INTERVAL_MS));
+        }
+        sampleOnce();
+    }
+}
+
+void SamplingTask::sampleOnce() {
+    SensorSample sample;
+
+    lock();
+    ina.readSensors();
+    sample.timestamp_us = esp_timer_get_time();
+    sample.busVoltage_V = ina.getBusVoltage_V();
+    sample.current_mA = ina.getCurrent_mA();
+    sample.filteredCurrent_mA = ina.getFilteredCurrent_mA();
+    sample.power_mW = ina.getPower_mW();
+    // Record before protection runs: it clears the alert and may drop the load
+    if (ina.isAlertTriggered()) {
+        capture.trigger(TransientCapture::TRIGGER_ALERT);
+    }
+    capture.record(sample);
+    // A hardware trip already opened the switch; book it here rather than
+    // in loop(), which can block for seconds during an uplink
+    ina.processAlert();
+    ina.checkAndHandleProtection();
+    if (ina.isConfigured()) {
+        ina.updateBatteryCapacity(sample.current_mA / 1000.0f,
+                                  sample.timestamp_us);
+        ina.updateEnergyUsage(sample.power_mW, sample.timestamp_us);
+    }
+    const float maxCapacity_Ah = ina.getMaxBatteryCapacity();
+    history.record(sample, maxCapacity_Ah > 0.0f
+                               ? ina.getBatteryCapacity() / maxCapacity_Ah * 100.0f
+                               : NAN);
+    unlock();
+
+    ring.push(sample);
+}
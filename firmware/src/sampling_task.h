@@ -0,0 +1,72 @@
+#ifndef SAMPLING_TASK_H
+#define SAMPLING_TASK_H
+
+#include <Arduino.h>
+#include "ina226_adc.h"
+#include "SpscRing.h"
+#include "history_store.h"
+#include "sensor_sample.h"
+#include "transient_capture.h"
+
+// Runs readSensors(), protection, coulomb counting and energy accounting in a
+// dedicated high-priority FreeRTOS task so radio work in loop() cannot stall
+// them. Samples are handed to loop() through a lock-free SPSC ring.
+class SamplingTask {
+public:
+    // Bytes. readSensors() prints with floats and runs the SOC filter and
+    // stats on this stack; check the headroom with getStackHeadroom().
+    static constexpr uint32_t STACK_SIZE = 6144;
+    static constexpr UBaseType_t PRIORITY = configMAX_PRIORITIES - 2;
+    static constexpr uint32_t POLL_INTERVAL_MS = 100; // when CNVR mode is off
+    static constexpr size_t RING_SIZE = 256;
+
+    explicit SamplingTask(INA226_ADC& ina);
+    bool begin();
+
+    // Called from the ALERT pin ISR.
+    void notifyFromISR();
+
+    // Consumer side (loop() only).
+    bool popSample(SensorSample& out);
+    uint32_t getDroppedSamples() const { return ring.getDropped(); }
+    // Least free stack seen so far, in bytes (0 before begin()).
+    uint32_t getStackHeadroom() const;
+
+    // Overcurrent/inrush waveform capture. A frozen capture may be read
+    // without the lock; trigger/rearm/threshold changes need it.
+    TransientCapture& getCapture() { return capture; }
+
+    // V/I/P/SOC history, updated on every sample. Read it under the lock.
+    HistoryStore& getHistory() { return history; }
+
+    // Serialises access to the INA226 and its state between the task and
+    // configuration paths in other tasks (BLE callbacks, Serial commands).
+    void lock();
+    void unlock();
+
+private:
+    static void taskEntry(void* arg);
+    void run();
+    void sampleOnce();
+
+    INA226_ADC& ina;
+    TaskHandle_t taskHandle;
+    SemaphoreHandle_t mutex;
+    SpscRing<SensorSample, RING_SIZE> ring;
+    TransientCapture capture;
+    HistoryStore history;
+};
+
+// Scoped SamplingTask::lock()/unlock().
+class SamplingLock {
+public:
+    explicit SamplingLock(SamplingTask& task) : task(task) { task.lock(); }
+    ~SamplingLock() { task.unlock(); }
+    SamplingLock(const SamplingLock&) = delete;
+    SamplingLock& operator=(const SamplingLock&) = delete;
+
+private:
+    SamplingTask& task;
+};
+
+#endif // SAMPLING_TASK_H
@@ -0,0 +1,15 @@
+#ifndef SENSOR_SAMPLE_H
+#define SENSOR_SAMPLE_H
+
+#include <stdint.h>
+
+// One INA226 reading as published to the telemetry side.
+struct SensorSample {
+    int64_t timestamp_us;  // esp_timer time the registers were read
+    float busVoltage_V;
+    float current_mA;      // calibrated, positive = charge
+    float filteredCurrent_mA; // decimated/FIR-filtered current, for display
+    float power_mW;
+};
+
+#endif // SENSOR_SAMPLE_H
@@ -0,0 +1,318 @@
+#include "settings_store.h"
+#include <Preferences.h>
+#include <algorithm>
+#include <string.h>
+
+SettingsStore settings;
+
+namespace {
+uint32_t floatBits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+float bitsFloat(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+} // end anonymous namespace
+
+SettingsStore::SettingsStore(uint32_t debounce_ms)
+    : debounce_ms(debounce_ms), pending(0), firstChange_ms(0), lastChange_ms(0),
+      puts(0), nvsWrites(0), writeFailures(0) {}
+
+SettingsStore::Entry* SettingsStore::find(const char* ns, const char* key) {
+    for (Entry& e : entries) {
+        if (strcmp(e.key, key) == 0 && strcmp(e.ns, ns) == 0) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+SettingsStore::Entry& SettingsStore::add(const char* ns, const char* key, Type type) {
+    entries.emplace_back();
+    Entry& e = entries.back();
+    strncpy(e.ns, ns, NAME_LEN - 1);
+    e.ns[NAME_LEN - 1] = '\0';
+    strncpy(e.key, key, NAME_LEN - 1);
+    e.key[NAME_LEN - 1] = '\0';
+    e.type = type;
+    e.present = false;
+    e.storedPresent = false;
+    e.value = 0;
+    e.stored = 0;
+    e.dirty = false;
+    return e;
+}
+
+SettingsStore::Entry& SettingsStore::lookup(const char* ns, const char* key, Type type) {
+    Entry* cached = find(ns, key);
+    if (cached != nullptr) {
+        return *cached;
+    }
+
+    // First use of this key: read it through once
+    Entry& e = add(ns, key, type);
+    Preferences prefs;
+    if (prefs.begin(ns, true)) {
+        if (prefs.isKey(key)) {
+            e.present = true;
+            switch (type) {
+                case TYPE_FLOAT:  e.value = floatBits(prefs.getFloat(key, 0.0f)); break;
+                case TYPE_USHORT: e.value = prefs.getUShort(key, 0); break;
+                case TYPE_UINT:   e.value = prefs.getUInt(key, 0); break;
+                case TYPE_BOOL:   e.value = prefs.getBool(key, false) ? 1 : 0; break;
+                case TYPE_STRING: e.str = prefs.getString(key, ""); break;
+            }
+        }
+        prefs.end();
+    }
+    e.storedPresent = e.present;
+    e.stored = e.value;
+    e.storedStr = e.str;
+    return e;
+}
+
+bool SettingsStore::isKey(const char* ns, const char* key) {
+    std::lock_guard<std::mutex> guard(mutex);
+    const Entry* cached = find(ns, key);
+    if (cached != nullptr) {
+        return cached->present;
+    }
+    // Not cached yet and the type is unknown, so ask NVS without caching
+    Preferences prefs;
+    bool found = false;
+    if (prefs.begin(ns, true)) {
+        found = prefs.isKey(key);
+        prefs.end();
+    }
+    return found;
+}
+
+uint32_t SettingsStore::getScalar(const char* ns, const char* key, Type type,
+                                  uint32_t defaultValue) {
+    std::lock_guard<std::mutex> guard(mutex);
+    const Entry& e = lookup(ns, key, type);
+    return (e.present && e.type == type) ? e.value : defaultValue;
+}
+
+float SettingsStore::getFloat(const char* ns, const char* key, float defaultValue) {
+    return bitsFloat(getScalar(ns, key, TYPE_FLOAT, floatBits(defaultValue)));
+}
+
+uint16_t SettingsStore::getUShort(const char* ns, const char* key, uint16_t defaultValue) {
+    return (uint16_t)getScalar(ns, key, TYPE_USHORT, defaultValue);
+}
+
+uint32_t SettingsStore::getUInt(const char* ns, const char* key, uint32_t defaultValue) {
+    return getScalar(ns, key, TYPE_UINT, defaultValue);
+}
+
+bool SettingsStore::getBool(const char* ns, const char* key, bool defaultValue) {
+    return getScalar(ns, key, TYPE_BOOL, defaultValue ? 1 : 0) != 0;
+}
+
+String SettingsStore::getString(const char* ns, const char* key, const String& defaultValue) {
+    std::lock_guard<std::mutex> guard(mutex);
+    const Entry& e = lookup(ns, key, TYPE_STRING);
+    return (e.present && e.type == TYPE_STRING) ? e.str : defaultValue;
+}
+
+bool SettingsStore::differsFromStored(const Entry& e) {
+    if (e.present != e.storedPresent) {
+        return true;
+    }
+    return e.present &&
+           ((e.type == TYPE_STRING) ? (e.str != e.storedStr) : (e.value != e.stored));
+}
+
+void SettingsStore::markChanged(Entry& e) {
+    const bool differs = differsFromStored(e);
+
+    const uint32_t now = millis();
+    if (differs && !e.dirty) {
+        e.dirty = true;
+        if (pending++ == 0) {
+            firstChange_ms = now;
+        }
+    } else if (!differs && e.dirty) {
+        // Moved back to what NVS already holds
+        e.dirty = false;
+        pending--;
+    }
+    lastChange_ms = now;
+    puts++;
+}
+
+void SettingsStore::putScalar(const char* ns, const char* key, Type type, uint32_t value) {
+    std::lock_guard<std::mutex> guard(mutex);
+    Entry& e = lookup(ns, key, type);
+    e.type = type;
+    e.present = true;
+    e.value = value;
+    markChanged(e);
+}
+
+void SettingsStore::putFloat(const char* ns, const char* key, float value) {
+    putScalar(ns, key, TYPE_FLOAT, floatBits(value));
+}
+
+void SettingsStore::putUShort(const char* ns, const char* key, uint16_t value) {
+    putScalar(ns, key, TYPE_USHORT, value);
+}
+
+void SettingsStore::putUInt(const char* ns, const char* key, uint32_t value) {
+    putScalar(ns, key, TYPE_UINT, value);
+}
+
+void SettingsStore::putBool(const char* ns, const char* key, bool value) {
+    putScalar(ns, key, TYPE_BOOL, value ? 1 : 0);
+}
+
+void SettingsStore::putString(const char* ns, const char* key, const String& value) {
+    std::lock_guard<std::mutex> guard(mutex);
+    Entry& e = lookup(ns, key, TYPE_STRING);
+    e.type = TYPE_STRING;
+    e.present = true;
+    e.str = value;
+    markChanged(e);
+}
+
+void SettingsStore::remove(const char* ns, const char* key) {
+    std::lock_guard<std::mutex> guard(mutex);
+    Entry* e = find(ns, key);
+    if (e == nullptr) {
+        // Not cached: only whether NVS has the key matters, not its type
+        e = &add(ns, key, TYPE_UINT);
+        Preferences prefs;
+        if (prefs.begin(ns, true)) {
+            e->storedPresent = prefs.isKey(key);
+            prefs.end();
+        }
+    }
+    e->present = false;
+    markChanged(*e);
+}
+
+size_t SettingsStore::commitDue(uint32_t now_ms) {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (pending == 0) {
+            return 0;
+        }
+        if (now_ms - lastChange_ms < debounce_ms &&
+            now_ms - firstChange_ms < MAX_DELAY_MS) {
+            return 0;
+        }
+    }
+    return commit();
+}
+
+size_t SettingsStore::flush() {
+    return commit();
+}
+
+size_t SettingsStore::commit() {
+    std::lock_guard<std::mutex> commitGuard(commitMutex);
+
+    // Copy the dirty keys and release the cache before touching flash. They
+    // stay dirty until NVS has accepted them, so a failed write is retried.
+    std::vector<Entry> batch;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (pending == 0) {
+            return 0;
+        }
+        batch.reserve(pending);
+        for (const Entry& e : entries) {
+            if (e.dirty) {
+                batch.push_back(e);
+            }
+        }
+    }
+
+    std::stable_sort(batch.begin(), batch.end(), [](const Entry& a, const Entry& b) {
+        return strcmp(a.ns, b.ns) < 0;
+    });
+
+    std::vector<bool> written(batch.size(), false);
+    Preferences prefs;
+    const char* openNs = nullptr;
+    bool opened = false;
+    for (size_t i = 0; i < batch.size(); i++) {
+        const Entry& e = batch[i];
+        if (openNs == nullptr || strcmp(openNs, e.ns) != 0) {
+            if (opened) {
+                prefs.end();
+            }
+            opened = prefs.begin(e.ns, false);
+            openNs = e.ns;
+        }
+        if (!opened) {
+            continue;
+        }
+        if (!e.present) {
+            // Erasing a key NVS no longer has is not a failure
+            written[i] = prefs.remove(e.key) || !prefs.isKey(e.key);
+            continue;
+        }
+        size_t len = 0;
+        switch (e.type) {
+            case TYPE_FLOAT:  len = prefs.putFloat(e.key, bitsFloat(e.value)); break;
+            case TYPE_USHORT: len = prefs.putUShort(e.key, (uint16_t)e.value); break;
+            case TYPE_UINT:   len = prefs.putUInt(e.key, e.value); break;
+            case TYPE_BOOL:   len = prefs.putBool(e.key, e.value != 0); break;
+            case TYPE_STRING: len = prefs.putString(e.key, e.str); break;
+        }
+        // putString() reports the string length, so "" succeeds with 0
+        written[i] = len > 0 || (e.type == TYPE_STRING && e.str.length() == 0);
+    }
+    if (opened) {
+        prefs.end();
+    }
+
+    std::lock_guard<std::mutex> guard(mutex);
+    size_t count = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+        Entry* e = find(batch[i].ns, batch[i].key);
+        if (!written[i] || e == nullptr) {
+            continue;
+        }
+        count++;
+        e->storedPresent = batch[i].present;
+        e->stored = batch[i].value;
+        e->storedStr = batch[i].str;
+        // A put during the write leaves the key dirty for the next commit
+        if (e->dirty && !differsFromStored(*e)) {
+            e->dirty = false;
+            pending--;
+        }
+    }
+    if (count < batch.size()) {
+        // Back off for a full debounce period before trying again
+        writeFailures += batch.size() - count;
+        firstChange_ms = lastChange_ms = millis();
+    }
+    nvsWrites += count;
+    return count;
+}
+
+void SettingsStore::invalidate() {
+    std::lock_guard<std::mutex> commitGuard(commitMutex);
+    std::lock_guard<std::mutex> guard(mutex);
+    entries.clear();
+    pending = 0;
+}
+
+void SettingsStore::setDebounce_ms(uint32_t debounce) {
+    std::lock_guard<std::mutex> guard(mutex);
+    debounce_ms = debounce;
+}
+
+size_t SettingsStore::getPendingCount() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return pending;
+}
@@ -0,0 +1,101 @@
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <Arduino.h>
+#include <mutex>
+#include <vector>
+
+// In-RAM cache in front of every Preferences namespace used for settings.
+//
+// A key is read from NVS the first time it is asked for and served from RAM
+// afterwards. put*() only updates RAM and marks the key dirty, so BLE/MQTT
+// callbacks never wait on a flash erase. Dirty keys are written together
+// once no setting has changed for the debounce period (or at the latest
+// after MAX_DELAY_MS of continuous changes), grouped so each namespace is
+// opened once. A key that is moved and then moved back before the commit is
+// not written at all.
+//
+// commitDue() is polled from a low-priority task; flush() must be called
+// before anything that loses RAM (OTA, restart, deep sleep).
+class SettingsStore {
+public:
+    static constexpr uint32_t DEFAULT_DEBOUNCE_MS = 2000;
+    static constexpr uint32_t MAX_DELAY_MS = 30000;
+
+    explicit SettingsStore(uint32_t debounce_ms = DEFAULT_DEBOUNCE_MS);
+
+    bool isKey(const char* ns, const char* key);
+
+    float getFloat(const char* ns, const char* key, float defaultValue);
+    uint16_t getUShort(const char* ns, const char* key, uint16_t defaultValue);
+    uint32_t getUInt(const char* ns, const char* key, uint32_t defaultValue);
+    bool getBool(const char* ns, const char* key, bool defaultValue);
+    String getString(const char* ns, const char* key, const String& defaultValue);
+
+    void putFloat(const char* ns, const char* key, float value);
+    void putUShort(const char* ns, const char* key, uint16_t value);
+    void putUInt(const char* ns, const char* key, uint32_t value);
+    void putBool(const char* ns, const char* key, bool value);
+    void putString(const char* ns, const char* key, const String& value);
+    void remove(const char* ns, const char* key);
+
+    // Write the pending keys if the debounce has expired. Returns the number
+    // of keys written (or removed) in NVS. A key NVS refuses stays pending
+    // and is retried one debounce period later.
+    size_t commitDue(uint32_t now_ms);
+    // Write every pending key now.
+    size_t flush();
+    // Forget all cached values and pending writes, e.g. before the NVS
+    // partition is erased. Waits for a commit in progress to finish.
+    void invalidate();
+
+    void setDebounce_ms(uint32_t debounce_ms);
+    uint32_t getDebounce_ms() const { return debounce_ms; }
+    size_t getPendingCount() const;
+    uint32_t getPutCount() const { return puts; }
+    uint32_t getNvsWriteCount() const { return nvsWrites; }
+    uint32_t getWriteFailureCount() const { return writeFailures; }
+
+private:
+    enum Type : uint8_t { TYPE_FLOAT, TYPE_USHORT, TYPE_UINT, TYPE_BOOL, TYPE_STRING };
+
+    // NVS namespace and key names are limited to 15 characters
+    static constexpr size_t NAME_LEN = 16;
+
+    struct Entry {
+        char ns[NAME_LEN];
+        char key[NAME_LEN];
+        Type type;
+        bool present;       // value below is set (false: key absent/removed)
+        bool storedPresent; // what NVS holds
+        uint32_t value;     // scalar types, float as its bit pattern
+        uint32_t stored;
+        String str;
+        String storedStr;
+        bool dirty;
+    };
+
+    Entry* find(const char* ns, const char* key);
+    Entry& add(const char* ns, const char* key, Type type);
+    Entry& lookup(const char* ns, const char* key, Type type);
+    uint32_t getScalar(const char* ns, const char* key, Type type, uint32_t defaultValue);
+    void putScalar(const char* ns, const char* key, Type type, uint32_t value);
+    static bool differsFromStored(const Entry& e);
+    void markChanged(Entry& e);
+    size_t commit();
+
+    uint32_t debounce_ms;
+    std::vector<Entry> entries;
+    size_t pending;
+    uint32_t firstChange_ms;
+    uint32_t lastChange_ms;
+    uint32_t puts;
+    uint32_t nvsWrites;
+    uint32_t writeFailures;
+    mutable std::mutex mutex;     // entries and counters
+    std::mutex commitMutex;       // held for the duration of an NVS commit
+};
+
+extern SettingsStore settings;
+
+#endif // SETTINGS_STORE_H
@@ -18,6 +18,8 @@
 #define NVS_KEY_LOW_VOLTAGE_DELAY "lv_delay"
 #define NVS_KEY_DEVICE_NAME_SUFFIX "name_suffix"
 #define NVS_KEY_COMPENSATION_RESISTANCE "comp_res"
+#define NVS_KEY_COMPENSATION_AUTO "comp_auto"
+#define NVS_KEY_CONVERSION_READY "cnvr"
 #define NVS_KEY_EFUSE_LIMIT "efuse_limit"
 
 #define I2C_ADDRESS 0x40
@@ -95,6 +97,12 @@ typedef struct struct_message_ae_smart_shunt_mesh {
 
   // Hardware Version
   uint8_t hardwareVersion;
+
+  // Lifetime throughput per direction
+  float lifetimeAhIn;
+  float lifetimeAhOut;
+  float lifetimeWhIn;
+  float lifetimeWhOut;
 } __attribute__((packed)) struct_message_ae_smart_shunt_mesh;
 
 // Full Telemetry used by Shunt for MQTT/Cloud (Internal use)
@@ -112,6 +120,13 @@ typedef struct struct_message_ae_smart_shunt_1 {
   char gaugeFirmwareVersion[12];
   uint8_t gaugeMac[6]; 
   uint32_t gaugeLastUpdate;
+
+  // Cycling and health (BLE/Cloud only; capacity and SOH are 0 until
+  // first measured)
+  float equivalentCycles;
+  float usableCapacityAh;
+  float stateOfHealth;    // percent of rated capacity
+  float internalResistanceMilliOhm; // learnt from load steps, 0 until known
 } __attribute__((packed)) struct_message_ae_smart_shunt_1;
 
 typedef struct struct_message_tpms_config {
@@ -0,0 +1,91 @@
+#include "soc_kalman_filter.h"
+#include <math.h>
+
+SocKalmanFilter::SocKalmanFilter() : SocKalmanFilter(Config()) {}
+
+SocKalmanFilter::SocKalmanFilter(const Config& config) : cfg(config) {
+    temperature_C = NAN;
+    ocv::socRow(temperature_C, ocvRow);
+    reset();
+}
+
+void SocKalmanFilter::reset() {
+    primed = false;
+    lastTimestamp_us = 0;
+    lastDt_us = 0;
+    decay = 0.0f;
+    v1 = 0.0f;
+    p00 = cfg.initialSocSigma * cfg.initialSocSigma;
+    p01 = 0.0f;
+    p11 = 0.0f;
+    innovation = 0.0f;
+    updates = 0;
+}
+
+void SocKalmanFilter::resetSoc(float sigma_percent) {
+    p00 = sigma_percent * sigma_percent;
+    p01 = 0.0f;
+}
+
+void SocKalmanFilter::setTemperature_C(float t) {
+    if (t == temperature_C || (isnan(t) && isnan(temperature_C))) {
+        return;
+    }
+    temperature_C = t;
+    if (ocv::TEMPERATURE_DEPENDENT) {
+        ocv::socRow(temperature_C, ocvRow);
+    }
+}
+
+float SocKalmanFilter::getSocSigma_percent() const {
+    return sqrtf(p00);
+}
+
+float SocKalmanFilter::update(float soc_percent, float currentA, float voltage_V,
+                              float r0_Ohm, int64_t timestamp_us) {
+    if (isnan(soc_percent) || isnan(currentA) || isnan(voltage_V)) {
+        return 0.0f;
+    }
+    if (!primed) {
+        primed = true;
+        lastTimestamp_us = timestamp_us;
+        return 0.0f;
+    }
+    const int64_t dt_us = timestamp_us - lastTimestamp_us;
+    if (dt_us <= 0) {
+        return 0.0f;
+    }
+    lastTimestamp_us = timestamp_us;
+    const float dt_s = dt_us * 1e-6f;
+
+    // Predict. SOC was advanced by the caller; only its variance grows.
+    // The sample interval rarely changes, so the exponential is cached.
+    if (dt_us != lastDt_us) {
+        lastDt_us = dt_us;
+        decay = expf(-dt_s / cfg.tau1_s);
+    }
+    v1 = decay * v1 + (1.0f - decay) * cfg.r1_Ohm * currentA;
+    p00 += cfg.socNoise * dt_s;
+    p01 *= decay;
+    p11 = decay * decay * p11 + cfg.polarizationNoise * dt_s;
+
+    // Correct with the terminal voltage. H = [dOCV/dSOC, 1]
+    float h0;
+    const float ocv_V = ocv::restVoltage(ocvRow, soc_percent, h0);
+    innovation = voltage_V - (ocv_V + v1 + r0_Ohm * currentA);
+
+    const float ph0 = p00 * h0 + p01; // (P H^T)[0]
+    const float ph1 = p01 * h0 + p11; // (P H^T)[1]
+    const float s = h0 * ph0 + ph1 + cfg.voltageNoise / dt_s;
+    const float k0 = ph0 / s;
+    const float k1 = ph1 / s;
+
+    v1 += k1 * innovation;
+    // P = (I - K H) P, kept symmetric
+    p00 -= k0 * ph0;
+    p01 -= k0 * ph1;
+    p11 -= k1 * ph1;
+    updates++;
+
+    return k0 * innovation;
+}
@@ -0,0 +1,68 @@
+#ifndef SOC_KALMAN_FILTER_H
+#define SOC_KALMAN_FILTER_H
+
+#include <stdint.h>
+#include "ocv_table.h"
+
+// Extended Kalman filter that corrects the coulomb-counted SOC with the
+// terminal voltage, so SOC converges without waiting for a sync to full or
+// empty. Pure logic so it can be tested natively.
+//
+// Battery model (first-order Thevenin, I positive = charging):
+//   V = OCV(SOC, T) + V1 + R0 * I
+//   V1' = -V1 / tau1 + I * R1 / tau1
+// The state is [SOC, V1] with a fixed 2x2 covariance, so an update is a
+// few dozen float operations plus one OCV row lookup, and no allocation.
+//
+// The SOC part of the state lives in the caller's integer charge counter:
+// the counter is the prediction, and update() returns the correction to
+// add to it. That keeps the coulomb count exact however small the per
+// sample charge. Measurement noise is a density (V^2 * s) and is divided
+// by the sample interval, so the filter trusts the voltage by the same
+// amount per second at any sample rate.
+class SocKalmanFilter {
+public:
+    struct Config {
+        float r1_Ohm = 0.004f;          // polarization resistance
+        float tau1_s = 60.0f;           // polarization time constant R1 * C1
+        float socNoise = 1e-4f;         // SOC random walk, %^2 per s
+        float polarizationNoise = 1e-4f; // V1 random walk, V^2 per s
+        float voltageNoise = 0.1f;      // V^2 * s, includes model error
+        float initialSocSigma = 20.0f;  // % at start
+    };
+
+    SocKalmanFilter();
+    explicit SocKalmanFilter(const Config& config);
+
+    // One predict / correct step. soc_percent is the coulomb-counted SOC
+    // including this sample; r0_Ohm is the ohmic resistance. Returns the
+    // SOC correction in %; the first sample only primes the filter.
+    float update(float soc_percent, float currentA, float voltage_V, float r0_Ohm,
+                 int64_t timestamp_us);
+
+    // The OCV row is recomputed only when the temperature changes
+    void setTemperature_C(float temperature_C);
+    // The caller moved the SOC by other means (sync, seed): reset its variance
+    void resetSoc(float sigma_percent);
+    void reset();
+
+    float getSocSigma_percent() const;
+    float getPolarization_V() const { return v1; }
+    float getInnovation_V() const { return innovation; }
+    uint32_t getUpdates() const { return updates; }
+
+private:
+    Config cfg;
+    bool primed;
+    int64_t lastTimestamp_us;
+    int64_t lastDt_us;
+    float decay;         // exp(-dt / tau1) for lastDt_us
+    float v1;
+    float p00, p01, p11; // symmetric covariance of [SOC, V1]
+    float innovation;
+    uint32_t updates;
+    float temperature_C;
+    float ocvRow[ocv::VOLTAGE_POINTS];
+};
+
+#endif // SOC_KALMAN_FILTER_H
@@ -0,0 +1,172 @@
+#include "streaming_stats.h"
+#include <math.h>
+
+float RunningStats::stddev() const {
+    return sqrtf(variance());
+}
+
+P2Quantile::P2Quantile(float p) : p(p) {
+    reset();
+}
+
+void P2Quantile::reset() {
+    n = 0;
+    for (int i = 0; i < 5; i++) {
+        q[i] = 0.0f;
+        pos[i] = i + 1;
+    }
+    want[0] = 1.0f;
+    want[1] = 1.0f + 2.0f * p;
+    want[2] = 1.0f + 4.0f * p;
+    want[3] = 3.0f + 2.0f * p;
+    want[4] = 5.0f;
+    step[0] = 0.0f;
+    step[1] = p / 2.0f;
+    step[2] = p;
+    step[3] = (1.0f + p) / 2.0f;
+    step[4] = 1.0f;
+}
+
+void P2Quantile::add(float x) {
+    if (n < 5) {
+        // Insertion sort of the first five samples
+        int i = (int)n;
+        while (i > 0 && q[i - 1] > x) {
+            q[i] = q[i - 1];
+            i--;
+        }
+        q[i] = x;
+        n++;
+        return;
+    }
+    n++;
+
+    // Cell the sample falls into, extending the extremes if needed
+    int k;
+    if (x < q[0]) {
+        q[0] = x;
+        k = 0;
+    } else if (x >= q[4]) {
+        if (x > q[4]) q[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+        while (k < 3 && x >= q[k + 1]) {
+            k++;
+        }
+    }
+    for (int i = k + 1; i < 5; i++) {
+        pos[i]++;
+    }
+    for (int i = 0; i < 5; i++) {
+        want[i] += step[i];
+    }
+
+    // Move the middle markers towards their desired positions
+    for (int i = 1; i <= 3; i++) {
+        const float d = want[i] - pos[i];
+        if ((d >= 1.0f && pos[i + 1] - pos[i] > 1) ||
+            (d <= -1.0f && pos[i - 1] - pos[i] < -1)) {
+            const int s = d > 0.0f ? 1 : -1;
+            const float candidate = parabolic(i, (float)s);
+            if (q[i - 1] < candidate && candidate < q[i + 1]) {
+                q[i] = candidate;
+            } else {
+                q[i] = linear(i, s);
+            }
+            pos[i] += s;
+        }
+    }
+}
+
+float P2Quantile::parabolic(int i, float d) const {
+    const float np = (float)(pos[i + 1] - pos[i - 1]);
+    const float left = (float)(pos[i] - pos[i - 1]);
+    const float right = (float)(pos[i + 1] - pos[i]);
+    return q[i] + d / np *
+                      ((left + d) * (q[i + 1] - q[i]) / right +
+                       (right - d) * (q[i] - q[i - 1]) / left);
+}
+
+float P2Quantile::linear(int i, int d) const {
+    return q[i] + d * (q[i + d] - q[i]) / (float)(pos[i + d] - pos[i]);
+}
+
+float P2Quantile::value() const {
+    if (n == 0) {
+        return 0.0f;
+    }
+    if (n <= 5) {
+        // Nearest rank among the samples seen so far
+        int idx = (int)lroundf(p * (n - 1));
+        return q[idx];
+    }
+    return q[2];
+}
+
+SignalStats::SignalStats(uint32_t window_ms)
+    : windowMs(window_ms), windowStart_ms(0), p50(0.50f), p95(0.95f),
+      p99(0.99f), published(), sequence(0) {}
+
+void SignalStats::reset() {
+    stats.reset();
+    p50.reset();
+    p95.reset();
+    p99.reset();
+}
+
+void SignalStats::setWindow_ms(uint32_t window_ms) {
+    windowMs = window_ms > 0 ? window_ms : DEFAULT_WINDOW_MS;
+    reset();
+}
+
+void SignalStats::add(float x, uint32_t now_ms) {
+    if (isnan(x)) {
+        return;
+    }
+    if (stats.count() == 0) {
+        windowStart_ms = now_ms;
+    } else if (now_ms - windowStart_ms >= windowMs) {
+        publish(now_ms - windowStart_ms);
+        reset();
+        windowStart_ms = now_ms;
+    }
+    stats.add(x);
+    p50.add(x);
+    p95.add(x);
+    p99.add(x);
+}
+
+SignalStats::Summary SignalStats::getCurrent() const {
+    Summary s;
+    s.count = stats.count();
+    s.window_ms = windowMs;
+    s.mean = stats.mean();
+    s.stddev = stats.stddev();
+    s.min = stats.min();
+    s.max = stats.max();
+    s.p50 = p50.value();
+    s.p95 = p95.value();
+    s.p99 = p99.value();
+    return s;
+}
+
+void SignalStats::publish(uint32_t elapsed_ms) {
+    Summary s = getCurrent();
+    s.window_ms = elapsed_ms;
+    sequence.fetch_add(1, std::memory_order_acq_rel);
+    published = s;
+    sequence.fetch_add(1, std::memory_order_release);
+}
+
+SignalStats::Summary SignalStats::getSummary() const {
+    Summary s;
+    uint32_t before, after;
+    do {
+        before = sequence.load(std::memory_order_acquire);
+        s = published;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+    return s;
+}
@@ -0,0 +1,118 @@
+#ifndef STREAMING_STATS_H
+#define STREAMING_STATS_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Mean/variance (Welford), min and max of a stream in constant memory.
+class RunningStats {
+public:
+    RunningStats() { reset(); }
+
+    void add(float x) {
+        n++;
+        const float delta = x - m;
+        m += delta / n;
+        m2 += delta * (x - m);
+        if (n == 1 || x < lo) lo = x;
+        if (n == 1 || x > hi) hi = x;
+    }
+
+    void reset() {
+        n = 0;
+        m = 0.0f;
+        m2 = 0.0f;
+        lo = 0.0f;
+        hi = 0.0f;
+    }
+
+    uint32_t count() const { return n; }
+    float mean() const { return m; }
+    // Sample variance (n - 1); 0 with fewer than two samples
+    float variance() const { return n > 1 ? m2 / (n - 1) : 0.0f; }
+    float stddev() const;
+    float min() const { return lo; }
+    float max() const { return hi; }
+
+private:
+    uint32_t n;
+    float m;
+    float m2;
+    float lo;
+    float hi;
+};
+
+// One streaming quantile estimate with the P-square algorithm (Jain &
+// Chlamtac): five markers whose heights are adjusted with a piecewise
+// parabolic fit as samples arrive. O(1) time and memory per sample; exact
+// for the first five samples.
+class P2Quantile {
+public:
+    explicit P2Quantile(float p = 0.5f);
+
+    void add(float x);
+    void reset();
+    float value() const;
+    uint32_t count() const { return n; }
+
+private:
+    float parabolic(int i, float d) const;
+    float linear(int i, int d) const;
+
+    float p;
+    uint32_t n;
+    float q[5];       // marker heights
+    int32_t pos[5];   // actual marker positions
+    float want[5];    // desired marker positions
+    float step[5];    // desired position increments
+};
+
+// Windowed statistics of one signal: count, mean, standard deviation,
+// min, max and P50/P95/P99. Windows are tumbling: when a sample arrives
+// window_ms after the window started, the finished window is published and
+// a new one starts. Single producer; getSummary() may be called from any
+// task and retries if it races with a publish.
+class SignalStats {
+public:
+    static constexpr uint32_t DEFAULT_WINDOW_MS = 60000;
+
+    struct Summary {
+        uint32_t count; // 0: no window finished yet
+        uint32_t window_ms;
+        float mean;
+        float stddev;
+        float min;
+        float max;
+        float p50;
+        float p95;
+        float p99;
+    };
+
+    explicit SignalStats(uint32_t window_ms = DEFAULT_WINDOW_MS);
+
+    void add(float x, uint32_t now_ms);
+    void setWindow_ms(uint32_t window_ms);
+    uint32_t getWindow_ms() const { return windowMs; }
+    void reset();
+
+    // Last finished window.
+    Summary getSummary() const;
+    // Window in progress (producer side only).
+    Summary getCurrent() const;
+
+private:
+    void publish(uint32_t elapsed_ms);
+
+    uint32_t windowMs;
+    uint32_t windowStart_ms;
+    RunningStats stats;
+    P2Quantile p50;
+    P2Quantile p95;
+    P2Quantile p99;
+
+    Summary published;
+    std::atomic<uint32_t> sequence; // odd while published is being written
+};
+
+#endif // STREAMING_STATS_H
@@ -1,4 +1,5 @@
 #include "tpms_handler.h"
+#include "settings_store.h"
 #include <NimBLEDevice.h>
 #include <NimBLEUtils.h>
 #include <NimBLEScan.h>
@@ -178,13 +179,11 @@ void TPMSHandler::getRawConfig(void* target_48_bytes) {
 }
 
 void TPMSHandler::loadFromNVS() {
-    Preferences prefs;
-    prefs.begin("tpms", true);
     const char* keys[TPMS_COUNT] = {"tpms_fr", "tpms_rr", "tpms_rl", "tpms_fl"};
     const char* baseKeys[TPMS_COUNT] = {"base_fr", "base_rr", "base_rl", "base_fl"};
     
     for (int i = 0; i < TPMS_COUNT; i++) {
-        String macStr = prefs.getString(keys[i], "");
+        String macStr = settings.getString("tpms", keys[i], "");
         if (macStr.length() > 0) {
              // Hex string to bytes
              if (macStr.length() == 17) {
@@ -200,14 +199,11 @@ void TPMSHandler::loadFromNVS() {
         } else {
             sensors[i].configured = false;
         }
-        sensors[i].baselinePsi = prefs.getFloat(baseKeys[i], 0.0f);
+        sensors[i].baselinePsi = settings.getFloat("tpms", baseKeys[i], 0.0f);
     }
-    prefs.end();
 }
 
 void TPMSHandler::saveToNVS() {
-    Preferences prefs;
-    prefs.begin("tpms", false);
     const char* keys[TPMS_COUNT] = {"tpms_fr", "tpms_rr", "tpms_rl", "tpms_fl"};
     const char* baseKeys[TPMS_COUNT] = {"base_fr", "base_rr", "base_rl", "base_fl"};
     
@@ -217,13 +213,12 @@ void TPMSHandler::saveToNVS() {
             snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x", 
                 sensors[i].mac[0], sensors[i].mac[1], sensors[i].mac[2], 
                 sensors[i].mac[3], sensors[i].mac[4], sensors[i].mac[5]);
-            prefs.putString(keys[i], buf);
-            prefs.putFloat(baseKeys[i], sensors[i].baselinePsi);
+            settings.putString("tpms", keys[i], buf);
+            settings.putFloat("tpms", baseKeys[i], sensors[i].baselinePsi);
         } else {
-            prefs.remove(keys[i]);
-            prefs.remove(baseKeys[i]);
+            settings.remove("tpms", keys[i]);
+            settings.remove("tpms", baseKeys[i]);
         }
     }
-    prefs.end();
     Serial.println("[TPMS] Configuration Saved to NVS");
 }
@@ -2,7 +2,6 @@
 #define TPMS_HANDLER_H
 
 #include <Arduino.h>
-#include <Preferences.h>
 #include "shared_defs.h"
 
 // Positions (FR, RR, RL, FL)
@@ -0,0 +1,75 @@
+#include "transient_capture.h"
+#include <math.h>
+
+TransientCapture::TransientCapture()
+    : buffer(), head(0), triggerIndex(0), postRemaining(0),
+      threshold_mA_(0.0f), source(TRIGGER_NONE), state(ARMED) {}
+
+const char* TransientCapture::sourceName(TriggerSource source) {
+    switch (source) {
+        case TRIGGER_ALERT:     return "ALERT";
+        case TRIGGER_THRESHOLD: return "THRESHOLD";
+        case TRIGGER_MANUAL:    return "MANUAL";
+        default:                return "NONE";
+    }
+}
+
+void TransientCapture::trigger(TriggerSource src) {
+    if (state.load(std::memory_order_relaxed) != ARMED) {
+        return;
+    }
+    source = src;
+    triggerIndex = head;
+    postRemaining = POST_SAMPLES;
+    state.store(TRIGGERED, std::memory_order_relaxed);
+}
+
+void TransientCapture::record(const SensorSample& sample) {
+    const State current = state.load(std::memory_order_relaxed);
+    if (current == FROZEN) {
+        return;
+    }
+    if (current == ARMED && threshold_mA_ > 0.0f &&
+        fabsf(sample.current_mA) >= threshold_mA_) {
+        trigger(TRIGGER_THRESHOLD);
+    }
+
+    buffer[head % CAPACITY] = sample;
+    head++;
+
+    if (state.load(std::memory_order_relaxed) == TRIGGERED &&
+        --postRemaining == 0) {
+        freeze();
+    }
+}
+
+void TransientCapture::freeze() {
+    // Publish the buffer contents before the state the reader checks
+    state.store(FROZEN, std::memory_order_release);
+}
+
+void TransientCapture::rearm() {
+    head = 0;
+    triggerIndex = 0;
+    postRemaining = 0;
+    source = TRIGGER_NONE;
+    state.store(ARMED, std::memory_order_release);
+}
+
+size_t TransientCapture::size() const {
+    if (!isFrozen()) {
+        return 0;
+    }
+    return head < CAPACITY ? head : CAPACITY;
+}
+
+size_t TransientCapture::getPreTriggerCount() const {
+    if (!isFrozen()) {
+        return 0;
+    }
+    return triggerIndex - (head - size());
+}
+
+const SensorSample& TransientCapture::at(size_t index) const {
+    return buffer[(head - size() + index) % CAPACITY];
+}
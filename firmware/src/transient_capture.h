@@ -0,0 +1,67 @@
+#ifndef TRANSIENT_CAPTURE_H
+#define TRANSIENT_CAPTURE_H
+
+#include <atomic>
+#include <stddef.h>
+#include "sensor_sample.h"
+
+// Scope-style capture of the sample stream around an overcurrent event.
+//
+// While ARMED every sample goes into a rolling window. trigger() (INA226
+// alert, manual) or a sample at or above the software threshold switches to
+// TRIGGERED; after POST_SAMPLES more samples (the trigger sample included)
+// the window is FROZEN with up to PRE_SAMPLES of history before the trigger.
+// A frozen capture is not written again until rearm(), so it can be read
+// from another task while the producer keeps running.
+class TransientCapture {
+public:
+    static constexpr size_t PRE_SAMPLES = 64;
+    static constexpr size_t POST_SAMPLES = 192;
+    static constexpr size_t CAPACITY = PRE_SAMPLES + POST_SAMPLES;
+
+    enum State : uint8_t { ARMED = 0, TRIGGERED, FROZEN };
+    enum TriggerSource : uint8_t {
+        TRIGGER_NONE = 0,
+        TRIGGER_ALERT,      // INA226 SHUNT_OVER alert
+        TRIGGER_THRESHOLD,  // |current| >= software threshold
+        TRIGGER_MANUAL
+    };
+
+    TransientCapture();
+
+    // Producer side, once per sample.
+    void record(const SensorSample& sample);
+    // The next recorded sample becomes the trigger point. Ignored unless ARMED.
+    void trigger(TriggerSource source);
+    // Drop the frozen capture and start filling the pre-trigger window again.
+    void rearm();
+
+    // 0 disables the software trigger.
+    void setThreshold_mA(float threshold_mA) { threshold_mA_ = threshold_mA; }
+    float getThreshold_mA() const { return threshold_mA_; }
+
+    State getState() const { return state.load(std::memory_order_acquire); }
+    bool isFrozen() const { return getState() == FROZEN; }
+    TriggerSource getSource() const { return source; }
+
+    // Frozen capture access, oldest first. Index getPreTriggerCount() is the
+    // trigger sample.
+    size_t size() const;
+    size_t getPreTriggerCount() const;
+    const SensorSample& at(size_t index) const;
+
+    static const char* sourceName(TriggerSource source);
+
+private:
+    void freeze();
+
+    SensorSample buffer[CAPACITY];
+    size_t head;          // total samples written since rearm()
+    size_t triggerIndex;  // value of head when the trigger sample was written
+    size_t postRemaining;
+    float threshold_mA_;
+    TriggerSource source;
+    std::atomic<State> state;
+};
+
+#endif // TRANSIENT_CAPTURE_H
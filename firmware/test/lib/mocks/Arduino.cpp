@@ -9,6 +9,10 @@ unsigned long millis() {
     return mock_millis_value;
 }
 
+unsigned long micros() {
+    return mock_millis_value * 1000UL;
+}
+
 void set_mock_millis(unsigned long value) {
     mock_millis_value = value;
 }
@@ -22,6 +26,7 @@ MockSerial Serial;
 #include <map>
 static std::map<uint8_t, uint8_t> mock_pin_modes;
 static std::map<uint8_t, uint8_t> mock_digital_write_values;
+static std::map<uint8_t, int> mock_analog_read_values;
 static bool mock_deep_sleep_called = false;
 
 void pinMode(uint8_t pin, uint8_t mode) {
@@ -37,7 +42,11 @@ int digitalRead(uint8_t pin) {
 }
 
 int analogRead(uint8_t pin) {
-    return 0; // Not mocked yet
+    return mock_analog_read_values.count(pin) ? mock_analog_read_values[pin] : 0;
+}
+
+void set_mock_analog_read(uint8_t pin, int value) {
+    mock_analog_read_values[pin] = value;
 }
 
 void mock_digital_write_clear() {
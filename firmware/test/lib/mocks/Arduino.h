@@ -26,6 +26,7 @@
 // Mock millis() function
 unsigned long millis();
 void set_mock_millis(unsigned long value);
+unsigned long micros(); // derived from the mock millis value
 
 void delay(unsigned long ms);
 
@@ -62,6 +63,7 @@ void pinMode(uint8_t pin, uint8_t mode);
 void digitalWrite(uint8_t pin, uint8_t val);
 int digitalRead(uint8_t pin);
 int analogRead(uint8_t pin);
+void set_mock_analog_read(uint8_t pin, int value);
 
 // Mock GPIO state inspection functions (for tests)
 void mock_digital_write_clear();
@@ -1,5 +1,6 @@
 #include "INA226_WE.h"
 #include <map>
+#include <cmath>
 
 // Initialize static mock data members
 float INA226_WE::mockShuntVoltage_mV = 0.0;
@@ -7,6 +8,8 @@ float INA226_WE::mockBusVoltage_V = 0.0;
 float INA226_WE::mockCurrent_mA = 0.0;
 float INA226_WE::mockBusPower = 0.0;
 bool INA226_WE::overflow = false;
+bool INA226_WE::convAlert = false;
+bool INA226_WE::limitAlert = false;
 
 static std::map<uint8_t, uint16_t> mock_registers;
 
@@ -33,6 +36,10 @@ void INA226_WE::enableAlertLatch() {
     //
 }
 
+void INA226_WE::enableConvReadyAlert() {
+    mock_registers[INA226_MASK_EN_REG] |= INA226_CNVR;
+}
+
 uint16_t INA226_WE::readRegister(uint8_t reg) const {
     if (mock_registers.count(reg)) {
         return mock_registers.at(reg);
@@ -43,3 +50,13 @@ uint16_t INA226_WE::readRegister(uint8_t reg) const {
 void INA226_WE::writeRegister(uint8_t reg, uint16_t val) {
     mock_registers[reg] = val;
 }
+
+bool INA226_WE::readMeasurements(INA226_RAW_VALUES &raw, bool withCurrent) {
+    raw.maskEnable = (overflow ? 0x0004 : 0) | (convAlert ? INA226_CVRF : 0) |
+                     (limitAlert ? INA226_AFF : 0);
+    raw.shunt = (int32_t)std::lround((double)mockShuntVoltage_mV * 1000.0);
+    raw.bus = (int32_t)std::lround((double)mockBusVoltage_V * 1000000.0);
+    raw.current = withCurrent ? (int32_t)std::lround((double)mockCurrent_mA * 1000.0) : 0;
+    i2cTransactions += withCurrent ? 4 : 3;
+    return true;
+}
@@ -26,6 +26,10 @@ enum ina226_conversion_times{
     CONV_TIME_8244
 };
 
+// Type names used by the real library
+typedef ina226_averages INA226_AVERAGES;
+typedef ina226_conversion_times INA226_CONV_TIME;
+
 enum ina226_alert_type{
     SHUNT_OVER,
     SHUNT_UNDER,
@@ -36,13 +40,27 @@ enum ina226_alert_type{
     POWER_OVER
 };
 
+// Mock raw values use finer LSBs (1 uV, 1 uV, 1 uA) than the real chip so
+// tests can round-trip arbitrary float inputs.
+struct INA226_RAW_VALUES {
+    uint16_t maskEnable;
+    int32_t shunt;
+    int32_t bus;
+    int32_t current;
+};
+
 class INA226_WE {
 public:
     // Register addresses
-    static const uint8_t INA226_CONF_REG = 0x00;
-    static const uint8_t INA226_CAL_REG = 0x05;
-    static const uint8_t INA226_MASK_EN_REG = 0x06;
-    static const uint8_t INA226_ALERT_LIMIT_REG = 0x07;
+    static constexpr uint8_t INA226_CONF_REG = 0x00;
+    static constexpr uint8_t INA226_CAL_REG = 0x05;
+    static constexpr uint8_t INA226_MASK_EN_REG = 0x06;
+    static constexpr uint8_t INA226_ALERT_LIMIT_REG = 0x07;
+
+    // Flag bits
+    static constexpr uint16_t INA226_CNVR = 0x0400;
+    static constexpr uint16_t INA226_AFF = 0x0010;
+    static constexpr uint16_t INA226_CVRF = 0x0008;
 
     INA226_WE(uint8_t addr);
     void init();
@@ -54,8 +72,14 @@ public:
     void readAndClearFlags();
     void setAlertType(ina226_alert_type type, float limit);
     void enableAlertLatch();
+    void enableConvReadyAlert();
     uint16_t readRegister(uint8_t reg) const;
     void writeRegister(uint8_t reg, uint16_t val);
+    bool readMeasurements(INA226_RAW_VALUES &raw, bool withCurrent = true);
+    float rawShuntToMilliVolts(int32_t raw) const { return (float)(raw / 1000.0); }
+    float rawBusToVolts(int32_t raw) const { return (float)(raw / 1000000.0); }
+    float rawCurrentToMilliAmps(int32_t raw) const { return (float)(raw / 1000.0); }
+    uint32_t getI2cTransactionCount() const { return i2cTransactions; }
 
     // Mock data members - public to allow easy manipulation in tests
     static float mockShuntVoltage_mV;
@@ -63,6 +87,9 @@ public:
     static float mockCurrent_mA;
     static float mockBusPower;
     static bool overflow;
+    static bool convAlert;
+    static bool limitAlert;
+    uint32_t i2cTransactions = 0;
 
     // Mock methods to return the mock data
     float getShuntVoltage_mV() { return mockShuntVoltage_mV; }
@@ -0,0 +1,40 @@
+#ifndef MOCK_ADC_BACKEND_H
+#define MOCK_ADC_BACKEND_H
+
+#include <deque>
+#include "adc_backend.h"
+
+// AdcBackend fed by the test: push() queues raw conversions that the next
+// readSamples() hands out, as the DMA driver would.
+class MockAdcBackend : public AdcBackend {
+public:
+    bool beginResult = true;
+    int pin = -1;
+
+    bool begin(int p) override {
+        pin = p;
+        return beginResult;
+    }
+
+    size_t readSamples(uint16_t* out, size_t maxSamples) override {
+        size_t n = 0;
+        while (n < maxSamples && !pending.empty()) {
+            out[n++] = pending.front();
+            pending.pop_front();
+        }
+        return n;
+    }
+
+    void push(uint16_t raw, size_t count = 1) {
+        for (size_t i = 0; i < count; i++) {
+            pending.push_back(raw);
+        }
+    }
+
+    size_t available() const { return pending.size(); }
+
+private:
+    std::deque<uint16_t> pending;
+};
+
+#endif // MOCK_ADC_BACKEND_H
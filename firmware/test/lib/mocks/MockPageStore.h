@@ -0,0 +1,59 @@
+#ifndef MOCK_PAGE_STORE_H
+#define MOCK_PAGE_STORE_H
+
+#include <string.h>
+#include <vector>
+#include "page_store.h"
+
+// In-memory PageStore with NOR flash behaviour: erase() sets 0xFF and
+// write() ANDs into what is there, so writing a byte twice shows up.
+class MockPageStore : public PageStore {
+public:
+    MockPageStore(size_t pages, size_t pageBytes)
+        : pages(pages), pageBytes(pageBytes), data(pages * pageBytes, 0xFF),
+          erases(pages, 0) {}
+
+    size_t pageSize() const override { return pageBytes; }
+    size_t pageCount() const override { return pages; }
+
+    bool read(size_t page, size_t offset, void* out, size_t length) const override {
+        if (page >= pages || offset + length > pageBytes) return false;
+        memcpy(out, &data[page * pageBytes + offset], length);
+        reads++;
+        return true;
+    }
+
+    bool write(size_t page, size_t offset, const void* src, size_t length) override {
+        if (page >= pages || offset + length > pageBytes) return false;
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        for (size_t i = 0; i < length; i++) {
+            data[page * pageBytes + offset + i] &= bytes[i];
+        }
+        writes++;
+        return true;
+    }
+
+    bool erase(size_t page) override {
+        if (page >= pages) return false;
+        memset(&data[page * pageBytes], 0xFF, pageBytes);
+        erases[page]++;
+        return true;
+    }
+
+    // Simulate a torn write: garbage where the next bytes would have gone
+    void corrupt(size_t page, size_t offset, uint8_t value) {
+        data[page * pageBytes + offset] &= value;
+    }
+
+    uint32_t eraseCount(size_t page) const { return erases[page]; }
+    mutable uint32_t reads = 0;
+    uint32_t writes = 0;
+
+private:
+    size_t pages;
+    size_t pageBytes;
+    std::vector<uint8_t> data;
+    std::vector<uint32_t> erases;
+};
+
+#endif // MOCK_PAGE_STORE_H
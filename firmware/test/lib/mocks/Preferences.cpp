@@ -1,6 +1,8 @@
 #include "Preferences.h"
+#include <algorithm>
 
 std::map<std::string, Preferences::pref_variant> Preferences::preferences;
+bool Preferences::failWrites = false;
 
 bool Preferences::begin(const char* name, bool readOnly) {
     // Mock always succeeds
@@ -19,12 +21,19 @@ bool Preferences::isKey(const char* key) {
     return preferences.count(key);
 }
 
-void Preferences::remove(const char* key) {
-    preferences.erase(key);
+bool Preferences::remove(const char* key) {
+    if (failWrites) {
+        return false;
+    }
+    return preferences.erase(key) > 0;
 }
 
-void Preferences::putFloat(const char* key, float value) {
+size_t Preferences::putFloat(const char* key, float value) {
+    if (failWrites) {
+        return 0;
+    }
     preferences[key] = value;
+    return sizeof(value);
 }
 
 float Preferences::getFloat(const char* key, float defaultValue) {
@@ -34,8 +43,12 @@ float Preferences::getFloat(const char* key, float defaultValue) {
     return defaultValue;
 }
 
-void Preferences::putUShort(const char* key, uint16_t value) {
+size_t Preferences::putUShort(const char* key, uint16_t value) {
+    if (failWrites) {
+        return 0;
+    }
     preferences[key] = value;
+    return sizeof(value);
 }
 
 uint16_t Preferences::getUShort(const char* key, uint16_t defaultValue) {
@@ -45,8 +58,27 @@ uint16_t Preferences::getUShort(const char* key, uint16_t defaultValue) {
     return defaultValue;
 }
 
-void Preferences::putUInt(const char* key, uint32_t value) {
+size_t Preferences::putInt(const char* key, int32_t value) {
+    if (failWrites) {
+        return 0;
+    }
+    preferences[key] = value;
+    return sizeof(value);
+}
+
+int32_t Preferences::getInt(const char* key, int32_t defaultValue) {
+    if (preferences.count(key)) {
+        return std::get<int32_t>(preferences[key]);
+    }
+    return defaultValue;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    if (failWrites) {
+        return 0;
+    }
     preferences[key] = value;
+    return sizeof(value);
 }
 
 uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
@@ -56,8 +88,12 @@ uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
     return defaultValue;
 }
 
-void Preferences::putBool(const char* key, bool value) {
+size_t Preferences::putBool(const char* key, bool value) {
+    if (failWrites) {
+        return 0;
+    }
     preferences[key] = value;
+    return sizeof(value);
 }
 
 bool Preferences::getBool(const char* key, bool defaultValue) {
@@ -67,8 +103,12 @@ bool Preferences::getBool(const char* key, bool defaultValue) {
     return defaultValue;
 }
 
-void Preferences::putString(const char* key, String value) {
+size_t Preferences::putString(const char* key, String value) {
+    if (failWrites) {
+        return 0;
+    }
     preferences[key] = value;
+    return value.length();
 }
 
 String Preferences::getString(const char* key, String defaultValue) {
@@ -78,6 +118,35 @@ String Preferences::getString(const char* key, String defaultValue) {
     return defaultValue;
 }
 
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    if (failWrites) {
+        return 0;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    preferences[key] = std::vector<uint8_t>(bytes, bytes + len);
+    return len;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (preferences.count(key)) {
+        return std::get<std::vector<uint8_t>>(preferences[key]).size();
+    }
+    return 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    if (!preferences.count(key)) {
+        return 0;
+    }
+    const std::vector<uint8_t>& bytes = std::get<std::vector<uint8_t>>(preferences[key]);
+    if (bytes.size() > maxLen) {
+        return 0;
+    }
+    std::copy(bytes.begin(), bytes.end(), static_cast<uint8_t*>(buf));
+    return bytes.size();
+}
+
 void Preferences::clear_static() {
     preferences.clear();
+    failWrites = false;
 }
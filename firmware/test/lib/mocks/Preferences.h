@@ -4,6 +4,7 @@
 #include <string>
 #include <map>
 #include <variant>
+#include <vector>
 #include "Arduino.h" // For String
 
 class Preferences {
@@ -12,27 +13,36 @@ public:
     void end();
     void clear();
     bool isKey(const char* key);
-    void remove(const char* key);
+    bool remove(const char* key);
 
-    void putFloat(const char* key, float value);
+    size_t putFloat(const char* key, float value);
     float getFloat(const char* key, float defaultValue);
 
-    void putUShort(const char* key, uint16_t value);
+    size_t putUShort(const char* key, uint16_t value);
     uint16_t getUShort(const char* key, uint16_t defaultValue);
 
-    void putUInt(const char* key, uint32_t value);
+    size_t putInt(const char* key, int32_t value);
+    int32_t getInt(const char* key, int32_t defaultValue);
+
+    size_t putUInt(const char* key, uint32_t value);
     uint32_t getUInt(const char* key, uint32_t defaultValue);
 
-    void putBool(const char* key, bool value);
+    size_t putBool(const char* key, bool value);
     bool getBool(const char* key, bool defaultValue);
 
-    void putString(const char* key, String value);
+    size_t putString(const char* key, String value);
     String getString(const char* key, String defaultValue);
 
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+
     static void clear_static();
+    // Make every write and remove fail, as on a full or worn NVS partition
+    static bool failWrites;
 
 private:
-    using pref_variant = std::variant<float, uint16_t, uint32_t, bool, String>;
+    using pref_variant = std::variant<float, uint16_t, int32_t, uint32_t, bool, String, std::vector<uint8_t>>;
     static std::map<std::string, pref_variant> preferences;
 };
 
@@ -1,4 +1,7 @@
 #include "gpio.h"
+#include "../hal/gpio_ll.h"
+
+gpio_dev_t GPIO;
 
 // Mock implementations
 void gpio_hold_en(gpio_num_t gpio_num) {
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+#include "Arduino.h"
+
+// Microsecond timer, driven by the mock millis() value
+inline int64_t esp_timer_get_time(void) {
+    return (int64_t)millis() * 1000;
+}
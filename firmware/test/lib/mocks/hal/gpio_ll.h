@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+#include "Arduino.h"
+#include "driver/gpio.h"
+
+// Register-level GPIO access; the mock routes it through digitalWrite() so
+// tests can inspect the pin
+typedef struct {
+} gpio_dev_t;
+
+extern gpio_dev_t GPIO;
+
+static inline void gpio_ll_set_level(gpio_dev_t *hw, gpio_num_t gpio_num, uint32_t level) {
+    (void)hw;
+    digitalWrite((uint8_t)gpio_num, level ? HIGH : LOW);
+}
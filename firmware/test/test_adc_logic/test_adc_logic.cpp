@@ -1,4 +1,14 @@
 #include "../../src/ina226_adc.cpp"
+#include "../../src/conversion_controller.cpp"
+#include "../../src/cycle_counter.cpp"
+#include "../../src/run_flat_estimator.cpp"
+#include "../../src/resistance_estimator.cpp"
+#include "../../src/latency_histogram.cpp"
+#include "../../src/soc_kalman_filter.cpp"
+#include "../../src/lifetime_counters.cpp"
+#include "../../src/streaming_stats.cpp"
+#include "../../src/ocv_table.cpp"
+#include "../../src/settings_store.cpp"
 #include "../lib/mocks/Arduino.cpp"
 #include "../lib/mocks/Arduino.h"
 #include "../lib/mocks/INA226_WE.cpp"
@@ -8,7 +18,10 @@
 #include "ina226_adc.h"
 #include <unity.h>
 
-void setUp(void) { Preferences::clear_static(); }
+void setUp(void) {
+  Preferences::clear_static();
+  settings.invalidate();
+}
 
 void tearDown(void) {}
 
@@ -45,7 +58,8 @@ void test_set_voltage_protection(void) {
   TEST_ASSERT_EQUAL_FLOAT(cutoff, adc.getLowVoltageCutoff());
   TEST_ASSERT_EQUAL_FLOAT(expected_hysteresis, adc.getHysteresis());
 
-  // Verify that the values were saved to preferences
+  // Verify that the values reach preferences once the store is flushed
+  settings.flush();
   Preferences prefs;
   prefs.begin(NVS_PROTECTION_NAMESPACE, true);
   float saved_cutoff = prefs.getFloat(NVS_KEY_LOW_VOLTAGE_CUTOFF, 0.0f);
@@ -86,6 +100,7 @@ void test_load_protection_settings_validation(void) {
     prefs.putFloat(NVS_KEY_LOW_VOLTAGE_CUTOFF, 10.0f);
     prefs.putFloat(NVS_KEY_HYSTERESIS, 1.0f);
     prefs.end();
+    settings.invalidate(); // written behind the store's back
 
     INA226_ADC adc(0x40, 0.001, 100.0f);
     adc.loadProtectionSettings();
@@ -101,6 +116,7 @@ void test_load_protection_settings_validation(void) {
     prefs.putFloat(NVS_KEY_LOW_VOLTAGE_CUTOFF, 5.0f); // Invalid
     prefs.putFloat(NVS_KEY_HYSTERESIS, 1.0f);
     prefs.end();
+    settings.invalidate(); // written behind the store's back
 
     INA226_ADC adc(0x40, 0.001, 100.0f);
     adc.loadProtectionSettings();
@@ -118,6 +134,7 @@ void test_load_protection_settings_validation(void) {
     prefs.putFloat(NVS_KEY_LOW_VOLTAGE_CUTOFF, 15.0f); // Invalid
     prefs.putFloat(NVS_KEY_HYSTERESIS, 1.0f);
     prefs.end();
+    settings.invalidate(); // written behind the store's back
 
     INA226_ADC adc(0x40, 0.001, 100.0f);
     adc.loadProtectionSettings();
@@ -134,6 +151,7 @@ void test_load_protection_settings_validation(void) {
     prefs.putFloat(NVS_KEY_LOW_VOLTAGE_CUTOFF, 10.0f);
     prefs.putFloat(NVS_KEY_HYSTERESIS, 0.05f); // Invalid
     prefs.end();
+    settings.invalidate(); // written behind the store's back
 
     INA226_ADC adc(0x40, 0.001, 100.0f);
     adc.loadProtectionSettings();
@@ -150,6 +168,7 @@ void test_load_protection_settings_validation(void) {
     prefs.putFloat(NVS_KEY_LOW_VOLTAGE_CUTOFF, 10.0f);
     prefs.putFloat(NVS_KEY_HYSTERESIS, 4.0f); // Invalid
     prefs.end();
+    settings.invalidate(); // written behind the store's back
 
     INA226_ADC adc(0x40, 0.001, 100.0f);
     adc.loadProtectionSettings();
@@ -164,8 +183,8 @@ void test_energy_usage_tracking(void) {
   unsigned long initial_millis = 1000000;
   set_mock_millis(initial_millis);
 
-  // Initial call to set timestamps
-  adc.updateEnergyUsage(0.0f);
+  // Initial call to set timestamps (10W already flowing)
+  adc.updateEnergyUsage(10000.0f);
 
   // Simulate 10W (10000mW) usage for 1 second (1000ms)
   set_mock_millis(initial_millis + 1000);
@@ -178,12 +197,12 @@ void test_energy_usage_tracking(void) {
   TEST_ASSERT_EQUAL_FLOAT(expected_wh, adc.getLastDayEnergy_Wh());
   TEST_ASSERT_EQUAL_FLOAT(expected_wh, adc.getLastWeekEnergy_Wh());
 
-  // Simulate another 5W usage for 2 seconds
+  // Power ramps down to 5W over the next 2 seconds
   set_mock_millis(initial_millis + 3000); // 1000 + 2000
   adc.updateEnergyUsage(5000.0f);         // 5W
 
-  // Total energy is now 10Ws (from before) + 5W * 2s = 20Ws
-  expected_wh = 20.0f / 3600.0f;
+  // Trapezoidal: 10Ws (from before) + (10W + 5W) / 2 * 2s = 25Ws
+  expected_wh = 25.0f / 3600.0f;
   TEST_ASSERT_EQUAL_FLOAT(expected_wh, adc.getLastHourEnergy_Wh());
   TEST_ASSERT_EQUAL_FLOAT(expected_wh, adc.getLastDayEnergy_Wh());
   TEST_ASSERT_EQUAL_FLOAT(expected_wh, adc.getLastWeekEnergy_Wh());
@@ -225,73 +244,45 @@ void test_energy_usage_rollover(void) {
                            adc.getLastHourEnergy_Wh());
 }
 
+// Feed readSensors() at 10 Hz with the given raw current
+static void feedRunFlat(INA226_ADC &adc, float raw_mA, unsigned long &now_ms,
+                        int count) {
+  INA226_WE::mockCurrent_mA = raw_mA;
+  for (int i = 0; i < count; i++) {
+    now_ms += 100;
+    set_mock_millis(now_ms);
+    adc.readSensors();
+  }
+}
+
 void test_run_flat_averaging(void) {
-  // Setup
   INA226_ADC adc(0x40, 0.001, 100.0f);
-  set_mock_millis(1000000);
+  unsigned long now_ms = 1000000;
+  set_mock_millis(now_ms);
   bool warning = false;
 
-  // Set SOC to 50% so we have room to charge/discharge
+  // Stay clear of the 0% / 100% voltage syncs; SOC 50% leaves room both ways
+  INA226_WE::mockBusVoltage_V = 12.8f;
   adc.setSOC_percent(50.0f);
 
-  // 1. Discharge State (-1A)
-  // Send 10 samples of -1A. Interval > 10s.
-  for (int i = 0; i < 10; i++) {
-    set_mock_millis(1000000 + (unsigned long)(i * 10005));
-    adc.getAveragedRunFlatTime(-1.0f, 10.0f, warning);
-  }
-
-  // Check prediction.
-  // Capacity 50Ah. Current -1A. Time 50h.
-  // 50h = 2 days 2 hours.
-  String res = adc.getAveragedRunFlatTime(-1.0f, 10.0f, warning);
-  // res should be "2 days 2 hours until flat"
-
-  // Check if it matches (std::string find)
-  bool found = (res.find("2 days 2 hours") != std::string::npos);
-  std::string msg = "Expected 2 days 2 hours, got: " + res;
-  TEST_ASSERT_TRUE_MESSAGE(found, msg.c_str());
+  // 1. Discharge at 3.2 A (the current sign is flipped by the ADC)
+  // Capacity 50Ah / 3.2A = 15.625h
+  feedRunFlat(adc, 3200.0f, now_ms, 30);
+  String res = adc.getAveragedRunFlatTime(10.0f, warning);
+  std::string msg = "Expected 15h 37m until flat, got: " + res;
+  TEST_ASSERT_TRUE_MESSAGE(res.find("15h 37m until flat") != std::string::npos,
+                           msg.c_str());
+  TEST_ASSERT_FALSE(warning);
 
   // 2. Discharge -> Charge State Change
-  // Switch to +5A.
-  // Need to advance time for sample to be accepted.
-  set_mock_millis(1000000 + (10 * 10005) + 10005);
-
-  // This call should trigger RESET and record +5A.
-  res = adc.getAveragedRunFlatTime(5.0f, 10.0f, warning);
-
-  // If reset worked, avg is +5A.
-  // Remaining to full: 50Ah. 5A. 10 hours.
-  // "10 hours until full".
-  found = (res.find("10 hours") != std::string::npos);
-  msg = "Expected 10 hours, got: " + res;
-  TEST_ASSERT_TRUE_MESSAGE(found, msg.c_str());
-
-  // 3. Charging Window (Short) vs Long Discharge Buffer
-  // Let's fill the buffer with +5A for 50 samples.
-  // Start from i=0 (relative to now)
-  unsigned long baseTime = 1000000 + (12 * 10005);
-  for (int i = 0; i < 50; i++) {
-    set_mock_millis(baseTime + (unsigned long)(i * 10005));
-    adc.getAveragedRunFlatTime(5.0f, 10.0f, warning);
-  }
-
-  // Now switch to +10A. Still Charging. NO RESET.
-  // But averaging window should be max 10.
-  // Feed 10 samples of +10A.
-  baseTime += (50 * 10005);
-  for (int i = 0; i < 10; i++) {
-    set_mock_millis(baseTime + (unsigned long)(i * 10005));
-    adc.getAveragedRunFlatTime(10.0f, 10.0f, warning);
-  }
-
-  // Avg should be 10A (from last 10 samples), NOT mixed with 5A.
-  // Time to full: 50Ah / 10A = 5 hours.
-
-  res = adc.getAveragedRunFlatTime(10.0f, 10.0f, warning);
-  found = (res.find("5 hours") != std::string::npos);
-  msg = "Expected 5 hours, got: " + res;
-  TEST_ASSERT_TRUE_MESSAGE(found, msg.c_str());
+  // The estimate restarts instead of averaging the discharge in:
+  // ~50Ah to full / 7A = 7.14h
+  feedRunFlat(adc, -7000.0f, now_ms, 100);
+  res = adc.getAveragedRunFlatTime(10.0f, warning);
+  msg = "Expected 7h 8m until full, got: " + res;
+  TEST_ASSERT_TRUE_MESSAGE(res.find("7h 8m until full") != std::string::npos,
+                           msg.c_str());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 7.0f, adc.getRunFlatCurrent_A());
 }
 
 int main(int argc, char **argv) {
@@ -0,0 +1,184 @@
+#include "../../src/ina226_adc.cpp"
+#include "../../src/conversion_controller.cpp"
+#include "../../src/cycle_counter.cpp"
+#include "../../src/run_flat_estimator.cpp"
+#include "../../src/resistance_estimator.cpp"
+#include "../../src/latency_histogram.cpp"
+#include "../../src/soc_kalman_filter.cpp"
+#include "../../src/lifetime_counters.cpp"
+#include "../../src/streaming_stats.cpp"
+#include "../../src/ocv_table.cpp"
+#include "../../src/settings_store.cpp"
+#include "../lib/mocks/Arduino.cpp"
+#include "../lib/mocks/Arduino.h"
+#include "../lib/mocks/INA226_WE.cpp"
+#include "../lib/mocks/Preferences.cpp"
+#include "../lib/mocks/Wire.cpp"
+#include "../lib/mocks/driver/gpio.cpp"
+#include "ina226_adc.h"
+#include <unity.h>
+#include <chrono>
+
+// Writes a table in the per-point format used before tables became blobs
+static void writeLegacyTable(uint16_t shuntRatedA, const std::vector<CalPoint> &pts) {
+  Preferences prefs;
+  prefs.begin("ina_cal", false);
+  char key[20];
+  snprintf(key, sizeof(key), "n_%u", (unsigned)shuntRatedA);
+  prefs.putUInt(key, (uint32_t)pts.size());
+  for (size_t i = 0; i < pts.size(); i++) {
+    snprintf(key, sizeof(key), "r_%u_%u", (unsigned)shuntRatedA, (unsigned)i);
+    prefs.putFloat(key, pts[i].raw_mA);
+    snprintf(key, sizeof(key), "t_%u_%u", (unsigned)shuntRatedA, (unsigned)i);
+    prefs.putFloat(key, pts[i].true_mA);
+  }
+  prefs.end();
+}
+
+static std::vector<CalPoint> makeTable(size_t n) {
+  std::vector<CalPoint> pts;
+  for (size_t i = 0; i < n; i++) {
+    const float raw = 1000.0f * i;
+    pts.push_back({raw, raw * 1.01f + 3.0f});
+  }
+  return pts;
+}
+
+void setUp(void) {
+  Preferences::clear_static();
+  settings.invalidate();
+}
+
+void tearDown(void) {}
+
+void test_blob_round_trip(void) {
+  Preferences prefs;
+  const CalPoint pts[] = {{0.0f, 1.0f}, {100.0f, 99.0f}, {200.0f, 205.0f}};
+  TEST_ASSERT_TRUE((CalibrationBlob::write<CalPoint, 8>(prefs, "k", pts, 3)));
+  TEST_ASSERT_EQUAL(sizeof(CalibrationBlob::Header) + 3 * sizeof(CalPoint),
+                    prefs.getBytesLength("k"));
+
+  CalPoint out[8];
+  bool found = false;
+  TEST_ASSERT_EQUAL(3, (CalibrationBlob::read<CalPoint, 8>(prefs, "k", out, found)));
+  TEST_ASSERT_TRUE(found);
+  TEST_ASSERT_EQUAL_FLOAT(205.0f, out[2].true_mA);
+
+  // Too many points for the reader's capacity is rejected, not truncated
+  TEST_ASSERT_EQUAL(0, (CalibrationBlob::read<CalPoint, 2>(prefs, "k", out, found)));
+  TEST_ASSERT_TRUE(found);
+
+  TEST_ASSERT_EQUAL(0, (CalibrationBlob::read<CalPoint, 8>(prefs, "missing", out, found)));
+  TEST_ASSERT_FALSE(found);
+}
+
+void test_blob_rejects_corruption(void) {
+  Preferences prefs;
+  const CalPoint pts[] = {{0.0f, 1.0f}, {100.0f, 99.0f}};
+  CalibrationBlob::write<CalPoint, 8>(prefs, "k", pts, 2);
+
+  uint8_t bytes[64];
+  size_t len = prefs.getBytes("k", bytes, sizeof(bytes));
+  bytes[len - 1] ^= 0x01; // flip one bit of the last point
+  prefs.putBytes("k", bytes, len);
+
+  CalPoint out[8];
+  bool found = false;
+  TEST_ASSERT_EQUAL(0, (CalibrationBlob::read<CalPoint, 8>(prefs, "k", out, found)));
+  TEST_ASSERT_TRUE(found);
+
+  // A truncated blob is rejected too
+  prefs.putBytes("k", bytes, len - sizeof(CalPoint));
+  TEST_ASSERT_EQUAL(0, (CalibrationBlob::read<CalPoint, 8>(prefs, "k", out, found)));
+}
+
+void test_legacy_table_is_migrated(void) {
+  const std::vector<CalPoint> table = makeTable(20);
+  writeLegacyTable(100, table);
+
+  INA226_ADC adc(0x40, 0.001, 100.0f);
+  size_t count = 0;
+  TEST_ASSERT_TRUE(adc.hasStoredCalibrationTable(100, count));
+  TEST_ASSERT_EQUAL(20, count);
+
+  TEST_ASSERT_TRUE(adc.loadCalibrationTable(100));
+  TEST_ASSERT_EQUAL(20, adc.getCalibrationTable().size());
+  TEST_ASSERT_EQUAL_FLOAT(table[7].true_mA, adc.getCalibratedCurrent_mA(table[7].raw_mA));
+
+  // The per-point keys are gone and the blob is used from now on
+  Preferences prefs;
+  TEST_ASSERT_FALSE(prefs.isKey("n_100"));
+  TEST_ASSERT_FALSE(prefs.isKey("r_100_0"));
+  TEST_ASSERT_FALSE(prefs.isKey("t_100_19"));
+  TEST_ASSERT_TRUE(prefs.getBytesLength("cal_100") > 0);
+
+  INA226_ADC reloaded(0x40, 0.001, 100.0f);
+  TEST_ASSERT_TRUE(reloaded.loadCalibrationTable(100));
+  TEST_ASSERT_EQUAL(20, reloaded.getCalibrationTable().size());
+  TEST_ASSERT_TRUE(reloaded.hasStoredCalibrationTable(100, count));
+  TEST_ASSERT_EQUAL(20, count);
+
+  TEST_ASSERT_TRUE(reloaded.clearCalibrationTable(100));
+  TEST_ASSERT_FALSE(reloaded.hasStoredCalibrationTable(100, count));
+  TEST_ASSERT_FALSE(reloaded.loadCalibrationTable(100));
+}
+
+void test_save_replaces_legacy_keys(void) {
+  writeLegacyTable(200, makeTable(5));
+  INA226_ADC adc(0x40, 0.001, 100.0f);
+  TEST_ASSERT_TRUE(adc.saveCalibrationTable(200, makeTable(3)));
+
+  Preferences prefs;
+  TEST_ASSERT_FALSE(prefs.isKey("n_200"));
+  TEST_ASSERT_FALSE(prefs.isKey("r_200_4"));
+
+  INA226_ADC reloaded(0x40, 0.001, 100.0f);
+  TEST_ASSERT_TRUE(reloaded.loadCalibrationTable(200));
+  TEST_ASSERT_EQUAL(3, reloaded.getCalibrationTable().size());
+}
+
+void test_benchmark_boot_load(void) {
+  const std::vector<CalPoint> table = makeTable(20);
+  const int loads = 20000;
+  INA226_ADC adc(0x40, 0.001, 100.0f);
+
+  // Legacy layout, read the way loadCalibrationTable() used to
+  writeLegacyTable(100, table);
+  std::vector<CalPoint> pts;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < loads; i++) {
+    Preferences prefs;
+    prefs.begin("ina_cal", true);
+    readLegacyCalibrationTable(prefs, 100, pts);
+    prefs.end();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  TEST_ASSERT_TRUE(adc.loadCalibrationTable(100)); // migrates
+  auto t2 = std::chrono::steady_clock::now();
+  for (int i = 0; i < loads; i++) {
+    adc.loadCalibrationTable(100);
+  }
+  auto t3 = std::chrono::steady_clock::now();
+
+  const double legacyUs =
+      std::chrono::duration<double, std::micro>(t1 - t0).count() / loads;
+  const double blobUs =
+      std::chrono::duration<double, std::micro>(t3 - t2).count() / loads;
+  char msg[160];
+  snprintf(msg, sizeof(msg),
+           "20-point table load (host NVS mock): %u keys %.2f us, one blob %.2f us",
+           (unsigned)(2 * table.size() + 1), legacyUs, blobUs);
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_blob_round_trip);
+  RUN_TEST(test_blob_rejects_corruption);
+  RUN_TEST(test_legacy_table_is_migrated);
+  RUN_TEST(test_save_replaces_legacy_keys);
+  RUN_TEST(test_benchmark_boot_load);
+  UNITY_END();
+  return 0;
+}
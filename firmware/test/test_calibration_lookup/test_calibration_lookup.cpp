@@ -0,0 +1,155 @@
+#include "../../src/ina226_adc.cpp"
+#include "../../src/conversion_controller.cpp"
+#include "../../src/cycle_counter.cpp"
+#include "../../src/run_flat_estimator.cpp"
+#include "../../src/resistance_estimator.cpp"
+#include "../../src/latency_histogram.cpp"
+#include "../../src/soc_kalman_filter.cpp"
+#include "../../src/lifetime_counters.cpp"
+#include "../../src/streaming_stats.cpp"
+#include "../../src/ocv_table.cpp"
+#include "../../src/settings_store.cpp"
+#include "../lib/mocks/Arduino.cpp"
+#include "../lib/mocks/Arduino.h"
+#include "../lib/mocks/INA226_WE.cpp"
+#include "../lib/mocks/Preferences.cpp"
+#include "../lib/mocks/Wire.cpp"
+#include "../lib/mocks/driver/gpio.cpp"
+#include "ina226_adc.h"
+#include <unity.h>
+#include <chrono>
+
+// The linear-scan interpolation getCalibratedCurrent_mA() used before the
+// segment table, kept as the reference for equivalence and benchmarking.
+static float referenceCalibrated_mA(const std::vector<CalPoint> &table,
+                                    float raw_mA) {
+  if (table.size() < 2)
+    return raw_mA;
+
+  const bool is_negative = raw_mA < 0.0f;
+  const float abs_raw_mA = fabsf(raw_mA);
+  float calibrated_abs_mA;
+
+  if (abs_raw_mA <= table.front().raw_mA) {
+    calibrated_abs_mA = table.front().true_mA;
+  } else if (abs_raw_mA >= table.back().raw_mA) {
+    calibrated_abs_mA = table.back().true_mA;
+  } else {
+    calibrated_abs_mA = abs_raw_mA;
+    for (size_t i = 1; i < table.size(); ++i) {
+      if (abs_raw_mA < table[i].raw_mA) {
+        const float x0 = table[i - 1].raw_mA;
+        const float y0 = table[i - 1].true_mA;
+        const float x1 = table[i].raw_mA;
+        const float y1 = table[i].true_mA;
+        if (fabsf(x1 - x0) < 1e-9f) {
+          calibrated_abs_mA = y0;
+        } else {
+          calibrated_abs_mA = y0 + (abs_raw_mA - x0) * (y1 - y0) / (x1 - x0);
+        }
+        break;
+      }
+    }
+  }
+  return is_negative ? -calibrated_abs_mA : calibrated_abs_mA;
+}
+
+// A denser, mildly nonlinear table like a full bench calibration run
+static std::vector<CalPoint> makeBenchTable() {
+  std::vector<CalPoint> pts;
+  for (int i = 0; i < 24; i++) {
+    float raw = 50.0f + i * i * 350.0f;
+    pts.push_back({raw, raw * (1.0f + 0.0004f * i) + 12.0f});
+  }
+  return pts;
+}
+
+static void assertMatchesReference(INA226_ADC &adc) {
+  const std::vector<CalPoint> table = adc.getCalibrationTable();
+  TEST_ASSERT_TRUE(table.size() >= 2);
+
+  // Every breakpoint, its neighbours, both signs, and a fine sweep
+  std::vector<float> probes;
+  for (const CalPoint &p : table) {
+    probes.push_back(p.raw_mA);
+    probes.push_back(nextafterf(p.raw_mA, 0.0f));
+    probes.push_back(nextafterf(p.raw_mA, INFINITY));
+  }
+  const float top = table.back().raw_mA * 1.1f;
+  for (int i = 0; i <= 20000; i++) {
+    probes.push_back(top * i / 20000.0f);
+  }
+
+  for (float raw : probes) {
+    for (float x : {raw, -raw}) {
+      const float expected = referenceCalibrated_mA(table, x);
+      const float actual = adc.getCalibratedCurrent_mA(x);
+      // Same segment, same formula up to rounding of the slope
+      TEST_ASSERT_FLOAT_WITHIN(fabsf(expected) * 2e-6f + 1e-4f, expected, actual);
+    }
+  }
+}
+
+void setUp(void) {
+  Preferences::clear_static();
+  settings.invalidate();
+}
+
+void tearDown(void) {}
+
+void test_matches_reference_factory_table(void) {
+  INA226_ADC adc(0x40, 0.001, 100.0f);
+  TEST_ASSERT_TRUE(adc.saveCalibrationTable(200, std::vector<CalPoint>(std::begin(factory_cal_200A), std::end(factory_cal_200A))));
+  assertMatchesReference(adc);
+}
+
+void test_matches_reference_bench_table(void) {
+  INA226_ADC adc(0x40, 0.001, 100.0f);
+  TEST_ASSERT_TRUE(adc.saveCalibrationTable(100, makeBenchTable()));
+  assertMatchesReference(adc);
+
+  // Segments are rebuilt when the table is reloaded or cleared
+  INA226_ADC reloaded(0x40, 0.001, 100.0f);
+  TEST_ASSERT_TRUE(reloaded.loadCalibrationTable(100));
+  assertMatchesReference(reloaded);
+  reloaded.clearCalibrationTable(100);
+  TEST_ASSERT_EQUAL_FLOAT(1234.0f, reloaded.getCalibratedCurrent_mA(1234.0f));
+}
+
+void test_benchmark_lookup(void) {
+  INA226_ADC adc(0x40, 0.001, 100.0f);
+  adc.saveCalibrationTable(100, makeBenchTable());
+  const std::vector<CalPoint> table = adc.getCalibrationTable();
+  const float top = table.back().raw_mA;
+  const int calls = 2000000;
+
+  volatile float sink = 0.0f;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < calls; i++) {
+    sink = sink + referenceCalibrated_mA(table, top * (i % 1000) / 1000.0f);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < calls; i++) {
+    sink = sink + adc.getCalibratedCurrent_mA(top * (i % 1000) / 1000.0f);
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  const double refNs =
+      std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+  const double newNs =
+      std::chrono::duration<double, std::nano>(t2 - t1).count() / calls;
+  char msg[128];
+  snprintf(msg, sizeof(msg),
+           "Calibration lookup (%u points): linear scan %.1f ns, segments %.1f ns",
+           (unsigned)table.size(), refNs, newNs);
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_reference_factory_table);
+  RUN_TEST(test_matches_reference_bench_table);
+  RUN_TEST(test_benchmark_lookup);
+  UNITY_END();
+  return 0;
+}
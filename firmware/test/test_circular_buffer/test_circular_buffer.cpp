@@ -0,0 +1,162 @@
+#include <unity.h>
+
+#include "CircularBuffer.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../lib/mocks/Arduino.cpp"
+
+#include <chrono>
+#include <deque>
+#include <random>
+
+// Reference model: the plain ring the buffer replaced, summed from scratch
+template <typename T, size_t Size>
+struct NaiveRing {
+    std::deque<T> values;
+
+    void push(T v) {
+        values.push_back(v);
+        if (values.size() > Size) values.pop_front();
+    }
+    double sum() const {
+        double s = 0.0;
+        for (T v : values) s += v;
+        return s;
+    }
+    T min() const {
+        T m = values.empty() ? T(0) : values.front();
+        for (T v : values) if (v < m) m = v;
+        return m;
+    }
+    T max() const {
+        T m = values.empty() ? T(0) : values.front();
+        for (T v : values) if (v > m) m = v;
+        return m;
+    }
+};
+
+// Random push / snapshot-restore / clear sequence, checking every step
+template <size_t Size>
+static void checkRandomSequence(uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> value(-50.0f, 5000.0f);
+    std::uniform_int_distribution<int> op(0, 99);
+
+    CircularBuffer<float, Size, true> buf;
+    NaiveRing<float, Size> ref;
+    for (int step = 0; step < 20000; step++) {
+        const int o = op(rng);
+        if (o == 0) {
+            buf.clear();
+            ref.values.clear();
+        } else if (o < 3) {
+            // Round trip through the persistence accessors, as RTC memory does
+            float snapshot[Size];
+            memcpy(snapshot, buf.getBuffer(), sizeof(snapshot));
+            CircularBuffer<float, Size, true> restored;
+            restored.restore(snapshot, buf.getHead(), buf.getCount());
+            buf = restored;
+        } else {
+            const float v = value(rng);
+            buf.push(v);
+            ref.push(v);
+        }
+
+        TEST_ASSERT_EQUAL(ref.values.size(), buf.getCount());
+        const double expected = ref.sum();
+        TEST_ASSERT_FLOAT_WITHIN(1e-6 * (1.0 + fabs(expected)) * Size, (float)expected, buf.sum());
+        TEST_ASSERT_EQUAL_FLOAT(ref.min(), buf.min());
+        TEST_ASSERT_EQUAL_FLOAT(ref.max(), buf.max());
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_matches_naive_sum_power_of_two(void) {
+    checkRandomSequence<64>(1);
+    checkRandomSequence<1>(2);
+}
+
+void test_matches_naive_sum_other_sizes(void) {
+    checkRandomSequence<60>(3);
+    checkRandomSequence<24>(4);
+    checkRandomSequence<7>(5);
+}
+
+void test_integer_sum_and_wrap(void) {
+    CircularBuffer<uint32_t, 8> buf;
+    for (uint32_t i = 1; i <= 20; i++) {
+        buf.push(i);
+    }
+    TEST_ASSERT_EQUAL(8, buf.getCount());
+    TEST_ASSERT_EQUAL(4, buf.getHead());
+    TEST_ASSERT_EQUAL_UINT32(13 + 14 + 15 + 16 + 17 + 18 + 19 + 20, buf.sum());
+}
+
+void test_compensated_sum_does_not_drift(void) {
+    // Small per-minute energies on top of a large one, for a simulated year
+    CircularBuffer<float, 60> buf;
+    NaiveRing<float, 60> ref;
+    for (int minute = 0; minute < 365 * 24 * 60; minute++) {
+        const float v = (minute % 997 == 0) ? 360000.0f : 0.1f + (minute % 13) * 0.01f;
+        buf.push(v);
+        ref.push(v);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, (float)ref.sum(), buf.sum());
+}
+
+void test_restore_sanitises_unwrapped_head(void) {
+    float stored[24] = {1.0f, 2.0f, 3.0f, 99.0f, 99.0f};
+    CircularBuffer<float, 24, true> buf;
+    buf.restore(stored, 17, 3); // head that push() could never have produced
+    TEST_ASSERT_EQUAL(3, buf.getHead());
+    TEST_ASSERT_EQUAL_FLOAT(6.0f, buf.sum());
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, buf.max());
+    buf.push(4.0f);
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, buf.sum());
+    TEST_ASSERT_EQUAL_FLOAT(4.0f, buf.getBuffer()[3]);
+}
+
+void test_benchmark_sum(void) {
+    CircularBuffer<float, 60> buf;
+    float naive[60];
+    for (int i = 0; i < 60; i++) {
+        buf.push(i * 1.5f);
+        naive[i] = i * 1.5f;
+    }
+    const int calls = 1000000;
+    volatile float sink = 0.0f;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int c = 0; c < calls; c++) {
+        float total = 0;
+        for (int i = 0; i < 60; i++) total += naive[i];
+        sink = sink + total;
+        naive[c % 60] += 0.0f * sink;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int c = 0; c < calls; c++) {
+        sink = sink + buf.sum();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "host: 60-slot sum() scan %.2f ns, running %.2f ns",
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / calls,
+             std::chrono::duration<double, std::nano>(t2 - t1).count() / calls);
+    TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_naive_sum_power_of_two);
+    RUN_TEST(test_matches_naive_sum_other_sizes);
+    RUN_TEST(test_integer_sum_and_wrap);
+    RUN_TEST(test_compensated_sum_does_not_drift);
+    RUN_TEST(test_restore_sanitises_unwrapped_head);
+    RUN_TEST(test_benchmark_sum);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <unity.h>
+
+#include "conversion_controller.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/conversion_controller.cpp"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Feed a constant current at a fixed period and return the final profile
+static void feed(ConversionController &ctl, float currentA, int64_t &t_us,
+                 int64_t period_us, int count) {
+    for (int i = 0; i < count; i++) {
+        t_us += period_us;
+        ctl.update(currentA, t_us);
+    }
+}
+
+void test_starts_at_rest_and_stays_when_idle(void) {
+    ConversionController ctl;
+    int64_t t = 0;
+    feed(ctl, 0.2f, t, 264000, 100);
+    TEST_ASSERT_EQUAL(PROFILE_REST, ctl.getProfile());
+    TEST_ASSERT_EQUAL_UINT32(0, ctl.getSwitchCount());
+}
+
+void test_load_step_switches_to_fast_immediately(void) {
+    ConversionController ctl;
+    int64_t t = 0;
+    feed(ctl, 0.2f, t, 264000, 10);
+
+    t += 264000;
+    TEST_ASSERT_TRUE(ctl.update(-40.0f, t)); // 40 A load switched on
+    TEST_ASSERT_EQUAL(PROFILE_FAST, ctl.getProfile());
+}
+
+void test_steps_back_down_one_level_after_dwell(void) {
+    ConversionController ctl;
+    int64_t t = 0;
+    feed(ctl, 0.0f, t, 264000, 5);
+    t += 264000;
+    const int64_t stepAt = t;
+    ctl.update(-40.0f, t);
+    TEST_ASSERT_EQUAL(PROFILE_FAST, ctl.getProfile());
+
+    // Steady load afterwards: FAST -> ACTIVE -> REST, one level at a time
+    int64_t activeAt = -1;
+    int64_t restAt = -1;
+    while (t - stepAt < 60000000 && restAt < 0) {
+        t += 8800;
+        ctl.update(-40.0f, t);
+        if (ctl.getProfile() == PROFILE_ACTIVE && activeAt < 0) activeAt = t;
+        if (ctl.getProfile() == PROFILE_REST) restAt = t;
+    }
+    TEST_ASSERT_TRUE(activeAt > 0);
+    TEST_ASSERT_TRUE(restAt > activeAt);
+    // Never before the fast hold plus one dwell period
+    TEST_ASSERT_GREATER_OR_EQUAL(7000000, activeAt - stepAt);
+    TEST_ASSERT_GREATER_OR_EQUAL(5000000, restAt - activeAt);
+    TEST_ASSERT_EQUAL_UINT32(3, ctl.getSwitchCount());
+}
+
+void test_noisy_current_keeps_active_profile(void) {
+    ConversionController ctl;
+    int64_t t = 0;
+    // +/-1 A ripple, below the step threshold but well above activeStdDevA
+    for (int i = 0; i < 400; i++) {
+        t += 35200;
+        ctl.update((i & 1) ? -6.0f : -4.5f, t);
+    }
+    TEST_ASSERT_EQUAL(PROFILE_ACTIVE, ctl.getProfile());
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.75f, ctl.getStdDev_A());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_starts_at_rest_and_stays_when_idle);
+    RUN_TEST(test_load_step_switches_to_fast_immediately);
+    RUN_TEST(test_steps_back_down_one_level_after_dwell);
+    RUN_TEST(test_noisy_current_keeps_active_profile);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <unity.h>
+
+#include "cycle_counter.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/cycle_counter.cpp"
+#include "../lib/mocks/Preferences.cpp"
+
+static constexpr int64_t ONE_AH_PC = 3600LL * 1000000 * 1000000;
+
+void setUp(void) {
+    Preferences::clear_static();
+}
+
+void tearDown(void) {}
+
+// Walk the SOC from one value to another in 0.1 % steps
+static void ramp(CycleCounter &cc, int from_tenths, int to_tenths) {
+    const int step = to_tenths > from_tenths ? 1 : -1;
+    for (int s = from_tenths; s != to_tenths + step; s += step) {
+        cc.addSoc(s / 10.0f);
+    }
+}
+
+void test_nested_cycle_is_counted_first(void) {
+    CycleCounter cc;
+    // Turning points 50, 90, 70, 80, 10: the 70-80 cycle closes inside the
+    // 90-10 swing, then 50-90 is left as a half cycle
+    ramp(cc, 500, 900);
+    ramp(cc, 900, 700);
+    ramp(cc, 700, 800);
+    ramp(cc, 800, 100);
+    ramp(cc, 100, 200);
+
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, cc.getCycles(1));
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, cc.getCycles(4));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, cc.getCycles(8));
+    // 20 + 40 closed, 80 + 10 of residue: 150 % of travel
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.75f, cc.getEquivalentCycles());
+}
+
+void test_deep_cycles_add_up(void) {
+    CycleCounter cc;
+    for (int i = 0; i < 5; i++) {
+        ramp(cc, 1000, 0);
+        ramp(cc, 0, 1000);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 5.0f, cc.getEquivalentCycles());
+    TEST_ASSERT_TRUE(cc.getCycles(9) >= 4.0f);
+}
+
+void test_noise_inside_hysteresis_is_not_a_cycle(void) {
+    CycleCounter cc;
+    for (int i = 0; i < 10000; i++) {
+        cc.addSoc((i & 1) ? 50.4f : 49.7f);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, cc.getEquivalentCycles());
+    for (size_t b = 0; b < CycleCounter::DEPTH_BINS; b++) {
+        TEST_ASSERT_EQUAL_FLOAT(0.0f, cc.getCycles(b));
+    }
+}
+
+void test_residue_stays_bounded(void) {
+    CycleCounter cc;
+    // Converging swings never close a cycle and pile up in the residue
+    float travel = 0.0f;
+    float last = 0.0f;
+    cc.addSoc(0.0f);
+    for (int k = 0; k < 45; k++) {
+        const float hi = 100.0f - k;
+        const float lo = (float)k + 1.0f;
+        cc.addSoc(hi);
+        cc.addSoc(lo);
+        travel += (hi - last) + (hi - lo);
+        last = lo;
+    }
+    TEST_ASSERT_TRUE(cc.getState().residueCount <= CycleCounter::MAX_REVERSALS);
+    // Dropped ranges are still counted, as half cycles
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, travel / 200.0f, cc.getEquivalentCycles());
+}
+
+void test_capacity_from_full_to_empty(void) {
+    CycleCounter cc;
+    TEST_ASSERT_TRUE(isnan(cc.getStateOfHealth_percent(100.0f)));
+    // Empty without a full sync first says nothing
+    TEST_ASSERT_FALSE(cc.markEmpty(100.0f));
+
+    cc.markFull();
+    for (int i = 0; i < 900; i++) {
+        cc.addCharge(-ONE_AH_PC / 10);
+    }
+    TEST_ASSERT_TRUE(cc.markEmpty(100.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 90.0f, cc.getCapacity_Ah());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 90.0f, cc.getStateOfHealth_percent(100.0f));
+
+    // A partial recharge on the way down is netted out
+    cc.markFull();
+    cc.addCharge(-50 * ONE_AH_PC);
+    cc.addCharge(10 * ONE_AH_PC);
+    cc.addCharge(-40 * ONE_AH_PC);
+    TEST_ASSERT_TRUE(cc.markEmpty(100.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 80.0f, cc.getLastMeasured_Ah());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 87.0f, cc.getCapacity_Ah());
+
+    // Implausible measurement (sag under load) is rejected
+    cc.markFull();
+    cc.addCharge(-10 * ONE_AH_PC);
+    TEST_ASSERT_TRUE(cc.markEmpty(100.0f));
+    TEST_ASSERT_EQUAL_UINT32(2, cc.getCapacityMeasurements());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 87.0f, cc.getCapacity_Ah());
+    // Charge is only collected while armed
+    cc.addCharge(-90 * ONE_AH_PC);
+    TEST_ASSERT_FALSE(cc.markEmpty(100.0f));
+}
+
+void test_blob_round_trip_and_corruption(void) {
+    CycleCounter cc;
+    ramp(cc, 800, 200);
+    ramp(cc, 200, 600);
+    cc.markFull();
+    cc.addCharge(-5 * ONE_AH_PC);
+
+    Preferences prefs;
+    prefs.begin("storage", false);
+    TEST_ASSERT_TRUE(CycleCounter::write(prefs, "cycles", cc.getState()));
+
+    CycleCounter restored;
+    CycleCounter::State s;
+    TEST_ASSERT_TRUE(CycleCounter::read(prefs, "cycles", s));
+    restored.restore(s);
+    TEST_ASSERT_EQUAL_FLOAT(cc.getEquivalentCycles(), restored.getEquivalentCycles());
+    // The pending capacity measurement carries on after the restore
+    restored.addCharge(-65 * ONE_AH_PC);
+    TEST_ASSERT_TRUE(restored.markEmpty(100.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 70.0f, restored.getCapacity_Ah());
+
+    uint8_t raw[512];
+    const size_t len = prefs.getBytes("cycles", raw, sizeof(raw));
+    raw[len / 2] ^= 0x40;
+    prefs.putBytes("cycles", raw, len);
+    TEST_ASSERT_FALSE(CycleCounter::read(prefs, "cycles", s));
+    prefs.end();
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_nested_cycle_is_counted_first);
+    RUN_TEST(test_deep_cycles_add_up);
+    RUN_TEST(test_noise_inside_hysteresis_is_not_a_cycle);
+    RUN_TEST(test_residue_stays_bounded);
+    RUN_TEST(test_capacity_from_full_to_empty);
+    RUN_TEST(test_blob_round_trip_and_corruption);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+
+#include "DecimationFilter.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_output_rate_follows_decimation(void) {
+    DecimationFilter filter(8);
+    int32_t out = 0;
+    int outputs = 0;
+    for (int i = 0; i < 80; i++) {
+        if (filter.push(100, out)) {
+            outputs++;
+            TEST_ASSERT_EQUAL(100 << DecimationFilter::FRAC_BITS, out);
+        }
+    }
+    TEST_ASSERT_EQUAL(10, outputs);
+
+    filter.setDecimation(200); // clamped
+    TEST_ASSERT_EQUAL(DecimationFilter::MAX_DECIMATION, filter.getDecimation());
+    filter.setDecimation(0);
+    TEST_ASSERT_EQUAL(1, filter.getDecimation());
+}
+
+void test_sub_lsb_resolution(void) {
+    // A true value of 3.25 counts dithered by noise reads as 3 or 4; the
+    // filtered output recovers the fraction.
+    DecimationFilter filter(16);
+    int32_t out = 0;
+    const int32_t pattern[4] = {3, 3, 4, 3};
+    for (int i = 0; i < 16 * 10; i++) {
+        filter.push(pattern[i % 4], out);
+    }
+    TEST_ASSERT_EQUAL((int32_t)(3.25f * (1 << DecimationFilter::FRAC_BITS)), out);
+}
+
+void test_fir_smooths_decimated_noise(void) {
+    // Alternating boxcar outputs of +-64 counts are the FIR's Nyquist
+    // frequency, where the binomial kernel has a zero.
+    DecimationFilter filter(1);
+    int32_t out = 0;
+    for (int i = 0; i < 20; i++) {
+        filter.push((i & 1) ? 64 : -64, out);
+    }
+    TEST_ASSERT_EQUAL(0, out);
+}
+
+void test_negative_input(void) {
+    DecimationFilter filter(4);
+    int32_t out = 0;
+    for (int i = 0; i < 40; i++) {
+        filter.push(-1200, out);
+    }
+    TEST_ASSERT_EQUAL(-1200 * (1 << DecimationFilter::FRAC_BITS), out);
+}
+
+void test_benchmark_cost_per_sample(void) {
+    DecimationFilter filter(16);
+    int32_t out = 0;
+    int64_t checksum = 0;
+    const uint32_t samples = 4000000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < samples; i++) {
+        if (filter.push((int32_t)((i * 7919u) & 0x3FF), out)) {
+            checksum += out;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double nsPerSample =
+        std::chrono::duration<double, std::nano>(elapsed).count() / samples;
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "DecimationFilter /16: %.2f ns per input sample (checksum %lld)",
+             nsPerSample, (long long)checksum);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(nsPerSample < 1000.0);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_output_rate_follows_decimation);
+    RUN_TEST(test_sub_lsb_resolution);
+    RUN_TEST(test_fir_smooths_decimated_noise);
+    RUN_TEST(test_negative_input);
+    RUN_TEST(test_benchmark_cost_per_sample);
+    UNITY_END();
+    return 0;
+}
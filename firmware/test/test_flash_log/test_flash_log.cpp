@@ -0,0 +1,196 @@
+#include <unity.h>
+
+#include "flash_log.h"
+#include "MockPageStore.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/flash_log.cpp"
+
+#include <vector>
+
+static FlashLog::Record makeRecord(uint32_t t, int i) {
+    FlashLog::Record r;
+    r.time_s = t;
+    for (size_t f = 0; f < FlashLog::FIELD_COUNT; f++) {
+        // Slowly drifting values with some noise, like minute summaries
+        r.field[f] = (int16_t)(6400 + (int)f * 100 + (i / 10) + ((i * 7 + (int)f) % 5) - 2);
+    }
+    r.field[FlashLog::CURRENT_MIN] = (int16_t)(-250 - (i % 40) * 3);
+    return r;
+}
+
+static std::vector<FlashLog::Record> collect(const FlashLog& log, uint32_t from, uint32_t to) {
+    std::vector<FlashLog::Record> out;
+    log.query(from, to, [&](const FlashLog::Record& r) {
+        out.push_back(r);
+        return true;
+    });
+    return out;
+}
+
+static void assertSame(const FlashLog::Record& a, const FlashLog::Record& b) {
+    TEST_ASSERT_EQUAL_UINT32(a.time_s, b.time_s);
+    TEST_ASSERT_EQUAL_MEMORY(a.field, b.field, sizeof(a.field));
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_round_trip_and_compression(void) {
+    MockPageStore flash(16, 4096);
+    FlashLog log(flash);
+    TEST_ASSERT_TRUE(log.begin());
+    TEST_ASSERT_TRUE(log.isEmpty());
+
+    const int minutes = 2000;
+    for (int i = 0; i < minutes; i++) {
+        TEST_ASSERT_TRUE(log.append(makeRecord(1700000000 + i * 60, i)));
+    }
+    std::vector<FlashLog::Record> all = collect(log, 0, UINT32_MAX);
+    TEST_ASSERT_EQUAL(minutes, all.size());
+    for (int i = 0; i < minutes; i++) {
+        assertSame(makeRecord(1700000000 + i * 60, i), all[i]);
+    }
+
+    // 8 int16 fields + time would be 20 bytes raw
+    const size_t bytes = log.getUsedPages() * flash.pageSize();
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%d minutes in %u pages (%.1f bytes/record incl. page slack)",
+             minutes, (unsigned)log.getUsedPages(), (double)bytes / minutes);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(bytes / minutes < 16);
+}
+
+void test_range_query_skips_pages(void) {
+    MockPageStore flash(32, 1024);
+    FlashLog log(flash);
+    log.begin();
+    for (int i = 0; i < 1500; i++) {
+        log.append(makeRecord(1000 + i * 60, i));
+    }
+
+    const uint32_t from = 1000 + 700 * 60;
+    const uint32_t to = 1000 + 709 * 60;
+    flash.reads = 0;
+    std::vector<FlashLog::Record> range = collect(log, from, to);
+    TEST_ASSERT_EQUAL(10, range.size());
+    assertSame(makeRecord(from, 700), range.front());
+    assertSame(makeRecord(to, 709), range.back());
+    // Page headers plus a couple of pages' worth of windows, not the whole log
+    TEST_ASSERT_TRUE(flash.reads < flash.pageCount() + 40);
+
+    // Stopping early
+    size_t seen = 0;
+    TEST_ASSERT_EQUAL(3, log.query(from, to, [&](const FlashLog::Record&) { return ++seen < 3; }));
+
+    TEST_ASSERT_EQUAL(0, collect(log, 0, 999).size());
+    TEST_ASSERT_EQUAL(0, collect(log, to, from).size());
+}
+
+void test_ring_rotation_wears_pages_evenly(void) {
+    MockPageStore flash(8, 512);
+    FlashLog log(flash);
+    log.begin();
+    const int records = 5000;
+    for (int i = 0; i < records; i++) {
+        log.append(makeRecord(i * 60, i));
+    }
+    uint32_t lo = UINT32_MAX, hi = 0;
+    for (size_t p = 0; p < flash.pageCount(); p++) {
+        if (flash.eraseCount(p) < lo) lo = flash.eraseCount(p);
+        if (flash.eraseCount(p) > hi) hi = flash.eraseCount(p);
+    }
+    TEST_ASSERT_TRUE(hi - lo <= 1);
+    TEST_ASSERT_EQUAL_UINT32(hi, log.getMaxEraseCount());
+
+    // Only the newest pages survive, and every one of them decodes on its own
+    std::vector<FlashLog::Record> all = collect(log, 0, UINT32_MAX);
+    TEST_ASSERT_TRUE(all.size() > 0);
+    assertSame(makeRecord((records - 1) * 60, records - 1), all.back());
+    const int first = (int)(all.front().time_s / 60);
+    for (size_t i = 0; i < all.size(); i++) {
+        assertSame(makeRecord((first + i) * 60, first + (int)i), all[i]);
+    }
+}
+
+void test_resume_after_reset(void) {
+    MockPageStore flash(8, 1024);
+    {
+        FlashLog log(flash);
+        log.begin();
+        for (int i = 0; i < 300; i++) {
+            log.append(makeRecord(i * 60, i));
+        }
+    }
+    FlashLog log(flash);
+    TEST_ASSERT_TRUE(log.begin());
+    TEST_ASSERT_EQUAL_UINT32(299 * 60, log.getLastTime_s());
+    for (int i = 300; i < 400; i++) {
+        log.append(makeRecord(i * 60, i));
+    }
+    std::vector<FlashLog::Record> all = collect(log, 0, UINT32_MAX);
+    TEST_ASSERT_EQUAL(400, all.size());
+    assertSame(makeRecord(300 * 60, 300), all[300]);
+}
+
+void test_torn_record_is_dropped(void) {
+    MockPageStore flash(8, 1024);
+    size_t tornOffset;
+    {
+        FlashLog log(flash);
+        log.begin();
+        for (int i = 0; i < 20; i++) {
+            log.append(makeRecord(i * 60, i));
+        }
+        // Find the end of the data and fake a half-written record there
+        std::vector<uint8_t> page(1024);
+        flash.read(0, 0, page.data(), page.size());
+        tornOffset = 1024;
+        while (tornOffset > 0 && page[tornOffset - 1] == 0xFF) tornOffset--;
+        flash.corrupt(0, tornOffset, 10);   // length byte
+        flash.corrupt(0, tornOffset + 1, 0x44);
+    }
+
+    FlashLog log(flash);
+    TEST_ASSERT_TRUE(log.begin());
+    TEST_ASSERT_EQUAL_UINT32(19 * 60, log.getLastTime_s());
+    TEST_ASSERT_TRUE(log.append(makeRecord(20 * 60, 20)));
+
+    // The torn page is closed; the new record went to the next page
+    std::vector<FlashLog::Record> all = collect(log, 0, UINT32_MAX);
+    TEST_ASSERT_EQUAL(21, all.size());
+    assertSame(makeRecord(20 * 60, 20), all.back());
+    TEST_ASSERT_EQUAL(2, log.getUsedPages());
+}
+
+void test_time_is_clamped_and_clear(void) {
+    MockPageStore flash(4, 512);
+    FlashLog log(flash);
+    log.begin();
+    log.append(makeRecord(1000, 0));
+    log.append(makeRecord(900, 1)); // clock stepped back
+    std::vector<FlashLog::Record> all = collect(log, 0, UINT32_MAX);
+    TEST_ASSERT_EQUAL(2, all.size());
+    TEST_ASSERT_EQUAL_UINT32(1000, all[1].time_s);
+
+    log.clear();
+    TEST_ASSERT_TRUE(log.isEmpty());
+    TEST_ASSERT_EQUAL(0, collect(log, 0, UINT32_MAX).size());
+    log.append(makeRecord(5, 0));
+    FlashLog reopened(flash);
+    reopened.begin();
+    TEST_ASSERT_EQUAL(1, collect(reopened, 0, UINT32_MAX).size());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_and_compression);
+    RUN_TEST(test_range_query_skips_pages);
+    RUN_TEST(test_ring_rotation_wears_pages_evenly);
+    RUN_TEST(test_resume_after_reset);
+    RUN_TEST(test_torn_record_is_dropped);
+    RUN_TEST(test_time_is_clamped_and_clear);
+    UNITY_END();
+    return 0;
+}
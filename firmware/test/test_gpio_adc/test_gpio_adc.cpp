@@ -0,0 +1,178 @@
+#include <unity.h>
+
+#include "gpio_adc.h"
+#include "MockAdcBackend.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/gpio_adc.cpp"
+#include "../lib/mocks/Arduino.cpp"
+#include "../lib/mocks/Preferences.cpp"
+
+#include <chrono>
+
+void setUp(void) {
+    Preferences::clear_static();
+}
+
+void tearDown(void) {}
+
+void test_average_over_window(void) {
+    MockAdcBackend backend;
+    GPIO_ADC adc(3, &backend);
+    adc.begin();
+    TEST_ASSERT_EQUAL(3, backend.pin);
+
+    // Nothing converted yet
+    adc.update();
+    TEST_ASSERT_EQUAL(-1, adc.getAverageRaw());
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, adc.readVoltage());
+
+    // Noise around the 12 V point of the default table averages out
+    for (int i = 0; i < 100; i++) {
+        backend.push(2625 + ((i % 2) ? 20 : -20));
+    }
+    adc.update();
+    TEST_ASSERT_EQUAL(0, backend.available());
+    TEST_ASSERT_EQUAL(2625, adc.getAverageRaw());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.0f, adc.readVoltage());
+}
+
+void test_window_evicts_old_samples(void) {
+    MockAdcBackend backend;
+    GPIO_ADC adc(3, &backend);
+    adc.begin();
+
+    backend.push(2182, GPIO_ADC::AVG_SAMPLES);
+    adc.update();
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 10.0f, adc.readVoltage());
+
+    // Half a window later the mean is halfway between the two levels
+    backend.push(2748, GPIO_ADC::AVG_SAMPLES / 2);
+    adc.update();
+    TEST_ASSERT_EQUAL(2465, adc.getAverageRaw());
+
+    // A full window later the old level is gone entirely
+    backend.push(2748, GPIO_ADC::AVG_SAMPLES / 2 + 7);
+    adc.update();
+    TEST_ASSERT_EQUAL(2748, adc.getAverageRaw());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.5f, adc.readVoltage());
+}
+
+void test_interpolates_between_points(void) {
+    MockAdcBackend backend;
+    GPIO_ADC adc(3, &backend);
+    adc.begin();
+
+    // Midway between {2625, 12.0} and {2748, 12.5}
+    backend.push(2686, 128);
+    backend.push(2687, 128);
+    adc.update();
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 12.25f, adc.readVoltage());
+
+    // Clamped outside the table
+    adc.clearAverage();
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, adc.readVoltage());
+    backend.push(4000, 10);
+    adc.update();
+    TEST_ASSERT_EQUAL_FLOAT(15.0f, adc.readVoltage());
+}
+
+void test_update_without_samples_keeps_reading(void) {
+    MockAdcBackend backend;
+    GPIO_ADC adc(3, &backend);
+    adc.begin();
+
+    backend.push(3055, 50);
+    adc.update();
+    adc.update();
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 14.0f, adc.readVoltage());
+    TEST_ASSERT_EQUAL(3055, adc.getAverageRaw());
+}
+
+void test_clear_discards_queued_samples(void) {
+    MockAdcBackend backend;
+    GPIO_ADC adc(3, &backend);
+    adc.begin();
+
+    // Conversions taken at the previous step, not yet read by update()
+    backend.push(2182, 200);
+    adc.clearAverage();
+    backend.push(3055, 8);
+    adc.update();
+    TEST_ASSERT_EQUAL_INT(3055, adc.getAverageRaw());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 14.0f, adc.readVoltage());
+}
+
+void test_calibrate_refreshes_cached_voltage(void) {
+    MockAdcBackend backend;
+    GPIO_ADC adc(3, &backend);
+    adc.begin();
+
+    backend.push(2000, 20);
+    adc.update();
+    adc.calibrate({{1000, 5.0f}, {3000, 15.0f}});
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 10.0f, adc.readVoltage());
+
+    // The new table was stored and is used after a reboot
+    MockAdcBackend backend2;
+    GPIO_ADC reloaded(3, &backend2);
+    reloaded.begin();
+    backend2.push(2000, 20);
+    reloaded.update();
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 10.0f, reloaded.readVoltage());
+}
+
+void test_falls_back_to_analog_read(void) {
+    MockAdcBackend backend;
+    backend.beginResult = false;
+    GPIO_ADC adc(3, &backend);
+    adc.begin();
+
+    backend.push(2182, 10);
+    adc.update();
+    TEST_ASSERT_EQUAL(10, backend.available()); // no longer drained
+
+    set_mock_analog_read(3, 2625);
+    TEST_ASSERT_EQUAL(2625, adc.getAverageRaw());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.0f, adc.readVoltage());
+}
+
+void test_benchmark_read_voltage(void) {
+    MockAdcBackend backend;
+    GPIO_ADC adc(3, &backend);
+    adc.begin();
+    const int reads = 1000000;
+
+    // Backend path: the 256 samples are folded in once per update()
+    backend.push(2748, GPIO_ADC::AVG_SAMPLES);
+    auto t0 = std::chrono::steady_clock::now();
+    adc.update();
+    auto t1 = std::chrono::steady_clock::now();
+    volatile float sink = 0.0f;
+    for (int i = 0; i < reads; i++) {
+        sink = sink + adc.readVoltage();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    const double updateUs = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    const double readNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / reads;
+    char msg[160];
+    snprintf(msg, sizeof(msg),
+             "host: update() of %u samples %.2f us, readVoltage() %.2f ns",
+             (unsigned)GPIO_ADC::AVG_SAMPLES, updateUs, readNs);
+    TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_average_over_window);
+    RUN_TEST(test_window_evicts_old_samples);
+    RUN_TEST(test_interpolates_between_points);
+    RUN_TEST(test_update_without_samples_keeps_reading);
+    RUN_TEST(test_clear_discards_queued_samples);
+    RUN_TEST(test_calibrate_refreshes_cached_voltage);
+    RUN_TEST(test_falls_back_to_analog_read);
+    RUN_TEST(test_benchmark_read_voltage);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <unity.h>
+
+#include "history_store.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/history_store.cpp"
+
+#include <chrono>
+
+static SensorSample makeSample(int64_t t_us, float voltage_V, float current_mA) {
+    SensorSample s = {};
+    s.timestamp_us = t_us;
+    s.busVoltage_V = voltage_V;
+    s.current_mA = current_mA;
+    s.power_mW = voltage_V * current_mA;
+    return s;
+}
+
+static float mean(const HistoryStore::Bucket& b, HistoryStore::Channel ch) {
+    return HistoryStore::decode(ch, b.channel[ch].mean);
+}
+
+static HistoryStore history;
+
+void setUp(void) {
+    history.clear();
+}
+
+void tearDown(void) {}
+
+void test_second_buckets_hold_min_max_mean(void) {
+    // 10 samples per second for 3 seconds
+    for (int i = 0; i < 30; i++) {
+        const int64_t t = i * 100000LL;
+        history.record(makeSample(t, 12.0f + 0.01f * (i % 10), -1000.0f * (i / 10 + 1)), 80.0f);
+    }
+    // The third second is still open
+    TEST_ASSERT_EQUAL(2, history.size(HistoryStore::TIER_SECOND));
+    TEST_ASSERT_EQUAL(1, history.getNewestPeriod(HistoryStore::TIER_SECOND));
+
+    const HistoryStore::Bucket& b = history.at(HistoryStore::TIER_SECOND, 1);
+    TEST_ASSERT_EQUAL_UINT32(10, b.samples);
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 12.0f,
+                             HistoryStore::decode(HistoryStore::CH_VOLTAGE, b.channel[0].min));
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 12.09f,
+                             HistoryStore::decode(HistoryStore::CH_VOLTAGE, b.channel[0].max));
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 12.045f, mean(b, HistoryStore::CH_VOLTAGE));
+    TEST_ASSERT_FLOAT_WITHIN(20.0f, -2000.0f, mean(b, HistoryStore::CH_CURRENT));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 80.0f, mean(b, HistoryStore::CH_SOC));
+}
+
+void test_upper_tiers_are_sample_weighted(void) {
+    // First minute: 1 sample/s at 2 A; second minute: 10 samples/s at 4 A
+    for (int s = 0; s < 60; s++) {
+        history.record(makeSample(s * 1000000LL, 12.5f, 2000.0f), 50.0f);
+    }
+    for (int i = 0; i < 600; i++) {
+        history.record(makeSample(60000000LL + i * 100000LL, 12.5f, 4000.0f), 50.0f);
+    }
+    // Crossing into the third minute closes the second
+    history.record(makeSample(120000000LL, 12.5f, 0.0f), 50.0f);
+
+    TEST_ASSERT_EQUAL(2, history.size(HistoryStore::TIER_MINUTE));
+    TEST_ASSERT_EQUAL_UINT32(60, history.at(HistoryStore::TIER_MINUTE, 0).samples);
+    TEST_ASSERT_EQUAL_UINT32(600, history.at(HistoryStore::TIER_MINUTE, 1).samples);
+    TEST_ASSERT_FLOAT_WITHIN(20.0f, 4000.0f,
+                             mean(history.at(HistoryStore::TIER_MINUTE, 1), HistoryStore::CH_CURRENT));
+
+    // Close the hour: its mean weights the 600 samples over the 60
+    history.record(makeSample(3600000000LL, 12.5f, 0.0f), 50.0f);
+    TEST_ASSERT_EQUAL(1, history.size(HistoryStore::TIER_HOUR));
+    const HistoryStore::Bucket& hour = history.at(HistoryStore::TIER_HOUR, 0);
+    TEST_ASSERT_EQUAL_UINT32(661, hour.samples);
+    const float expected = (60 * 2000.0f + 600 * 4000.0f) / 661.0f;
+    TEST_ASSERT_FLOAT_WITHIN(20.0f, expected, mean(hour, HistoryStore::CH_CURRENT));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f,
+                             HistoryStore::decode(HistoryStore::CH_CURRENT, hour.channel[1].min));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 4000.0f,
+                             HistoryStore::decode(HistoryStore::CH_CURRENT, hour.channel[1].max));
+}
+
+void test_gaps_are_stored_as_empty_buckets(void) {
+    history.record(makeSample(0, 12.0f, 0.0f), 50.0f);
+    history.record(makeSample(5000000LL, 12.0f, 0.0f), 50.0f); // 4 s without samples
+    history.record(makeSample(6000000LL, 12.0f, 0.0f), 50.0f);
+
+    TEST_ASSERT_EQUAL(6, history.size(HistoryStore::TIER_SECOND));
+    TEST_ASSERT_EQUAL(5, history.getNewestPeriod(HistoryStore::TIER_SECOND));
+    TEST_ASSERT_EQUAL_UINT32(1, history.at(HistoryStore::TIER_SECOND, 0).samples);
+    for (size_t i = 1; i < 5; i++) {
+        TEST_ASSERT_EQUAL_UINT32(0, history.at(HistoryStore::TIER_SECOND, i).samples);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, history.at(HistoryStore::TIER_SECOND, 5).samples);
+}
+
+void test_rings_keep_the_newest_buckets(void) {
+    const size_t seconds = HistoryStore::SECOND_BUCKETS * 3 + 7;
+    for (size_t s = 0; s <= seconds; s++) {
+        history.record(makeSample(s * 1000000LL, 10.0f + 0.001f * s, 0.0f), 50.0f);
+    }
+    TEST_ASSERT_EQUAL(HistoryStore::SECOND_BUCKETS, history.size(HistoryStore::TIER_SECOND));
+    const HistoryStore::Bucket& oldest = history.at(HistoryStore::TIER_SECOND, 0);
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 10.0f + 0.001f * (seconds - HistoryStore::SECOND_BUCKETS),
+                             mean(oldest, HistoryStore::CH_VOLTAGE));
+    TEST_ASSERT_EQUAL(seconds / 60, history.size(HistoryStore::TIER_MINUTE));
+}
+
+void test_encoding_saturates(void) {
+    TEST_ASSERT_EQUAL_INT16(32767, HistoryStore::encode(HistoryStore::CH_VOLTAGE, 100.0f));
+    TEST_ASSERT_EQUAL_INT16(-32768, HistoryStore::encode(HistoryStore::CH_CURRENT, -1e6f));
+    TEST_ASSERT_EQUAL_INT16(0, HistoryStore::encode(HistoryStore::CH_SOC, NAN));
+    TEST_ASSERT_EQUAL_INT16(6400, HistoryStore::encode(HistoryStore::CH_VOLTAGE, 12.8f));
+}
+
+void test_export_page(void) {
+    for (int s = 0; s <= 40; s++) {
+        history.record(makeSample(s * 1000000LL, 12.0f + 0.01f * s, 0.0f), 50.0f);
+    }
+    uint8_t page[128];
+    const size_t len = history.exportPage(HistoryStore::TIER_SECOND, 2, 42500000LL, page, sizeof(page));
+    const size_t bucketBytes = 4 + HistoryStore::CHANNEL_COUNT * 6;
+    const size_t n = (sizeof(page) - HistoryStore::PAGE_HEADER_BYTES) / bucketBytes;
+    TEST_ASSERT_EQUAL(HistoryStore::PAGE_HEADER_BYTES + n * bucketBytes, len);
+    TEST_ASSERT_EQUAL(HistoryStore::TIER_SECOND, page[0]);
+    TEST_ASSERT_EQUAL(n, page[1]);
+    TEST_ASSERT_EQUAL(2, page[2] | (page[3] << 8));
+    TEST_ASSERT_EQUAL(40, page[4] | (page[5] << 8));
+    TEST_ASSERT_EQUAL(1, page[8]);
+    TEST_ASSERT_EQUAL(3, page[12]); // newest bucket (39 s) started 3 s before now
+
+    // First bucket is two back from the newest, i.e. second 37
+    const uint8_t* b = page + HistoryStore::PAGE_HEADER_BYTES;
+    TEST_ASSERT_EQUAL(1, b[0]);
+    const int16_t meanV = (int16_t)(b[4 + 4] | (b[4 + 5] << 8));
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 12.37f, HistoryStore::decode(HistoryStore::CH_VOLTAGE, meanV));
+
+    // Past the end: header only
+    TEST_ASSERT_EQUAL(HistoryStore::PAGE_HEADER_BYTES,
+                      history.exportPage(HistoryStore::TIER_SECOND, 40, 0, page, sizeof(page)));
+}
+
+void test_benchmark_record(void) {
+    const int samples = 2000000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; i++) {
+        history.record(makeSample(i * 1000LL, 12.0f + (i % 7) * 0.01f, -1500.0f + (i % 13)), 75.0f);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    char msg[128];
+    snprintf(msg, sizeof(msg), "host: record() %.1f ns per sample, %u bytes",
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / samples,
+             (unsigned)sizeof(HistoryStore));
+    TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_second_buckets_hold_min_max_mean);
+    RUN_TEST(test_upper_tiers_are_sample_weighted);
+    RUN_TEST(test_gaps_are_stored_as_empty_buckets);
+    RUN_TEST(test_rings_keep_the_newest_buckets);
+    RUN_TEST(test_encoding_saturates);
+    RUN_TEST(test_export_page);
+    RUN_TEST(test_benchmark_record);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <unity.h>
+
+#include "latency_histogram.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/latency_histogram.cpp"
+
+#include <chrono>
+#include <stdio.h>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_bins_are_powers_of_two(void) {
+    LatencyHistogram h;
+    h.record(0);
+    h.record(1);
+    h.record(2);
+    h.record(3);
+    h.record(4);
+    h.record(1023);
+    h.record(1024);
+    TEST_ASSERT_EQUAL_UINT32(1, h.getBin(0));
+    TEST_ASSERT_EQUAL_UINT32(1, h.getBin(1));
+    TEST_ASSERT_EQUAL_UINT32(2, h.getBin(2));
+    TEST_ASSERT_EQUAL_UINT32(1, h.getBin(3));
+    TEST_ASSERT_EQUAL_UINT32(1, h.getBin(10));
+    TEST_ASSERT_EQUAL_UINT32(1, h.getBin(11));
+    TEST_ASSERT_EQUAL_UINT32(1024, LatencyHistogram::getBinLimit_us(10));
+    TEST_ASSERT_EQUAL_UINT32(7, h.getCount());
+}
+
+void test_long_stalls_land_in_the_last_bin(void) {
+    LatencyHistogram h;
+    h.record(5000000);
+    h.record(UINT32_MAX);
+    TEST_ASSERT_EQUAL_UINT32(2, h.getBin(LatencyHistogram::BINS - 1));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, LatencyHistogram::getBinLimit_us(LatencyHistogram::BINS - 1));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, h.getMax_us());
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, h.getPercentile_us(1.0f));
+}
+
+void test_summary_and_percentiles(void) {
+    LatencyHistogram h;
+    TEST_ASSERT_EQUAL_UINT32(0, h.getPercentile_us(0.99f));
+    TEST_ASSERT_EQUAL_UINT32(0, h.getMin_us());
+
+    // 99 fast trips and one slow one
+    for (int i = 0; i < 99; i++) {
+        h.record(20 + i % 5);
+    }
+    h.record(900);
+    TEST_ASSERT_EQUAL_UINT32(20, h.getMin_us());
+    TEST_ASSERT_EQUAL_UINT32(900, h.getMax_us());
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, (99 * 22.0f + 900.0f) / 100.0f, h.getMean_us());
+    // Bounds, never below the true quantile
+    TEST_ASSERT_EQUAL_UINT32(31, h.getPercentile_us(0.5f));
+    TEST_ASSERT_EQUAL_UINT32(31, h.getPercentile_us(0.99f));
+    TEST_ASSERT_EQUAL_UINT32(900, h.getPercentile_us(1.0f));
+
+    h.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, h.getCount());
+    TEST_ASSERT_EQUAL_UINT32(0, h.getMax_us());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, h.getMean_us());
+}
+
+void test_benchmark_record(void) {
+    LatencyHistogram h;
+    const int samples = 10000000;
+    uint32_t x = 1;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; i++) {
+        x = x * 1664525u + 1013904223u;
+        h.record(x >> 12);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    char msg[128];
+    snprintf(msg, sizeof(msg), "host: record() %.2f ns per sample, %u bytes (p99 %u us)",
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / samples,
+             (unsigned)sizeof(LatencyHistogram), (unsigned)h.getPercentile_us(0.99f));
+    TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bins_are_powers_of_two);
+    RUN_TEST(test_long_stalls_land_in_the_last_bin);
+    RUN_TEST(test_summary_and_percentiles);
+    RUN_TEST(test_benchmark_record);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <unity.h>
+
+#include "lifetime_counters.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/lifetime_counters.cpp"
+#include "../lib/mocks/Preferences.cpp"
+
+void setUp(void) {
+    Preferences::clear_static();
+}
+
+void tearDown(void) {}
+
+void test_directions_are_counted_separately(void) {
+    LifetimeCounters life;
+    int64_t t = 0;
+    // One hour charging at 10 A / 130 W, then one hour discharging at 4 A / 50 W
+    for (int i = 0; i <= 3600 * 250; i++, t += 4000) {
+        life.addCurrent(10000.0f, t);
+        life.addPower(130000.0f, t);
+    }
+    for (int i = 0; i < 3600 * 250; i++, t += 4000) {
+        life.addCurrent(-4000.0f, t);
+        life.addPower(-50000.0f, t);
+    }
+    const LifetimeCounters::Totals& totals = life.getTotals();
+    // The interval containing the step is split between both directions
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 10.0f, totals.chargeIn_Ah());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 4.0f, totals.chargeOut_Ah());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 130.0f, totals.energyIn_Wh());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, totals.energyOut_Wh());
+}
+
+void test_small_currents_are_not_rounded_away(void) {
+    LifetimeCounters life;
+    // 0.1 mA at 250 Hz is 0.4 uC per sample, less than one counter unit
+    int64_t t = 0;
+    for (int i = 0; i <= 10 * 3600 * 250; i++, t += 4000) {
+        life.addCurrent(-0.1f, t);
+    }
+    const uint64_t expected_uC = 3600ULL * 1000; // 1 mAh in ten hours
+    TEST_ASSERT_UINT64_WITHIN(1, expected_uC, life.getTotals().chargeOut_uC);
+    TEST_ASSERT_EQUAL_UINT64(0, life.getTotals().chargeIn_uC);
+}
+
+void test_net_matches_trapezoid_across_zero(void) {
+    LifetimeCounters life;
+    // Ramp from -2 A to +2 A in one step of one second
+    life.addCurrent(-2000.0f, 0);
+    life.addCurrent(2000.0f, 1000000);
+    const LifetimeCounters::Totals& totals = life.getTotals();
+    TEST_ASSERT_EQUAL_UINT64(1000000, totals.chargeIn_uC);
+    TEST_ASSERT_EQUAL_UINT64(1000000, totals.chargeOut_uC);
+
+    // Gaps of over an hour and time going backwards are not bridged
+    life.addCurrent(2000.0f, 1000000 + 2 * 3600LL * 1000000);
+    life.addCurrent(2000.0f, 0);
+    TEST_ASSERT_EQUAL_UINT64(1000000, life.getTotals().chargeIn_uC);
+}
+
+void test_save_policy_bounds_writes(void) {
+    LifetimeCounters life;
+    int64_t t = 0;
+    uint32_t writes = 0;
+    // A day of heavy cycling at 50 A, polled every second
+    for (uint32_t s = 0; s < 24 * 3600; s++) {
+        for (int i = 0; i < 10; i++, t += 100000) {
+            life.addCurrent((s / 600) % 2 ? 50000.0f : -50000.0f, t);
+        }
+        const LifetimeCounters::Totals snapshot = life.getTotals();
+        if (life.saveDue(snapshot, s * 1000)) {
+            life.markSaved(snapshot, s * 1000);
+            writes++;
+        }
+    }
+    TEST_ASSERT_TRUE(writes <= 24 * 60 * 60 * 1000 / LifetimeCounters::MIN_SAVE_INTERVAL_MS);
+    TEST_ASSERT_TRUE(writes >= 90);
+    TEST_ASSERT_EQUAL_UINT32(writes, life.getSaveCount());
+
+    // Idle battery: small drift is written only every MAX_SAVE_INTERVAL_MS
+    LifetimeCounters idle;
+    t = 0;
+    writes = 0;
+    for (uint32_t s = 0; s < 24 * 3600; s++, t += 1000000) {
+        idle.addCurrent(-20.0f, t);
+        const LifetimeCounters::Totals snapshot = idle.getTotals();
+        if (idle.saveDue(snapshot, s * 1000)) {
+            idle.markSaved(snapshot, s * 1000);
+            writes++;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, writes);
+    TEST_ASSERT_TRUE(idle.isUnsaved(idle.getTotals()));
+}
+
+void test_blob_round_trip_and_corruption(void) {
+    LifetimeCounters::Totals totals = {123456789012ULL, 42ULL, 7ULL, 99999999999ULL};
+    Preferences prefs;
+    prefs.begin("storage", false);
+    TEST_ASSERT_TRUE(LifetimeCounters::write(prefs, "life", totals));
+
+    LifetimeCounters::Totals out = {};
+    TEST_ASSERT_TRUE(LifetimeCounters::read(prefs, "life", out));
+    TEST_ASSERT_TRUE(out == totals);
+
+    // Flip a byte of the stored blob: rejected by the CRC
+    uint8_t raw[64];
+    const size_t len = prefs.getBytes("life", raw, sizeof(raw));
+    raw[len - 1] ^= 0x01;
+    prefs.putBytes("life", raw, len);
+    TEST_ASSERT_FALSE(LifetimeCounters::read(prefs, "life", out));
+    TEST_ASSERT_FALSE(LifetimeCounters::read(prefs, "missing", out));
+    prefs.end();
+
+    // restore() continues from the newer totals but remembers what NVS holds
+    LifetimeCounters life;
+    LifetimeCounters::Totals newer = totals;
+    newer.chargeOut_uC += 1000;
+    life.restore(newer, totals);
+    TEST_ASSERT_TRUE(life.getTotals() == newer);
+    TEST_ASSERT_TRUE(life.isUnsaved(life.getTotals()));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_directions_are_counted_separately);
+    RUN_TEST(test_small_currents_are_not_rounded_away);
+    RUN_TEST(test_net_matches_trapezoid_across_zero);
+    RUN_TEST(test_save_policy_bounds_writes);
+    RUN_TEST(test_blob_round_trip_and_corruption);
+    UNITY_END();
+    return 0;
+}
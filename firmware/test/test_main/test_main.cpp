@@ -7,6 +7,16 @@
 
 // HACK: Include the source file directly to get around linker issues
 #include "../../src/ina226_adc.cpp"
+#include "../../src/conversion_controller.cpp"
+#include "../../src/cycle_counter.cpp"
+#include "../../src/run_flat_estimator.cpp"
+#include "../../src/resistance_estimator.cpp"
+#include "../../src/latency_histogram.cpp"
+#include "../../src/soc_kalman_filter.cpp"
+#include "../../src/lifetime_counters.cpp"
+#include "../../src/streaming_stats.cpp"
+#include "../../src/ocv_table.cpp"
+#include "../../src/settings_store.cpp"
 #include "../../src/espnow_handler.cpp"
 #include "../lib/mocks/Arduino.h"
 #include "../lib/mocks/Arduino.cpp"
@@ -24,8 +34,11 @@ void setUp(void) {
     INA226_WE::mockCurrent_mA = 0.0;
     INA226_WE::mockBusPower = 0.0;
     INA226_WE::overflow = false;
+    INA226_WE::convAlert = false;
+    INA226_WE::limitAlert = false;
     set_mock_millis(0);
     Preferences::clear_static();
+    settings.invalidate();
     mock_digital_write_clear();
     mock_esp_deep_sleep_clear();
 }
@@ -64,9 +77,14 @@ void test_battery_capacity(void) {
     float initialCapacity = 100.0;
     INA226_ADC adc(0x40, 0.001, initialCapacity);
 
-    // Initialize lastUpdateTime
+    // Stay clear of the 0% voltage sync
+    INA226_WE::mockBusVoltage_V = 12.8;
+    adc.readSensors();
+
+    // Integration is trapezoidal, so each hour starts with a sample at the
+    // new current (a zero-length interval) to model a step.
     set_mock_millis(1000);
-    adc.updateBatteryCapacity(0.0);
+    adc.updateBatteryCapacity(-10.0);
 
     // --- Test discharging ---
     set_mock_millis(1000 + 3600 * 1000); // Advance time by 1 hour
@@ -77,6 +95,7 @@ void test_battery_capacity(void) {
     TEST_ASSERT_EQUAL_FLOAT(expectedCapacity, adc.getBatteryCapacity());
 
     // --- Test charging ---
+    adc.updateBatteryCapacity(5.0);
     set_mock_millis(1000 + 2 * 3600 * 1000); // Advance time by another 1 hour
     adc.updateBatteryCapacity(5.0);        // 5A charge over the last hour
 
@@ -86,6 +105,7 @@ void test_battery_capacity(void) {
 
     // --- Test capacity limits ---
     // Test not exceeding max capacity
+    adc.updateBatteryCapacity(100.0);
     set_mock_millis(1000 + 3 * 3600 * 1000); // Advance time by another 1 hour
     adc.updateBatteryCapacity(100.0);      // charge with 100A for 1h
     expectedCapacity += 100.0;
@@ -95,6 +115,7 @@ void test_battery_capacity(void) {
     TEST_ASSERT_EQUAL_FLOAT(expectedCapacity, adc.getBatteryCapacity());
 
     // Test not going below zero
+    adc.updateBatteryCapacity(-200.0);
     set_mock_millis(1000 + 4 * 3600 * 1000); // Advance time by another 1 hour
     adc.updateBatteryCapacity(-200.0);       // discharge with 200A for 1h
     expectedCapacity -= 200.0;
@@ -104,6 +125,54 @@ void test_battery_capacity(void) {
     TEST_ASSERT_EQUAL_FLOAT(expectedCapacity, adc.getBatteryCapacity());
 }
 
+void test_coulomb_counter_no_drift(void) {
+    // A week of 1 mA discharge at 10 Hz on a 100 Ah bank. Each step is
+    // ~2.8e-8 Ah, well below the float resolution of a 100 Ah value.
+    INA226_WE::mockBusVoltage_V = 12.8; // stay clear of the 0% voltage sync
+    INA226_ADC adc(0x40, 0.001, 100.0);
+    adc.readSensors();
+
+    set_mock_millis(1000);
+    adc.updateBatteryCapacity(-0.001f);
+    const int64_t start_pC = adc.getBatteryCharge_pC();
+
+    const uint32_t samples = 7UL * 24 * 3600 * 10;
+    for (uint32_t i = 1; i <= samples; i++) {
+        set_mock_millis(1000 + i * 100);
+        adc.updateBatteryCapacity(-0.001f);
+    }
+
+    // 1000 uA * 100000 us per sample, exactly
+    const int64_t expected_pC = start_pC - (int64_t)samples * 1000 * 100000;
+    TEST_ASSERT_TRUE(expected_pC == adc.getBatteryCharge_pC());
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 100.0f - 0.168f, adc.getBatteryCapacity());
+}
+
+void test_trapezoidal_integration_and_gaps(void) {
+    INA226_WE::mockBusVoltage_V = 12.8;
+    INA226_ADC adc(0x40, 0.001, 100.0);
+    adc.readSensors();
+    adc.setBatteryCapacity(50.0);
+    adc.setMaxSampleGap_ms(500);
+
+    // Linear ramp 0 A -> -10 A over one hour in 1 mA / 360 ms steps. The
+    // trapezoid gives the exact -5 Ah; a rectangle rule is off by 0.5 mAh.
+    const int steps = 10000;
+    for (int i = 0; i <= steps; i++) {
+        adc.updateBatteryCapacity(-10.0f * i / steps, (int64_t)i * 360000);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.00002f, 45.0f, adc.getBatteryCapacity());
+    TEST_ASSERT_EQUAL_UINT32(0, adc.getIntegrationGapCount());
+
+    // A 15 s stall between -10 A and -20 A is bridged with the -15 A average
+    const int64_t beforeGap_pC = adc.getBatteryCharge_pC();
+    const int64_t t0 = (int64_t)steps * 360000;
+    adc.updateBatteryCapacity(-20.0f, t0 + 15000000);
+    TEST_ASSERT_TRUE(beforeGap_pC - (int64_t)15000000 * 15000000 == adc.getBatteryCharge_pC());
+    TEST_ASSERT_EQUAL_UINT32(1, adc.getIntegrationGapCount());
+    TEST_ASSERT_EQUAL_UINT32(15000, adc.getLongestGap_ms());
+}
+
 void test_run_flat_time_formatted(void) {
     bool warning;
 
@@ -169,26 +238,30 @@ void test_run_flat_time_formatted(void) {
 void test_averaged_run_flat_time(void) {
     INA226_ADC adc(0x40, 0.001, 100.0);
     bool warning;
+    bool expectedWarning;
+    INA226_WE::mockBusVoltage_V = 12.8;
 
-    // 1. Initial state - no samples yet
+    // 1. Initial state - no samples yet, falls back to the instantaneous current
     set_mock_millis(0);
-    String result = adc.getAveragedRunFlatTime(-10.0, 12.0, warning);
-    TEST_ASSERT_EQUAL_STRING("Gathering data...", result.c_str());
-
-    // 2. First sample is taken after 10 seconds
-    set_mock_millis(10000); // 10s
-    result = adc.getAveragedRunFlatTime(-10.0, 12.0, warning);
-    TEST_ASSERT_EQUAL_STRING("Gathering data...", result.c_str()); // Still not enough samples
-
-    // 3. Second sample is taken after 20 seconds
-    set_mock_millis(20000); // 20s
-    result = adc.getAveragedRunFlatTime(-10.0, 12.0, warning);
-    TEST_ASSERT_EQUAL_STRING("Gathering data...", result.c_str()); // Still not enough samples
-
-    // 4. Third sample is taken, now we have enough for an average
-    set_mock_millis(30000); // 30s
-    result = adc.getAveragedRunFlatTime(-10.0, 12.0, warning);
-    TEST_ASSERT_EQUAL_STRING("10 hours until flat", result.c_str());
+    String result = adc.getAveragedRunFlatTime(12.0, warning);
+    String expected = adc.calculateRunFlatTimeFormatted(adc.getCurrent_mA() / 1000.0f, 12.0, expectedWarning);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), result.c_str());
+
+    // 2. Samples from readSensors() drive the average (10 A discharge)
+    INA226_WE::mockCurrent_mA = 10000.0;
+    for (unsigned long t = 0; t <= 30000; t += 10000) {
+        set_mock_millis(t);
+        adc.readSensors();
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -10.0, adc.getRunFlatCurrent_A());
+    result = adc.getAveragedRunFlatTime(12.0, warning);
+    expected = adc.calculateRunFlatTimeFormatted(-10.0, 12.0, expectedWarning);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), result.c_str());
+    TEST_ASSERT_TRUE(warning);
+
+    // 3. The state survives calls that do not sample
+    result = adc.getAveragedRunFlatTime(12.0, warning);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), result.c_str());
 }
 
 void test_calibration_persistence(void) {
@@ -296,6 +369,39 @@ void test_protection_settings_persistence(void) {
     }
 }
 
+// Ten 20 A load steps on a 13.2 V pack with the given resistance
+static void runLoadSteps(INA226_ADC &adc, float ohm) {
+    unsigned long t = 1000;
+    for (int step = 0; step < 10; step++) {
+        const float currentA = (step & 1) ? 0.0f : -20.0f;
+        for (int i = 0; i < 10; i++) {
+            set_mock_millis(t += 100);
+            INA226_WE::mockCurrent_mA = -currentA * 1000.0f; // shunt reads discharge positive
+            INA226_WE::mockBusVoltage_V = 13.2f + currentA * ohm;
+            adc.readSensors();
+        }
+    }
+}
+
+void test_manual_compensation_survives_load_steps(void) {
+    INA226_ADC adc(0x40, 0.001, 100.0);
+    adc.setAutoCompensation(true);
+    adc.setCompensationResistance(0.010f);
+    TEST_ASSERT_FALSE(adc.isAutoCompensation());
+
+    runLoadSteps(adc, 0.030f);
+    // Learnt, but the value entered by hand stays in use
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 0.030f, adc.getInternalResistance_Ohm());
+    TEST_ASSERT_EQUAL_FLOAT(0.010f, adc.getCompensationResistance());
+
+    // Opting in applies the estimate, capped to a realistic value
+    adc.setAutoCompensation(true);
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 0.030f, adc.getCompensationResistance());
+    runLoadSteps(adc, 0.200f);
+    runLoadSteps(adc, 0.200f);
+    TEST_ASSERT_EQUAL_FLOAT(INA226_ADC::MAX_AUTO_COMPENSATION_OHM, adc.getCompensationResistance());
+}
+
 void test_low_voltage_disconnect(void) {
     INA226_ADC adc(0x40, 0.001, 100.0);
     adc.setProtectionSettings(9.0f, 0.5f, 50.0f);
@@ -342,16 +448,19 @@ void test_alert_disconnect(void) {
     INA226_ADC adc(0x40, 0.001, 100.0);
     adc.setLoadConnected(true);
 
-    // Simulate ISR
+    // Simulate ISR: the switch opens before any task runs
     adc.handleAlert();
     TEST_ASSERT_TRUE(adc.isAlertTriggered());
+    TEST_ASSERT_EQUAL(LOW, mock_digital_write_get_last_value(LOAD_SWITCH_PIN));
 
-    // Simulate main loop processing
+    // Simulate the deferred bookkeeping in the sampling task
     adc.processAlert();
 
     TEST_ASSERT_FALSE(adc.isLoadConnected());
+    TEST_ASSERT_EQUAL(OVERCURRENT, adc.getDisconnectReason());
     TEST_ASSERT_EQUAL(LOW, mock_digital_write_get_last_value(LOAD_SWITCH_PIN));
     TEST_ASSERT_FALSE(adc.isAlertTriggered());
+    TEST_ASSERT_EQUAL_UINT32(1, adc.getTripLatency().getCount());
 }
 
 void test_usb_power_no_disconnect(void) {
@@ -384,22 +493,144 @@ void test_alert_ignored_when_disconnected(void) {
     TEST_ASSERT_FALSE(adc.isAlertTriggered());
 }
 
+void test_conversion_ready_sampling(void) {
+    INA226_ADC adc(0x40, 0.001, 100.0);
+    adc.setLoadConnected(true);
+    set_mock_millis(1000);
+    adc.setConversionReadyMode(true);
+
+    // No edge yet: nothing to read
+    TEST_ASSERT_FALSE(adc.pollConversionReady());
+
+    // A conversion-ready edge is consumed exactly once
+    adc.handleAlert();
+    TEST_ASSERT_FALSE(adc.isAlertTriggered());
+    TEST_ASSERT_TRUE(adc.pollConversionReady());
+    TEST_ASSERT_FALSE(adc.pollConversionReady());
+
+    // A plain conversion does not look like an over-limit alert
+    INA226_WE::convAlert = true;
+    adc.readSensors();
+    TEST_ASSERT_FALSE(adc.isAlertTriggered());
+
+    // AFF set in Mask/Enable: the same edge is an over-limit alert, and
+    // readSensors() opens the switch as soon as it sees it
+    INA226_WE::limitAlert = true;
+    adc.handleAlert();
+    TEST_ASSERT_TRUE(adc.pollConversionReady());
+    TEST_ASSERT_EQUAL(HIGH, mock_digital_write_get_last_value(LOAD_SWITCH_PIN));
+    set_mock_millis(1003);
+    adc.readSensors();
+    TEST_ASSERT_TRUE(adc.isAlertTriggered());
+    TEST_ASSERT_EQUAL(LOW, mock_digital_write_get_last_value(LOAD_SWITCH_PIN));
+    adc.processAlert();
+    TEST_ASSERT_FALSE(adc.isLoadConnected());
+    // Edge to switch as seen by esp_timer, plus the averaging window the
+    // over-limit current may have started in
+    TEST_ASSERT_EQUAL_UINT32(1, adc.getTripLatency().getCount());
+    TEST_ASSERT_EQUAL_UINT32(3000 + adc.getConversionPeriod_us(), adc.getTripLatency().getMax_us());
+}
+
+void test_conversion_ready_watchdog(void) {
+    INA226_ADC adc(0x40, 0.001, 100.0);
+    set_mock_millis(1000);
+    adc.setConversionReadyMode(true);
+
+    // Lost edge: after three conversion periods the loop reads anyway
+    uint32_t period_ms = adc.getConversionPeriod_us() / 1000;
+    set_mock_millis(1000 + 4 * period_ms);
+    TEST_ASSERT_TRUE(adc.pollConversionReady());
+    // Just under four periods elapsed: three conversions done, two overwritten
+    TEST_ASSERT_EQUAL_UINT32(2, adc.getMissedConversions());
+}
+
+void test_batched_register_read(void) {
+    INA226_ADC adc(0x40, 0.001, 100.0);
+    INA226_WE::mockBusVoltage_V = 13.2f;
+    INA226_WE::mockShuntVoltage_mV = -1.5f;
+    INA226_WE::mockCurrent_mA = 1500.0f;
+
+    adc.readSensors();
+
+    TEST_ASSERT_EQUAL_FLOAT(13.2f, adc.getBusVoltage_V());
+    TEST_ASSERT_EQUAL_FLOAT(-1.5f, adc.getShuntVoltage_mV());
+    TEST_ASSERT_EQUAL_FLOAT(1500.0f, adc.getRawCurrent_mA());
+    // Flags, shunt, bus and current in one batch
+    TEST_ASSERT_EQUAL_UINT32(4, adc.getSampleI2cTransactions());
+}
+
+void test_shunt_current_path(void) {
+    INA226_ADC adc(0x40, 0.001, 100.0);
+    adc.setShuntCurrentPath(true);
+    INA226_WE::mockBusVoltage_V = 13.2f;
+    INA226_WE::mockShuntVoltage_mV = 2.0f;
+    INA226_WE::mockCurrent_mA = 0.0f; // current register must be ignored
+
+    adc.readSensors();
+
+    // 2.0 mV across 1 mOhm
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 2000.0f, adc.getRawCurrent_mA());
+    // No current register read
+    TEST_ASSERT_EQUAL_UINT32(3, adc.getSampleI2cTransactions());
+}
+
+void test_filtered_current_resolution(void) {
+    INA226_ADC adc(0x40, 0.001, 100.0);
+    adc.setShuntCurrentPath(true);
+    adc.setCurrentDecimation(4);
+    INA226_WE::mockBusVoltage_V = 12.8f;
+
+    // Before the first decimated output the filtered value follows the raw one
+    INA226_WE::mockShuntVoltage_mV = 0.007f;
+    adc.readSensors();
+    TEST_ASSERT_EQUAL_FLOAT(adc.getCurrent_mA(), adc.getFilteredCurrent_mA());
+
+    // Shunt reads dither between 1 and 2 LSB (1 uV in the mock): 1.25 uV
+    // across 1 mOhm is 1.25 mA, below a single reading's resolution.
+    const float pattern_mV[4] = {0.001f, 0.001f, 0.002f, 0.001f};
+    for (int i = 0; i < 4 * 6; i++) {
+        INA226_WE::mockShuntVoltage_mV = pattern_mV[i % 4];
+        adc.readSensors();
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -1.25f, adc.getFilteredCurrent_mA());
+
+    // Switching path drops the shunt counts; the current register path is
+    // filtered from the current register, not from the shunt voltage.
+    adc.setShuntCurrentPath(false);
+    TEST_ASSERT_EQUAL_FLOAT(adc.getCurrent_mA(), adc.getFilteredCurrent_mA());
+    INA226_WE::mockShuntVoltage_mV = 0.050f; // would read as 50 mA
+    INA226_WE::mockCurrent_mA = 7.0f;
+    for (int i = 0; i < 4 * 6; i++) {
+        adc.readSensors();
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -7.0f, adc.getFilteredCurrent_mA());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, adc.getCurrent_mA(), adc.getFilteredCurrent_mA());
+}
+
 int main(int argc, char **argv) {
     UNITY_BEGIN();
     RUN_TEST(test_current_calibration);
     RUN_TEST(test_battery_capacity);
+    RUN_TEST(test_coulomb_counter_no_drift);
+    RUN_TEST(test_trapezoidal_integration_and_gaps);
     RUN_TEST(test_run_flat_time_formatted);
     RUN_TEST(test_averaged_run_flat_time);
     RUN_TEST(test_calibration_persistence);
     RUN_TEST(test_espnow_handler);
     RUN_TEST(test_main_loop_logic);
     RUN_TEST(test_protection_settings_persistence);
+    RUN_TEST(test_manual_compensation_survives_load_steps);
     RUN_TEST(test_low_voltage_disconnect);
     RUN_TEST(test_overcurrent_disconnect);
     RUN_TEST(test_voltage_reconnect);
     RUN_TEST(test_alert_disconnect);
     RUN_TEST(test_usb_power_no_disconnect);
     RUN_TEST(test_alert_ignored_when_disconnected);
+    RUN_TEST(test_conversion_ready_sampling);
+    RUN_TEST(test_conversion_ready_watchdog);
+    RUN_TEST(test_batched_register_read);
+    RUN_TEST(test_shunt_current_path);
+    RUN_TEST(test_filtered_current_resolution);
     UNITY_END();
     return 0;
 }
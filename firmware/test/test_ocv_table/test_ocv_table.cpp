@@ -0,0 +1,156 @@
+#include <unity.h>
+#include <chrono>
+#include <map>
+#include <stdio.h>
+
+#include "ocv_table.h"
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/ocv_table.cpp"
+
+// The std::map lookup that seeded SOC before the table became two
+// dimensional, kept as the 25 C reference and the benchmark baseline.
+static const std::map<float, float> &referenceMap() {
+  static const std::map<float, float> m = {
+      {14.60, 100.0}, {14.45, 99.0}, {13.87, 95.0}, {13.30, 90.0}, {13.25, 80.0},
+      {13.20, 70.0},  {13.17, 60.0}, {13.13, 50.0}, {13.10, 40.0}, {13.00, 30.0},
+      {12.90, 20.0},  {12.80, 17.0}, {12.50, 14.0}, {12.00, 9.0},  {10.00, 0.0}};
+  return m;
+}
+
+static float referenceSoc(float voltage) {
+  const std::map<float, float> &m = referenceMap();
+  auto it = m.lower_bound(voltage);
+  if (it == m.end()) {
+    return 100.0f;
+  }
+  if (it == m.begin()) {
+    return 0.0f;
+  }
+  float v_high = it->first;
+  float soc_high = it->second;
+  it--;
+  float v_low = it->first;
+  float soc_low = it->second;
+  return soc_low + ((voltage - v_low) * (soc_high - soc_low)) / (v_high - v_low);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_reference_temperature_matches_map(void) {
+  // Every breakpoint and the midpoint of every segment
+  for (size_t i = 0; i < ocv::VOLTAGE_POINTS; i++) {
+    const float v = ocv::kVoltages_V[i];
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, referenceSoc(v), ocv::socPercent(v));
+    if (i + 1 < ocv::VOLTAGE_POINTS) {
+      const float mid = 0.5f * (v + ocv::kVoltages_V[i + 1]);
+      TEST_ASSERT_FLOAT_WITHIN(0.01f, referenceSoc(mid), ocv::socPercent(mid));
+    }
+  }
+  // Fine sweep across the whole range
+  for (float v = 9.5f; v <= 15.0f; v += 0.005f) {
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, referenceSoc(v), ocv::socPercent(v, 25.0f));
+  }
+}
+
+void test_table_is_monotonic(void) {
+  for (size_t t = 0; t < ocv::TEMPERATURE_POINTS; t++) {
+    const float *row = &ocv::kSoc_percent[t * ocv::VOLTAGE_POINTS];
+    for (size_t v = 1; v < ocv::VOLTAGE_POINTS; v++) {
+      TEST_ASSERT_TRUE(row[v] >= row[v - 1]);
+      TEST_ASSERT_TRUE(row[v] >= 0.0f && row[v] <= 100.0f);
+    }
+  }
+  for (size_t i = 1; i < ocv::VOLTAGE_POINTS; i++) {
+    TEST_ASSERT_TRUE(ocv::kVoltages_V[i] > ocv::kVoltages_V[i - 1]);
+  }
+  for (size_t i = 1; i < ocv::TEMPERATURE_POINTS; i++) {
+    TEST_ASSERT_TRUE(ocv::kTemperatures_C[i] > ocv::kTemperatures_C[i - 1]);
+  }
+}
+
+void test_unmeasured_temperatures_follow_reference(void) {
+  // Only the 25 C curve is measured; no temperature may move the SOC
+  TEST_ASSERT_FALSE(ocv::TEMPERATURE_DEPENDENT);
+  for (size_t t = 0; t < ocv::TEMPERATURE_POINTS; t++) {
+    for (size_t v = 0; v < ocv::VOLTAGE_POINTS; v++) {
+      TEST_ASSERT_EQUAL_FLOAT(referenceSoc(ocv::kVoltages_V[v]),
+                              ocv::kSoc_percent[t * ocv::VOLTAGE_POINTS + v]);
+    }
+  }
+  for (float t = -30.0f; t <= 60.0f; t += 2.5f) {
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, ocv::socPercent(13.115f),
+                             ocv::socPercent(13.115f, t));
+  }
+}
+
+void test_clamps_outside_table(void) {
+  TEST_ASSERT_EQUAL_FLOAT(ocv::socPercent(13.0f, -20.0f), ocv::socPercent(13.0f, -40.0f));
+  TEST_ASSERT_EQUAL_FLOAT(ocv::socPercent(13.0f, 45.0f), ocv::socPercent(13.0f, 70.0f));
+  TEST_ASSERT_EQUAL_FLOAT(ocv::socPercent(13.0f, 25.0f), ocv::socPercent(13.0f, NAN));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, ocv::socPercent(8.0f, 25.0f));
+  TEST_ASSERT_EQUAL_FLOAT(100.0f, ocv::socPercent(16.0f, 25.0f));
+}
+
+void test_rest_voltage_inverts_rows(void) {
+  const float temps[] = {-20.0f, 5.0f, 25.0f, 45.0f};
+  for (float t : temps) {
+    float row[ocv::VOLTAGE_POINTS];
+    ocv::socRow(t, row);
+    for (float v = 10.0f; v <= 14.6f; v += 0.01f) {
+      float slope;
+      const float back = ocv::restVoltage(row, ocv::socPercent(v, t), slope);
+      TEST_ASSERT_FLOAT_WITHIN(0.001f, v, back);
+      TEST_ASSERT_TRUE(slope > 0.0f);
+    }
+  }
+
+  // Slope on the 25 C plateau: 13.13 -> 13.17 V over 50 -> 60 %
+  float row[ocv::VOLTAGE_POINTS];
+  ocv::socRow(NAN, row);
+  float slope;
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 13.15f, ocv::restVoltage(row, 55.0f, slope));
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.004f, slope);
+  // Clamped ends
+  TEST_ASSERT_EQUAL_FLOAT(14.60f, ocv::restVoltage(row, 120.0f, slope));
+  TEST_ASSERT_EQUAL_FLOAT(10.00f, ocv::restVoltage(row, -5.0f, slope));
+}
+
+void test_benchmark_lookup(void) {
+  const int calls = 2000000;
+  volatile float sink = 0.0f;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < calls; i++) {
+    sink = sink + referenceSoc(11.5f + 3.0f * (i % 1000) / 1000.0f);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < calls; i++) {
+    sink = sink + ocv::socPercent(11.5f + 3.0f * (i % 1000) / 1000.0f,
+                                  -20.0f + (i % 65));
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  const double refNs =
+      std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+  const double newNs =
+      std::chrono::duration<double, std::nano>(t2 - t1).count() / calls;
+  char msg[128];
+  snprintf(msg, sizeof(msg),
+           "OCV lookup: std::map 1D %.1f ns, flat 2D bilinear %.1f ns", refNs,
+           newNs);
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_reference_temperature_matches_map);
+  RUN_TEST(test_table_is_monotonic);
+  RUN_TEST(test_unmeasured_temperatures_follow_reference);
+  RUN_TEST(test_clamps_outside_table);
+  RUN_TEST(test_rest_voltage_inverts_rows);
+  RUN_TEST(test_benchmark_lookup);
+  UNITY_END();
+  return 0;
+}
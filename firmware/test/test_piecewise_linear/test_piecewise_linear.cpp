@@ -0,0 +1,89 @@
+#include <unity.h>
+
+#include "PiecewiseLinear.h"
+
+struct IntPoint {
+    int raw;
+    float value;
+};
+
+// Same shape as GPIO_ADC's default starter voltage table
+constexpr IntPoint voltage_table[] = {
+    {2182, 10.0f}, {2396, 11.0f}, {2525, 11.5f}, {2625, 12.0f},
+    {2748, 12.5f}, {2841, 13.0f}, {3055, 14.0f}, {3283, 15.0f}
+};
+constexpr size_t voltage_table_size = sizeof(voltage_table) / sizeof(voltage_table[0]);
+
+static PiecewiseLinear<16> makeVoltageCurve() {
+    PiecewiseLinear<16> curve;
+    curve.assign(voltage_table, voltage_table_size,
+                 [](const IntPoint& p) { return p.raw; },
+                 [](const IntPoint& p) { return p.value; });
+    return curve;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_breakpoints_and_midpoints(void) {
+    PiecewiseLinear<16> curve = makeVoltageCurve();
+    TEST_ASSERT_EQUAL(voltage_table_size, curve.size());
+
+    for (size_t i = 0; i < voltage_table_size; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(voltage_table[i].value,
+                                curve.evaluate((float)voltage_table[i].raw));
+    }
+    for (size_t i = 1; i < voltage_table_size; i++) {
+        const float x = 0.5f * (voltage_table[i - 1].raw + voltage_table[i].raw);
+        const float y = 0.5f * (voltage_table[i - 1].value + voltage_table[i].value);
+        TEST_ASSERT_EQUAL_FLOAT(y, curve.evaluate(x));
+    }
+}
+
+void test_clamps_outside_table(void) {
+    PiecewiseLinear<16> curve = makeVoltageCurve();
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, curve.evaluate(0.0f));
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, curve.evaluate(2182.0f));
+    TEST_ASSERT_EQUAL_FLOAT(15.0f, curve.evaluate(4095.0f));
+}
+
+void test_no_curve_is_identity(void) {
+    PiecewiseLinear<4> curve;
+    TEST_ASSERT_TRUE(curve.empty());
+    TEST_ASSERT_EQUAL_FLOAT(123.0f, curve.evaluate(123.0f));
+
+    const PiecewiseLinear<4>::Point one[] = {{1.0f, 5.0f}};
+    curve.assign(one, 1);
+    TEST_ASSERT_EQUAL_FLOAT(123.0f, curve.evaluate(123.0f));
+}
+
+void test_rejects_too_many_points(void) {
+    PiecewiseLinear<4> curve;
+    const PiecewiseLinear<4>::Point pts[] = {
+        {0.0f, 0.0f}, {1.0f, 1.0f}, {2.0f, 2.0f}, {3.0f, 3.0f}, {4.0f, 4.0f}};
+    TEST_ASSERT_FALSE(curve.assign(pts, 5));
+    TEST_ASSERT_TRUE(curve.empty());
+    TEST_ASSERT_TRUE(curve.assign(pts, 4));
+    TEST_ASSERT_EQUAL_FLOAT(2.5f, curve.evaluate(2.5f));
+}
+
+void test_two_point_curve(void) {
+    PiecewiseLinear<2> curve;
+    const PiecewiseLinear<2>::Point pts[] = {{100.0f, 0.0f}, {200.0f, -50.0f}};
+    TEST_ASSERT_TRUE(curve.assign(pts, 2));
+    TEST_ASSERT_EQUAL_FLOAT(-25.0f, curve.evaluate(150.0f));
+    TEST_ASSERT_EQUAL_FLOAT(100.0f, curve.point(0).x);
+    TEST_ASSERT_EQUAL_FLOAT(-50.0f, curve.point(1).y);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_breakpoints_and_midpoints);
+    RUN_TEST(test_clamps_outside_table);
+    RUN_TEST(test_no_curve_is_identity);
+    RUN_TEST(test_rejects_too_many_points);
+    RUN_TEST(test_two_point_curve);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <unity.h>
+
+#include "resistance_estimator.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/resistance_estimator.cpp"
+
+#include <chrono>
+#include <stdio.h>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// A pack with a rested voltage of 13.2 V and internal resistance r, sampled
+// every 100 ms with a little voltage noise
+struct Pack {
+    float r;
+    int64_t t_us = 0;
+    uint32_t noise = 7;
+
+    float voltage(float currentA) {
+        noise = noise * 1664525u + 1013904223u;
+        const float n = ((noise >> 8) / 16777216.0f - 0.5f) * 0.004f;
+        return 13.2f + currentA * r + n;
+    }
+    // Hold a current for count samples; returns the steps measured
+    int hold(ResistanceEstimator &est, float currentA, int count) {
+        int measured = 0;
+        for (int i = 0; i < count; i++) {
+            t_us += 100000;
+            measured += est.update(currentA, voltage(currentA), t_us) ? 1 : 0;
+        }
+        return measured;
+    }
+};
+
+void test_load_steps_give_the_resistance(void) {
+    ResistanceEstimator est;
+    Pack pack{0.012f};
+    int measured = 0;
+    for (int i = 0; i < 20; i++) {
+        measured += pack.hold(est, -0.5f, 100);
+        measured += pack.hold(est, -20.5f, 100);
+    }
+    // Every switch on and off is one step
+    TEST_ASSERT_EQUAL(39, measured);
+    TEST_ASSERT_TRUE(est.isPrimed());
+    TEST_ASSERT_FLOAT_WITHIN(0.0005f, 0.012f, est.getEstimate_Ohm());
+    TEST_ASSERT_EQUAL_UINT32(39, est.getAcceptedSteps());
+}
+
+void test_mixed_sample_between_is_tolerated(void) {
+    ResistanceEstimator est;
+    Pack pack{0.020f};
+    for (int i = 0; i < 10; i++) {
+        pack.hold(est, -1.0f, 50);
+        // Shunt converted after the step, bus voltage before it
+        pack.t_us += 100000;
+        est.update(-31.0f, pack.voltage(-1.0f), pack.t_us);
+        pack.hold(est, -31.0f, 50);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.020f, est.getEstimate_Ohm());
+}
+
+void test_ramps_and_slow_samples_are_not_steps(void) {
+    ResistanceEstimator est;
+    Pack pack{0.012f};
+    // 0.4 A per sample ramp to 40 A and back
+    for (int i = 0; i <= 100; i++) {
+        TEST_ASSERT_FALSE(est.update(-0.4f * i, pack.voltage(-0.4f * i), pack.t_us += 100000));
+    }
+    for (int i = 100; i >= 0; i--) {
+        TEST_ASSERT_FALSE(est.update(-0.4f * i, pack.voltage(-0.4f * i), pack.t_us += 100000));
+    }
+    // A clean step across a two second gap is not trusted
+    pack.hold(est, 0.0f, 10);
+    pack.t_us += 2000000;
+    TEST_ASSERT_EQUAL(0, pack.hold(est, -20.0f, 10));
+    TEST_ASSERT_EQUAL_UINT32(0, est.getAcceptedSteps() + est.getRejectedSteps());
+    TEST_ASSERT_TRUE(isnan(est.getEstimate_Ohm()));
+}
+
+void test_outliers_are_rejected_and_real_change_relearnt(void) {
+    ResistanceEstimator est;
+    Pack pack{0.010f};
+    for (int i = 0; i < 10; i++) {
+        pack.hold(est, 0.0f, 30);
+        pack.hold(est, -15.0f, 30);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.0005f, 0.010f, est.getEstimate_Ohm());
+
+    // The charger drops out at the same moment the load starts: one bogus
+    // step with a large voltage change, then business as usual
+    pack.hold(est, 0.0f, 30);
+    pack.r = 0.060f;
+    pack.hold(est, -15.0f, 3);
+    pack.r = 0.010f;
+    pack.hold(est, -15.0f, 27);
+    TEST_ASSERT_EQUAL_UINT32(1, est.getRejectedSteps());
+    TEST_ASSERT_FLOAT_WITHIN(0.0005f, 0.010f, est.getEstimate_Ohm());
+
+    // A cold battery really has twice the resistance: relearnt
+    pack.r = 0.020f;
+    for (int i = 0; i < 10; i++) {
+        pack.hold(est, 0.0f, 30);
+        pack.hold(est, -15.0f, 30);
+    }
+    TEST_ASSERT_TRUE(est.isPrimed());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.020f, est.getEstimate_Ohm());
+
+    // Implausible values never enter the estimate
+    ResistanceEstimator fresh;
+    Pack usb{0.012f};
+    for (int i = 0; i < 10; i++) {
+        usb.t_us += 100000;
+        fresh.update(i < 5 ? 0.0f : -10.0f, 5.0f, usb.t_us);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, fresh.getAcceptedSteps() + fresh.getRejectedSteps());
+}
+
+void test_benchmark_update(void) {
+    ResistanceEstimator est;
+    const int samples = 2000000;
+    int64_t t = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; i++) {
+        t += 4000;
+        const float currentA = (i / 500) & 1 ? -20.0f : -1.0f;
+        est.update(currentA, 13.2f + currentA * 0.01f, t);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    char msg[128];
+    snprintf(msg, sizeof(msg), "host: update() %.1f ns per sample, %u bytes (%u steps)",
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / samples,
+             (unsigned)sizeof(ResistanceEstimator), (unsigned)est.getAcceptedSteps());
+    TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_load_steps_give_the_resistance);
+    RUN_TEST(test_mixed_sample_between_is_tolerated);
+    RUN_TEST(test_ramps_and_slow_samples_are_not_steps);
+    RUN_TEST(test_outliers_are_rejected_and_real_change_relearnt);
+    RUN_TEST(test_benchmark_update);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <unity.h>
+
+#include "run_flat_estimator.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/run_flat_estimator.cpp"
+
+#include <chrono>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Feed a constant current at a fixed period
+static void feed(RunFlatEstimator &est, float currentA, int64_t &t_us,
+                 int64_t period_us, int count) {
+    for (int i = 0; i < count; i++) {
+        t_us += period_us;
+        est.update(currentA, t_us);
+    }
+}
+
+void test_warm_up_is_time_weighted_mean(void) {
+    RunFlatEstimator est;
+    int64_t t = 0;
+    TEST_ASSERT_FALSE(est.isPrimed());
+    est.update(-2.0f, t);
+    TEST_ASSERT_TRUE(est.isPrimed());
+    TEST_ASSERT_EQUAL_FLOAT(-2.0f, est.getAverage_A());
+
+    // 60 s at -2 A then 60 s at -6 A: well inside the discharge time constant
+    feed(est, -2.0f, t, 100000, 600);
+    feed(est, -6.0f, t, 100000, 600);
+    TEST_ASSERT_EQUAL(RunFlatEstimator::REGIME_DISCHARGING, est.getRegime());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -4.0f, est.getAverage_A());
+}
+
+void test_fridge_cycling_is_one_regime(void) {
+    RunFlatEstimator est;
+    int64_t t = 0;
+    // Compressor 10 min at 5 A, off 20 min with a 0.2 A standby load
+    for (int cycle = 0; cycle < 8; cycle++) {
+        feed(est, -5.0f, t, 1000000, 600);
+        feed(est, -0.2f, t, 1000000, 1200);
+    }
+    TEST_ASSERT_EQUAL(RunFlatEstimator::REGIME_DISCHARGING, est.getRegime());
+    TEST_ASSERT_EQUAL_UINT32(0, est.getRegimeChanges());
+    // Duty-cycle mean is -1.8 A; the long time constant keeps the ripple small
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, -1.8f, est.getAverage_A());
+}
+
+void test_charging_follows_the_charger(void) {
+    RunFlatEstimator est;
+    int64_t t = 0;
+    feed(est, -3.0f, t, 100000, 3000);
+    feed(est, 10.0f, t, 100000, 600);
+    TEST_ASSERT_EQUAL(RunFlatEstimator::REGIME_CHARGING, est.getRegime());
+    TEST_ASSERT_EQUAL_UINT32(1, est.getRegimeChanges());
+    // Restarted on the change: no discharge current mixed in
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f, est.getAverage_A());
+
+    // Charger steps down (absorption); 5 min is several charge time constants
+    feed(est, 4.0f, t, 100000, 3000);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 4.0f, est.getAverage_A());
+    TEST_ASSERT_EQUAL_UINT32(1, est.getRegimeChanges());
+}
+
+void test_noise_around_zero_does_not_flap(void) {
+    RunFlatEstimator est;
+    int64_t t = 0;
+    for (int i = 0; i < 20000; i++) {
+        t += 100000;
+        est.update((i & 1) ? 0.4f : -0.3f, t);
+    }
+    TEST_ASSERT_EQUAL(RunFlatEstimator::REGIME_DISCHARGING, est.getRegime());
+    TEST_ASSERT_EQUAL_UINT32(0, est.getRegimeChanges());
+}
+
+void test_gap_and_stale_timestamps(void) {
+    RunFlatEstimator est;
+    int64_t t = 0;
+    feed(est, -1.0f, t, 100000, 36000); // one hour
+    // A repeated timestamp is ignored
+    est.update(-50.0f, t);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -1.0f, est.getAverage_A());
+
+    // After a long gap (deep sleep) the new current dominates
+    t += 24LL * 3600 * 1000000;
+    est.update(-3.0f, t);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, -3.0f, est.getAverage_A());
+
+    est.reset();
+    TEST_ASSERT_FALSE(est.isPrimed());
+    TEST_ASSERT_EQUAL(RunFlatEstimator::REGIME_UNKNOWN, est.getRegime());
+}
+
+void test_benchmark_update(void) {
+    RunFlatEstimator est;
+    const int samples = 2000000;
+    int64_t t = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; i++) {
+        t += 4000;
+        est.update(-2.0f + (float)(i % 17) * 0.1f, t);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    char msg[128];
+    snprintf(msg, sizeof(msg), "host: update() %.1f ns per sample, %u bytes (avg %.2f A)",
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / samples,
+             (unsigned)sizeof(RunFlatEstimator), est.getAverage_A());
+    TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_warm_up_is_time_weighted_mean);
+    RUN_TEST(test_fridge_cycling_is_one_regime);
+    RUN_TEST(test_charging_follows_the_charger);
+    RUN_TEST(test_noise_around_zero_does_not_flap);
+    RUN_TEST(test_gap_and_stale_timestamps);
+    RUN_TEST(test_benchmark_update);
+    UNITY_END();
+    return 0;
+}
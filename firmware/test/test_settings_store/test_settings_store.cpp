@@ -0,0 +1,160 @@
+#include <unity.h>
+
+#include "settings_store.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/settings_store.cpp"
+#include "../lib/mocks/Arduino.cpp"
+#include "../lib/mocks/Preferences.cpp"
+
+static float nvsFloat(const char* key, float defaultValue) {
+    Preferences prefs;
+    prefs.begin("test", true);
+    float v = prefs.getFloat(key, defaultValue);
+    prefs.end();
+    return v;
+}
+
+void setUp(void) {
+    Preferences::clear_static();
+    set_mock_millis(0);
+    settings.invalidate();
+    settings.setDebounce_ms(SettingsStore::DEFAULT_DEBOUNCE_MS);
+}
+
+void tearDown(void) {}
+
+void test_reads_through_once(void) {
+    Preferences prefs;
+    prefs.begin("test", false);
+    prefs.putFloat("cutoff", 11.8f);
+    prefs.end();
+
+    TEST_ASSERT_EQUAL_FLOAT(11.8f, settings.getFloat("test", "cutoff", 0.0f));
+
+    // Later reads are served from RAM
+    prefs.begin("test", false);
+    prefs.putFloat("cutoff", 12.5f);
+    prefs.end();
+    TEST_ASSERT_EQUAL_FLOAT(11.8f, settings.getFloat("test", "cutoff", 0.0f));
+
+    // Missing keys return the caller's default and are cached as absent
+    TEST_ASSERT_EQUAL_UINT32(30000, settings.getUInt("test", "delay", 30000));
+    TEST_ASSERT_FALSE(settings.isKey("test", "delay"));
+    TEST_ASSERT_EQUAL_STRING("x", settings.getString("test", "name", "x").c_str());
+}
+
+void test_writes_are_debounced(void) {
+    settings.putFloat("test", "cutoff", 11.0f);
+    TEST_ASSERT_EQUAL_FLOAT(11.0f, settings.getFloat("test", "cutoff", 0.0f));
+    TEST_ASSERT_EQUAL(1, settings.getPendingCount());
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, nvsFloat("cutoff", -1.0f));
+
+    // Each change restarts the quiet period
+    set_mock_millis(1500);
+    settings.putFloat("test", "cutoff", 11.2f);
+    TEST_ASSERT_EQUAL(0, settings.commitDue(3000));
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, nvsFloat("cutoff", -1.0f));
+
+    TEST_ASSERT_EQUAL(1, settings.commitDue(3500));
+    TEST_ASSERT_EQUAL_FLOAT(11.2f, nvsFloat("cutoff", -1.0f));
+    TEST_ASSERT_EQUAL(0, settings.getPendingCount());
+    TEST_ASSERT_EQUAL_UINT32(1, settings.getNvsWriteCount());
+}
+
+void test_slider_back_and_forth_is_not_written(void) {
+    settings.putFloat("test", "cutoff", 11.6f);
+    settings.flush();
+    const uint32_t writes = settings.getNvsWriteCount();
+
+    for (int i = 0; i < 50; i++) {
+        set_mock_millis(i * 20);
+        settings.putFloat("test", "cutoff", 11.0f + i * 0.02f);
+    }
+    settings.putFloat("test", "cutoff", 11.6f);
+    TEST_ASSERT_EQUAL(0, settings.getPendingCount());
+    TEST_ASSERT_EQUAL(0, settings.commitDue(60000));
+    TEST_ASSERT_EQUAL_UINT32(writes, settings.getNvsWriteCount());
+}
+
+void test_continuous_changes_still_commit(void) {
+    settings.setDebounce_ms(1000);
+    uint32_t now = 0;
+    for (; now < SettingsStore::MAX_DELAY_MS; now += 500) {
+        set_mock_millis(now);
+        settings.putUInt("test", "count", now);
+        TEST_ASSERT_EQUAL(0, settings.commitDue(now));
+    }
+    TEST_ASSERT_EQUAL(1, settings.commitDue(now));
+}
+
+void test_flush_writes_every_type_and_removal(void) {
+    Preferences prefs;
+    prefs.begin("other", false);
+    prefs.putString("old", "gone soon");
+    prefs.end();
+
+    settings.putFloat("test", "f", 1.5f);
+    settings.putUShort("test", "s", 200);
+    settings.putUInt("test", "u", 123456);
+    settings.putBool("test", "b", true);
+    settings.putString("other", "str", "hello");
+    settings.remove("other", "old");
+    settings.remove("other", "never"); // absent in NVS: nothing to do
+    TEST_ASSERT_EQUAL(6, settings.getPendingCount());
+
+    TEST_ASSERT_EQUAL(6, settings.flush());
+    prefs.begin("test", true);
+    TEST_ASSERT_EQUAL_FLOAT(1.5f, prefs.getFloat("f", 0.0f));
+    TEST_ASSERT_EQUAL_UINT16(200, prefs.getUShort("s", 0));
+    TEST_ASSERT_EQUAL_UINT32(123456, prefs.getUInt("u", 0));
+    TEST_ASSERT_TRUE(prefs.getBool("b", false));
+    TEST_ASSERT_EQUAL_STRING("hello", prefs.getString("str", "").c_str());
+    TEST_ASSERT_FALSE(prefs.isKey("old"));
+    prefs.end();
+
+    // A fresh cache sees the committed values
+    settings.invalidate();
+    TEST_ASSERT_EQUAL_UINT16(200, settings.getUShort("test", "s", 0));
+    TEST_ASSERT_FALSE(settings.isKey("other", "old"));
+}
+
+void test_failed_write_stays_pending(void) {
+    const uint32_t writes = settings.getNvsWriteCount();
+    const uint32_t failures = settings.getWriteFailureCount();
+    settings.putFloat("test", "cutoff", 11.0f);
+    Preferences::failWrites = true;
+    set_mock_millis(5000);
+    TEST_ASSERT_EQUAL(0, settings.commitDue(5000));
+    TEST_ASSERT_EQUAL(1, settings.getPendingCount());
+    TEST_ASSERT_EQUAL_UINT32(failures + 1, settings.getWriteFailureCount());
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, nvsFloat("cutoff", -1.0f));
+
+    // The retry waits a debounce period from the failure, then succeeds
+    Preferences::failWrites = false;
+    TEST_ASSERT_EQUAL(0, settings.commitDue(6000));
+    TEST_ASSERT_EQUAL(1, settings.commitDue(7000));
+    TEST_ASSERT_EQUAL_FLOAT(11.0f, nvsFloat("cutoff", -1.0f));
+    TEST_ASSERT_EQUAL(0, settings.getPendingCount());
+    TEST_ASSERT_EQUAL_UINT32(writes + 1, settings.getNvsWriteCount());
+}
+
+void test_invalidate_drops_pending_writes(void) {
+    settings.putFloat("test", "cutoff", 11.0f);
+    settings.invalidate();
+    TEST_ASSERT_EQUAL(0, settings.flush());
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, nvsFloat("cutoff", -1.0f));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_reads_through_once);
+    RUN_TEST(test_writes_are_debounced);
+    RUN_TEST(test_slider_back_and_forth_is_not_written);
+    RUN_TEST(test_continuous_changes_still_commit);
+    RUN_TEST(test_flush_writes_every_type_and_removal);
+    RUN_TEST(test_failed_write_stays_pending);
+    RUN_TEST(test_invalidate_drops_pending_writes);
+    UNITY_END();
+    return 0;
+}
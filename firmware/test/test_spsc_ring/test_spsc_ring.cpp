@@ -0,0 +1,87 @@
+#include <unity.h>
+#include <thread>
+
+#include "SpscRing.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_push_pop_order(void) {
+    SpscRing<int, 8> ring;
+    int out = 0;
+    TEST_ASSERT_FALSE(ring.pop(out));
+
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+    }
+    TEST_ASSERT_EQUAL(5, ring.available());
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(ring.pop(out));
+        TEST_ASSERT_EQUAL(i, out);
+    }
+    TEST_ASSERT_FALSE(ring.pop(out));
+}
+
+void test_full_ring_drops_newest(void) {
+    SpscRing<int, 4> ring;
+    for (int i = 0; i < 6; i++) {
+        ring.push(i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, ring.getDropped());
+
+    // The oldest samples survive; the producer never overwrites unread data
+    int out = 0;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.pop(out));
+        TEST_ASSERT_EQUAL(i, out);
+    }
+}
+
+void test_wraps_many_times(void) {
+    SpscRing<int, 4> ring;
+    int out = 0;
+    for (int i = 0; i < 1000; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+        TEST_ASSERT_TRUE(ring.pop(out));
+        TEST_ASSERT_EQUAL(i, out);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, ring.getDropped());
+}
+
+void test_concurrent_producer_consumer(void) {
+    static SpscRing<uint32_t, 64> ring;
+    const uint32_t total = 200000;
+
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < total; i++) {
+            while (!ring.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    bool inOrder = true;
+    while (expected < total) {
+        uint32_t v;
+        if (ring.pop(v)) {
+            if (v != expected) inOrder = false;
+            expected++;
+        }
+    }
+    producer.join();
+
+    TEST_ASSERT_TRUE(inOrder);
+    TEST_ASSERT_EQUAL(0, ring.available());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_push_pop_order);
+    RUN_TEST(test_full_ring_drops_newest);
+    RUN_TEST(test_wraps_many_times);
+    RUN_TEST(test_concurrent_producer_consumer);
+    UNITY_END();
+    return 0;
+}
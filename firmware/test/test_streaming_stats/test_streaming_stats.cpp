@@ -0,0 +1,166 @@
+#include <unity.h>
+
+#include "streaming_stats.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/streaming_stats.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+static float exactQuantile(std::vector<float> v, float p) {
+    std::sort(v.begin(), v.end());
+    return v[(size_t)(p * (v.size() - 1) + 0.5f)];
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_welford_matches_two_pass(void) {
+    RunningStats stats;
+    std::vector<float> v;
+    // Large offset, small spread: the case a naive sum of squares gets wrong
+    for (int i = 0; i < 5000; i++) {
+        const float x = 13.2f + 0.001f * ((i * 37) % 101);
+        v.push_back(x);
+        stats.add(x);
+    }
+    double sum = 0.0;
+    for (float x : v) sum += x;
+    const double mean = sum / v.size();
+    double sq = 0.0;
+    for (float x : v) sq += (x - mean) * (x - mean);
+    const double var = sq / (v.size() - 1);
+
+    TEST_ASSERT_EQUAL_UINT32(5000, stats.count());
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, (float)mean, stats.mean());
+    TEST_ASSERT_FLOAT_WITHIN((float)var * 0.01f, (float)var, stats.variance());
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 13.2f, stats.min());
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 13.3f, stats.max());
+
+    stats.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, stats.count());
+    stats.add(-4.0f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.variance());
+    TEST_ASSERT_EQUAL_FLOAT(-4.0f, stats.min());
+    TEST_ASSERT_EQUAL_FLOAT(-4.0f, stats.max());
+}
+
+void test_p2_tracks_exact_percentiles(void) {
+    std::mt19937 rng(42);
+    std::normal_distribution<float> normal(-2500.0f, 400.0f);
+    std::exponential_distribution<float> spikes(1.0f / 3000.0f);
+    P2Quantile q50(0.50f), q95(0.95f), q99(0.99f);
+    std::vector<float> v;
+    for (int i = 0; i < 20000; i++) {
+        // Load current with occasional inrush spikes: a long upper tail
+        float x = normal(rng);
+        if (i % 20 == 0) x -= spikes(rng);
+        v.push_back(x);
+        q50.add(x);
+        q95.add(x);
+        q99.add(x);
+    }
+    const float spread = exactQuantile(v, 0.99f) - exactQuantile(v, 0.01f);
+    TEST_ASSERT_FLOAT_WITHIN(spread * 0.02f, exactQuantile(v, 0.50f), q50.value());
+    TEST_ASSERT_FLOAT_WITHIN(spread * 0.02f, exactQuantile(v, 0.95f), q95.value());
+    TEST_ASSERT_FLOAT_WITHIN(spread * 0.02f, exactQuantile(v, 0.99f), q99.value());
+}
+
+void test_p2_first_samples_are_exact(void) {
+    P2Quantile q(0.5f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, q.value());
+    q.add(3.0f);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, q.value());
+    q.add(1.0f);
+    q.add(2.0f);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, q.value());
+    q.add(5.0f);
+    q.add(4.0f);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, q.value());
+
+    // Sorted input is the worst case for marker movement
+    P2Quantile ramp(0.95f);
+    for (int i = 0; i <= 1000; i++) {
+        ramp.add((float)i);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(10.0f, 950.0f, ramp.value());
+}
+
+void test_window_rolls_over_and_publishes(void) {
+    SignalStats stats(1000);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.getSummary().count);
+
+    for (uint32_t t = 0; t < 1000; t += 10) {
+        stats.add((float)(t / 10), 5000 + t);
+    }
+    // Nothing published until a sample lands past the window
+    TEST_ASSERT_EQUAL_UINT32(0, stats.getSummary().count);
+    TEST_ASSERT_EQUAL_UINT32(100, stats.getCurrent().count);
+
+    stats.add(1000.0f, 6000);
+    SignalStats::Summary s = stats.getSummary();
+    TEST_ASSERT_EQUAL_UINT32(100, s.count);
+    TEST_ASSERT_EQUAL_UINT32(1000, s.window_ms);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 49.5f, s.mean);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, s.min);
+    TEST_ASSERT_EQUAL_FLOAT(99.0f, s.max);
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, 49.5f, s.p50);
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, 94.0f, s.p95);
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, 98.0f, s.p99);
+
+    // The new window started with the sample that closed the old one
+    TEST_ASSERT_EQUAL_UINT32(1, stats.getCurrent().count);
+    TEST_ASSERT_EQUAL_FLOAT(1000.0f, stats.getCurrent().mean);
+
+    // NaN readings are skipped
+    stats.add(NAN, 6010);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.getCurrent().count);
+
+    // Changing the window discards the partial one but keeps the last summary
+    stats.setWindow_ms(0);
+    TEST_ASSERT_EQUAL_UINT32(SignalStats::DEFAULT_WINDOW_MS, stats.getWindow_ms());
+    TEST_ASSERT_EQUAL_UINT32(0, stats.getCurrent().count);
+    TEST_ASSERT_EQUAL_UINT32(100, stats.getSummary().count);
+}
+
+void test_window_survives_millis_wrap(void) {
+    SignalStats stats(100);
+    stats.add(1.0f, 0xFFFFFFC0u);
+    stats.add(2.0f, 0xFFFFFFF0u);
+    stats.add(3.0f, 0x00000010u); // 80 ms later
+    TEST_ASSERT_EQUAL_UINT32(0, stats.getSummary().count);
+    stats.add(4.0f, 0x00000030u);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.getSummary().count);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, stats.getSummary().mean);
+}
+
+void test_benchmark_add(void) {
+    SignalStats stats;
+    const int samples = 2000000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; i++) {
+        stats.add(-1500.0f + (float)((uint32_t)i * 7919u % 401u), (uint32_t)i);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    char msg[128];
+    snprintf(msg, sizeof(msg), "host: add() %.1f ns per sample, %u bytes per signal (p99 %.0f)",
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / samples,
+             (unsigned)sizeof(SignalStats), stats.getSummary().p99);
+    TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_welford_matches_two_pass);
+    RUN_TEST(test_p2_tracks_exact_percentiles);
+    RUN_TEST(test_p2_first_samples_are_exact);
+    RUN_TEST(test_window_rolls_over_and_publishes);
+    RUN_TEST(test_window_survives_millis_wrap);
+    RUN_TEST(test_benchmark_add);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <unity.h>
+
+#include "transient_capture.h"
+
+// HACK: Include the source file directly to get around linker issues
+#include "../../src/transient_capture.cpp"
+
+static SensorSample makeSample(int64_t t_us, float current_mA) {
+    SensorSample s = {};
+    s.timestamp_us = t_us;
+    s.current_mA = current_mA;
+    s.busVoltage_V = 12.8f;
+    return s;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_alert_trigger_keeps_pre_and_post_window(void) {
+    static TransientCapture capture;
+    capture.rearm();
+
+    for (int i = 0; i < 1000; i++) {
+        capture.record(makeSample(i, 1000.0f));
+    }
+    capture.trigger(TransientCapture::TRIGGER_ALERT);
+    for (size_t i = 0; i < TransientCapture::POST_SAMPLES - 1; i++) {
+        capture.record(makeSample(1000 + i, -150000.0f));
+        TEST_ASSERT_FALSE(capture.isFrozen());
+    }
+    capture.record(makeSample(2000, 0.0f));
+
+    TEST_ASSERT_TRUE(capture.isFrozen());
+    TEST_ASSERT_EQUAL(TransientCapture::TRIGGER_ALERT, capture.getSource());
+    TEST_ASSERT_EQUAL(TransientCapture::CAPACITY, capture.size());
+    TEST_ASSERT_EQUAL(TransientCapture::PRE_SAMPLES, capture.getPreTriggerCount());
+    // Oldest kept pre-trigger sample, the trigger sample and the last one
+    TEST_ASSERT_EQUAL(1000 - TransientCapture::PRE_SAMPLES, capture.at(0).timestamp_us);
+    TEST_ASSERT_EQUAL(1000, capture.at(TransientCapture::PRE_SAMPLES).timestamp_us);
+    TEST_ASSERT_EQUAL(2000, capture.at(capture.size() - 1).timestamp_us);
+}
+
+void test_frozen_capture_is_not_overwritten(void) {
+    static TransientCapture capture;
+    capture.rearm();
+    capture.trigger(TransientCapture::TRIGGER_MANUAL);
+    for (size_t i = 0; i < TransientCapture::POST_SAMPLES; i++) {
+        capture.record(makeSample(i, 0.0f));
+    }
+    TEST_ASSERT_TRUE(capture.isFrozen());
+
+    capture.record(makeSample(99999, 0.0f));
+    capture.trigger(TransientCapture::TRIGGER_ALERT);
+    TEST_ASSERT_EQUAL(TransientCapture::TRIGGER_MANUAL, capture.getSource());
+    TEST_ASSERT_EQUAL(TransientCapture::POST_SAMPLES, capture.size());
+    TEST_ASSERT_EQUAL(0, capture.getPreTriggerCount());
+    TEST_ASSERT_EQUAL(TransientCapture::POST_SAMPLES - 1,
+                      capture.at(capture.size() - 1).timestamp_us);
+
+    capture.rearm();
+    TEST_ASSERT_EQUAL(TransientCapture::ARMED, capture.getState());
+    TEST_ASSERT_EQUAL(0, capture.size());
+}
+
+void test_software_threshold_trigger(void) {
+    static TransientCapture capture;
+    capture.rearm();
+    capture.setThreshold_mA(50000.0f);
+
+    for (int i = 0; i < 10; i++) {
+        capture.record(makeSample(i, -20000.0f));
+    }
+    TEST_ASSERT_EQUAL(TransientCapture::ARMED, capture.getState());
+
+    // Discharge counts too: the threshold applies to |current|
+    capture.record(makeSample(10, -60000.0f));
+    TEST_ASSERT_EQUAL(TransientCapture::TRIGGERED, capture.getState());
+    for (size_t i = 1; i < TransientCapture::POST_SAMPLES; i++) {
+        capture.record(makeSample(10 + i, -60000.0f));
+    }
+
+    TEST_ASSERT_TRUE(capture.isFrozen());
+    TEST_ASSERT_EQUAL(TransientCapture::TRIGGER_THRESHOLD, capture.getSource());
+    TEST_ASSERT_EQUAL(10, capture.getPreTriggerCount());
+    TEST_ASSERT_EQUAL(10, capture.at(10).timestamp_us);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_alert_trigger_keeps_pre_and_post_window);
+    RUN_TEST(test_frozen_capture_is_not_overwritten);
+    RUN_TEST(test_software_threshold_trigger);
+    UNITY_END();
+    return 0;
+}